@@ -136,6 +136,9 @@
 /* Define to 1 if you have the `sysctlbyname' function. */
 #define HAVE_SYSCTLBYNAME 1
 
+/* Define to 1 if you have the <sys/mman.h> header file. */
+#define HAVE_SYS_MMAN_H 1
+
 /* Define to 1 if you have the <sys/stat.h> header file. */
 #define HAVE_SYS_STAT_H 1
 
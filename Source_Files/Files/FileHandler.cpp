@@ -49,6 +49,10 @@
 #include <unistd.h>
 #endif
 
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
 #ifdef HAVE_ZZIP
 #include <zzip/lib.h>
 #include "SDL_rwops_zzip.h"
@@ -101,6 +105,7 @@ bool OpenedFile::Close()
 	is_forked = false;
 	fork_offset = 0;
 	fork_length = 0;
+	path.clear();
 	return true;
 }
 
@@ -169,6 +174,61 @@ SDL_RWops *OpenedFile::TakeRWops ()
 	return taken;
 }
 
+FileMapping::FileMapping() : base(NULL), base_length(0), data(NULL), length(0) {}
+
+bool FileMapping::Map(OpenedFile& OFile, int32 Position, int32 Length)
+{
+	Unmap();
+
+#ifdef HAVE_SYS_MMAN_H
+	if (OFile.path.empty() || Position < 0 || Length <= 0)
+		return false;
+	if (OFile.is_forked && Position + Length > OFile.fork_length)
+		return false;
+
+	// Map the file by name; files inside zip archives only exist behind the zzip
+	// SDL_RWops, so their names won't open here
+	int fd = open(OFile.path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	off_t start = off_t(Position) + OFile.fork_offset;
+	if (fstat(fd, &st) < 0 || start + Length > st.st_size) {
+		close(fd);
+		return false;
+	}
+
+	off_t page_size = sysconf(_SC_PAGESIZE);
+	off_t map_start = start - start % page_size;
+	size_t map_length = size_t(start - map_start) + Length;
+	void *p = mmap(NULL, map_length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, map_start);
+	close(fd);
+	if (p == MAP_FAILED)
+		return false;
+
+	base = p;
+	base_length = map_length;
+	data = (uint8 *) p + (start - map_start);
+	length = Length;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void FileMapping::Unmap()
+{
+#ifdef HAVE_SYS_MMAN_H
+	if (base)
+		munmap(base, base_length);
+#endif
+	base = NULL;
+	base_length = 0;
+	data = NULL;
+	length = 0;
+}
+
 opened_file_device::opened_file_device(OpenedFile& f) : f(f) { }
 
 std::streamsize opened_file_device::read(char* s, std::streamsize n)
@@ -384,6 +444,7 @@ bool FileSpecifier::Open(OpenedFile &OFile, bool Writable)
 	}
 	if (Writable)
 		return true;
+	OFile.path = GetPath();
 
 	// Transparently handle AppleSingle and MacBinary files on reading
 	int32 offset, data_length, rsrc_length;
@@ -85,6 +85,7 @@ class OpenedFile
 	// This class will need to set the refnum and error value appropriately 
 	friend class FileSpecifier;
 	friend class opened_file_device;
+	friend class FileMapping;
 	
 public:
 	bool IsOpen();
@@ -111,6 +112,38 @@ private:
 	int err;		// Error code
 	bool is_forked;
 	int32 fork_offset, fork_length;
+	string path;	// Set for files opened read-only, so they can be mapped
+};
+
+/*
+	Read-only view of part of an opened file, mapped into memory rather than read;
+	pages are copy-on-write, so the contents may be changed in place without touching
+	the file.  The mapping stays valid after the file is closed.  Map() fails where
+	mapping isn't available (no mmap(), files inside zip archives, files opened for
+	writing), and the caller should then fall back on OpenedFile::Read().
+*/
+class FileMapping
+{
+public:
+	// Position is relative to the data fork, as with OpenedFile::SetPosition()
+	bool Map(OpenedFile& OFile, int32 Position, int32 Length);
+	void Unmap();
+
+	bool IsMapped() {return data != NULL;}
+	uint8 *GetPointer() {return data;}
+	int32 GetLength() {return length;}
+
+	FileMapping();
+	~FileMapping() {Unmap();}	// Auto-unmap when destroying
+
+private:
+	FileMapping(const FileMapping&);
+	FileMapping& operator=(const FileMapping&);
+
+	void *base;			// Page-aligned start of the mapping
+	size_t base_length;
+	uint8 *data;
+	int32 length;
 };
 
 class opened_file_device {
@@ -111,6 +111,8 @@ static short get_entry_header_length(struct wad_header *header);
 static bool read_indexed_directory_data(OpenedFile& OFile, struct wad_header *header,
 	short index, struct directory_entry *entry);
 static int32 calculate_raw_wad_length(struct wad_header *file_header, uint8 *wad);
+static struct wad_data *read_indexed_wad_from_mapping(OpenedFile& OFile,
+	struct wad_header *header, short index, bool read_only);
 static bool read_indexed_wad_from_file_into_buffer(OpenedFile& OFile, 
 	struct wad_header *header, short index, void *buffer, int32 *length);
 static short count_raw_tags(uint8 *raw_wad);
@@ -167,8 +169,10 @@ bool read_wad_header(
 
 extern void *level_transition_malloc(size_t size);
 
-/* This could be improved.  Under the current implementation, it requires 2X sizeof level worth */
-/*  of memory to load... (This makes writing wads easier, but isn't really useful for loading */
+/* Where the file can be memory-mapped, read-only wads point straight into the mapping and */
+/*  modifiable ones are copied out of it, so nothing is read into an intermediate buffer. */
+/* Otherwise, this requires 2X sizeof level worth of memory to load... (This makes writing */
+/*  wads easier, but isn't really useful for loading */
 /* Note that this does the correct thing for union wadfiles... */
 struct wad_data *read_indexed_wad_from_file(
 	OpenedFile& OFile, 
@@ -181,6 +185,9 @@ struct wad_data *read_indexed_wad_from_file(
      int32 length = 0;
 	int error = 0;
 
+	read_wad= read_indexed_wad_from_mapping(OFile, header, index, read_only);
+	if(read_wad) return read_wad;
+
 	// if(file_id>=0) /* NOT a union wadfile... */
 	{
 		if (size_of_indexed_wad(OFile, header, index, &length))
@@ -748,7 +755,12 @@ void free_wad(
 	assert(wad);
 	
 	/* Free all of the tags */
-	if(wad->read_only_data)
+	if(wad->mapping)
+	{
+		/* Read only wad, in a mapped file.. */
+		delete wad->mapping;
+		free(wad->tag_data);
+	} else if(wad->read_only_data)
 	{
 		/* Read only wad.. */
 		free(wad->read_only_data);
@@ -1128,6 +1140,48 @@ static bool read_indexed_directory_data(
 }
 
 /* Internal function.. */
+/* Returns NULL if the wad can't be mapped, and the caller should read it instead */
+static struct wad_data *read_indexed_wad_from_mapping(
+	OpenedFile& OFile,
+	struct wad_header *header,
+	short index,
+	bool read_only)
+{
+	struct directory_entry entry;
+	struct wad_data *wad= NULL;
+
+	if (!read_indexed_directory_data(OFile, header, index, &entry) || entry.length <= 0)
+		return NULL;
+
+	/* Map the same padding past the end that read_indexed_wad_from_file() allocates */
+	int32 padding= SIZEOF_entry_header-SIZEOF_old_entry_header;
+	FileMapping *mapping= new FileMapping;
+	if (!mapping->Map(OFile, entry.offset_to_start, entry.length + padding))
+	{
+		delete mapping;
+		return NULL;
+	}
+
+	uint8 *raw_wad= mapping->GetPointer();
+	/* Veracity Check */
+	assert(entry.length==calculate_raw_wad_length(header, raw_wad));
+
+	if(read_only)
+	{
+		wad= convert_wad_from_raw(header, raw_wad, 0, entry.length);
+		if(wad && wad->read_only_data)
+		{
+			wad->mapping= mapping;
+			return wad;
+		}
+	} else {
+		wad= convert_wad_from_raw_modifiable(header, raw_wad, entry.length);
+	}
+
+	delete mapping;
+	return wad;
+}
+
 static bool read_indexed_wad_from_file_into_buffer(
 	OpenedFile& OFile, 
 	struct wad_header *header, 
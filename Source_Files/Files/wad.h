@@ -118,12 +118,15 @@ struct tag_data {
 	int32 offset;			/* Offset for patches */
 };
 
+class FileMapping;
+
 /* This is what a wad * actually is.. */
 struct wad_data {
 	short tag_count;			/* Tag count */
 	short padding;
 	byte *read_only_data;		/* If this is non NULL, we are read only.... */
 	struct tag_data *tag_data;	/* Tag data array */
+	FileMapping *mapping;		/* If non NULL, read_only_data points into this instead of being malloc'ed */
 };
 
 /* ----- miscellaneous functions */
@@ -32,6 +32,11 @@ Jan 30, 2000 (Loren Petrich):
 
 Feb. 4, 2000 (Loren Petrich):
 	Changed halt() to assert(false) for better debugging
+
+	_best_first now keeps its unexpanded nodes in an indexed binary heap ordered by
+	(cost, node index) instead of scanning the whole node list, which picks exactly the
+	same node the scan did; visited_polygons is reset through the node list instead of
+	being cleared for every polygon in the map.
 */
 
 /*
@@ -58,7 +63,7 @@ on very small maps, choose_random_flood_node() may not terminate
 #define NODE_IS_UNEXPANDED(n) (!NODE_IS_EXPANDED(n))
 #define MARK_NODE_AS_EXPANDED(n) ((n)->flags|=(uint16)0x8000)
 
-struct node_data /* 16 bytes */
+struct node_data /* 24 bytes */
 {
 	uint16 flags;
 	
@@ -69,6 +74,8 @@ struct node_data /* 16 bytes */
 	int16 depth;
 
 	int32 user_flags;
+
+	int16 frontier_index; /* position in the best-first frontier heap, or NONE */
 };
 
 /* ---------- globals */
@@ -77,10 +84,22 @@ static short node_count= 0, last_node_index_expanded= NONE;
 static struct node_data *nodes = NULL;
 static short *visited_polygons = NULL;
 
+/* binary min-heap of unexpanded node indexes, only maintained for _best_first */
+static bool frontier_active= false;
+static short frontier_count= 0;
+static short *frontier = NULL;
+
 /* ---------- private prototypes */
 
 static void add_node(short parent_node_index, short polygon_index, short depth, int32 cost, int32 user_flags);
 
+static bool frontier_node_precedes(short node_index, short other_node_index);
+static void frontier_place(short frontier_index, short node_index);
+static void frontier_sift_up(short frontier_index);
+static void frontier_sift_down(short frontier_index);
+static void frontier_insert(short node_index);
+static short frontier_remove_lowest(void);
+
 /* ---------- code */
 
 void allocate_flood_map_memory(
@@ -91,7 +110,15 @@ void allocate_flood_map_memory(
 	nodes= new node_data[MAXIMUM_FLOOD_NODES];
 	if (visited_polygons) delete []visited_polygons;
 	visited_polygons= new short[MAXIMUM_POLYGONS_PER_MAP];
-	assert(nodes&&visited_polygons);
+	if (frontier) delete []frontier;
+	frontier= new short[MAXIMUM_FLOOD_NODES];
+	assert(nodes&&visited_polygons&&frontier);
+
+	/* every polygon starts out unvisited; after this, flood_map() only resets the polygons
+		its previous flood actually touched */
+	objlist_set(visited_polygons, UNVISITED, MAXIMUM_POLYGONS_PER_MAP);
+	node_count= 0, last_node_index_expanded= NONE;
+	frontier_count= 0, frontier_active= false;
 }
 
 /* returns next polygon index or NONE if there are no more polygons left cheaper than maximum_cost */
@@ -110,26 +137,30 @@ short flood_map(
 	/* initialize ourselves if first_polygon_index!=NONE */
 	if (first_polygon_index!=NONE)
 	{
-		/* clear the visited polygon array */
-		objlist_set(visited_polygons, NONE, MAXIMUM_POLYGONS_PER_MAP);
+		/* clear the visited polygon array (only the polygons we have nodes for can be set) */
+		for (node= nodes, node_index= 0; node_index<node_count; ++node_index, ++node)
+		{
+			visited_polygons[node->polygon_index]= UNVISITED;
+		}
 		
 		node_count= 0;
 		last_node_index_expanded= NONE;
+		frontier_count= 0;
+		frontier_active= (flood_mode==_best_first);
 		add_node(NONE, first_polygon_index, 0, 0, (flood_mode==_flagged_breadth_first) ? *((int32*)caller_data) : 0);
 	}
 	
 	switch (flood_mode)
 	{
 		case _best_first:
-			/* find the unexpanded node with the lowest cost */
+			/* find the unexpanded node with the lowest cost; the frontier is ordered by
+				(cost, node index) so ties go to the earliest node, as a linear scan would */
+			assert(frontier_active);
 			lowest_cost= maximum_cost, lowest_cost_node_index= NONE;
-			for (node= nodes, node_index= 0; node_index<node_count; ++node_index, ++node)
+			if (frontier_count>0 && nodes[frontier[0]].cost<maximum_cost)
 			{
-				if (NODE_IS_UNEXPANDED(node)&&node->cost<lowest_cost)
-				{
-					lowest_cost_node_index= node_index;
-					lowest_cost= node->cost;
-				}
+				lowest_cost_node_index= frontier_remove_lowest();
+				lowest_cost= nodes[lowest_cost_node_index].cost;
 			}
 			break;
 		
@@ -314,10 +345,13 @@ static void add_node(
 		{
 			node_index= node_count;
 			node= nodes + node_index;
+			node->frontier_index= NONE;
 		}
 		
 		if (node)
 		{
+			bool cost_lowered= node_index!=node_count;
+			
 			if (node_index==node_count)
 			{
 				node_count+= 1;
@@ -333,7 +367,103 @@ static void add_node(
 			assert(polygon_index>=0&&polygon_index<dynamic_world->polygon_count);
 			visited_polygons[polygon_index]= node_index;
 			
+			if (frontier_active)
+			{
+				/* a replaced node is still unexpanded (and so still in the frontier), but
+					is now cheaper */
+				if (cost_lowered)
+				{
+					assert(node->frontier_index!=NONE);
+					frontier_sift_up(node->frontier_index);
+				}
+				else
+				{
+					frontier_insert(node_index);
+				}
+			}
+			
 //			dprintf("added polygon #%d to node #%d (nodes=%p,visited=%p)", polygon_index, node_index, nodes, visited_polygons);
 		}
 	}
 }
+
+/* the frontier is a binary min-heap of node indexes keyed on (cost, node index); the node
+	index breaks ties so that we expand nodes in the same order the old linear scan did */
+static bool frontier_node_precedes(
+	short node_index,
+	short other_node_index)
+{
+	int32 cost= nodes[node_index].cost, other_cost= nodes[other_node_index].cost;
+	
+	return cost<other_cost || (cost==other_cost && node_index<other_node_index);
+}
+
+static void frontier_place(
+	short frontier_index,
+	short node_index)
+{
+	frontier[frontier_index]= node_index;
+	nodes[node_index].frontier_index= frontier_index;
+}
+
+static void frontier_sift_up(
+	short frontier_index)
+{
+	short node_index= frontier[frontier_index];
+	
+	while (frontier_index>0)
+	{
+		short parent_index= (frontier_index-1)>>1;
+		
+		if (!frontier_node_precedes(node_index, frontier[parent_index])) break;
+		frontier_place(frontier_index, frontier[parent_index]);
+		frontier_index= parent_index;
+	}
+	frontier_place(frontier_index, node_index);
+}
+
+static void frontier_sift_down(
+	short frontier_index)
+{
+	short node_index= frontier[frontier_index];
+	
+	for (;;)
+	{
+		short child_index= 2*frontier_index+1;
+		
+		if (child_index>=frontier_count) break;
+		if (child_index+1<frontier_count && frontier_node_precedes(frontier[child_index+1], frontier[child_index])) child_index+= 1;
+		if (!frontier_node_precedes(frontier[child_index], node_index)) break;
+		frontier_place(frontier_index, frontier[child_index]);
+		frontier_index= child_index;
+	}
+	frontier_place(frontier_index, node_index);
+}
+
+static void frontier_insert(
+	short node_index)
+{
+	assert(frontier_count<MAXIMUM_FLOOD_NODES);
+	frontier_place(frontier_count, node_index);
+	frontier_count+= 1;
+	frontier_sift_up(frontier_count-1);
+}
+
+static short frontier_remove_lowest(
+	void)
+{
+	short node_index;
+	
+	assert(frontier_count>0);
+	node_index= frontier[0];
+	nodes[node_index].frontier_index= NONE;
+	
+	frontier_count-= 1;
+	if (frontier_count>0)
+	{
+		frontier_place(0, frontier[frontier_count]);
+		frontier_sift_down(0);
+	}
+	
+	return node_index;
+}
@@ -114,6 +114,7 @@ find_line_crossed leaving polygon could be sped up considerable by reversing the
 #include "lua_script.h"
 #include "media.h"
 #include "scenery.h"
+#include "render.h"
 #include "SoundManager.h"
 #include "Console.h"
 #include "InfoTree.h"
@@ -233,6 +234,13 @@ struct map_memory_data {
 // LP addition: growable list of intersected objects
 static vector<short> IntersectedObjects;
 
+/* get_polygon_first_obstacle() and get_next_obstacle(): a polygon's list is good while its
+	generation is the current one */
+static vector<uint32> PolygonObstacleGenerations;
+static vector<int16> PolygonFirstObstacles;
+static vector<int16> NextObstacles;
+static uint32 polygon_obstacle_generation= 1;
+
 // Whether or not Marathon 2/oo landscapes had been loaded (switch off for Marathon 1 compatibility)
 bool LandscapesLoaded = true;
 
@@ -413,6 +421,10 @@ void initialize_map_for_new_level(
 	obj_clear(*static_world);
 	Console::instance()->clear_saves();
 	
+	invalidate_line_of_sight_cache();
+	reset_line_of_sight_cache_counts();
+	invalidate_all_polygon_obstacles();
+	
 	// Clear all these out -- supposed to be none of the contents of these when starting a level.
 	objlist_clear(automap_lines, AutomapLineList.size());
 	objlist_clear(automap_polygons, AutomapPolygonList.size());
@@ -634,6 +646,8 @@ void reconnect_map_object_list(
 	struct object_data *object;
 	struct polygon_data *polygon;
 
+	invalidate_all_polygon_obstacles();
+
 	/* wipe first_object links from polygon structures */
 	for (polygon=map_polygons,i=0;i<dynamic_world->polygon_count;--i,++polygon)
 	{
@@ -736,6 +750,7 @@ short new_map_object3d(
 		/* insert at head of linked list */
 		object->next_object= polygon->first_object;
 		polygon->first_object= object_index;
+		invalidate_polygon_obstacles(polygon_index);
 	}
 	
 	return object_index;
@@ -827,6 +842,7 @@ void remove_map_object(
 	L_Invalidate_Object(object_index);
 	*next_object= object->next_object;
 	MARK_SLOT_AS_FREE(object);
+	invalidate_polygon_obstacles(object->polygon);
 }
 
 
@@ -851,6 +867,7 @@ remove_object_from_polygon_object_list(short object_index, short polygon_index)
 	*next_object= object->next_object;
 
 	object->polygon= NONE;
+	invalidate_polygon_obstacles(polygon_index);
 }
 
 void
@@ -872,6 +889,7 @@ add_object_to_polygon_object_list(short object_index, short polygon_index)
 	polygon->first_object= object_index;
 
 	object->polygon= polygon_index;
+	invalidate_polygon_obstacles(polygon_index);
 }
 
 typedef std::pair<short, short>	DeferredObjectListInsertion;
@@ -913,6 +931,7 @@ perform_deferred_polygon_object_list_manipulations()
 					object->next_object = *next_object_index_p;
 					*next_object_index_p = object_to_insert_index;
 					inserted = true;
+					invalidate_polygon_obstacles(object->polygon);
 				}
 
 				if(*next_object_index_p == NONE)
@@ -947,6 +966,77 @@ perform_deferred_polygon_object_list_manipulations()
 } // perform_deferred_polygon_object_list_manipulations
 
 
+/* new objects get their owners after they're on a list, so those without one yet stay in */
+static bool object_may_be_obstacle(
+	struct object_data *object)
+{
+	switch (GET_OBJECT_OWNER(object))
+	{
+		case _object_is_normal:
+		case _object_is_scenery:
+		case _object_is_monster:
+			return true;
+	}
+	
+	return false;
+}
+
+short get_polygon_first_obstacle(
+	short polygon_index)
+{
+	if (PolygonObstacleGenerations.size()<PolygonList.size())
+	{
+		PolygonObstacleGenerations.resize(PolygonList.size(), 0);
+		PolygonFirstObstacles.resize(PolygonList.size(), NONE);
+	}
+	if (NextObstacles.size()<ObjectList.size()) NextObstacles.resize(ObjectList.size(), NONE);
+	
+	if (PolygonObstacleGenerations[polygon_index]!=polygon_obstacle_generation)
+	{
+		int16 *next_obstacle= &PolygonFirstObstacles[polygon_index];
+		short object_index;
+		
+		for (object_index= get_polygon_data(polygon_index)->first_object; object_index!=NONE; object_index= get_object_data(object_index)->next_object)
+		{
+			if (object_may_be_obstacle(get_object_data(object_index)))
+			{
+				*next_obstacle= object_index;
+				next_obstacle= &NextObstacles[object_index];
+			}
+		}
+		*next_obstacle= NONE;
+		
+		PolygonObstacleGenerations[polygon_index]= polygon_obstacle_generation;
+	}
+	
+	return PolygonFirstObstacles[polygon_index];
+}
+
+short get_next_obstacle(
+	short object_index)
+{
+	return NextObstacles[object_index];
+}
+
+void invalidate_polygon_obstacles(
+	short polygon_index)
+{
+	if (polygon_index>=0 && static_cast<size_t>(polygon_index)<PolygonObstacleGenerations.size())
+		PolygonObstacleGenerations[polygon_index]= 0;
+}
+
+void invalidate_all_polygon_obstacles(
+	void)
+{
+	if (++polygon_obstacle_generation==0)
+	{
+		/* wrapped around; nothing may claim to be from the new generation */
+		std::fill(PolygonObstacleGenerations.begin(), PolygonObstacleGenerations.end(), 0);
+		polygon_obstacle_generation= 1;
+	}
+}
+
+
 
 /* if a new polygon index is supplied, it will be used, otherwise well try to find the new
 	polygon index ourselves */
@@ -2088,6 +2178,7 @@ bool change_polygon_height(
 		/* slam the polygon heights, directly */
 		polygon->floor_height= new_floor_height;
 		polygon->ceiling_height= new_ceiling_height;
+		invalidate_render_tree_cache(polygon_index);
 		
 		/* the highest_adjacent_floor, lowest_adjacent_ceiling and supporting_polygon_index fields
 			of all of this polygons endpoints and lines are potentially invalid now.  to assure
@@ -2161,11 +2252,164 @@ bool point_is_monster_visible(
 	return *distance!=INT32_MAX;
 }
 
+/* what line_is_obstructed() and clear_line_of_sight() found for recent pairs of points; the
+	walks depend only on the points, their polygons and which lines are solid or transparent,
+	so an answer stays good until invalidate_line_of_sight_cache() */
+#define LINE_OF_SIGHT_CACHE_SIZE 4096
+
+struct line_of_sight_cache_entry
+{
+	uint32 generation; /* only entries from the current generation are any good */
+	int16 query;
+	short polygon_index1, polygon_index2;
+	world_point2d p1, p2;
+	bool blocked;
+};
+
+static line_of_sight_cache_entry line_of_sight_cache[LINE_OF_SIGHT_CACHE_SIZE];
+static uint32 line_of_sight_cache_generation= 1;
+static uint32 line_of_sight_cache_hits= 0;
+static uint32 line_of_sight_cache_misses= 0;
+
+static line_of_sight_cache_entry *get_line_of_sight_cache_entry(
+	int16 query,
+	short polygon_index1,
+	world_point2d *p1,
+	short polygon_index2,
+	world_point2d *p2)
+{
+	uint32 hash= static_cast<uint16>(query);
+	hash= hash*31 + static_cast<uint16>(polygon_index1);
+	hash= hash*31 + static_cast<uint16>(p1->x);
+	hash= hash*31 + static_cast<uint16>(p1->y);
+	hash= hash*31 + static_cast<uint16>(polygon_index2);
+	hash= hash*31 + static_cast<uint16>(p2->x);
+	hash= hash*31 + static_cast<uint16>(p2->y);
+	hash^= hash>>15;
+	
+	return &line_of_sight_cache[hash&(LINE_OF_SIGHT_CACHE_SIZE-1)];
+}
+
+void invalidate_line_of_sight_cache(
+	void)
+{
+	if (++line_of_sight_cache_generation==0)
+	{
+		/* wrapped around; nothing may claim to be from the new generation */
+		obj_clear(line_of_sight_cache);
+		line_of_sight_cache_generation= 1;
+	}
+}
+
+void reset_line_of_sight_cache_counts(
+	void)
+{
+	line_of_sight_cache_hits= line_of_sight_cache_misses= 0;
+}
+
+void get_line_of_sight_cache_counts(
+	uint32 *hits,
+	uint32 *misses)
+{
+	*hits= line_of_sight_cache_hits;
+	*misses= line_of_sight_cache_misses;
+}
+
+static bool find_line_of_sight_in_cache(
+	int16 query,
+	short polygon_index1,
+	world_point2d *p1,
+	short polygon_index2,
+	world_point2d *p2,
+	bool *blocked)
+{
+	line_of_sight_cache_entry *entry= get_line_of_sight_cache_entry(query, polygon_index1, p1, polygon_index2, p2);
+	
+	if (entry->generation==line_of_sight_cache_generation && entry->query==query &&
+		entry->polygon_index1==polygon_index1 && entry->p1.x==p1->x && entry->p1.y==p1->y &&
+		entry->polygon_index2==polygon_index2 && entry->p2.x==p2->x && entry->p2.y==p2->y)
+	{
+		*blocked= entry->blocked;
+		++line_of_sight_cache_hits;
+		return true;
+	}
+	
+	++line_of_sight_cache_misses;
+	return false;
+}
+
+bool line_of_sight_is_cached(
+	int16 query,
+	short polygon_index1,
+	world_point2d *p1,
+	short polygon_index2,
+	world_point2d *p2)
+{
+	line_of_sight_cache_entry *entry= get_line_of_sight_cache_entry(query, polygon_index1, p1, polygon_index2, p2);
+	
+	return entry->generation==line_of_sight_cache_generation && entry->query==query &&
+		entry->polygon_index1==polygon_index1 && entry->p1.x==p1->x && entry->p1.y==p1->y &&
+		entry->polygon_index2==polygon_index2 && entry->p2.x==p2->x && entry->p2.y==p2->y;
+}
+
+void add_line_of_sight_to_cache(
+	int16 query,
+	short polygon_index1,
+	world_point2d *p1,
+	short polygon_index2,
+	world_point2d *p2,
+	bool blocked)
+{
+	line_of_sight_cache_entry *entry= get_line_of_sight_cache_entry(query, polygon_index1, p1, polygon_index2, p2);
+	
+	entry->generation= line_of_sight_cache_generation;
+	entry->query= query;
+	entry->polygon_index1= polygon_index1;
+	entry->p1= *p1;
+	entry->polygon_index2= polygon_index2;
+	entry->p2= *p2;
+	entry->blocked= blocked;
+}
+
 bool line_is_obstructed(
 	short polygon_index1,
 	world_point2d *p1,
 	short polygon_index2,
 	world_point2d *p2)
+{
+	bool obstructed;
+	
+	if (!find_line_of_sight_in_cache(_line_is_obstructed_query, polygon_index1, p1, polygon_index2, p2, &obstructed))
+	{
+		obstructed= walk_line_is_obstructed(polygon_index1, p1, polygon_index2, p2);
+		add_line_of_sight_to_cache(_line_is_obstructed_query, polygon_index1, p1, polygon_index2, p2, obstructed);
+	}
+	
+	return obstructed;
+}
+
+bool line_of_sight_is_blocked(
+	short polygon_index1,
+	world_point2d *p1,
+	short polygon_index2,
+	world_point2d *p2)
+{
+	bool blocked;
+	
+	if (!find_line_of_sight_in_cache(_clear_line_of_sight_query, polygon_index1, p1, polygon_index2, p2, &blocked))
+	{
+		blocked= walk_line_of_sight(polygon_index1, p1, polygon_index2, p2);
+		add_line_of_sight_to_cache(_clear_line_of_sight_query, polygon_index1, p1, polygon_index2, p2, blocked);
+	}
+	
+	return blocked;
+}
+
+bool walk_line_is_obstructed(
+	short polygon_index1,
+	world_point2d *p1,
+	short polygon_index2,
+	world_point2d *p2)
 {
 	short polygon_index= polygon_index1;
 	bool obstructed= false;
@@ -2237,6 +2481,48 @@ bool line_is_obstructed(
 	return obstructed;
 }
 
+/* clear_line_of_sight()'s walk, which (unlike line_is_obstructed()) only sees through
+	transparent lines, and needs to end up in exactly the target's polygon */
+bool walk_line_of_sight(
+	short polygon_index1,
+	world_point2d *p1,
+	short polygon_index2,
+	world_point2d *p2)
+{
+	short polygon_index= polygon_index1;
+	bool target_visible= true;
+	short line_index;
+	
+	do
+	{
+		line_index= find_line_crossed_leaving_polygon(polygon_index, p1, p2);
+		if (line_index!=NONE)
+		{
+			if (LINE_IS_TRANSPARENT(get_line_data(line_index)))
+			{
+				/* transparent line, find adjacent polygon */
+				polygon_index= find_adjacent_polygon(polygon_index, line_index);
+				// LP change: make no polygon act like a non-transparent line
+				if (polygon_index == NONE) target_visible= false;
+			}
+			else
+			{
+				/* non-transparent line, target not visible */
+				target_visible= false;
+			}
+		}
+		else
+		{
+			/* we got to the targets (x,y) location, but were in a different polygon;
+				hes invisible */
+			if (polygon_index!=polygon_index2) target_visible= false;
+		}
+	}
+	while (target_visible&&line_index!=NONE);
+	
+	return !target_visible;
+}
+
 #define MAXIMUM_GARBAGE_OBJECTS_PER_MAP 256
 #define MAXIMUM_GARBAGE_OBJECTS_PER_POLYGON 10
 
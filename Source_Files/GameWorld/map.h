@@ -1099,6 +1099,27 @@ std::pair<bool, int16> update_world(void);
 void reset_intermediate_action_queues();
 void set_prediction_wanted(bool inPrediction);
 
+// Per-subsystem timing of update_world(), used by the replay benchmark
+enum {
+	_world_profile_lua,
+	_world_profile_lights,
+	_world_profile_media,
+	_world_profile_platforms,
+	_world_profile_players,
+	_world_profile_projectiles,
+	_world_profile_monsters,
+	_world_profile_effects,
+	_world_profile_other,
+	_world_profile_hash, // the running world hash netgames check; the benchmark times it too
+	NUMBER_OF_WORLD_PROFILE_STAGES
+};
+
+// turning profiling on clears the accumulated times
+void set_world_profiling(bool enabled);
+int32 get_world_profile_tick_count(void);
+double get_world_profile_seconds(short stage);
+const char *get_world_profile_stage_name(short stage);
+
 /* Called to activate lights, platforms, etc. (original polygon may be NONE) */
 void changed_polygon(short original_polygon_index, short new_polygon_index, short player_index);
 
@@ -1146,6 +1167,15 @@ extern void deferred_add_object_to_polygon_object_list(short object_index, short
 // deferred_add_object_to_polygon_object_list() was called!
 extern void perform_deferred_polygon_object_list_manipulations();
 
+// the objects on a polygon's list which might be in the way (monsters, scenery, and new objects
+// not given an owner yet), in list order, so walking them finds what walking the whole list would.
+// each polygon's is rebuilt on demand after anything changes its list; whatever changes a list
+// without going through the functions above has to invalidate it.
+short get_polygon_first_obstacle(short polygon_index);
+short get_next_obstacle(short object_index);
+void invalidate_polygon_obstacles(short polygon_index);
+void invalidate_all_polygon_obstacles(void);
+
 
 
 struct shape_and_transfer_mode
@@ -1219,6 +1249,31 @@ bool change_polygon_height(short polygon_index, world_distance new_floor_height,
 	world_distance new_ceiling_height, struct damage_definition *damage);
 
 bool line_is_obstructed(short polygon_index1, world_point2d *p1, short polygon_index2, world_point2d *p2);
+/* for clear_line_of_sight() in monsters.cpp */
+bool line_of_sight_is_blocked(short polygon_index1, world_point2d *p1, short polygon_index2, world_point2d *p2);
+
+/* the walks behind the two above, without the cache; they only read the map, so they're
+	safe to call from other threads while the world stands still */
+bool walk_line_is_obstructed(short polygon_index1, world_point2d *p1, short polygon_index2, world_point2d *p2);
+bool walk_line_of_sight(short polygon_index1, world_point2d *p1, short polygon_index2, world_point2d *p2);
+
+/* line_is_obstructed() and line_of_sight_is_blocked() remember their answers for exact pairs
+	of points; anything that changes which lines are solid or transparent has to forget them */
+enum /* line of sight queries */
+{
+	_line_is_obstructed_query,
+	_clear_line_of_sight_query
+};
+
+bool line_of_sight_is_cached(int16 query, short polygon_index1, world_point2d *p1,
+	short polygon_index2, world_point2d *p2);
+void add_line_of_sight_to_cache(int16 query, short polygon_index1, world_point2d *p1,
+	short polygon_index2, world_point2d *p2, bool blocked);
+void invalidate_line_of_sight_cache(void);
+
+/* how many answers came from the cache and how many had to be worked out, since the level started */
+void reset_line_of_sight_cache_counts(void);
+void get_line_of_sight_cache_counts(uint32 *hits, uint32 *misses);
 bool point_is_player_visible(short max_players, short polygon_index, world_point2d *p, int32 *distance);
 bool point_is_monster_visible(short polygon_index, world_point2d *p, int32 *distance);
 
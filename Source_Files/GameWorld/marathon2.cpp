@@ -77,6 +77,8 @@ Feb 8, 2003 (Woody Zenfell):
 #include "cseries.h"
 #include "map.h"
 #include "render.h"
+#include "RenderPVS.h"
+#include "monster_think.h"
 #include "interface.h"
 #include "FilmProfile.h"
 #include "flood_map.h"
@@ -120,11 +122,15 @@ Feb 8, 2003 (Woody Zenfell):
 #include "Statistics.h"
 
 #include "motion_sensor.h"
+#include "world_hash.h"
 
 #include <limits.h>
 
 /* ---------- constants */
 
+// how often (in ticks) a netgame reports its running world hash for desync checking
+#define WORLD_HASH_REPORT_PERIOD TICKS_PER_SECOND
+
 /* ---------- globals */
 
 // This is an intermediate action-flags queue for transferring action flags
@@ -158,7 +164,6 @@ void initialize_marathon(
 	// allocate_render_memory();
 	allocate_pathfinding_memory();
 	// allocate_flood_map_memory();
-	allocate_texture_tables();
 	initialize_weapon_manager();
 	initialize_game_window();
 	initialize_scenery();
@@ -377,6 +382,69 @@ overlay_queue_with_queue_into_queue(ActionQueues* inBaseQueues, ActionQueues* in
 }
 
 
+// Per-subsystem timing for the replay benchmark; when it's off, the only cost is a test
+// of sWorldProfiling per stage
+static bool sWorldProfiling = false;
+static int32 sWorldProfileTickCount = 0;
+static Uint64 sWorldProfileCounts[NUMBER_OF_WORLD_PROFILE_STAGES];
+
+static const char *sWorldProfileStageNames[NUMBER_OF_WORLD_PROFILE_STAGES] =
+{
+	"lua",
+	"lights",
+	"media",
+	"platforms",
+	"players",
+	"projectiles",
+	"monsters",
+	"effects",
+	"other",
+	"world hash"
+};
+
+void
+set_world_profiling(bool enabled)
+{
+	sWorldProfiling = enabled;
+	if (enabled)
+	{
+		sWorldProfileTickCount = 0;
+		objlist_clear(sWorldProfileCounts, NUMBER_OF_WORLD_PROFILE_STAGES);
+	}
+}
+
+int32
+get_world_profile_tick_count()
+{
+	return sWorldProfileTickCount;
+}
+
+double
+get_world_profile_seconds(short stage)
+{
+	assert(stage >= 0 && stage < NUMBER_OF_WORLD_PROFILE_STAGES);
+	return static_cast<double>(sWorldProfileCounts[stage]) / SDL_GetPerformanceFrequency();
+}
+
+const char *
+get_world_profile_stage_name(short stage)
+{
+	assert(stage >= 0 && stage < NUMBER_OF_WORLD_PROFILE_STAGES);
+	return sWorldProfileStageNames[stage];
+}
+
+// charges the time since inMark to inStage, and moves inMark up to now
+static inline void
+end_world_profile_stage(short inStage, Uint64& inMark)
+{
+	if (sWorldProfiling)
+	{
+		Uint64 theNow = SDL_GetPerformanceCounter();
+		sWorldProfileCounts[inStage] += theNow - inMark;
+		inMark = theNow;
+	}
+}
+
 // Return values for update_world_elements_one_tick()
 enum {
         kUpdateNormalCompletion,
@@ -388,23 +456,34 @@ enum {
 static int
 update_world_elements_one_tick()
 {
+	Uint64 theProfileMark = sWorldProfiling ? SDL_GetPerformanceCounter() : 0;
+
 	if (m1_solo_player_in_terminal()) 
 	{
 		update_m1_solo_player_in_terminal(GameQueue);
+		end_world_profile_stage(_world_profile_players, theProfileMark);
 	} 
 	else
 	{
 		L_Call_Idle();
+		end_world_profile_stage(_world_profile_lua, theProfileMark);
 		
 		update_lights();
+		end_world_profile_stage(_world_profile_lights, theProfileMark);
 		update_medias();
+		end_world_profile_stage(_world_profile_media, theProfileMark);
 		update_platforms();
+		end_world_profile_stage(_world_profile_platforms, theProfileMark);
 		
 		update_control_panels(); // don't put after update_players
 		update_players(GameQueue, false);
+		end_world_profile_stage(_world_profile_players, theProfileMark);
 		move_projectiles();
+		end_world_profile_stage(_world_profile_projectiles, theProfileMark);
 		move_monsters();
+		end_world_profile_stage(_world_profile_monsters, theProfileMark);
 		update_effects();
+		end_world_profile_stage(_world_profile_effects, theProfileMark);
 		recreate_objects();
 		
 		handle_random_sound_image();
@@ -424,8 +503,12 @@ update_world_elements_one_tick()
 #if !defined(DISABLE_NETWORKING)
 		update_net_game();
 #endif // !defined(DISABLE_NETWORKING)
+		end_world_profile_stage(_world_profile_other, theProfileMark);
 	}
 
+	if (sWorldProfiling)
+		sWorldProfileTickCount++;
+
         if(check_level_change()) 
         {
                 return kUpdateChangeLevel;
@@ -499,10 +582,24 @@ update_world()
 
 		theUpdateResult = update_world_elements_one_tick();
 
+#if !defined(DISABLE_NETWORKING)
+                // the benchmark hashes too (it only reads the world), so it can report what this costs
+                if((game_is_networked || sWorldProfiling) && theUpdateResult == kUpdateNormalCompletion)
+                {
+                        Uint64 theHashMark = sWorldProfiling ? SDL_GetPerformanceCounter() : 0;
+                        uint32 theWorldHash = update_world_tick_hash();
+                        end_world_profile_stage(_world_profile_hash, theHashMark);
+                        if(game_is_networked && dynamic_world->tick_count % WORLD_HASH_REPORT_PERIOD == 0)
+                                NetReportWorldHash(dynamic_world->tick_count, theWorldHash);
+                }
+#endif // !defined(DISABLE_NETWORKING)
+
                 theElapsedTime++;
 
                 
+                Uint64 theProfileMark = sWorldProfiling ? SDL_GetPerformanceCounter() : 0;
                 L_Call_PostIdle();
+                end_world_profile_stage(_world_profile_lua, theProfileMark);
                 if(theUpdateResult != kUpdateNormalCompletion || Movie::instance()->IsRecording())
                 {
                         canUpdate = false;
@@ -573,6 +670,15 @@ update_world()
 void leaving_map(
 	void)
 {
+	{
+		uint32 hits, misses;
+		get_line_of_sight_cache_counts(&hits, &misses);
+		if (hits+misses)
+			logNote("line of sight cache answered %u of %u queries", hits, hits+misses);
+	}
+	
+	stop_polygon_pvs();
+	stop_monster_thinking();
 	
 	remove_all_projectiles();
 	remove_all_nonpersistent_effects();
@@ -655,6 +761,10 @@ bool entering_map(bool restoring_saved)
 	if (dynamic_world->player_count>1 && !restoring_saved) initialize_net_game();
 #endif // !defined(DISABLE_NETWORKING)
 	randomize_scenery_shapes();
+	reset_world_tick_hash();
+
+	/* the platforms are in place, so the visible sets can be worked out (or read back) */
+	start_polygon_pvs();
 
 //	reset_action_queues(); //
 //	sync_heartbeat_count();
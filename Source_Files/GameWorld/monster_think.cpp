@@ -0,0 +1,263 @@
+/*
+MONSTER_THINK.C
+
+	Copyright (C) 1991-2001 and beyond by Bungie Studios, Inc.
+	and the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+*/
+
+#include "cseries.h"
+#include "map.h"
+#include "monster_think.h"
+#include "Console.h"
+#include "Logging.h"
+#include "shell.h"
+
+#include <string>
+#include <vector>
+
+#include <SDL_atomic.h>
+#include <SDL_cpuinfo.h>
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+
+/* ---------- constants */
+
+/* fewer walks than this aren't worth waking the threads for */
+#define MINIMUM_PARALLEL_THOUGHTS 16
+
+/* ---------- structures */
+
+struct monster_thought
+{
+	short query;
+	short polygon_index1, polygon_index2;
+	world_point2d p1, p2;
+	bool blocked;
+};
+
+/* ---------- globals */
+
+static short think_mode= _think_in_parallel;
+
+static std::vector<monster_thought> thoughts;
+static SDL_atomic_t next_thought;
+
+static std::vector<SDL_Thread *> think_threads;
+static std::vector<SDL_sem *> think_go;
+static SDL_sem *think_done= NULL;
+static bool think_threads_quitting= false;
+
+static int32 mismatch_count= 0;
+
+/* ---------- private code */
+
+static bool walk(
+	const monster_thought& thought)
+{
+	world_point2d p1= thought.p1, p2= thought.p2;
+
+	return thought.query==_line_is_obstructed_query ?
+		walk_line_is_obstructed(thought.polygon_index1, &p1, thought.polygon_index2, &p2) :
+		walk_line_of_sight(thought.polygon_index1, &p1, thought.polygon_index2, &p2);
+}
+
+/* each thread takes the next walk nobody has started, so a thread stuck with a long one
+	doesn't hold up the rest */
+static void think(
+	void)
+{
+	int count= static_cast<int>(thoughts.size());
+	int index;
+
+	while ((index= SDL_AtomicAdd(&next_thought, 1))<count)
+	{
+		thoughts[index].blocked= walk(thoughts[index]);
+	}
+}
+
+static int think_thread(
+	void *data)
+{
+	SDL_sem *go= static_cast<SDL_sem *>(data);
+
+	while (true)
+	{
+		SDL_SemWait(go);
+		if (think_threads_quitting) break;
+
+		think();
+		SDL_SemPost(think_done);
+	}
+
+	return 0;
+}
+
+static void start_think_threads(
+	void)
+{
+	if (!think_done) think_done= SDL_CreateSemaphore(0);
+
+	// Carry on with however many threads we get; this thread thinks too
+	for (int i= 1; i<SDL_GetCPUCount() && think_done; ++i)
+	{
+		SDL_sem *go= SDL_CreateSemaphore(0);
+		SDL_Thread *thread= go ? SDL_CreateThread(think_thread, "think_about_monsters_workerThread", go) : NULL;
+
+		if (!thread)
+		{
+			if (go) SDL_DestroySemaphore(go);
+			break;
+		}
+		think_go.push_back(go);
+		think_threads.push_back(thread);
+	}
+}
+
+/* ---------- code */
+
+void set_monster_think_mode(
+	short mode)
+{
+	assert(mode>=0 && mode<NUMBER_OF_MONSTER_THINK_MODES);
+	think_mode= mode;
+	if (mode==_think_serially) stop_monster_thinking();
+}
+
+short get_monster_think_mode(
+	void)
+{
+	return think_mode;
+}
+
+void queue_monster_thought(
+	short query,
+	short polygon_index1,
+	world_point2d *p1,
+	short polygon_index2,
+	world_point2d *p2)
+{
+	if (think_mode==_think_serially) return;
+	if (line_of_sight_is_cached(query, polygon_index1, p1, polygon_index2, p2)) return;
+
+	monster_thought thought;
+	thought.query= query;
+	thought.polygon_index1= polygon_index1;
+	thought.p1= *p1;
+	thought.polygon_index2= polygon_index2;
+	thought.p2= *p2;
+	thought.blocked= false;
+	thoughts.push_back(thought);
+}
+
+void think_about_monsters(
+	void)
+{
+	if (thoughts.size()>=MINIMUM_PARALLEL_THOUGHTS)
+	{
+		if (think_threads.empty()) start_think_threads();
+
+		SDL_AtomicSet(&next_thought, 0);
+		for (size_t i= 0; i<think_go.size(); ++i) SDL_SemPost(think_go[i]);
+		think();
+		for (size_t i= 0; i<think_go.size(); ++i) SDL_SemWait(think_done);
+
+		/* the same queue can ask for the same walk twice; the first answer wins, as it
+			would have if move_monsters() had asked for them one after the other */
+		for (size_t i= 0; i<thoughts.size(); ++i)
+		{
+			monster_thought& thought= thoughts[i];
+
+			if (think_mode==_think_and_check && walk(thought)!=thought.blocked)
+			{
+				logError("monster thought %d from polygon %d (%d, %d) to polygon %d (%d, %d) came out differently on another thread",
+					thought.query, thought.polygon_index1, thought.p1.x, thought.p1.y,
+					thought.polygon_index2, thought.p2.x, thought.p2.y);
+				++mismatch_count;
+				continue;
+			}
+			if (!line_of_sight_is_cached(thought.query, thought.polygon_index1, &thought.p1, thought.polygon_index2, &thought.p2))
+			{
+				add_line_of_sight_to_cache(thought.query, thought.polygon_index1, &thought.p1,
+					thought.polygon_index2, &thought.p2, thought.blocked);
+			}
+		}
+	}
+
+	thoughts.clear();
+}
+
+void stop_monster_thinking(
+	void)
+{
+	think_threads_quitting= true;
+	for (size_t i= 0; i<think_go.size(); ++i) SDL_SemPost(think_go[i]);
+	for (size_t i= 0; i<think_threads.size(); ++i)
+	{
+		SDL_WaitThread(think_threads[i], NULL);
+		SDL_DestroySemaphore(think_go[i]);
+	}
+	think_threads.clear();
+	think_go.clear();
+	think_threads_quitting= false;
+
+	thoughts.clear();
+	mismatch_count= 0;
+}
+
+int32 get_monster_think_mismatch_count(
+	void)
+{
+	return mismatch_count;
+}
+
+static const char *think_mode_names[NUMBER_OF_MONSTER_THINK_MODES]=
+{
+	"serial",
+	"parallel",
+	"check"
+};
+
+struct think_command
+{
+	void operator() (const std::string& arg) const {
+		if (arg=="")
+		{
+			screen_printf("Monsters think %s", think_mode_names[get_monster_think_mode()]);
+			if (get_monster_think_mode()==_think_and_check)
+				screen_printf("%d thoughts came out differently on other threads", get_monster_think_mismatch_count());
+			return;
+		}
+
+		for (short mode= 0; mode<NUMBER_OF_MONSTER_THINK_MODES; ++mode)
+		{
+			if (arg==think_mode_names[mode])
+			{
+				set_monster_think_mode(mode);
+				screen_printf("Monsters think %s", think_mode_names[mode]);
+				return;
+			}
+		}
+
+		screen_printf("Usage: .think, .think serial, .think parallel, .think check");
+	}
+};
+
+void register_monster_think_commands(
+	void)
+{
+	Console::instance()->register_command("think", think_command());
+}
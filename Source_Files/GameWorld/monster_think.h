@@ -0,0 +1,69 @@
+#ifndef __MONSTER_THINK_H
+#define __MONSTER_THINK_H
+
+/*
+MONSTER_THINK.H
+
+	Copyright (C) 1991-2001 and beyond by Bungie Studios, Inc.
+	and the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	The parallel part of move_monsters(), which is only its line of sight walks: before the
+	monsters move, the lines of sight they are about to ask about (every active monster to its
+	target) are walked on a pool of threads while the world stands still, and the answers go
+	into the line of sight cache in the order they were asked for.  move_monsters() then runs
+	exactly as it always has, in monster order, finding those answers in the cache; an answer
+	is only ever used for the exact same points and lines, so nothing can come out differently
+	than it would have on one thread.
+
+	Target acquisition (find_closest_appropriate_target()) and new paths are NOT done here; they
+	still happen one monster at a time in move_monsters(), since it only gives one monster each
+	a target search and a new path per tick, and what they find depends on the monsters that
+	moved before them.
+*/
+
+#include "cstypes.h"
+#include "world.h"
+
+enum /* monster think modes */
+{
+	_think_serially, /* no threads; move_monsters() walks everything itself */
+	_think_in_parallel,
+	_think_and_check, /* walks everything again on this thread and logs any disagreement */
+	NUMBER_OF_MONSTER_THINK_MODES
+};
+
+void set_monster_think_mode(short mode);
+short get_monster_think_mode(void);
+
+/* asks for a walk from line_is_obstructed() or line_of_sight_is_blocked(), unless the cache
+	already has it */
+void queue_monster_thought(short query, short polygon_index1, world_point2d *p1,
+	short polygon_index2, world_point2d *p2);
+
+/* walks everything queued since the last call, on every thread the pool has, and caches it */
+void think_about_monsters(void);
+
+/* lets the pool's threads go (call when leaving a level) */
+void stop_monster_thinking(void);
+
+/* how many walks disagreed since the level started, in _think_and_check */
+int32 get_monster_think_mismatch_count(void);
+
+/* .think, .think serial, .think parallel and .think check */
+void register_monster_think_commands(void);
+
+#endif
@@ -102,6 +102,7 @@ Jan 12, 2003 (Loren Petrich)
 #include "flood_map.h"
 #include "effects.h"
 #include "monsters.h"
+#include "monster_think.h"
 #include "projectiles.h"
 #include "player.h"
 #include "platforms.h"
@@ -240,12 +241,20 @@ struct damage_kick_definition damage_kick_definitions[NUMBER_OF_DAMAGE_TYPES] =
 // LP addition: growable list of intersected objects
 static vector<short> IntersectedObjects;
 
+/* which objects are in the list possible_intersecting_monsters() is adding to: an object is
+	in it if its mark is the current one, so finding out doesn't mean searching the list */
+static vector<uint16> IntersectedObjectMarks;
+static uint16 intersected_object_mark= 0;
+static const vector<short> *marked_intersected_objects= NULL;
+static size_t marked_intersected_object_count= 0;
+
 /* ---------- private prototypes */
 
 static monster_definition *get_monster_definition(
 	const short type);
 
 static void monster_needs_path(short monster_index, bool immediately);
+static void queue_monster_thoughts(void);
 static void generate_new_path_for_monster(short monster_index);
 void advance_monster_path(short monster_index);
 
@@ -467,6 +476,13 @@ void move_monsters(
 	bool monster_built_path= (dynamic_world->tick_count&3) ? true : false;
 	short monster_index;
 
+	/* walk the lines of sight we're about to need on every thread we have */
+	if (get_monster_think_mode()!=_think_serially)
+	{
+		queue_monster_thoughts();
+		think_about_monsters();
+	}
+
 	for (monster_index= 0, monster= monsters; monster_index<MAXIMUM_MONSTERS_PER_MAP; ++monster_index, ++monster)
 	{
 		if (SLOT_IS_USED(monster) && !MONSTER_IS_PLAYER(monster))
@@ -836,7 +852,7 @@ void activate_nearby_monsters(
 			struct object_data *object;
 	
 			/* loop through all objects in this polygon looking for _hostile inactive or unlocked monsters */
-			for (object_index= get_polygon_data(polygon_index)->first_object; object_index!=NONE; object_index= object->next_object)
+			for (object_index= get_polygon_first_obstacle(polygon_index); object_index!=NONE; object_index= get_next_obstacle(object_index))
 			{
 				object= get_object_data(object_index);
 				if (GET_OBJECT_OWNER(object)==_object_is_monster &&
@@ -1155,13 +1171,35 @@ bool possible_intersecting_monsters(
 	// Skip this step if neighbor indexes were not found
 	if (!neighbor_indexes) return found_solid_object;
 
+	if (IntersectedObjectsPtr)
+	{
+		/* a new list, or someone else's since we last added to this one, needs a new mark;
+			whatever is in it already gets the new mark too */
+		if (IntersectedObjectsPtr->empty() || IntersectedObjectsPtr!=marked_intersected_objects ||
+			IntersectedObjectsPtr->size()!=marked_intersected_object_count)
+		{
+			if (IntersectedObjectMarks.size()<MAXIMUM_OBJECTS_PER_MAP)
+				IntersectedObjectMarks.resize(MAXIMUM_OBJECTS_PER_MAP, 0);
+			if (++intersected_object_mark==0)
+			{
+				std::fill(IntersectedObjectMarks.begin(), IntersectedObjectMarks.end(), 0);
+				intersected_object_mark= 1;
+			}
+			
+			for (unsigned j=0; j<IntersectedObjectsPtr->size(); ++j)
+				IntersectedObjectMarks[(*IntersectedObjectsPtr)[j]]= intersected_object_mark;
+			marked_intersected_objects= IntersectedObjectsPtr;
+		}
+	}
+
 	for (short i=0;i<polygon->neighbor_count;++i)
 	{
-		struct polygon_data *neighboring_polygon= get_polygon_data(*neighbor_indexes++);
+		short neighbor_index= *neighbor_indexes++;
+		struct polygon_data *neighboring_polygon= get_polygon_data(neighbor_index);
 		
 		if (!POLYGON_IS_DETACHED(neighboring_polygon))
 		{
-			short object_index= neighboring_polygon->first_object;
+			short object_index= get_polygon_first_obstacle(neighbor_index);
 			
 			while (object_index!=NONE)
 			{
@@ -1196,23 +1234,23 @@ bool possible_intersecting_monsters(
 						// LP change:
 						if (IntersectedObjectsPtr && IntersectedObjectsPtr->size()<maximum_object_count) /* do we have enough space to add it? */
 						{
-							unsigned j;
-							
 							/* only add this object_index if it's not already in the list */
-							vector<short>& IntersectedObjects = *IntersectedObjectsPtr;
-							for (j=0; j<IntersectedObjects.size() && IntersectedObjects[j]!=object_index; ++j)
-								;
-							if (j==IntersectedObjects.size())
-								IntersectedObjects.push_back(object_index);
+							if (IntersectedObjectMarks[object_index]!=intersected_object_mark)
+							{
+								IntersectedObjectMarks[object_index]= intersected_object_mark;
+								IntersectedObjectsPtr->push_back(object_index);
+							}
 						}
 					}
 				}
 				
-				object_index= object->next_object;
+				object_index= get_next_obstacle(object_index);
 			}
 		}
 	}
 
+	if (IntersectedObjectsPtr) marked_intersected_object_count= IntersectedObjectsPtr->size();
+
 	return found_solid_object;
 }
 
@@ -2280,7 +2318,7 @@ short find_closest_appropriate_target(
 			struct object_data *object;
 	
 			/* loop through all objects in this polygon looking for hostile monsters we can see */
-			for (object_index= get_polygon_data(polygon_index)->first_object; object_index!=NONE; object_index= object->next_object)
+			for (object_index= get_polygon_first_obstacle(polygon_index); object_index!=NONE; object_index= get_next_obstacle(object_index))
 			{
 				object= get_object_data(object_index);
 				if (GET_OBJECT_OWNER(object)==_object_is_monster && OBJECT_IS_VISIBLE(object))
@@ -2387,39 +2425,39 @@ static bool clear_line_of_sight(
 		/* make sure there are no non-transparent lines between the viewer and the target */
 		if (target_visible)
 		{
-			short polygon_index= viewer_object->polygon;
-			short line_index;
+			if (line_of_sight_is_blocked(viewer_object->polygon, (world_point2d *)origin, target_object->polygon, (world_point2d *)destination))
+				target_visible= false;
+		}
+	}
+	
+	return target_visible;
+}
+
+/* every active monster with a target will look at it from where it stands (in
+	clear_line_of_sight() and try_monster_attack()) unless something moves first */
+static void queue_monster_thoughts(
+	void)
+{
+	struct monster_data *monster;
+	short monster_index;
+	
+	for (monster_index= 0, monster= monsters; monster_index<MAXIMUM_MONSTERS_PER_MAP; ++monster_index, ++monster)
+	{
+		if (SLOT_IS_USED(monster) && !MONSTER_IS_PLAYER(monster) && MONSTER_IS_ACTIVE(monster) &&
+			!MONSTER_IS_DYING(monster) && MONSTER_HAS_VALID_TARGET(monster))
+		{
+			struct object_data *object= get_object_data(monster->object_index);
+			struct object_data *target_object= get_object_data(get_monster_data(monster->target_index)->object_index);
 			
-			do
+			if (!OBJECT_IS_INVISIBLE(object))
 			{
-				line_index= find_line_crossed_leaving_polygon(polygon_index, (world_point2d *)origin, (world_point2d *)destination);
-				if (line_index!=NONE)
-				{
-					if (LINE_IS_TRANSPARENT(get_line_data(line_index)))
-					{
-						/* transparent line, find adjacent polygon */
-						polygon_index= find_adjacent_polygon(polygon_index, line_index);
-						// LP change: make no polygon act like a non-transparent line
-						if (polygon_index == NONE) target_visible= false;
-					}
-					else
-					{
-						/* non-transparent line, target not visible */
-						target_visible= false;
-					}
-				}
-				else
-				{
-					/* we got to the targets (x,y) location, but were in a different polygon;
-						hes invisible */
-					if (polygon_index!=target_object->polygon) target_visible= false;
-				}
+				queue_monster_thought(_clear_line_of_sight_query, object->polygon, (world_point2d *) &object->location,
+					target_object->polygon, (world_point2d *) &target_object->location);
+				queue_monster_thought(_line_is_obstructed_query, object->polygon, (world_point2d *) &object->location,
+					target_object->polygon, (world_point2d *) &target_object->location);
 			}
-			while (target_visible&&line_index!=NONE);
 		}
 	}
-	
-	return target_visible;
 }
 
 /* lock the given monster onto the given target, playing a locking sound if the monster
@@ -3199,7 +3237,7 @@ int32 monster_pathfinding_cost_function(
 
 	/* count up the monsters in destination_polygon and add a constant cost, MONSTER_PATHFINDING_OBSTRUCTION_PENALTY,
 		for each of them to discourage overcrowding */
-	for (object_index= destination_polygon->first_object; object_index!=NONE; object_index=  object->next_object)
+	for (object_index= get_polygon_first_obstacle(destination_polygon_index); object_index!=NONE; object_index= get_next_obstacle(object_index))
 	{
 		object= get_object_data(object_index);
 		if (GET_OBJECT_OWNER(object)==_object_is_monster) cost+= MONSTER_PATHFINDING_OBSTRUCTION_COST;
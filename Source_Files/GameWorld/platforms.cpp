@@ -71,6 +71,7 @@ Jun 30, 2002 (tiennou):
 #include "SoundManager.h"
 #include "player.h"
 #include "media.h"
+#include "render.h"
 #include "InfoTree.h"
 
 // LP addition: XML parser for damage
@@ -856,6 +857,8 @@ void adjust_platform_endpoint_and_line_heights(
 	struct polygon_data *polygon= get_polygon_data(platform->polygon_index);
 	short i;
 	
+	invalidate_render_tree_cache(platform->polygon_index);
+	
 	for (i= 0; i<polygon->vertex_count; ++i)
 	{
 		struct endpoint_data *endpoint= get_endpoint_data(polygon->endpoint_indexes[i]);
@@ -879,8 +882,15 @@ void adjust_platform_endpoint_and_line_heights(
 			/* only worry about transparency and solidity if theres a polygon on the other side */
 			if (LINE_IS_VARIABLE_ELEVATION(line))
 			{
+				uint16 old_flags= line->flags;
+				
 				SET_LINE_TRANSPARENCY(line, line->highest_adjacent_floor<line->lowest_adjacent_ceiling);
 				SET_LINE_SOLIDITY(line, line->highest_adjacent_floor>=line->lowest_adjacent_ceiling);
+				if (line->flags!=old_flags)
+				{
+					invalidate_line_of_sight_cache();
+					invalidate_automap_reach();
+				}
 			}
 			
 			/* and only if there is another polygon does this endpoint have a chance of being transparent */
@@ -0,0 +1,325 @@
+/*
+WORLD_HASH.C
+
+	Copyright (C) 1991-2001 and beyond by Bungie Studios, Inc.
+	and the "Aleph One" developers.
+ 
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+*/
+
+#include "cseries.h"
+#include "map.h"
+#include "world_hash.h"
+#include "effects.h"
+#include "lightsource.h"
+#include "media.h"
+#include "monsters.h"
+#include "platforms.h"
+#include "player.h"
+#include "projectiles.h"
+
+#include <vector>
+
+/* ---------- constants */
+
+#define WORLD_HASH_BASIS 0x811c9dc5 /* 32-bit FNV-1a */
+#define WORLD_HASH_PRIME 0x01000193
+
+/* ---------- globals */
+
+// packing scratch space; grows to the largest array we have hashed
+static std::vector<uint8> pack_buffer;
+
+// running hash of every real tick since the level was entered
+static uint32 world_tick_hash= WORLD_HASH_BASIS;
+
+// what each slot of a list looked like when it was last hashed, so that only the ones that
+// changed since are hashed again
+#define MAXIMUM_WORLD_HASH_SLOT_FIELDS 6
+
+struct world_hash_slot
+{
+	bool used;
+	int32 fields[MAXIMUM_WORLD_HASH_SLOT_FIELDS];
+	uint32 hash;
+};
+
+struct world_hash_list
+{
+	std::vector<world_hash_slot> slots;
+	uint32 sum; // of the hashes of the slots in use
+};
+
+enum
+{
+	_world_hash_objects,
+	_world_hash_monsters,
+	_world_hash_projectiles,
+	_world_hash_effects,
+	NUMBER_OF_WORLD_HASH_LISTS
+};
+
+static world_hash_list world_hash_lists[NUMBER_OF_WORLD_HASH_LISTS];
+
+/* ---------- private code */
+
+static uint32 hash_bytes(
+	uint32 hash,
+	const uint8 *bytes,
+	size_t count)
+{
+	for (size_t i= 0; i<count; ++i)
+	{
+		hash^= bytes[i];
+		hash*= WORLD_HASH_PRIME;
+	}
+	
+	return hash;
+}
+
+// hashes the big-endian bytes, so every machine agrees no matter its byte order
+static uint32 hash_value(
+	uint32 hash,
+	int32 value)
+{
+	uint8 bytes[4]= {static_cast<uint8>(value>>24), static_cast<uint8>(value>>16),
+		static_cast<uint8>(value>>8), static_cast<uint8>(value)};
+	
+	return hash_bytes(hash, bytes, sizeof(bytes));
+}
+
+static uint32 hash_location(
+	uint32 hash,
+	world_point3d *location)
+{
+	hash= hash_value(hash, location->x);
+	hash= hash_value(hash, location->y);
+	hash= hash_value(hash, location->z);
+	
+	return hash;
+}
+
+template<class T>
+static uint32 hash_packed(
+	uint32 hash,
+	uint8 *(*packer)(uint8 *, T *, size_t),
+	T *list,
+	size_t count,
+	size_t packed_size)
+{
+	if (count)
+	{
+		if (pack_buffer.size()<count*packed_size) pack_buffer.resize(count*packed_size);
+		uint8 *end= packer(&pack_buffer[0], list, count);
+		assert(static_cast<size_t>(end-&pack_buffer[0])==count*packed_size);
+		hash= hash_bytes(hash, &pack_buffer[0], count*packed_size);
+	}
+	
+	return hash;
+}
+
+template<class T>
+static uint32 hash_packed(
+	uint32 hash,
+	uint8 *(*packer)(uint8 *, T *, size_t),
+	std::vector<T>& list,
+	size_t packed_size)
+{
+	return list.empty() ? hash : hash_packed(hash, packer, &list[0], list.size(), packed_size);
+}
+
+// brings one slot's entry up to date; fields is ignored for a slot not in use
+static void update_world_hash_slot(
+	world_hash_list& list,
+	short index,
+	bool used,
+	const int32 *fields)
+{
+	world_hash_slot& slot= list.slots[index];
+	
+	if (!used)
+	{
+		if (slot.used)
+		{
+			list.sum-= slot.hash;
+			slot.used= false;
+		}
+		return;
+	}
+	
+	if (slot.used && memcmp(slot.fields, fields, sizeof(slot.fields))==0) return;
+	
+	uint32 hash= hash_value(WORLD_HASH_BASIS, index);
+	for (int i= 0; i<MAXIMUM_WORLD_HASH_SLOT_FIELDS; ++i) hash= hash_value(hash, fields[i]);
+	
+	if (slot.used) list.sum-= slot.hash;
+	list.sum+= hash;
+	memcpy(slot.fields, fields, sizeof(slot.fields));
+	slot.hash= hash;
+	slot.used= true;
+}
+
+static void size_world_hash_list(
+	world_hash_list& list,
+	size_t count)
+{
+	if (list.slots.size()!=count)
+	{
+		list.slots.clear();
+		list.slots.resize(count);
+		for (size_t i= 0; i<count; ++i) list.slots[i].used= false;
+		list.sum= 0;
+	}
+}
+
+/* ---------- code */
+
+uint32 calculate_world_hash(
+	void)
+{
+	uint32 hash= WORLD_HASH_BASIS;
+	uint16 random_seed= get_random_seed();
+	uint8 random_seed_bytes[2]= {static_cast<uint8>(random_seed>>8), static_cast<uint8>(random_seed)};
+	
+	hash= hash_bytes(hash, random_seed_bytes, sizeof(random_seed_bytes));
+	hash= hash_packed(hash, pack_dynamic_data, dynamic_world, 1, SIZEOF_dynamic_data);
+	hash= hash_packed(hash, pack_player_data, players, dynamic_world->player_count, SIZEOF_player_data);
+	hash= hash_packed(hash, pack_object_data, ObjectList, SIZEOF_object_data);
+	hash= hash_packed(hash, pack_monster_data, MonsterList, SIZEOF_monster_data);
+	hash= hash_packed(hash, pack_projectile_data, ProjectileList, SIZEOF_projectile_data);
+	hash= hash_packed(hash, pack_effect_data, EffectList, SIZEOF_effect_data);
+	hash= hash_packed(hash, pack_platform_data, PlatformList, SIZEOF_platform_data);
+	hash= hash_packed(hash, pack_light_data, LightList, SIZEOF_light_data);
+	hash= hash_packed(hash, pack_media_data, MediaList, SIZEOF_media_data);
+	hash= hash_packed(hash, pack_polygon_data, PolygonList, SIZEOF_polygon_data);
+	
+	return hash;
+}
+
+void reset_world_tick_hash(
+	void)
+{
+	world_tick_hash= WORLD_HASH_BASIS;
+	for (int i= 0; i<NUMBER_OF_WORLD_HASH_LISTS; ++i)
+	{
+		world_hash_lists[i].slots.clear();
+		world_hash_lists[i].sum= 0;
+	}
+}
+
+/* only the slots in use and only the fields that drive the simulation are hashed (no render
+	flags, no interface state), and a slot is only hashed again when one of those fields has
+	changed since the last tick, so this stays cheap enough to run every tick; anything that
+	drifts out of sync will show up in one of these sooner or later */
+uint32 update_world_tick_hash(
+	void)
+{
+	uint32 hash= world_tick_hash;
+	int32 fields[MAXIMUM_WORLD_HASH_SLOT_FIELDS];
+	short index;
+	
+	hash= hash_value(hash, dynamic_world->tick_count);
+	hash= hash_value(hash, get_random_seed());
+	
+	for (index= 0; index<dynamic_world->player_count; ++index)
+	{
+		struct player_data *player= get_player_data(index);
+		
+		hash= hash_location(hash, &player->location);
+		hash= hash_value(hash, player->facing);
+		hash= hash_value(hash, player->elevation);
+		hash= hash_value(hash, player->suit_energy);
+		hash= hash_value(hash, player->suit_oxygen);
+		hash= hash_value(hash, player->monster_index);
+	}
+	
+	world_hash_list& object_slots= world_hash_lists[_world_hash_objects];
+	size_world_hash_list(object_slots, ObjectList.size());
+	for (index= 0; index<static_cast<short>(ObjectList.size()); ++index)
+	{
+		struct object_data *object= &ObjectList[index];
+		bool used= SLOT_IS_USED(object);
+		
+		if (used)
+		{
+			fields[0]= object->location.x;
+			fields[1]= object->location.y;
+			fields[2]= object->location.z;
+			fields[3]= object->polygon;
+			fields[4]= object->facing;
+			fields[5]= object->permutation;
+		}
+		update_world_hash_slot(object_slots, index, used, fields);
+	}
+	
+	world_hash_list& monster_slots= world_hash_lists[_world_hash_monsters];
+	size_world_hash_list(monster_slots, MonsterList.size());
+	for (index= 0; index<static_cast<short>(MonsterList.size()); ++index)
+	{
+		struct monster_data *monster= &MonsterList[index];
+		bool used= SLOT_IS_USED(monster);
+		
+		if (used)
+		{
+			fields[0]= monster->type;
+			fields[1]= monster->vitality;
+			fields[2]= monster->mode;
+			fields[3]= monster->action;
+			fields[4]= monster->target_index;
+			fields[5]= 0;
+		}
+		update_world_hash_slot(monster_slots, index, used, fields);
+	}
+	
+	world_hash_list& projectile_slots= world_hash_lists[_world_hash_projectiles];
+	size_world_hash_list(projectile_slots, ProjectileList.size());
+	for (index= 0; index<static_cast<short>(ProjectileList.size()); ++index)
+	{
+		struct projectile_data *projectile= &ProjectileList[index];
+		bool used= SLOT_IS_USED(projectile);
+		
+		if (used)
+		{
+			fields[0]= projectile->type;
+			fields[1]= projectile->owner_index;
+			fields[2]= projectile->target_index;
+			fields[3]= projectile->distance_travelled;
+			fields[4]= fields[5]= 0;
+		}
+		update_world_hash_slot(projectile_slots, index, used, fields);
+	}
+	
+	world_hash_list& effect_slots= world_hash_lists[_world_hash_effects];
+	size_world_hash_list(effect_slots, EffectList.size());
+	for (index= 0; index<static_cast<short>(EffectList.size()); ++index)
+	{
+		struct effect_data *effect= &EffectList[index];
+		bool used= SLOT_IS_USED(effect);
+		
+		if (used)
+		{
+			fields[0]= effect->type;
+			fields[1]= effect->delay;
+			fields[2]= fields[3]= fields[4]= fields[5]= 0;
+		}
+		update_world_hash_slot(effect_slots, index, used, fields);
+	}
+	
+	/* the sums don't depend on the order the slots were brought up to date in, and each
+		slot's hash covers its index, so which slot holds what still counts */
+	for (int i= 0; i<NUMBER_OF_WORLD_HASH_LISTS; ++i) hash= hash_value(hash, world_hash_lists[i].sum);
+	
+	return world_tick_hash= hash;
+}
@@ -0,0 +1,38 @@
+#ifndef __WORLD_HASH_H
+#define __WORLD_HASH_H
+
+/*
+WORLD_HASH.H
+
+	Copyright (C) 1991-2001 and beyond by Bungie Studios, Inc.
+	and the "Aleph One" developers.
+ 
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Hashing of the dynamic world state, for checking that two runs of the
+	simulation (a film replayed twice, two players in a netgame) agree.
+*/
+
+#include "cstypes.h"
+
+/* hashes the saved-game (packed) form of every dynamic world array, so the result
+	doesn't depend on structure padding, byte order or compiler */
+uint32 calculate_world_hash(void);
+
+/* running hash over every real tick since entering the level, for netgame desync checks */
+void reset_world_tick_hash(void);
+uint32 update_world_tick_hash(void);
+
+#endif
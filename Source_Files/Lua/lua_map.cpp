@@ -30,6 +30,8 @@ LUA_MAP.CPP
 #include "map.h"
 #include "media.h"
 #include "platforms.h"
+#include "render.h"
+#include "RenderPVS.h"
 #include "OGL_Setup.h"
 #include "SoundManager.h"
 
@@ -424,6 +426,8 @@ static int Lua_Platform_Set_Ceiling_Height(lua_State *L)
 	platform_data *platform = get_platform_data(platform_index);
 
 	platform->ceiling_height = static_cast<world_distance>(lua_tonumber(L, 2) * WORLD_ONE);
+	if (platform->ceiling_height > platform->maximum_ceiling_height)
+		discard_polygon_pvs();
 	adjust_platform_endpoint_and_line_heights(platform_index);
 	adjust_platform_for_media(platform_index, false);
 	
@@ -467,6 +471,8 @@ static int Lua_Platform_Set_Floor_Height(lua_State *L)
 	platform_data *platform = get_platform_data(platform_index);
 
 	platform->floor_height = static_cast<world_distance>(lua_tonumber(L, 2) * WORLD_ONE);
+	if (platform->floor_height < platform->minimum_floor_height)
+		discard_polygon_pvs();
 	adjust_platform_endpoint_and_line_heights(platform_index);
 	adjust_platform_for_media(platform_index, false);
 	
@@ -590,8 +596,14 @@ static int Lua_Polygon_Floor_Set_Height(lua_State *L)
 		luaL_error(L, "height: incorrect argument type");
 	}
 
-	struct polygon_data *polygon = get_polygon_data(Lua_Polygon_Floor::Index(L, 1));
-	polygon->floor_height = static_cast<world_distance>(lua_tonumber(L,2)*WORLD_ONE);
+	short polygon_index = Lua_Polygon_Floor::Index(L, 1);
+	struct polygon_data *polygon = get_polygon_data(polygon_index);
+	world_distance height = static_cast<world_distance>(lua_tonumber(L,2)*WORLD_ONE);
+	// a lower floor can open up views the visible sets didn't allow for
+	if (height < polygon->floor_height)
+		discard_polygon_pvs();
+	polygon->floor_height = height;
+	invalidate_render_tree_cache(polygon_index);
 	for (short i = 0; i < polygon->vertex_count; ++i)
 	{
 		recalculate_redundant_endpoint_data(polygon->endpoint_indexes[i]);
@@ -744,8 +756,14 @@ static int Lua_Polygon_Ceiling_Set_Height(lua_State *L)
 		luaL_error(L, "height: incorrect argument type");
 	}
 
-	struct polygon_data *polygon = get_polygon_data(Lua_Polygon_Ceiling::Index(L, 1));
-	polygon->ceiling_height = static_cast<world_distance>(lua_tonumber(L,2)*WORLD_ONE);
+	short polygon_index = Lua_Polygon_Ceiling::Index(L, 1);
+	struct polygon_data *polygon = get_polygon_data(polygon_index);
+	world_distance height = static_cast<world_distance>(lua_tonumber(L,2)*WORLD_ONE);
+	// and so can a higher ceiling
+	if (height > polygon->ceiling_height)
+		discard_polygon_pvs();
+	polygon->ceiling_height = height;
+	invalidate_render_tree_cache(polygon_index);
 	for (short i = 0; i < polygon->vertex_count; ++i)
 	{
 		recalculate_redundant_endpoint_data(polygon->endpoint_indexes[i]);
@@ -33,8 +33,10 @@
 #include <vector>
 #include <time.h>	// apparently is in C std library, used here to print time/date log section started.
 #include <stdio.h>
+#ifndef A1_NETWORK_STANDALONE_HUB
 #include "FileHandler.h"
 #include "InfoTree.h"
+#endif
 
 #ifndef NO_STD_NAMESPACE
 using std::vector;
@@ -209,14 +211,20 @@ void TopLevelLogger::flush()
 #endif
 #endif
 
+#ifndef A1_NETWORK_STANDALONE_HUB
 extern DirectorySpecifier log_dir;
+#endif
 
 char g_loggingFileName[256] = "";
 const char *loggingFileName()
 {
 	if (!strlen(g_loggingFileName))
 	{
+#ifdef A1_NETWORK_STANDALONE_HUB
+		strncpy(g_loggingFileName, "Aleph One Hub", 256);
+#else
 		strncpy(g_loggingFileName, get_application_name(), 256);
+#endif
 		strncat(g_loggingFileName, " Log.txt", 256 - strlen(g_loggingFileName));
 	}
 	return g_loggingFileName;
@@ -225,10 +233,15 @@ const char *loggingFileName()
 static void
 InitializeLogging() {
     assert(sOutputFile == NULL);
+#ifdef A1_NETWORK_STANDALONE_HUB
+    // no shell, so no log directory; the hub logs to its working directory
+    sOutputFile = fopen(loggingFileName(), "a");
+#else
     FileSpecifier fs = log_dir;
     fs += loggingFileName();
 
     sOutputFile = fopen(fs.GetPath(), "a");
+#endif
 
     sCurrentLogger = new TopLevelLogger;
     if(sOutputFile != NULL)
@@ -263,6 +276,7 @@ setFlushLoggingOutput(const char* inDomain, bool inFlushOutput) {
 }
 
 
+#ifndef A1_NETWORK_STANDALONE_HUB
 void reset_mml_logging()
 {
 	// no reset
@@ -287,3 +301,4 @@ void parse_mml_logging(const InfoTree& root)
 			setFlushLoggingOutput(domain.c_str(), flush);
 	}
 }
+#endif
@@ -68,6 +68,7 @@ May 22, 2003 (Woody Zenfell):
 #include "find_files.h"
 #include "game_wad.h" // for set_map_file
 #include "screen.h"
+#include "render.h"
 #include "fades.h"
 #include "extensions.h"
 #include "Console.h"
@@ -971,6 +972,10 @@ static const char *sw_sdl_driver_labels[5] = {
 	"Default", "None", "Direct3D", "OpenGL", NULL
 };
 
+static const char *sw_threads_labels[3] = {
+	"One", "One Per CPU", NULL
+};
+
 static const char *gamma_labels[9] = {
 	"Darkest", "Darker", "Dark", "Normal", "Light", "Really Light", "Even Lighter", "Lightest", NULL
 };
@@ -1041,6 +1046,10 @@ static void software_rendering_options_dialog(void* arg)
 	w_select *sw_driver_w = new w_select(graphics_preferences->software_sdl_driver, sw_sdl_driver_labels);
 	table->dual_add(sw_driver_w->label("Acceleration"), d);
 	table->dual_add(sw_driver_w, d);
+
+	w_toggle *sw_threads_w = new w_toggle(graphics_preferences->software_multithreaded, sw_threads_labels);
+	table->dual_add(sw_threads_w->label("Threads"), d);
+	table->dual_add(sw_threads_w, d);
 	
 	placer->add(table, true);
 
@@ -1086,6 +1095,14 @@ static void software_rendering_options_dialog(void* arg)
 			graphics_preferences->software_sdl_driver = sw_driver_w->get_selection();
 			changed = true;
 		}
+
+		bool multithreaded = sw_threads_w->get_selection() != 0;
+		if (multithreaded != graphics_preferences->software_multithreaded)
+		{
+			graphics_preferences->software_multithreaded = multithreaded;
+			set_software_render_threads(multithreaded ? 0 : 1);
+			changed = true;
+		}
 		
 		if (changed)
 			write_preferences();
@@ -1366,6 +1383,8 @@ public:
 };
 
 static const char *channel_labels[] = {"1", "2", "4", "8", "16", "32", NULL};
+static const char *sound_cache_labels[] = {"Automatic", "16 MB", "32 MB", "64 MB", "128 MB", "256 MB", NULL};
+static const uint16 sound_cache_sizes[] = {0, 16, 32, 64, 128, 256};
 
 class w_volume_slider : public w_percentage_slider {
 public:
@@ -1440,6 +1459,16 @@ static void sound_dialog(void *arg)
 	table->dual_add(zrd_w->label("Zero Restart Delay"), d);
 	table->dual_add(zrd_w, d);
 
+	int sound_cache_selection = 0;
+	for (int i = 0; i < static_cast<int>(sizeof(sound_cache_sizes) / sizeof(sound_cache_sizes[0])); ++i)
+	{
+		if (sound_cache_sizes[i] == sound_preferences->cache_size)
+			sound_cache_selection = i;
+	}
+	w_select *sound_cache_w = new w_select(sound_cache_selection, sound_cache_labels);
+	table->dual_add(sound_cache_w->label("Sound Memory"), d);
+	table->dual_add(sound_cache_w, d);
+
 	placer->add(table, true);
 
 	placer->add(new w_spacer(), true);
@@ -1503,6 +1532,15 @@ static void sound_dialog(void *arg)
 			changed = true;
 		}
 
+		// leave hand-edited sizes that aren't in the list alone unless
+		// the user actually picked something else
+		int sound_cache_choice = sound_cache_w->get_selection();
+		if (sound_cache_choice != UNONE && sound_cache_choice != sound_cache_selection)
+		{
+			sound_preferences->cache_size = sound_cache_sizes[sound_cache_choice];
+			changed = true;
+		}
+
 		if (changed) {
 //			set_sound_manager_parameters(sound_preferences);
 			SoundManager::instance()->SetParameters(*sound_preferences);
@@ -2568,6 +2606,7 @@ InfoTree graphics_preferences_tree()
 	root.put_attr("ogl_flags", graphics_preferences->OGL_Configure.Flags);
 	root.put_attr("software_alpha_blending", graphics_preferences->software_alpha_blending);
 	root.put_attr("software_sdl_driver", graphics_preferences->software_sdl_driver);
+	root.put_attr("software_multithreaded", graphics_preferences->software_multithreaded);
 	root.put_attr("anisotropy_level", graphics_preferences->OGL_Configure.AnisotropyLevel);
 	root.put_attr("multisamples", graphics_preferences->OGL_Configure.Multisamples);
 	root.put_attr("geforce_fix", graphics_preferences->OGL_Configure.GeForceFix);
@@ -2835,6 +2874,7 @@ InfoTree sound_preferences_tree()
 	root.put_attr("samples", sound_preferences->samples);
 	root.put_attr("volume_while_speaking", sound_preferences->volume_while_speaking);
 	root.put_attr("mute_while_transmitting", sound_preferences->mute_while_transmitting);
+	root.put_attr("cache_size", sound_preferences->cache_size);
 	
 	return root;
 }
@@ -2993,6 +3033,7 @@ static void default_graphics_preferences(graphics_preferences_data *preferences)
 
 	preferences->software_alpha_blending = _sw_alpha_off;
 	preferences->software_sdl_driver = _sw_driver_default;
+	preferences->software_multithreaded = false;
 
 	preferences->movie_export_video_quality = 50;
 	preferences->movie_export_audio_quality = 50;
@@ -3477,6 +3518,7 @@ void parse_graphics_preferences(InfoTree root, std::string version)
 	root.read_attr("ogl_flags", graphics_preferences->OGL_Configure.Flags);
 	root.read_attr("software_alpha_blending", graphics_preferences->software_alpha_blending);
 	root.read_attr("software_sdl_driver", graphics_preferences->software_sdl_driver);
+	root.read_attr("software_multithreaded", graphics_preferences->software_multithreaded);
 	root.read_attr("anisotropy_level", graphics_preferences->OGL_Configure.AnisotropyLevel);
 	root.read_attr("multisamples", graphics_preferences->OGL_Configure.Multisamples);
 	root.read_attr("geforce_fix", graphics_preferences->OGL_Configure.GeForceFix);
@@ -3757,6 +3799,7 @@ void parse_sound_preferences(InfoTree root, std::string version)
 	root.read_attr("samples", sound_preferences->samples);
 	root.read_attr("volume_while_speaking", sound_preferences->volume_while_speaking);
 	root.read_attr("mute_while_transmitting", sound_preferences->mute_while_transmitting);
+	root.read_attr_bounded<uint16>("cache_size", sound_preferences->cache_size, 0, SoundManager::Parameters::MAXIMUM_CACHE_SIZE);
 }
 
 
@@ -87,6 +87,7 @@ struct graphics_preferences_data
 
 	int16 software_alpha_blending;
 	int16 software_sdl_driver;
+	bool software_multithreaded;	// draw in bands on one thread per CPU
 
 	bool hog_the_cpu;
 
@@ -120,6 +120,14 @@ void NetDDPDisposeFrame(DDPFramePtr frame);
 
 OSErr NetDDPSendFrame(DDPFramePtr frame, NetAddrBlock *address, short protocolType, short socket);
 
+// Incoming datagrams are queued by the receiving thread.  Normally that thread also hands them
+// to the packet handler (under the mytm mutex); with deferred dispatch on, it only queues them,
+// and the owner drains the queue with NetDDPDispatchQueuedPackets() while holding the mytm mutex.
+void NetDDPSetDeferredDispatch(bool inDeferred);
+void NetDDPDispatchQueuedPackets(void);
+// outDrops counts datagrams lost to a full queue since the socket was opened
+void NetDDPGetReceiveQueueStats(uint16* outDepth, uint16* outDrops);
+
 /* ---------- prototypes/NETWORK_ADSP.C */
 
 // jkvw: removed - we use TCPMess now
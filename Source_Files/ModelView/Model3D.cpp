@@ -36,6 +36,7 @@
 #endif
 
 #include "Model3D.h"
+#include "Model3D_simd.h"
 
 #ifdef HAVE_OPENGL
 #include "OGL_Headers.h"
@@ -48,6 +49,13 @@
 // the matrices have dimensions (output coords)(input-coord multipliers + offset for output)
 static vector<Model3D_Transform> BoneMatrices;
 static vector<size_t> BoneStack;
+static vector<Model3D_Columns> BoneColumns;
+
+// How many poses each model keeps
+const size_t MAXIMUM_POSES = 8;
+
+// The last positions stamp handed out
+static uint32 LastPositionsStamp = 0;
 
 
 // Find transform of point (source and dest must be different arrays)
@@ -101,6 +109,7 @@ void Model3D::Clear()
 	Frames.clear();
 	SeqFrames.clear();
 	SeqFrmPointers.clear();
+	ForgetPoses();
 	FindBoundingBox();
 }
 
@@ -222,6 +231,8 @@ void Model3D::CalculateTangents()
 // Normalize the normals
 void Model3D::AdjustNormals(int NormalType, float SmoothThreshold)
 {
+	ForgetPoses();
+	
 	// Copy in normal sources for processing
 	if (!NormSources.empty())
 	{
@@ -660,6 +671,8 @@ void Model3D::BuildTrigTables()
 
 void Model3D::BuildInverseVSIndices()
 {
+	ForgetPoses();
+	
 	if (VtxSrcIndices.empty()) return;
 	
 	InverseVSIndices.resize(VtxSrcIndices.size());
@@ -706,6 +719,9 @@ bool Model3D::FindPositions_Neutral(bool UseModelTransform)
 	// Positions already there
 	if (VtxSrcIndices.empty()) return false;
 	
+	CurrentPose = UNONE;
+	PositionsStamp = NewPositionsStamp();
+	
 	// Straight copy of the vertices:
 	
 	size_t NumVertices = VtxSrcIndices.size();
@@ -757,20 +773,14 @@ bool Model3D::FindPositions_Neutral(bool UseModelTransform)
 	
 	// Copy in the normals
 	Normals.resize(NormSources.size());
+	if (Normals.empty()) return true;
 	
+	objlist_copy(NormBase(),NormSrcBase(),NormSources.size());
 	if (UseModelTransform)
 	{
-		GLfloat *NormPtr = NormBase();
-		GLfloat *NormBasePtr = NormSrcBase();
-		size_t NumNorms = NormSources.size()/3;
-		for (size_t k=0; k<NumNorms; k++, NormPtr+=3, NormBasePtr+=3)
-		{
-			TransformVector(NormPtr, NormBasePtr, TransformNorm);			
-		}
-	}
-	else
-	{
-		objlist_copy(NormBase(),NormSrcBase(),NormSources.size());
+		Model3D_Columns T;
+		T.Set(TransformNorm);
+		current_model_kernels->transform_vectors(NormBase(), Normals.size()/3, T);
 	}
 	
 	return true;
@@ -779,6 +789,17 @@ bool Model3D::FindPositions_Neutral(bool UseModelTransform)
 // Frame case
 bool Model3D::FindPositions_Frame(bool UseModelTransform,
 	GLshort FrameIndex, GLfloat MixFrac, GLshort AddlFrameIndex)
+{
+	if (FindCachedPose(NONE,UseModelTransform,FrameIndex,MixFrac,AddlFrameIndex)) return true;
+	
+	if (!FindPositions_Bones(UseModelTransform,FrameIndex,MixFrac,AddlFrameIndex)) return false;
+	
+	CachePose(NONE,UseModelTransform,FrameIndex,MixFrac,AddlFrameIndex);
+	return true;
+}
+
+bool Model3D::FindPositions_Bones(bool UseModelTransform,
+	GLshort FrameIndex, GLfloat MixFrac, GLshort AddlFrameIndex)
 {
 	// Bad inputs: do nothing and return false
 	
@@ -789,6 +810,9 @@ bool Model3D::FindPositions_Frame(bool UseModelTransform,
 	
 	if (InverseVSIndices.empty()) BuildInverseVSIndices();
 	
+	CurrentPose = UNONE;
+	PositionsStamp = NewPositionsStamp();
+	
 	size_t NumVertices = VtxSrcIndices.size();
 	Positions.resize(3*NumVertices);
 	
@@ -842,86 +866,37 @@ bool Model3D::FindPositions_Frame(bool UseModelTransform,
 	bool NormalsPresent = !NormSources.empty();
 	if (NormalsPresent) Normals.resize(NormSources.size());
 	
-	for (unsigned ivs=0; ivs<VtxSources.size(); ivs++)
+	// Move every vertex source by its bones, all at once
+	if (!VtxSources.empty() && !Positions.empty())
 	{
-		Model3D_VertexSource& VS = VtxSources[ivs];
-		GLfloat Position[3];
+		BoneColumns.resize(NumBones);
+		for (size_t ib=0; ib<NumBones; ib++)
+			BoneColumns[ib].Set(BoneMatrices[ib]);
 		
-		if (VS.Bone0 >= 0)
-		{
-			Model3D_Transform& T0 = BoneMatrices[VS.Bone0];
-			TransformPoint(Position,VS.Position,T0);
-
-			if (NormalsPresent)
-			{
-				for (int iv=InvVSIPointers[ivs]; iv<InvVSIPointers[ivs+1]; iv++)
-				{
-					int Indx = 3*InverseVSIndices[iv];
-					TransformVector(NormBase() + Indx, NormSrcBase() + Indx, T0);
-				}
-			}			
-			
-			GLfloat Blend = VS.Blend;
-			if (VS.Bone1 >= 0 && Blend != 0)
-			{
-				Model3D_Transform& T1 = BoneMatrices[VS.Bone1];
-				GLfloat PosExtra[3];
-				GLfloat PosDiff[3];
-				TransformPoint(PosExtra,VS.Position,T1);
-				VecSub(PosExtra,Position,PosDiff);
-				VecScalarMultTo(PosDiff,Blend);
-				VecAddTo(Position,PosDiff);
-				
-				if (NormalsPresent)
-				{
-					for (int iv=InvVSIPointers[ivs]; iv<InvVSIPointers[ivs+1]; iv++)
-					{
-						int Indx = 3*InverseVSIndices[iv];
-						GLfloat NormExtra[3];
-						GLfloat NormDiff[3];
-						GLfloat *OrigNorm = NormSrcBase() + Indx;
-						GLfloat *Norm = NormBase() + Indx;
-						TransformVector(NormExtra,OrigNorm,T1);
-						VecSub(NormExtra,Norm,NormDiff);
-						VecScalarMultTo(NormDiff,Blend);
-						VecAddTo(Norm,NormDiff);
-					}
-				}			
-			}
-		}
-		else	// The assumed root bone (identity transformation)
-		{
-			VecCopy(VS.Position,Position);
-			if (NormalsPresent)
-			{
-				for (int iv=InvVSIPointers[ivs]; iv<InvVSIPointers[ivs+1]; iv++)
-				{
-					int Indx = 3*InverseVSIndices[iv];
-					VecCopy(NormSrcBase() + Indx, NormBase() + Indx);
-				}
-			}
-		}
-		
-		// Copy found position into vertex array!
-		for (int iv=InvVSIPointers[ivs]; iv<InvVSIPointers[ivs+1]; iv++)
-			VecCopy(Position,PosBase() + 3*InverseVSIndices[iv]);
+		model_skinning_job Job;
+		Job.sources = VtxSrcBase();
+		Job.source_count = VtxSources.size();
+		Job.inverse_pointers = InvVSIPtrBase();
+		Job.inverse_indices = InverseVSIndices.empty() ? NULL : InverseVIBase();
+		Job.bones = BoneColumns.empty() ? NULL : &BoneColumns[0];
+		Job.normal_sources = NormalsPresent ? NormSrcBase() : NULL;
+		Job.positions = PosBase();
+		Job.normals = NormalsPresent ? NormBase() : NULL;
+		current_model_kernels->skin(Job);
 	}
 	
 	if (UseModelTransform)
 	{
-		GLfloat *PP = PosBase();
-		for (size_t k=0; k<Positions.size()/3; k++, PP+=3)
+		Model3D_Columns T;
+		if (!Positions.empty())
 		{
-			GLfloat Position[3];
-			TransformPoint(Position,PP,TransformPos);
-			VecCopy(Position,PP);
+			T.Set(TransformPos);
+			current_model_kernels->transform_points(PosBase(), Positions.size()/3, T);
 		}
-		GLfloat *NP = NormBase();
-		for (size_t k=0; k<Normals.size()/3; k++, NP+=3)
+		if (!Normals.empty())
 		{
-			GLfloat Normal[3];
-			TransformVector(Normal,NP,TransformNorm);
-			VecCopy(Normal,NP);
+			T.Set(TransformNorm);
+			current_model_kernels->transform_vectors(NormBase(), Normals.size()/3, T);
 		}
 	}
 	
@@ -947,61 +922,120 @@ bool Model3D::FindPositions_Sequence(bool UseModelTransform, GLshort SeqIndex,
 	
 	if (FrameIndex < 0 || FrameIndex >= NumSF) return false;
 	
+	// Without a crossfade, the other frame doesn't matter
+	bool Mixed = (MixFrac != 0 && AddlFrameIndex != FrameIndex);
+	if (Mixed && (AddlFrameIndex < 0 || AddlFrameIndex >= NumSF)) return false;
+	if (!Mixed)
+	{
+		MixFrac = 0;
+		AddlFrameIndex = FrameIndex;
+	}
+	
+	if (FindCachedPose(SeqIndex,UseModelTransform,FrameIndex,MixFrac,AddlFrameIndex)) return true;
+	
 	Model3D_Transform TSF;
 	
 	Model3D_SeqFrame& SF = SeqFrames[SeqFrmPointers[SeqIndex] + FrameIndex];
 	
-	if (MixFrac != 0 && AddlFrameIndex != FrameIndex)
+	if (Mixed)
 	{
-		if (AddlFrameIndex < 0 || AddlFrameIndex >= NumSF) return false;
-		
 		Model3D_SeqFrame& ASF = SeqFrames[SeqFrmPointers[SeqIndex] + AddlFrameIndex];
 		FindFrameTransform(TSF,SF,MixFrac,ASF);
 		
-		if (!FindPositions_Frame(false,SF.Frame,MixFrac,ASF.Frame)) return false;
+		if (!FindPositions_Bones(false,SF.Frame,MixFrac,ASF.Frame)) return false;
 	}
 	else
 	{
-		if (!FindPositions_Frame(false,SF.Frame)) return false;
+		if (!FindPositions_Bones(false,SF.Frame,0,0)) return false;
 		FindFrameTransform(TSF,SF,0,SF);
 	}
 	
 	Model3D_Transform TTot;
+	Model3D_Columns T;
 	if (UseModelTransform)
 		TMatMultiply(TTot,TransformPos,TSF);
 	else
 		obj_copy(TTot,TSF);
 	
 	size_t NumVerts = Positions.size()/3;
-	GLfloat *Pos = PosBase();
-	for (size_t iv=0; iv<NumVerts; iv++)
+	if (NumVerts > 0)
 	{
-		GLfloat NewPos[3];
-		TransformPoint(NewPos,Pos,TTot);
-		VecCopy(NewPos,Pos);
-		Pos += 3;
+		T.Set(TTot);
+		current_model_kernels->transform_points(PosBase(),NumVerts,T);
 	}
 	
 	bool NormalsPresent = !NormSources.empty();
-	if (NormalsPresent)
+	if (NormalsPresent && NumVerts > 0)
 	{	
 		// OK, since the bones don't change bulk
 		if (UseModelTransform)
 			TMatMultiply(TTot,TransformNorm,TSF);
 		else
 			obj_copy(TTot,TSF);
-				
-		GLfloat *Norm = NormBase();
-		for (size_t iv=0; iv<NumVerts; iv++)
+		
+		T.Set(TTot);
+		current_model_kernels->transform_vectors(NormBase(),NumVerts,T);
+	}
+	
+	CachePose(SeqIndex,UseModelTransform,FrameIndex,MixFrac,AddlFrameIndex);
+	return true;
+}
+
+
+bool Model3D::FindCachedPose(GLshort SeqIndex, bool UseModelTransform,
+	GLshort FrameIndex, GLfloat MixFrac, GLshort AddlFrameIndex)
+{
+	for (size_t k=0; k<Poses.size(); k++)
+	{
+		Model3D_Pose& Pose = Poses[k];
+		if (Pose.SeqIndex == SeqIndex && Pose.UseModelTransform == UseModelTransform &&
+			Pose.FrameIndex == FrameIndex && Pose.MixFrac == MixFrac &&
+			Pose.AddlFrameIndex == AddlFrameIndex)
 		{
-			GLfloat NewNorm[3];
-			TransformVector(NewNorm,Norm,TTot);
-			VecCopy(NewNorm,Norm);
-			Norm += 3;
+			// Already there?
+			if (CurrentPose != k)
+			{
+				Positions = Pose.Positions;
+				Normals = Pose.Normals;
+				CurrentPose = k;
+				PositionsStamp = NewPositionsStamp();
+			}
+			return true;
 		}
 	}
+	return false;
+}
+
+void Model3D::CachePose(GLshort SeqIndex, bool UseModelTransform,
+	GLshort FrameIndex, GLfloat MixFrac, GLshort AddlFrameIndex)
+{
+	size_t k;
+	if (Poses.size() < MAXIMUM_POSES)
+	{
+		k = Poses.size();
+		Poses.resize(k+1);
+	}
+	else
+	{
+		k = NextPose;
+		NextPose = (NextPose+1) % MAXIMUM_POSES;
+	}
 	
-	return true;
+	Model3D_Pose& Pose = Poses[k];
+	Pose.SeqIndex = SeqIndex;
+	Pose.UseModelTransform = UseModelTransform;
+	Pose.FrameIndex = FrameIndex;
+	Pose.MixFrac = MixFrac;
+	Pose.AddlFrameIndex = AddlFrameIndex;
+	Pose.Positions = Positions;
+	Pose.Normals = Normals;
+	CurrentPose = k;
+}
+
+
+uint32 Model3D::NewPositionsStamp()
+{
+	return ++LastPositionsStamp;
 }
 
 
@@ -97,6 +97,19 @@ struct Model3D_Transform
 };
 
 
+// Positions and normals already found for a frame or sequence frame, kept so that
+// drawing the same one again (as for several monsters in step) is only a copy
+struct Model3D_Pose
+{
+	GLshort SeqIndex;		// NONE for a frame
+	GLshort FrameIndex, AddlFrameIndex;
+	GLfloat MixFrac;
+	bool UseModelTransform;
+	
+	vector<GLfloat> Positions, Normals;
+};
+
+
 struct Model3D
 {
 	// Assumed dimensions:
@@ -251,8 +264,33 @@ struct Model3D
 	bool FindPositions_Sequence(bool UseModelTransform, GLshort SeqIndex,
 		GLshort FrameIndex, GLfloat MixFrac = 0, GLshort AddlFrameIndex = 0);
 	
+	// The last few frames and sequence frames found; anything that changes the
+	// vertex sources, normals, bones or frames after they're in use must forget them
+	vector<Model3D_Pose> Poses;
+	void ForgetPoses() {Poses.clear(); NextPose = 0; CurrentPose = UNONE; PositionsStamp = NewPositionsStamp();}
+	
+	// Different every time the positions are found for a frame or sequence frame
+	// (or the model is cleared), and never the same for two models, so that whatever
+	// was worked out from the positions can tell whether it's still good
+	uint32 PositionsStamp;
+	static uint32 NewPositionsStamp();
+	
 	// Constructor
-	Model3D() {FindBoundingBox(); TransformPos.Identity(); TransformNorm.Identity();}
+	Model3D(): PositionsStamp(NewPositionsStamp()), NextPose(0), CurrentPose(UNONE) {FindBoundingBox(); TransformPos.Identity(); TransformNorm.Identity();}
+
+private:
+	size_t NextPose;		// Which to replace next
+	size_t CurrentPose;		// Which one the positions and normals are now, if any
+	
+	// Find a pose in the list and copy it in, or put the one just found into it
+	bool FindCachedPose(GLshort SeqIndex, bool UseModelTransform,
+		GLshort FrameIndex, GLfloat MixFrac, GLshort AddlFrameIndex);
+	void CachePose(GLshort SeqIndex, bool UseModelTransform,
+		GLshort FrameIndex, GLfloat MixFrac, GLshort AddlFrameIndex);
+	
+	// FindPositions_Frame() without looking in the list
+	bool FindPositions_Bones(bool UseModelTransform,
+		GLshort FrameIndex, GLfloat MixFrac, GLshort AddlFrameIndex);
 };
 
 #endif
@@ -0,0 +1,514 @@
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Skinning kernels for Model3D
+*/
+
+#include "cseries.h"
+#include "VecOps.h"
+#include "world.h"
+
+#ifdef HAVE_OPENGL
+
+#include "Model3D.h"
+#include "Model3D_simd.h"
+
+#include <SDL_cpuinfo.h>
+#include <SDL_timer.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MODEL_SSE2
+#include <emmintrin.h>
+#endif
+
+void Model3D_Columns::Set(const Model3D_Transform& T)
+{
+	for (int j=0; j<4; j++)
+	{
+		for (int i=0; i<3; i++)
+			C[j][i] = T.M[i][j];
+		C[j][3] = 0;
+	}
+}
+
+/* ---------- scalar */
+
+// What TransformPoint() and TransformVector() in Model3D.cpp do, a row at a time
+static inline void transform_point_scalar(GLfloat *Dest, const GLfloat *Src, const Model3D_Columns& T)
+{
+	for (int ic=0; ic<3; ic++)
+		Dest[ic] = (Src[0]*T.C[0][ic] + Src[1]*T.C[1][ic] + Src[2]*T.C[2][ic]) + T.C[3][ic];
+}
+
+static inline void transform_vector_scalar(GLfloat *Dest, const GLfloat *Src, const Model3D_Columns& T)
+{
+	for (int ic=0; ic<3; ic++)
+		Dest[ic] = Src[0]*T.C[0][ic] + Src[1]*T.C[1][ic] + Src[2]*T.C[2][ic];
+}
+
+static void skin_scalar(const model_skinning_job& job)
+{
+	for (size_t ivs=0; ivs<job.source_count; ivs++)
+	{
+		const Model3D_VertexSource& VS = job.sources[ivs];
+		int First = job.inverse_pointers[ivs], Last = job.inverse_pointers[ivs+1];
+		GLfloat Position[3];
+
+		if (VS.Bone0 >= 0)
+		{
+			const Model3D_Columns& T0 = job.bones[VS.Bone0];
+			transform_point_scalar(Position,VS.Position,T0);
+
+			if (job.normal_sources)
+			{
+				for (int iv=First; iv<Last; iv++)
+				{
+					int Indx = 3*job.inverse_indices[iv];
+					transform_vector_scalar(job.normals + Indx, job.normal_sources + Indx, T0);
+				}
+			}
+
+			GLfloat Blend = VS.Blend;
+			if (VS.Bone1 >= 0 && Blend != 0)
+			{
+				const Model3D_Columns& T1 = job.bones[VS.Bone1];
+				GLfloat PosExtra[3];
+				transform_point_scalar(PosExtra,VS.Position,T1);
+				for (int ic=0; ic<3; ic++)
+					Position[ic] += (PosExtra[ic] - Position[ic])*Blend;
+
+				if (job.normal_sources)
+				{
+					for (int iv=First; iv<Last; iv++)
+					{
+						int Indx = 3*job.inverse_indices[iv];
+						GLfloat NormExtra[3];
+						GLfloat *Norm = job.normals + Indx;
+						transform_vector_scalar(NormExtra, job.normal_sources + Indx, T1);
+						for (int ic=0; ic<3; ic++)
+							Norm[ic] += (NormExtra[ic] - Norm[ic])*Blend;
+					}
+				}
+			}
+		}
+		else	// The assumed root bone (identity transformation)
+		{
+			VecCopy(VS.Position,Position);
+			if (job.normal_sources)
+			{
+				for (int iv=First; iv<Last; iv++)
+				{
+					int Indx = 3*job.inverse_indices[iv];
+					VecCopy(job.normal_sources + Indx, job.normals + Indx);
+				}
+			}
+		}
+
+		for (int iv=First; iv<Last; iv++)
+			VecCopy(Position, job.positions + 3*job.inverse_indices[iv]);
+	}
+}
+
+static void transform_points_scalar(GLfloat *Vectors, size_t Count, const Model3D_Columns& T)
+{
+	for (size_t k=0; k<Count; k++, Vectors+=3)
+	{
+		GLfloat Point[3];
+		transform_point_scalar(Point,Vectors,T);
+		VecCopy(Point,Vectors);
+	}
+}
+
+static void transform_vectors_scalar(GLfloat *Vectors, size_t Count, const Model3D_Columns& T)
+{
+	for (size_t k=0; k<Count; k++, Vectors+=3)
+	{
+		GLfloat Vector[3];
+		transform_vector_scalar(Vector,Vectors,T);
+		VecCopy(Vector,Vectors);
+	}
+}
+
+static const model_kernels scalar_kernels = {
+	"scalar",
+	skin_scalar,
+	transform_points_scalar,
+	transform_vectors_scalar
+};
+
+/* ---------- SSE2 */
+
+#ifdef MODEL_SSE2
+
+// A point or vector at a time, the columns scaled by its x, y and z and added up in the
+// same order as the scalar rows
+struct sse2_columns
+{
+	__m128 C[4];
+
+	sse2_columns(const Model3D_Columns& T)
+	{
+		for (int j=0; j<4; j++)
+			C[j] = _mm_loadu_ps(T.C[j]);
+	}
+
+	__m128 vector(const GLfloat *Src) const
+	{
+		__m128 r = _mm_mul_ps(_mm_set1_ps(Src[0]), C[0]);
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(Src[1]), C[1]));
+		return _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(Src[2]), C[2]));
+	}
+
+	__m128 point(const GLfloat *Src) const
+	{
+		return _mm_add_ps(vector(Src), C[3]);
+	}
+};
+
+static inline void store3_sse2(GLfloat *Dest, __m128 v)
+{
+	_mm_storel_pi(reinterpret_cast<__m64 *>(Dest), v);
+	_mm_store_ss(Dest + 2, _mm_movehl_ps(v, v));
+}
+
+// a + (b - a)*blend, as the scalar blends do it
+static inline __m128 blend_sse2(__m128 a, __m128 b, __m128 blend)
+{
+	return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), blend));
+}
+
+static void skin_sse2(const model_skinning_job& job)
+{
+	for (size_t ivs=0; ivs<job.source_count; ivs++)
+	{
+		const Model3D_VertexSource& VS = job.sources[ivs];
+		int First = job.inverse_pointers[ivs], Last = job.inverse_pointers[ivs+1];
+		__m128 Position;
+
+		if (VS.Bone0 >= 0)
+		{
+			sse2_columns T0(job.bones[VS.Bone0]);
+			Position = T0.point(VS.Position);
+
+			GLfloat Blend = VS.Blend;
+			if (VS.Bone1 >= 0 && Blend != 0)
+			{
+				sse2_columns T1(job.bones[VS.Bone1]);
+				__m128 Blends = _mm_set1_ps(Blend);
+				Position = blend_sse2(Position, T1.point(VS.Position), Blends);
+
+				if (job.normal_sources)
+				{
+					for (int iv=First; iv<Last; iv++)
+					{
+						int Indx = 3*job.inverse_indices[iv];
+						const GLfloat *OrigNorm = job.normal_sources + Indx;
+						store3_sse2(job.normals + Indx, blend_sse2(T0.vector(OrigNorm), T1.vector(OrigNorm), Blends));
+					}
+				}
+			}
+			else if (job.normal_sources)
+			{
+				for (int iv=First; iv<Last; iv++)
+				{
+					int Indx = 3*job.inverse_indices[iv];
+					store3_sse2(job.normals + Indx, T0.vector(job.normal_sources + Indx));
+				}
+			}
+		}
+		else	// The assumed root bone (identity transformation)
+		{
+			Position = _mm_setr_ps(VS.Position[0], VS.Position[1], VS.Position[2], 0);
+			if (job.normal_sources)
+			{
+				for (int iv=First; iv<Last; iv++)
+				{
+					int Indx = 3*job.inverse_indices[iv];
+					VecCopy(job.normal_sources + Indx, job.normals + Indx);
+				}
+			}
+		}
+
+		for (int iv=First; iv<Last; iv++)
+			store3_sse2(job.positions + 3*job.inverse_indices[iv], Position);
+	}
+}
+
+static void transform_points_sse2(GLfloat *Vectors, size_t Count, const Model3D_Columns& T)
+{
+	sse2_columns Columns(T);
+	for (size_t k=0; k<Count; k++, Vectors+=3)
+		store3_sse2(Vectors, Columns.point(Vectors));
+}
+
+static void transform_vectors_sse2(GLfloat *Vectors, size_t Count, const Model3D_Columns& T)
+{
+	sse2_columns Columns(T);
+	for (size_t k=0; k<Count; k++, Vectors+=3)
+		store3_sse2(Vectors, Columns.vector(Vectors));
+}
+
+static const model_kernels sse2_kernels = {
+	"SSE2",
+	skin_sse2,
+	transform_points_sse2,
+	transform_vectors_sse2
+};
+
+#endif
+
+/* ---------- selection */
+
+const model_kernels *get_model_kernels(int set)
+{
+	switch (set)
+	{
+		case _model_kernels_scalar:
+			return &scalar_kernels;
+#ifdef MODEL_SSE2
+		case _model_kernels_sse2:
+			return SDL_HasSSE2() ? &sse2_kernels : NULL;
+#endif
+		default:
+			return NULL;
+	}
+}
+
+static int best_model_kernels()
+{
+	int set = NUMBER_OF_MODEL_KERNEL_SETS - 1;
+	while (!get_model_kernels(set))
+		--set;
+	return set;
+}
+
+static int current_model_kernel_set = best_model_kernels();
+const model_kernels *current_model_kernels = get_model_kernels(current_model_kernel_set);
+
+void set_model_kernels(int set)
+{
+	if (get_model_kernels(set))
+	{
+		current_model_kernel_set = set;
+		current_model_kernels = get_model_kernels(set);
+	}
+}
+
+int get_model_kernels_set()
+{
+	return current_model_kernel_set;
+}
+
+/* ---------- benchmark */
+
+const int BENCHMARK_PASSES = 20;
+
+static uint32 benchmark_random(uint32& seed)
+{
+	// xorshift
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+static GLfloat benchmark_float(uint32& seed, GLfloat range)
+{
+	return range * (static_cast<GLfloat>(benchmark_random(seed) % 2001) / 1000 - 1);
+}
+
+struct benchmark_pose
+{
+	GLshort Sequence, Frame, NextFrame;
+	GLfloat MixFrac;
+};
+
+// Every frame of every sequence, crossfading a third of the way to the next
+static void find_benchmark_poses(Model3D& Model, std::vector<benchmark_pose>& Poses)
+{
+	for (int Seq=0; Seq<Model.TrueNumSeqs(); Seq++)
+	{
+		GLshort NumFrames = Model.NumSeqFrames(Seq);
+		for (GLshort Frame=0; Frame<NumFrames; Frame++)
+		{
+			benchmark_pose Pose;
+			Pose.Sequence = Seq;
+			Pose.Frame = Frame;
+			Pose.NextFrame = (Frame + 1) % NumFrames;
+			Pose.MixFrac = GLfloat(1)/3;
+			Poses.push_back(Pose);
+		}
+	}
+}
+
+static size_t find_benchmark_pose(Model3D& Model, const benchmark_pose& Pose)
+{
+	if (!Model.FindPositions_Sequence(true, Pose.Sequence, Pose.Frame, Pose.MixFrac, Pose.NextFrame))
+		return 0;
+	return Model.Positions.size()/3;
+}
+
+bool benchmark_model_skinning(Model3D& Model, model_skinning_timing& timing)
+{
+	std::vector<benchmark_pose> Poses;
+	find_benchmark_poses(Model, Poses);
+	if (Poses.empty() || Model.VtxSources.empty())
+		return false;
+
+	timing.identical = true;
+	timing.cached_vertices_per_second = 0;
+
+	int original_set = get_model_kernels_set();
+	std::vector<GLfloat> reference;
+	for (int set = 0; set < NUMBER_OF_MODEL_KERNEL_SETS; set++)
+	{
+		timing.vertices_per_second[set] = 0;
+		if (!get_model_kernels(set))
+			continue;
+		set_model_kernels(set);
+
+		// One pass to compare...
+		std::vector<GLfloat> found;
+		for (size_t i = 0; i < Poses.size(); i++)
+		{
+			Model.ForgetPoses();
+			find_benchmark_pose(Model, Poses[i]);
+			found.insert(found.end(), Model.Positions.begin(), Model.Positions.end());
+			found.insert(found.end(), Model.Normals.begin(), Model.Normals.end());
+		}
+		if (set == _model_kernels_scalar)
+			reference = found;
+		else if (found != reference)
+			timing.identical = false;
+
+		// ...then a few more to time, never finding a pose in the list
+		size_t vertices = 0;
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int pass = 0; pass < BENCHMARK_PASSES; pass++)
+		{
+			for (size_t i = 0; i < Poses.size(); i++)
+			{
+				Model.ForgetPoses();
+				vertices += find_benchmark_pose(Model, Poses[i]);
+			}
+		}
+		double seconds = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+		if (seconds > 0)
+			timing.vertices_per_second[set] = vertices / seconds;
+	}
+	set_model_kernels(original_set);
+
+	// Several monsters in step, with another in between each so the list is copied from
+	Model.ForgetPoses();
+	size_t vertices = 0;
+	Uint64 start = SDL_GetPerformanceCounter();
+	for (int pass = 0; pass < BENCHMARK_PASSES; pass++)
+	{
+		for (size_t i = 0; i < Poses.size(); i++)
+		{
+			vertices += find_benchmark_pose(Model, Poses[0]);
+			vertices += find_benchmark_pose(Model, Poses[Poses.size() - 1]);
+		}
+	}
+	double seconds = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+	if (seconds > 0)
+		timing.cached_vertices_per_second = vertices / seconds;
+
+	Model.ForgetPoses();
+	return true;
+}
+
+void build_benchmark_model(Model3D& Model)
+{
+	const int NumBones = 24;
+	const int NumVtxSources = 2000;
+	const int NumSeqs = 4;
+	const int NumFramesPerSeq = 12;
+
+	uint32 seed = 0x5eed5eed;
+	Model3D::BuildTrigTables();
+	Model.Clear();
+
+	// A spine, with a limb off it every fourth bone
+	Model.Bones.resize(NumBones);
+	for (int ib=0; ib<NumBones; ib++)
+	{
+		Model3D_Bone& Bone = Model.Bones[ib];
+		for (int ic=0; ic<3; ic++)
+			Bone.Position[ic] = benchmark_float(seed, 50);
+		Bone.Flags = (ib % 4 == 0) ? (Model3D_Bone::Pop | Model3D_Bone::Push) : 0;
+	}
+
+	// Three quarters of the sources blended between two bones, as in Dim3 monsters
+	Model.VtxSources.resize(NumVtxSources);
+	for (int ivs=0; ivs<NumVtxSources; ivs++)
+	{
+		Model3D_VertexSource& VS = Model.VtxSources[ivs];
+		for (int ic=0; ic<3; ic++)
+			VS.Position[ic] = benchmark_float(seed, 100);
+		VS.Bone0 = benchmark_random(seed) % NumBones;
+		VS.Bone1 = (ivs % 4) ? GLshort(benchmark_random(seed) % NumBones) : GLshort(NONE);
+		VS.Blend = static_cast<GLfloat>(benchmark_random(seed) % 1000) / 1000;
+	}
+
+	// Triangles of three different sources, each source making three vertices
+	for (int iv=0; iv<3*NumVtxSources; iv++)
+	{
+		Model.VtxSrcIndices.push_back(GLushort(benchmark_random(seed) % NumVtxSources));
+		Model.VertIndices.push_back(GLushort(iv));
+		for (int ic=0; ic<3; ic++)
+			Model.NormSources.push_back(benchmark_float(seed, 1));
+	}
+
+	for (int iframe=0; iframe<NumSeqs*NumFramesPerSeq; iframe++)
+	{
+		for (int ib=0; ib<NumBones; ib++)
+		{
+			Model3D_Frame Frame;
+			for (int ic=0; ic<3; ic++)
+			{
+				Frame.Offset[ic] = benchmark_float(seed, 5);
+				Frame.Angles[ic] = GLshort(benchmark_random(seed) % FULL_CIRCLE);
+			}
+			Model.Frames.push_back(Frame);
+		}
+	}
+
+	for (int iseq=0; iseq<NumSeqs; iseq++)
+	{
+		Model.SeqFrmPointers.push_back(GLushort(Model.SeqFrames.size()));
+		for (int iframe=0; iframe<NumFramesPerSeq; iframe++)
+		{
+			Model3D_SeqFrame SeqFrame;
+			for (int ic=0; ic<3; ic++)
+			{
+				SeqFrame.Offset[ic] = benchmark_float(seed, 20);
+				SeqFrame.Angles[ic] = GLshort(benchmark_random(seed) % FULL_CIRCLE);
+			}
+			SeqFrame.Frame = GLshort(iseq*NumFramesPerSeq + iframe);
+			Model.SeqFrames.push_back(SeqFrame);
+		}
+	}
+	Model.SeqFrmPointers.push_back(GLushort(Model.SeqFrames.size()));
+
+	Model.BuildInverseVSIndices();
+	Model.FindPositions_Neutral(false);
+	Model.FindBoundingBox();
+}
+
+#endif
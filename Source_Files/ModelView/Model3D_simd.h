@@ -0,0 +1,115 @@
+#ifndef MODEL_3D_SIMD
+#define MODEL_3D_SIMD
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Skinning kernels for Model3D
+
+	The loops of Model3D::FindPositions_Frame() that move every vertex source by its bones
+	(and the normals of the vertices made from it), and the loops that move every position
+	and normal by a single transform, in scalar and SSE2 versions.  The best set the CPU can
+	run is picked at startup; both do the same arithmetic in the same order, so they come
+	out exactly the same.  (There's no AVX set: with a different pair of bones for every
+	vertex source, putting them side by side in one register costs more than it saves.)
+*/
+
+#include "Model3D.h"
+
+#ifdef HAVE_OPENGL
+
+#include <string>
+#include <vector>
+
+// A transform laid out by columns, for the kernels: the multipliers of x, then of y, then
+// of z, then the offsets, each padded to four floats with a zero
+struct Model3D_Columns
+{
+	GLfloat C[4][4];
+
+	void Set(const Model3D_Transform& T);
+};
+
+struct model_skinning_job
+{
+	const Model3D_VertexSource *sources;
+	size_t source_count;
+
+	// Which vertices each source makes: those in inverse_indices between
+	// inverse_pointers[source] and inverse_pointers[source + 1]
+	const GLushort *inverse_pointers;
+	const GLushort *inverse_indices;
+
+	// By bone
+	const Model3D_Columns *bones;
+
+	// 3 per vertex; normal_sources is NULL if the model has no normals
+	const GLfloat *normal_sources;
+	GLfloat *positions;
+	GLfloat *normals;
+};
+
+typedef void (*model_skinning_proc)(const model_skinning_job& job);
+// In place; 3 floats each
+typedef void (*model_transform_proc)(GLfloat *vectors, size_t count, const Model3D_Columns& T);
+
+enum /* model skinning kernel sets */
+{
+	_model_kernels_scalar,
+	_model_kernels_sse2,
+	NUMBER_OF_MODEL_KERNEL_SETS
+};
+
+struct model_kernels
+{
+	const char *name;
+
+	model_skinning_proc skin;
+	model_transform_proc transform_points;		// with the offsets
+	model_transform_proc transform_vectors;		// without
+};
+
+// What Model3D calls
+extern const model_kernels *current_model_kernels;
+
+// NULL if this build or this CPU can't run the set; the scalar set is always there
+const model_kernels *get_model_kernels(int set);
+
+void set_model_kernels(int set);
+int get_model_kernels_set();
+
+struct model_skinning_timing
+{
+	std::string model;
+	// by kernel set, each pose a different one; 0 where the set isn't available
+	double vertices_per_second[NUMBER_OF_MODEL_KERNEL_SETS];
+	// the same pose over and over, as for several monsters in step
+	double cached_vertices_per_second;
+	// every available set found what the scalar set did
+	bool identical;
+};
+
+// Times FindPositions_Sequence() on every sequence and frame of an animated model
+// with every available kernel set; false if the model isn't animated
+bool benchmark_model_skinning(Model3D& Model, model_skinning_timing& timing);
+
+// A made-up animated model, like a Dim3 monster, for when there's none at hand
+void build_benchmark_model(Model3D& Model);
+
+#endif
+
+#endif
@@ -35,6 +35,12 @@
 
 #include "ModelRenderer.h"
 #include <algorithm>
+#include <math.h>
+
+#include <SDL_timer.h>
+
+// The depth keys are 16 bits, sorted a byte at a time
+const int DEPTH_KEY_RADIX = 256;
 
 void ModelRenderer::Render(Model3D& Model, ModelRenderShader *Shaders, int NumShaders,
 	int NumSeparableShaders, bool Use_Z_Buffer)
@@ -67,29 +73,9 @@ void ModelRenderer::Render(Model3D& Model, ModelRenderShader *Shaders, int NumSh
 	// OpenGL != PowerVR
 	// (which can store polygons and depth-sort them in its hardware)
 	
-	// Find the centroids:
-	size_t NumTriangles = Model.NumVI()/3;
-	IndexedCentroidDepths.resize(NumTriangles);
-	
-	GLushort *VIPtr = Model.VIBase();
-	for (unsigned short k=0; k<NumTriangles; k++)
-	{
-		GLfloat Sum[3] = {0, 0, 0};
-		for (int v=0; v<3; v++)
-		{
-			GLfloat *Pos = &Model.Positions[3*(*VIPtr)];
-			Sum[0] += Pos[0];
-			Sum[1] += Pos[1];
-			Sum[2] += Pos[2];
-			VIPtr++;
-		}
-		IndexedCentroidDepths[k].index = k;
-		IndexedCentroidDepths[k].depth = 
-			Sum[0]*ViewDirection[0] + Sum[1]*ViewDirection[1] + Sum[2]*ViewDirection[2];
-	}
-	
 	// Sort!
-	std::sort(IndexedCentroidDepths.begin(), IndexedCentroidDepths.end());
+	size_t NumTriangles = Model.NumVI()/3;
+	const GLushort *Order = SortTriangles(Model);
 	
 	// Optimization: a single nonseparable shader can be rendered as if it was separable,
 	// though it must still be depth-sorted.
@@ -105,7 +91,7 @@ void ModelRenderer::Render(Model3D& Model, ModelRenderShader *Shaders, int NumSh
 			GLushort *DestTriangle = &SortedVertIndices[0];
 			for (size_t k=0; k<NumTriangles; k++)
 			{
-				GLushort *SourceTriangle = &Model.VertIndices[3*IndexedCentroidDepths[k].index];
+				GLushort *SourceTriangle = &Model.VertIndices[3*Order[k]];
 				// Copy-over unrolled for speed
 				*(DestTriangle++) = *(SourceTriangle++);
 				*(DestTriangle++) = *(SourceTriangle++);
@@ -125,7 +111,7 @@ void ModelRenderer::Render(Model3D& Model, ModelRenderShader *Shaders, int NumSh
 		// Multishader case: each triangle separately
 		for (size_t k=0; k<NumTriangles; k++)
 		{
-			GLushort *Triangle = &Model.VertIndices[3*IndexedCentroidDepths[k].index];
+			GLushort *Triangle = &Model.VertIndices[3*Order[k]];
 			for (int q=NumSeparableShaders; q<NumShaders; q++)
 			{
 				SetupRenderPass(Model,Shaders[q]);
@@ -136,6 +122,194 @@ void ModelRenderer::Render(Model3D& Model, ModelRenderShader *Shaders, int NumSh
 }
 
 
+// Whether two view directions (of any length) are less than some angle apart,
+// from the cosine of that angle
+static bool TurnedLessThan(const GLfloat *Dir0, const GLfloat *Dir1, GLfloat Cosine)
+{
+	GLfloat Dot = Dir0[0]*Dir1[0] + Dir0[1]*Dir1[1] + Dir0[2]*Dir1[2];
+	GLfloat Len0Sq = Dir0[0]*Dir0[0] + Dir0[1]*Dir0[1] + Dir0[2]*Dir0[2];
+	GLfloat Len1Sq = Dir1[0]*Dir1[0] + Dir1[1]*Dir1[1] + Dir1[2]*Dir1[2];
+	return Dot > 0 && Dot*Dot > Cosine*Cosine*Len0Sq*Len1Sq;
+}
+
+const GLushort *ModelRenderer::SortTriangles(Model3D& Model)
+{
+	size_t NumTriangles = Model.NumVI()/3;
+	if (NumTriangles == 0) return NULL;
+	
+	// Still good from last time?
+	SavedOrder *Saved = NULL;
+	if (OrderReuseAngle > 0 && OrderReuseAngle < 90)
+	{
+		Saved = &SavedOrders[&Model];
+		GLfloat Cosine = GLfloat(cos(OrderReuseAngle*M_PI/180));
+		if (Saved->PositionsStamp == Model.PositionsStamp &&
+			Saved->Triangles.size() == NumTriangles &&
+			TurnedLessThan(Saved->ViewDirection,ViewDirection,Cosine))
+			return &Saved->Triangles[0];
+	}
+	
+	// Find the centroids' depths; the sums of the vertices will do,
+	// since only their order matters
+	CentroidDepths.resize(NumTriangles);
+	GLfloat MinDepth = 0, MaxDepth = 0;
+	GLushort *VIPtr = Model.VIBase();
+	for (size_t k=0; k<NumTriangles; k++)
+	{
+		GLfloat Sum[3] = {0, 0, 0};
+		for (int v=0; v<3; v++)
+		{
+			GLfloat *Pos = &Model.Positions[3*(*VIPtr)];
+			Sum[0] += Pos[0];
+			Sum[1] += Pos[1];
+			Sum[2] += Pos[2];
+			VIPtr++;
+		}
+		GLfloat Depth = Sum[0]*ViewDirection[0] + Sum[1]*ViewDirection[1] + Sum[2]*ViewDirection[2];
+		CentroidDepths[k] = Depth;
+		if (k == 0 || Depth < MinDepth) MinDepth = Depth;
+		if (k == 0 || Depth > MaxDepth) MaxDepth = Depth;
+	}
+	
+	// Quantize them, so that the farthest gets 0 and the nearest 65535
+	DepthKeys.resize(NumTriangles);
+	GLfloat Scale = (MaxDepth > MinDepth) ? 65535/(MaxDepth - MinDepth) : 0;
+	for (size_t k=0; k<NumTriangles; k++)
+		DepthKeys[k] = uint16((MaxDepth - CentroidDepths[k])*Scale);
+	
+	// Radix-sort on them, low byte then high byte; each pass keeps the order
+	// of equal keys, so equal-depth triangles stay in model order
+	size_t LowStarts[DEPTH_KEY_RADIX+1], HighStarts[DEPTH_KEY_RADIX+1];
+	obj_clear(LowStarts);
+	obj_clear(HighStarts);
+	for (size_t k=0; k<NumTriangles; k++)
+	{
+		LowStarts[(DepthKeys[k] & 0xff) + 1]++;
+		HighStarts[(DepthKeys[k] >> 8) + 1]++;
+	}
+	for (int b=1; b<DEPTH_KEY_RADIX; b++)
+	{
+		LowStarts[b] += LowStarts[b-1];
+		HighStarts[b] += HighStarts[b-1];
+	}
+	
+	PartialOrder.resize(NumTriangles);
+	TriangleOrder.resize(NumTriangles);
+	for (size_t k=0; k<NumTriangles; k++)
+		PartialOrder[LowStarts[DepthKeys[k] & 0xff]++] = GLushort(k);
+	for (size_t i=0; i<NumTriangles; i++)
+	{
+		GLushort k = PartialOrder[i];
+		TriangleOrder[HighStarts[DepthKeys[k] >> 8]++] = k;
+	}
+	
+	if (!Saved) return &TriangleOrder[0];
+	
+	// Trade buffers with the saved order, so neither has to be allocated again
+	Saved->PositionsStamp = Model.PositionsStamp;
+	objlist_copy(Saved->ViewDirection,ViewDirection,3);
+	Saved->Triangles.swap(TriangleOrder);
+	return &Saved->Triangles[0];
+}
+
+
+// A view turning a degree at a time, all the way around
+const int BENCHMARK_TURNS = 360;
+const int BENCHMARK_PASSES = 10;
+const GLfloat BENCHMARK_REUSE_ANGLE = 5;
+
+static void SetBenchmarkView(ModelRenderer& Renderer, int Turn)
+{
+	double Angle = Turn*M_PI/180;
+	Renderer.ViewDirection[0] = GLfloat(cos(Angle));
+	Renderer.ViewDirection[1] = GLfloat(sin(Angle));
+	Renderer.ViewDirection[2] = 0;
+}
+
+static double TimeSorting(ModelRenderer& Renderer, Model3D& Model)
+{
+	size_t Triangles = 0;
+	Uint64 Start = SDL_GetPerformanceCounter();
+	for (int Pass=0; Pass<BENCHMARK_PASSES; Pass++)
+	{
+		for (int Turn=0; Turn<BENCHMARK_TURNS; Turn++)
+		{
+			SetBenchmarkView(Renderer,Turn);
+			Renderer.SortTriangles(Model);
+			Triangles += Model.NumVI()/3;
+		}
+	}
+	double Seconds = double(SDL_GetPerformanceCounter() - Start)/SDL_GetPerformanceFrequency();
+	return Seconds > 0 ? Triangles/Seconds : 0;
+}
+
+bool benchmark_model_sorting(Model3D& Model, model_sorting_timing& timing)
+{
+	Model.FindPositions_Neutral(true);
+	size_t NumTriangles = Model.NumVI()/3;
+	if (NumTriangles == 0 || Model.Positions.empty())
+		return false;
+	
+	timing.triangles = NumTriangles;
+	timing.ordered = true;
+	
+	ModelRenderer Renderer;
+	
+	// What Render() used to do
+	vector<IndexedCentroidDepth> Depths(NumTriangles);
+	size_t Triangles = 0;
+	Uint64 Start = SDL_GetPerformanceCounter();
+	for (int Pass=0; Pass<BENCHMARK_PASSES; Pass++)
+	{
+		for (int Turn=0; Turn<BENCHMARK_TURNS; Turn++)
+		{
+			SetBenchmarkView(Renderer,Turn);
+			GLushort *VIPtr = Model.VIBase();
+			for (size_t k=0; k<NumTriangles; k++)
+			{
+				GLfloat Sum[3] = {0, 0, 0};
+				for (int v=0; v<3; v++)
+				{
+					GLfloat *Pos = &Model.Positions[3*(*VIPtr)];
+					Sum[0] += Pos[0];
+					Sum[1] += Pos[1];
+					Sum[2] += Pos[2];
+					VIPtr++;
+				}
+				Depths[k].index = GLushort(k);
+				Depths[k].depth = Sum[0]*Renderer.ViewDirection[0] +
+					Sum[1]*Renderer.ViewDirection[1] + Sum[2]*Renderer.ViewDirection[2];
+			}
+			std::sort(Depths.begin(), Depths.end());
+			Triangles += NumTriangles;
+		}
+	}
+	double Seconds = double(SDL_GetPerformanceCounter() - Start)/SDL_GetPerformanceFrequency();
+	timing.std_sort_triangles_per_second = Seconds > 0 ? Triangles/Seconds : 0;
+	
+	timing.radix_triangles_per_second = TimeSorting(Renderer,Model);
+	
+	// Check the last turn's order: no triangle may be nearer than the next one
+	// by more than a key's worth of depth (plus a little for rounding)
+	const GLushort *Order = Renderer.SortTriangles(Model);
+	GLfloat MinDepth = Depths[NumTriangles-1].depth, MaxDepth = Depths[0].depth;
+	GLfloat Quantum = (MaxDepth - MinDepth)/65535;
+	vector<GLfloat> DepthsByIndex(NumTriangles);
+	for (size_t k=0; k<NumTriangles; k++)
+		DepthsByIndex[Depths[k].index] = Depths[k].depth;
+	for (size_t k=1; k<NumTriangles; k++)
+	{
+		if (DepthsByIndex[Order[k]] > DepthsByIndex[Order[k-1]] + 1.01f*Quantum + 1e-6f*fabs(MaxDepth))
+			timing.ordered = false;
+	}
+	
+	Renderer.OrderReuseAngle = BENCHMARK_REUSE_ANGLE;
+	timing.reused_triangles_per_second = TimeSorting(Renderer,Model);
+	
+	return true;
+}
+
+
 /* TODO: sRGB-correct model colors. This needs to be done in the loader. The
    lighting colors are already sRGB-corrected. -SB */
 void ModelRenderer::SetupRenderPass(Model3D& Model, ModelRenderShader& Shader)
@@ -214,9 +388,13 @@ void ModelRenderer::SetupRenderPass(Model3D& Model, ModelRenderShader& Shader)
 
 void ModelRenderer::Clear()
 {
-	IndexedCentroidDepths.clear();
+	CentroidDepths.clear();
+	DepthKeys.clear();
+	TriangleOrder.clear();
+	PartialOrder.clear();
 	SortedVertIndices.clear();
 	ExtLightColors.clear();
+	SavedOrders.clear();
 }
 
 #endif // def HAVE_OPENGL
@@ -28,6 +28,8 @@
 
 #include "csmacros.h"  // need obj_clear
 #include "Model3D.h"
+#include <map>
+#include <string>
 
 struct ModelRenderShader
 {
@@ -49,6 +51,7 @@ struct ModelRenderShader
 	ModelRenderShader() {obj_clear(*this);}
 };
 
+// What std::sort() sorted before the radix sort; the benchmark still compares with it
 struct IndexedCentroidDepth
 {
 	// sort from farthest to nearest
@@ -63,10 +66,23 @@ struct IndexedCentroidDepth
 class ModelRenderer
 {
 	// Kept here to avoid unnecessary re-allocation
-	vector<IndexedCentroidDepth> IndexedCentroidDepths;
+	vector<GLfloat> CentroidDepths;
+	vector<uint16> DepthKeys;
+	vector<GLushort> TriangleOrder, PartialOrder;
 	vector<GLushort> SortedVertIndices;
 	vector<GLfloat> ExtLightColors;
 	
+	// The last order found for each model, and what it was found for
+	struct SavedOrder
+	{
+		uint32 PositionsStamp;
+		GLfloat ViewDirection[3];
+		vector<GLushort> Triangles;
+		
+		SavedOrder(): PositionsStamp(0) {obj_clear(ViewDirection);}
+	};
+	map<const Model3D *, SavedOrder> SavedOrders;
+	
 	void SetupRenderPass(Model3D& Model, ModelRenderShader& Shader);
 	
 public:
@@ -75,6 +91,15 @@ public:
 	// it is in model coordinates.
 	GLfloat ViewDirection[3];
 	
+	// If the view direction has turned by less than this many degrees since a model was
+	// last sorted, and its positions haven't changed, it's drawn in the same order again;
+	// 0 (the default) sorts every time.  Less than 90.
+	GLfloat OrderReuseAngle;
+	
+	// Finds the order to draw the model's triangles in, farthest first, by sorting on
+	// quantized centroid depths; good until the next call
+	const GLushort *SortTriangles(Model3D& Model);
+	
 	// External lighting now done with a shader callback
 		
 	// Render flags:
@@ -98,7 +123,26 @@ public:
 	
 	// In case one wants to start over again with these persistent arrays
 	void Clear();
+	
+	ModelRenderer(): OrderReuseAngle(0) {obj_clear(ViewDirection);}
 };
 
 
+struct model_sorting_timing
+{
+	std::string model;
+	size_t triangles;
+	// Sorting for a view turning a degree at a time
+	double std_sort_triangles_per_second;
+	double radix_triangles_per_second;
+	// The same, reusing orders for up to 5 degrees
+	double reused_triangles_per_second;
+	// the radix sort's order was farthest first, to within a quantum
+	bool ordered;
+};
+
+// Times sorting a model's triangles (in its neutral pose) both ways; false if it has none
+bool benchmark_model_sorting(Model3D& Model, model_sorting_timing& timing);
+
+
 #endif
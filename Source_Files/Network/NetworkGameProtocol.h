@@ -46,6 +46,9 @@ public:
 	virtual int32   GetUnconfirmedActionFlagsCount() = 0;
 	virtual uint32  PeekUnconfirmedActionFlag(int32 offset) = 0;
 	virtual void    UpdateUnconfirmedActionFlags() = 0;
+
+	// running world hash as of the given tick, so desyncs can be noticed early
+	virtual void    ReportWorldHash(int32 tick, uint32 hash) = 0;
 	
 };
 
@@ -2142,6 +2142,9 @@ uint32 RingGameProtocol::PeekUnconfirmedActionFlag(int32 offset)
 
 void RingGameProtocol::UpdateUnconfirmedActionFlags() { }
 
+// the ring protocol has no room for world hashes; desyncs go unnoticed as before
+void RingGameProtocol::ReportWorldHash(int32 tick, uint32 hash) { }
+
 
 // brazenly copied and modified from player.c (though i clearly format it much better)
 static short NetSizeofLocalQueue(
@@ -47,6 +47,7 @@ public:
 	int32   GetUnconfirmedActionFlagsCount();
 	uint32  PeekUnconfirmedActionFlag(int32 offset);
 	void    UpdateUnconfirmedActionFlags();
+	void    ReportWorldHash(int32 tick, uint32 hash);
 
 	static void ParsePreferencesTree(InfoTree prefs, std::string version);
 };
@@ -142,6 +142,9 @@ StarGameProtocol::Sync(NetTopology* inTopology, int32 inSmallestGameTick, size_t
         spoke_initialize(sTopology->players[inServerPlayerIndex].ddpAddress, inSmallestGameTick, sTopology->player_count,
                          sStarQueues, theConnectedPlayerStatus, inLocalPlayerIndex, sHubIsLocal);
 
+        // From here on, incoming packets are handled at hub/spoke tick time rather than on the receiving thread
+        NetDDPSetDeferredDispatch(true);
+
         *sNetStatePtr = netActive;
 
         return true;
@@ -154,6 +157,8 @@ StarGameProtocol::UnSync(bool inGraceful, int32 inSmallestPostgameTick)
 {
         if(*sNetStatePtr == netStartingUp || *sNetStatePtr == netActive)
         {
+                NetDDPSetDeferredDispatch(false);
+
                 spoke_cleanup(inGraceful);
                 if(sHubIsLocal)
                         hub_cleanup(inGraceful, inSmallestPostgameTick);
@@ -205,6 +210,12 @@ StarGameProtocol::UpdateUnconfirmedActionFlags()
 	}
 }
 
+void
+StarGameProtocol::ReportWorldHash(int32 tick, uint32 hash)
+{
+	spoke_report_world_hash(tick, hash);
+}
+
 /* ZZZ addition:
 ---------------------------
 	make_player_really_net_dead
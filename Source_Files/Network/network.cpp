@@ -214,8 +214,12 @@ static std::vector<NetworkStats> sNetworkStats;
 const static NetworkStats sInvalidStats = {
 	NetworkStats::invalid,
 	NetworkStats::invalid,
+	0,
+	0,
+	0,
 	0
 };
+static NetworkStats sLocalStats;
 uint32 last_network_stats_send = 0;
 const static int network_stats_send_period = MACHINE_TICKS_PER_SECOND;
 
@@ -2558,7 +2562,7 @@ int32 NetGetLatency() {
 	}
 }
 
-const NetworkStats& NetGetStats(int player_index)
+static const NetworkStats& get_player_stats(int player_index)
 {
 	if (sCurrentGameProtocol == static_cast<NetworkGameProtocol*>(&sStarGameProtocol))
 	{
@@ -2584,6 +2588,18 @@ const NetworkStats& NetGetStats(int player_index)
 	}
 }
 
+const NetworkStats& NetGetStats(int player_index)
+{
+	if (player_index != localPlayerIndex)
+	{
+		return get_player_stats(player_index);
+	}
+
+	sLocalStats = get_player_stats(player_index);
+	NetDDPGetReceiveQueueStats(&sLocalStats.receive_queue_depth, &sLocalStats.receive_queue_drops);
+	return sLocalStats;
+}
+
 int32 NetGetUnconfirmedActionFlagsCount()
 {
 	assert (sCurrentGameProtocol);
@@ -2602,5 +2618,11 @@ void NetUpdateUnconfirmedActionFlags()
 	return sCurrentGameProtocol->UpdateUnconfirmedActionFlags();
 }
 
+void NetReportWorldHash(int32 tick, uint32 hash)
+{
+	assert (sCurrentGameProtocol);
+	sCurrentGameProtocol->ReportWorldHash(tick, hash);
+}
+
 #endif // !defined(DISABLE_NETWORKING)
 
@@ -290,6 +290,9 @@ int32 NetGetUnconfirmedActionFlagsCount(); // how many flags can we use for pred
 uint32 NetGetUnconfirmedActionFlag(int32 offset); // offset < GetUnconfirmedActionFlagsCount
 void NetUpdateUnconfirmedActionFlags();
 
+// hands the local running world hash for a tick to the game protocol, for desync detection
+void NetReportWorldHash(int32 tick, uint32 hash);
+
 struct NetworkStats
 {
 	enum {
@@ -300,6 +303,15 @@ struct NetworkStats
 	int16 latency;
 	int16 jitter;
 	uint16 errors;
+
+	// this machine's UDP receive queue; only filled in for the local player,
+	// and never sent over the wire
+	uint16 receive_queue_depth;
+	uint16 receive_queue_drops;
+
+	// bytes of action_flags the hub has sent this player per tick, over the last
+	// second; only filled in by the hub, and never sent over the wire
+	uint16 flags_bytes_per_tick;
 };
 
 // returns latency in ms, or kNetLatencyInvalid or kNetLatencyDisconnected
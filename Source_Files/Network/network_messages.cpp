@@ -264,6 +264,9 @@ bool NetworkStatsMessage::reallyInflateFrom(AIStream& inputStream) {
 		inputStream >> stats.latency;
 		inputStream >> stats.jitter;
 		inputStream >> stats.errors;
+		stats.receive_queue_depth = 0;
+		stats.receive_queue_drops = 0;
+		stats.flags_bytes_per_tick = 0;
 
 		mStats.push_back(stats);
 	}
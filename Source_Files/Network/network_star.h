@@ -28,6 +28,7 @@
 #include "ActionQueues.h"
 
 #include "sdl_network.h"
+#include "AStream.h"
 
 // We avoid including half the world just to get TICKS_PER_SECOND for standalone hub...
 #ifndef A1_NETWORK_STANDALONE_HUB
@@ -39,6 +40,7 @@ enum {
 #endif
 
 #include <stdio.h>
+#include <vector>
 
 enum {
         kEndOfMessagesMessageType = 0x454d,	// 'EM'
@@ -46,21 +48,158 @@ enum {
         kPlayerNetDeadMessageType = 0x4e44,	// 'ND'
 	kSpokeToHubLossyByteStreamMessageType = 0x534c,	// 'SL'
 	kHubToSpokeLossyByteStreamMessageType = 0x484c, // 'HL'
+	kSpokeToHubWorldHashMessageType = 0x5748, // 'WH'
 
 	kSpokeToHubIdentification = 0x4944,   // 'ID'
 	kSpokeToHubGameDataPacketV1Magic = 0x5331, // 'S1'
 	kHubToSpokeGameDataPacketV1Magic = 0x4831, // 'H1'
 	kHubToSpokeGameDataPacketWithSpokeFlagsV1Magic = 0x4631, // 'F1'
+	kSpokeToHubGameDataPacketV2Magic = 0x5332, // 'S2'
+	kHubToSpokeGameDataPacketV2Magic = 0x4832, // 'H2'
+	kHubToSpokeGameDataPacketWithSpokeFlagsV2Magic = 0x4632, // 'F2'
 	kPingRequestPacket = 0x5051, // 'PQ'
 	kPingResponsePacket = 0x5052, // 'PR'
 
         kPregameTicks = TICKS_PER_SECOND * 3,	// Synchronization/timing adjustment before real data
         kActionFlagsSerializedLength = 4,	// bytes for each serialized action_flags_t (should be elsewhere)
+	kActionFlagsDeltaMaximumLength = 5,	// the most a version 2 varint takes (33 bits)
 	
 	kStarPacketHeaderSize = 4, // 2 bytes for packet magic, 2 for CRC
+
+	// Spokes tell the hub which game data packet version they speak when they identify
+	// themselves (spokes that don't say speak version 1), and the hub sends each spoke that
+	// version; a spoke sends the hub version 2 once it's heard version 2 from it.
+	kStarPacketVersion = 2,
 };
 
 typedef uint32 action_flags_t;	// (should be elsewhere)
+
+// Writes the action_flags at the end of a game data packet.  Version 1 writes each as it is.
+// Version 2 XORs each with the same player's flags before it in the packet (or with 0, the
+// first time), and writes varints: a flags word that changed is its XOR shifted left one bit,
+// and a run of ones that didn't change is the run's length shifted left one bit with the low
+// bit set.  Mostly nobody changes what they're doing from one tick to the next, so a run of
+// them costs a byte.
+class ActionFlagsWriter
+{
+public:
+	ActionFlagsWriter(AOStream& inStream, size_t inNumberOfPlayers, uint16 inPacketVersion) :
+		mStream(inStream), mPacketVersion(inPacketVersion), mPrevious(inNumberOfPlayers, 0), mUnchangedCount(0) {}
+
+	void write(size_t inPlayerIndex, action_flags_t inFlags)
+	{
+		if(mPacketVersion < 2)
+		{
+			mStream << inFlags;
+			return;
+		}
+
+		action_flags_t theChange = inFlags ^ mPrevious[inPlayerIndex];
+		mPrevious[inPlayerIndex] = inFlags;
+		if(theChange == 0)
+		{
+			mUnchangedCount++;
+			return;
+		}
+
+		flush();
+		write_varint(static_cast<Uint64>(theChange) << 1);
+	}
+
+	// Call after the last write()
+	void flush()
+	{
+		if(mUnchangedCount > 0)
+		{
+			write_varint((static_cast<Uint64>(mUnchangedCount) << 1) | 1);
+			mUnchangedCount = 0;
+		}
+	}
+
+	// Whether inCount more flags are sure to fit in the packet, along with what flush() writes
+	bool has_room(size_t inCount) const
+	{
+		size_t theRemaining = mStream.maxp() - mStream.tellp();
+		if(mPacketVersion < 2)
+			return theRemaining >= inCount * kActionFlagsSerializedLength;
+		else
+			return theRemaining >= (inCount + 1) * kActionFlagsDeltaMaximumLength;
+	}
+
+private:
+	void write_varint(Uint64 inValue)
+	{
+		while(inValue >= 0x80)
+		{
+			mStream << static_cast<uint8>((inValue & 0x7f) | 0x80);
+			inValue >>= 7;
+		}
+		mStream << static_cast<uint8>(inValue);
+	}
+
+	AOStream& mStream;
+	uint16 mPacketVersion;
+	std::vector<action_flags_t> mPrevious;
+	uint32 mUnchangedCount;
+};
+
+// Reads what ActionFlagsWriter wrote; the players have to be read in the same order they
+// were written.  Throws AStream::failure when the packet runs out partway through.
+class ActionFlagsReader
+{
+public:
+	ActionFlagsReader(AIStream& inStream, size_t inNumberOfPlayers, uint16 inPacketVersion) :
+		mStream(inStream), mPacketVersion(inPacketVersion), mPrevious(inNumberOfPlayers, 0), mUnchangedCount(0) {}
+
+	bool done() const { return mUnchangedCount == 0 && mStream.tellg() >= mStream.maxg(); }
+
+	action_flags_t read(size_t inPlayerIndex)
+	{
+		if(mPacketVersion < 2)
+		{
+			action_flags_t theFlags;
+			mStream >> theFlags;
+			return theFlags;
+		}
+
+		if(mUnchangedCount == 0)
+		{
+			Uint64 theValue = read_varint();
+			if((theValue & 1) == 0)
+			{
+				mPrevious[inPlayerIndex] ^= static_cast<action_flags_t>(theValue >> 1);
+				return mPrevious[inPlayerIndex];
+			}
+
+			if((theValue >> 1) == 0 || (theValue >> 1) > 0xffffffff)
+				throw AStream::failure("bad run of unchanged action_flags");
+			mUnchangedCount = static_cast<uint32>(theValue >> 1);
+		}
+
+		mUnchangedCount--;
+		return mPrevious[inPlayerIndex];
+	}
+
+private:
+	Uint64 read_varint()
+	{
+		Uint64 theValue = 0;
+		for(int theShift = 0; theShift < 64; theShift += 7)
+		{
+			uint8 theByte;
+			mStream >> theByte;
+			theValue |= static_cast<Uint64>(theByte & 0x7f) << theShift;
+			if((theByte & 0x80) == 0)
+				return theValue;
+		}
+		throw AStream::failure("action_flags varint too long");
+	}
+
+	AIStream& mStream;
+	uint16 mPacketVersion;
+	std::vector<action_flags_t> mPrevious;
+	uint32 mUnchangedCount;
+};
 typedef ConcreteTickBasedCircularQueue<action_flags_t> TickBasedActionQueue;
 typedef WritableTickBasedCircularQueue<action_flags_t> WritableTickBasedActionQueue;
 
@@ -74,6 +213,20 @@ extern void DefaultHubPreferences();
 extern InfoTree HubPreferencesTree();
 extern void HubParsePreferencesTree(InfoTree prefs, std::string version);
 
+#ifdef A1_NETWORK_STANDALONE_HUB
+// A standalone hub can host several games; each HubInstance holds one game's hub state, and the
+// hub_* routines above work on whichever instance was last passed to hub_set_instance().
+// There is no tick task or receiving thread there - the driver calls hub_standalone_tick() at
+// TICKS_PER_SECOND and hands over packets itself, all on one thread.
+struct HubInstance;
+extern HubInstance* hub_new_instance();
+extern void hub_delete_instance(HubInstance* inInstance);
+extern void hub_set_instance(HubInstance* inInstance);
+extern bool hub_standalone_tick();
+extern bool hub_is_active();
+extern size_t hub_connected_player_count();
+#endif
+
 extern void spoke_initialize(const NetAddrBlock& inHubAddress, int32 inFirstTick, size_t inNumberOfPlayers, WritableTickBasedActionQueue* const inPlayerQueues[], bool inPlayerConnectedStatus[], size_t inLocalPlayerIndex, bool inHubIsLocal);
 extern void spoke_cleanup(bool inGraceful);
 extern void spoke_received_network_packet(DDPPacketBufferPtr inPacket);
@@ -87,6 +240,7 @@ extern int32 spoke_latency(); // in ms, kNetLatencyInvalid if not yet valid
 extern int32 hub_latency(int player_index); // in ms, kNetLatencyInvalid if not valid, kNetLatencyDisconnected if d/c
 extern TickBasedActionQueue* spoke_get_unconfirmed_flags_queue();
 extern int32 spoke_get_smallest_unconfirmed_tick();
+extern void spoke_report_world_hash(int32 inTick, uint32 inHash);
 extern void DefaultSpokePreferences();
 extern InfoTree SpokePreferencesTree();
 extern void SpokeParsePreferencesTree(InfoTree prefs, std::string version);
@@ -145,7 +145,8 @@ enum {
 
 	kLatencyBufferSize = TICKS_PER_SECOND * 5, // store 5 seconds of ping counts
 	kDisplayLatencyWindow = TICKS_PER_SECOND * 1, // display last second's ping
-	kJitterUpdateInterval = TICKS_PER_SECOND * 1 / 2
+	kJitterUpdateInterval = TICKS_PER_SECOND * 1 / 2,
+	kWorldHashWindowSize = TICKS_PER_SECOND * 10 // how far back we keep world hashes for comparison
 };
 
 
@@ -169,39 +170,13 @@ int32& hub_get_minimum_send_period() { return sHubPreferences.mMinimumSendPeriod
 
 void hub_set_minimum_send_period(int32 new_minimum) { sHubPreferences.mMinimumSendPeriod = new_minimum; }
 
-// sNetworkTicker advances even if the game clock doesn't.
-// sLastNetworkTickSent is used to force us to resend packets (at a lower rate) even if we're no longer
-// getting new data.
-static int32 sNetworkTicker;
-static int32 sLastNetworkTickSent;
-
-// We have a pregame startup period to help establish (via standard adjustment mechanism) everyone's
-// timing.  Ticks smaller than sSmallestRealGameTick are part of this startup period.  They smell
-// just like real in-game ticks, except that spokes won't enqueue them on player_queues, and we
-// may have different adjustment window sizes and timeout periods for pre-game and in-game ticks.
-static int32 sSmallestRealGameTick;
-
-// Once everyone ACKs this tick, we're satisfied the game is ended.  (They should all agree on which
-// tick is last due to the symmetric execution model.)
-static int32 sSmallestPostGameTick;
-
-// The sFlagsQueues hold all flags for ticks for which we've received data from at least one
-// station, but for which we haven't received an ACK from all stations.
-// sFlagsQueues[all].getReadIndex() == sPlayerDataDisposition.getReadIndex();
-// max(sFlagsQueues[all].getWriteIndex()) == sPlayerDataDisposition.getWriteIndex();
-// min(sFlagsQueues[all].getWriteIndex()) == sSmallestIncompleteTick;
 typedef std::vector<TickBasedActionQueue> TickBasedActionQueueCollection;
-static TickBasedActionQueueCollection	sFlagsQueues;
-
-// tracks the net ticks each flags tick was *first* sent out at
-static ConcreteTickBasedCircularQueue<int32> sFlagSendTimeQueue(kFlagsQueueSize);
-static int32 sLastRealUpdate;
 
 struct NetworkPlayer_hub {
         NetAddrBlock	mAddress;		// network address of player
 	bool		mAddressKnown;		// did player tell us his address yet?
         bool		mConnected;		// is player still connected?
-        int32		mLastNetworkTickHeard;	// our sNetworkTicker last time we got a packet from them
+        int32		mLastNetworkTickHeard;	// our mNetworkTicker last time we got a packet from them
         int32		mSmallestUnacknowledgedTick;
 
 	WindowedNthElementFinder<int32>	mNthElementFinder;
@@ -210,7 +185,7 @@ struct NetworkPlayer_hub {
 
         // When we decide a timing adjustment is needed, we include the timing adjustment
         // request in every packet outbound to the player until we're sure he's seen it.
-        // In particular, mTimingAdjustmentTick is set to the sSmallestIncompleteTick, so we
+        // In particular, mTimingAdjustmentTick is set to the mSmallestIncompleteTick, so we
         // know nobody's received data for that tick yet.  We continue to send the message
         // until the station ACKs past that tick; at that point we know he must have seen
         // our message.
@@ -235,45 +210,14 @@ struct NetworkPlayer_hub {
 	int32 mLatencyTicks; // sum of the latency ticks from the last second
 	deque<int32> mLatencyBuffer;
 
+	// game data packet version we send them (see kStarPacketVersion)
+	uint16		mPacketVersion;
+	// bytes of action_flags sent them since mStats.flags_bytes_per_tick was last worked out
+	int32		mFlagsBytesSent;
+
 	NetworkStats mStats;
 };
 
-// Housekeeping queues:
-// sPlayerDataDisposition holds an element for every tick for which data has been received from
-// someone, but which at least one player has not yet acknowledged.
-// sPlayerDataDisposition.getReadIndex() <= sSmallestIncompleteTick <= sPlayerDataDisposition.getWriteIndex()
-// sSmallestIncompleteTick indexes into sPlayerDataDisposition also; it divides the queue into ticks
-// for which data has been received from someone but not yet everyone (>= sSmallestIncompleteTick) and
-// ticks for which data has been sent out (to everyone) but for which someone hasn't yet acknowledged
-// (< sSmallestIncompleteTick).
-
-// The value of a queue element is a bit-set (indexed by player index) with a 1 bit for each player
-// that we're waiting on.  So, we can mask out successive players' bits as their traffic reaches us;
-// when the value hits 0, all players have checked in and we can advance an index.
-// sConnectedPlayersBitmask has '1' set for every connected player.
-static MutableElementsTickBasedCircularQueue<uint32>	sPlayerDataDisposition(kFlagsQueueSize);
-static int32 sSmallestIncompleteTick;
-static uint32 sConnectedPlayersBitmask;
-static uint32 sLaggingPlayersBitmask;
-
-
-// sPlayerReflectedFlags holds an element for every tick for which data has been
-// sent but at least one player has not yet acknowledged
-//
-// the value of a queue element is a bit-set (indexed by player index) with a 1
-// bit for each player we've altered flags and need to reflect flags for
-static MutableElementsTickBasedCircularQueue<uint32> sPlayerReflectedFlags(kFlagsQueueSize);
-
-// sLateFlagsQueues hold late flags we've received from lagging players
-static TickBasedActionQueueCollection sLateFlagsQueues;
-
-// holds the last real flags we received from this player
-static vector<action_flags_t> sLastFlagsReceived;
-
-// sSmallestUnsentTick is used for reducing the number of packets sent: we won't send a packet unless
-// sSmallestIncompleteTick - sSmallestUnsentTick >= sHubPreferences.mSendPeriod
-static int32 sSmallestUnsentTick;
-
 struct NetAddrBlockCompare
 {
 
@@ -287,21 +231,8 @@ struct NetAddrBlockCompare
 };
 
   typedef std::map<NetAddrBlock, int, NetAddrBlockCompare>	AddressToPlayerIndexType;
-static AddressToPlayerIndexType	sAddressToPlayerIndex;
 
 typedef std::vector<NetworkPlayer_hub>	NetworkPlayerCollection;
-static NetworkPlayerCollection	sNetworkPlayers;
-
-// Local player index is used to decide how to send a packet; ref is used for timing.
-static size_t			sLocalPlayerIndex;
-static size_t			sReferencePlayerIndex;
-
-static DDPFramePtr	sOutgoingFrame = NULL;
-
-#ifndef A1_NETWORK_STANDALONE_HUB
-static DDPPacketBuffer	sLocalOutgoingBuffer;
-static bool		sNeedToSendLocalOutgoingBuffer = false;
-#endif
 
 
 struct HubLossyByteStreamChunkDescriptor
@@ -312,27 +243,147 @@ struct HubLossyByteStreamChunkDescriptor
 	uint8	mSender;
 };
 
-// This holds outgoing lossy byte stream data
-static CircularByteBuffer sOutgoingLossyByteStreamData(kLossyByteStreamDataBufferSize);
 
-// This holds a descriptor for each chunk of lossy byte stream data held in the above buffer
-static CircularQueue<HubLossyByteStreamChunkDescriptor> sOutgoingLossyByteStreamDescriptors(kLossyByteStreamDescriptorCount);
+// World hashes reported by the spokes, by game tick.  The first report for a tick is the one
+// everyone else's is checked against; a mismatch means the players' simulations have diverged.
+struct WorldHashReport
+{
+	uint32	mHash;
+	int	mFirstReporter;
+	uint32	mReportersBitmask;
+};
+
+typedef std::map<int32, WorldHashReport> TickToWorldHashReport;
+
+
+// Everything the hub knows about the game it's running.  The game client only ever has one of these;
+// a standalone hub keeps one per game it hosts, and makes each current in turn (see hub_set_instance()).
+struct HubInstance
+{
+	HubInstance();
+
+	// mNetworkTicker advances even if the game clock doesn't.
+	// mLastNetworkTickSent is used to force us to resend packets (at a lower rate) even if we're no longer
+	// getting new data.
+	int32 mNetworkTicker;
+	int32 mLastNetworkTickSent;
+
+	// We have a pregame startup period to help establish (via standard adjustment mechanism) everyone's
+	// timing.  Ticks smaller than mSmallestRealGameTick are part of this startup period.  They smell
+	// just like real in-game ticks, except that spokes won't enqueue them on player_queues, and we
+	// may have different adjustment window sizes and timeout periods for pre-game and in-game ticks.
+	int32 mSmallestRealGameTick;
+
+	// Once everyone ACKs this tick, we're satisfied the game is ended.  (They should all agree on which
+	// tick is last due to the symmetric execution model.)
+	int32 mSmallestPostGameTick;
+
+	// The mFlagsQueues hold all flags for ticks for which we've received data from at least one
+	// station, but for which we haven't received an ACK from all stations.
+	// mFlagsQueues[all].getReadIndex() == mPlayerDataDisposition.getReadIndex();
+	// max(mFlagsQueues[all].getWriteIndex()) == mPlayerDataDisposition.getWriteIndex();
+	// min(mFlagsQueues[all].getWriteIndex()) == mSmallestIncompleteTick;
+	TickBasedActionQueueCollection	mFlagsQueues;
+
+	// tracks the net ticks each flags tick was *first* sent out at
+	ConcreteTickBasedCircularQueue<int32> mFlagSendTimeQueue;
+	int32 mLastRealUpdate;
+
+	// Housekeeping queues:
+	// mPlayerDataDisposition holds an element for every tick for which data has been received from
+	// someone, but which at least one player has not yet acknowledged.
+	// mPlayerDataDisposition.getReadIndex() <= mSmallestIncompleteTick <= mPlayerDataDisposition.getWriteIndex()
+	// mSmallestIncompleteTick indexes into mPlayerDataDisposition also; it divides the queue into ticks
+	// for which data has been received from someone but not yet everyone (>= mSmallestIncompleteTick) and
+	// ticks for which data has been sent out (to everyone) but for which someone hasn't yet acknowledged
+	// (< mSmallestIncompleteTick).
+
+	// The value of a queue element is a bit-set (indexed by player index) with a 1 bit for each player
+	// that we're waiting on.  So, we can mask out successive players' bits as their traffic reaches us;
+	// when the value hits 0, all players have checked in and we can advance an index.
+	// mConnectedPlayersBitmask has '1' set for every connected player.
+	MutableElementsTickBasedCircularQueue<uint32>	mPlayerDataDisposition;
+	int32 mSmallestIncompleteTick;
+	uint32 mConnectedPlayersBitmask;
+	uint32 mLaggingPlayersBitmask;
+
+	// mPlayerReflectedFlags holds an element for every tick for which data has been
+	// sent but at least one player has not yet acknowledged
+	//
+	// the value of a queue element is a bit-set (indexed by player index) with a 1
+	// bit for each player we've altered flags and need to reflect flags for
+	MutableElementsTickBasedCircularQueue<uint32> mPlayerReflectedFlags;
+
+	// mLateFlagsQueues hold late flags we've received from lagging players
+	TickBasedActionQueueCollection mLateFlagsQueues;
+
+	// holds the last real flags we received from this player
+	vector<action_flags_t> mLastFlagsReceived;
+
+	// mSmallestUnsentTick is used for reducing the number of packets sent: we won't send a packet unless
+	// mSmallestIncompleteTick - mSmallestUnsentTick >= sHubPreferences.mSendPeriod
+	int32 mSmallestUnsentTick;
+
+	AddressToPlayerIndexType	mAddressToPlayerIndex;
+	NetworkPlayerCollection		mNetworkPlayers;
+
+	// Local player index is used to decide how to send a packet; ref is used for timing.
+	size_t			mLocalPlayerIndex;
+	size_t			mReferencePlayerIndex;
+
+	DDPFramePtr	mOutgoingFrame;
+
+#ifndef A1_NETWORK_STANDALONE_HUB
+	DDPPacketBuffer	mLocalOutgoingBuffer;
+	bool		mNeedToSendLocalOutgoingBuffer;
+#endif
+
+	// This holds outgoing lossy byte stream data
+	CircularByteBuffer mOutgoingLossyByteStreamData;
+
+	// This holds a descriptor for each chunk of lossy byte stream data held in the above buffer
+	CircularQueue<HubLossyByteStreamChunkDescriptor> mOutgoingLossyByteStreamDescriptors;
+
+	TickToWorldHashReport mWorldHashReports;
+
+	myTMTaskPtr	mHubTickTask;
+	bool		mHubActive;	// used to enable the packet handler
+	bool		mHubInitialized;
+};
+
+HubInstance::HubInstance() :
+	mFlagSendTimeQueue(kFlagsQueueSize),
+	mPlayerDataDisposition(kFlagsQueueSize),
+	mPlayerReflectedFlags(kFlagsQueueSize),
+	mOutgoingFrame(NULL),
+#ifndef A1_NETWORK_STANDALONE_HUB
+	mNeedToSendLocalOutgoingBuffer(false),
+#endif
+	mOutgoingLossyByteStreamData(kLossyByteStreamDataBufferSize),
+	mOutgoingLossyByteStreamDescriptors(kLossyByteStreamDescriptorCount),
+	mHubTickTask(NULL),
+	mHubActive(false),
+	mHubInitialized(false)
+{
+}
+
+static HubInstance	sDefaultHub;
+static HubInstance*	sHub = &sDefaultHub;
 
 // This is used to copy between AStream and CircularByteBuffer
 // It's used in both directions, but that's ok because the routines that do so are mutex.
+// (It's shared by all instances, since only one ever runs at a time.)
 static byte sScratchBuffer[kLossyByteStreamDataBufferSize];
 
-
-static myTMTaskPtr	sHubTickTask = NULL;
-static bool		sHubActive = false;	// used to enable the packet handler
-static bool		sHubInitialized = false;
+// A spoke's action_flags, decoded before any are acted on (shared the same way)
+static std::vector<action_flags_t> sIncomingFlags;
 
 
 
 static void hub_check_for_completion();
 static void player_acknowledged_up_to_tick(size_t inPlayerIndex, int32 inSmallestUnacknowledgedTick);
 static bool player_provided_flags_from_tick_to_tick(size_t inPlayerIndex, int32 inFirstNewTick, int32 inSmallestUnreceivedTick);
-static void hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex);
+static void hub_received_game_data_packet(AIStream& ps, int inSenderIndex, uint16 inPacketVersion);
 static void hub_received_identification_packet(AIStream& ps, NetAddrBlock address);
 static void hub_received_ping_request(AIStream& ps, NetAddrBlock address);
 static void hub_received_ping_response(AIStream& ps, NetAddrBlock address);
@@ -349,22 +400,22 @@ static void send_packets();
 static inline NetworkPlayer_hub&
 getNetworkPlayer(size_t inIndex)
 {
-        assert(inIndex < sNetworkPlayers.size());
-        return sNetworkPlayers[inIndex];
+        assert(inIndex < sHub->mNetworkPlayers.size());
+        return sHub->mNetworkPlayers[inIndex];
 }
 
 static inline TickBasedActionQueue&
 getFlagsQueue(size_t inIndex)
 {
-        assert(inIndex < sFlagsQueues.size());
-        return sFlagsQueues[inIndex];
+        assert(inIndex < sHub->mFlagsQueues.size());
+        return sHub->mFlagsQueues[inIndex];
 }
 
 static inline TickBasedActionQueue&
 getLateFlagsQueue(size_t inIndex)
 {
-	assert(inIndex < sFlagsQueues.size());
-	return sLateFlagsQueues[inIndex];
+	assert(inIndex < sHub->mFlagsQueues.size());
+	return sHub->mLateFlagsQueues[inIndex];
 }
 
 
@@ -379,11 +430,11 @@ static OSErr
 send_frame_to_local_spoke(DDPFramePtr frame, NetAddrBlock *address, short protocolType, short port)
 {
 #ifndef A1_NETWORK_STANDALONE_HUB
-        sLocalOutgoingBuffer.datagramSize = frame->data_size;
-        memcpy(sLocalOutgoingBuffer.datagramData, frame->data, frame->data_size);
-        sLocalOutgoingBuffer.protocolType = protocolType;
+        sHub->mLocalOutgoingBuffer.datagramSize = frame->data_size;
+        memcpy(sHub->mLocalOutgoingBuffer.datagramData, frame->data, frame->data_size);
+        sHub->mLocalOutgoingBuffer.protocolType = protocolType;
         // We ignore the 'source address' because the spoke does too.
-        sNeedToSendLocalOutgoingBuffer = true;
+        sHub->mNeedToSendLocalOutgoingBuffer = true;
         return noErr;
 #else
 	// Standalone hub should never call this routine
@@ -399,10 +450,10 @@ check_send_packet_to_spoke()
 {
 	// Routine exists but has no implementation on standalone hub.
 #ifndef A1_NETWORK_STANDALONE_HUB
-        if(sNeedToSendLocalOutgoingBuffer)
-                spoke_received_network_packet(&sLocalOutgoingBuffer);
+        if(sHub->mNeedToSendLocalOutgoingBuffer)
+                spoke_received_network_packet(&sHub->mLocalOutgoingBuffer);
 
-        sNeedToSendLocalOutgoingBuffer = false;
+        sHub->mNeedToSendLocalOutgoingBuffer = false;
 #endif // A1_NETWORK_STANDALONE_HUB
 }
 
@@ -412,7 +463,10 @@ check_send_packet_to_spoke()
 #define INT32_MAX 0x7fffffff
 #endif
 
+// (the standalone hub has no FileSpecifier, nor player names to log)
+#ifndef A1_NETWORK_STANDALONE_HUB
 #define DEBUG_TIMING_ADJUSTMENTS
+#endif
 
 #ifdef DEBUG_TIMING_ADJUSTMENTS
 #include "FileHandler.h"
@@ -460,56 +514,60 @@ hub_initialize(int32 inStartingTick, size_t inNumPlayers, const NetAddrBlock* co
 #endif
 
         assert(inLocalPlayerIndex < inNumPlayers);
-        sLocalPlayerIndex = inLocalPlayerIndex;
-	sReferencePlayerIndex = sLocalPlayerIndex;
+        sHub->mLocalPlayerIndex = inLocalPlayerIndex;
+	sHub->mReferencePlayerIndex = sHub->mLocalPlayerIndex;
 
 #ifdef A1_NETWORK_STANDALONE_HUB
 	// There is no local player on standalone hub.
-	sLocalPlayerIndex = (size_t)NONE;
+	sHub->mLocalPlayerIndex = (size_t)NONE;
 #endif
 
-	sSmallestPostGameTick = INT32_MAX;
-        sSmallestRealGameTick = inStartingTick;
+	sHub->mSmallestPostGameTick = INT32_MAX;
+        sHub->mSmallestRealGameTick = inStartingTick;
         int32 theFirstTick = inStartingTick - kPregameTicks;
 
-        if(sOutgoingFrame == NULL)
-                sOutgoingFrame = NetDDPNewFrame();
+        if(sHub->mOutgoingFrame == NULL)
+                sHub->mOutgoingFrame = NetDDPNewFrame();
 
 #ifndef A1_NETWORK_STANDALONE_HUB
-        sNeedToSendLocalOutgoingBuffer = false;
+        sHub->mNeedToSendLocalOutgoingBuffer = false;
 #endif
 
-        sNetworkPlayers.clear();
-        sFlagsQueues.clear();
-	sLateFlagsQueues.clear();
-        sNetworkPlayers.resize(inNumPlayers);
-        sFlagsQueues.resize(inNumPlayers, TickBasedActionQueue(kFlagsQueueSize));
-	sLateFlagsQueues.resize(inNumPlayers, TickBasedActionQueue(kFlagsQueueSize));
+        sHub->mNetworkPlayers.clear();
+        sHub->mFlagsQueues.clear();
+	sHub->mLateFlagsQueues.clear();
+        sHub->mNetworkPlayers.resize(inNumPlayers);
+        sHub->mFlagsQueues.resize(inNumPlayers, TickBasedActionQueue(kFlagsQueueSize));
+	sHub->mLateFlagsQueues.resize(inNumPlayers, TickBasedActionQueue(kFlagsQueueSize));
+
+        sHub->mAddressToPlayerIndex.clear();
+        sHub->mConnectedPlayersBitmask = 0;
 
-        sAddressToPlayerIndex.clear();
-        sConnectedPlayersBitmask = 0;
+	sHub->mOutgoingLossyByteStreamDescriptors.reset();
+	sHub->mOutgoingLossyByteStreamData.reset();
 
-	sOutgoingLossyByteStreamDescriptors.reset();
-	sOutgoingLossyByteStreamData.reset();
+	sHub->mWorldHashReports.clear();
 
         for(size_t i = 0; i < inNumPlayers; i++)
         {
-                NetworkPlayer_hub& thePlayer = sNetworkPlayers[i];
+                NetworkPlayer_hub& thePlayer = sHub->mNetworkPlayers[i];
 
                 if(inPlayerAddresses[i] != NULL)
                 {
                         thePlayer.mConnected = true;
-                        sConnectedPlayersBitmask |= (((uint32)1) << i);
+                        sHub->mConnectedPlayersBitmask |= (((uint32)1) << i);
 			thePlayer.mAddressKnown = false;
                         // thePlayer.mAddress = *(inPlayerAddresses[i]); (jkvw: see note below)
                         // Currently, all-0 address is cue for local spoke.
 			// jkvw: The "real" addresses for spokes won't be known unti we get some UDP traffic
 			//	 from them - we'll update as they become known.
-                        if(i == sLocalPlayerIndex) { // jkvw: I don't need this, do I?
+                        if(i == sHub->mLocalPlayerIndex) { // jkvw: I don't need this, do I?
                                 obj_clear(thePlayer.mAddress);
-				sAddressToPlayerIndex[thePlayer.mAddress] = i;
+				sHub->mAddressToPlayerIndex[thePlayer.mAddress] = i;
 				thePlayer.mAddressKnown = true;
 			}
+			// Until they tell us otherwise; the local spoke is the same build we are
+			thePlayer.mPacketVersion = (i == sHub->mLocalPlayerIndex) ? kStarPacketVersion : 1;
                 }
                 else
                 {
@@ -531,27 +589,33 @@ hub_initialize(int32 inStartingTick, size_t inNumPlayers, const NetAddrBlock* co
 		thePlayer.mStats.latency = NetworkStats::invalid;
 		thePlayer.mStats.jitter = NetworkStats::invalid;
 		thePlayer.mStats.errors = 0;
+		thePlayer.mStats.receive_queue_depth = 0;
+		thePlayer.mStats.receive_queue_drops = 0;
+		thePlayer.mStats.flags_bytes_per_tick = 0;
+		thePlayer.mFlagsBytesSent = 0;
 
-                sFlagsQueues[i].reset(theFirstTick);
-		sLateFlagsQueues[i].reset(theFirstTick);
+                sHub->mFlagsQueues[i].reset(theFirstTick);
+		sHub->mLateFlagsQueues[i].reset(theFirstTick);
         }
         
-        sPlayerDataDisposition.reset(theFirstTick);
-	sPlayerReflectedFlags.reset(theFirstTick);
-	sLastFlagsReceived.resize(inNumPlayers);
-	sFlagSendTimeQueue.reset(theFirstTick);
-        sSmallestIncompleteTick = theFirstTick;
-	sSmallestUnsentTick = theFirstTick;
-        sNetworkTicker = 0;
-        sLastNetworkTickSent = 0;
-	sLastRealUpdate = 0;
-	sLaggingPlayersBitmask = 0;
-
-        sHubActive = true;
-
-        sHubTickTask = myXTMSetup(1000/TICKS_PER_SECOND, hub_tick);
-
-	sHubInitialized = true;
+        sHub->mPlayerDataDisposition.reset(theFirstTick);
+	sHub->mPlayerReflectedFlags.reset(theFirstTick);
+	sHub->mLastFlagsReceived.resize(inNumPlayers);
+	sHub->mFlagSendTimeQueue.reset(theFirstTick);
+        sHub->mSmallestIncompleteTick = theFirstTick;
+	sHub->mSmallestUnsentTick = theFirstTick;
+        sHub->mNetworkTicker = 0;
+        sHub->mLastNetworkTickSent = 0;
+	sHub->mLastRealUpdate = 0;
+	sHub->mLaggingPlayersBitmask = 0;
+
+        sHub->mHubActive = true;
+
+#ifndef A1_NETWORK_STANDALONE_HUB
+        sHub->mHubTickTask = myXTMSetup(1000/TICKS_PER_SECOND, hub_tick);
+#endif
+
+	sHub->mHubInitialized = true;
 }
 
 
@@ -559,12 +623,17 @@ hub_initialize(int32 inStartingTick, size_t inNumPlayers, const NetAddrBlock* co
 void
 hub_cleanup(bool inGraceful, int32 inSmallestPostGameTick)
 {
-	if(sHubInitialized)
+	if(sHub->mHubInitialized)
 	{
+#ifdef A1_NETWORK_STANDALONE_HUB
+		// Standalone hub runs everything on one thread, so there's nothing to wait for or to
+		// synchronize with; the driver only cleans up an instance once it has gone quiet anyway.
+		sHub->mHubActive = false;
+#else
 		if(inGraceful)
 		{
 			// Signal our demise
-			sSmallestPostGameTick = inSmallestPostGameTick;
+			sHub->mSmallestPostGameTick = inSmallestPostGameTick;
 
 			// We have to do a check now in case the conditions are already met
 			if(take_mytm_mutex())
@@ -574,8 +643,8 @@ hub_cleanup(bool inGraceful, int32 inSmallestPostGameTick)
 			}
 			
 			// Now we should wait/sleep for the rest of the machinery to wind down
-			// Packet handler will set sHubActive = false once it has acks from all connected players;
-			while(sHubActive)
+			// Packet handler will set mHubActive = false once it has acks from all connected players;
+			while(sHub->mHubActive)
 			{
 // Here we try to isolate the "Classic" Mac OS (we can only sleep on the others)
 				SDL_Delay(10);
@@ -584,30 +653,33 @@ hub_cleanup(bool inGraceful, int32 inSmallestPostGameTick)
 		else
 		{		
 			// Stop processing incoming packets (packet processor won't start processing another packet
-			// due to sHubActive = false, and we know it's not in the middle of processing one because
+			// due to mHubActive = false, and we know it's not in the middle of processing one because
 			// we take the mutex).
 			if(take_mytm_mutex())
 			{
-				sHubActive = false;
+				sHub->mHubActive = false;
 				release_mytm_mutex();
 			}
 		}
 	
 		// Mark the tick task for cancellation (it won't start running again after this returns).
-		myTMRemove(sHubTickTask);
-		sHubTickTask = NULL;
+		myTMRemove(sHub->mHubTickTask);
+		sHub->mHubTickTask = NULL;
 	
 		// This waits for the tick task to actually finish - so we know the tick task isn't in
 		// the middle of processing when we do the rest of the cleanup below.
 		myTMCleanup(true);
+#endif // A1_NETWORK_STANDALONE_HUB
 		
-		sNetworkPlayers.clear();
-		sFlagsQueues.clear();
-		sLateFlagsQueues.clear();
+		sHub->mNetworkPlayers.clear();
+		sHub->mFlagsQueues.clear();
+		sHub->mLateFlagsQueues.clear();
+
+		sHub->mAddressToPlayerIndex.clear();
+		NetDDPDisposeFrame(sHub->mOutgoingFrame);
+		sHub->mOutgoingFrame = NULL;
 
-		sAddressToPlayerIndex.clear();
-		NetDDPDisposeFrame(sOutgoingFrame);
-		sOutgoingFrame = NULL;
+		sHub->mHubInitialized = false;
 
 #ifdef DEBUG_TIMING_ADJUSTMENTS
 		if (debug_timing_adjustments)
@@ -623,14 +695,14 @@ hub_cleanup(bool inGraceful, int32 inSmallestPostGameTick)
 static void
 hub_check_for_completion()
 {
-	// When all players (including the local spoke) have either ACKed up to sSmallestPostGameTick
+	// When all players (including the local spoke) have either ACKed up to mSmallestPostGameTick
 	// or become disconnected, we're clear to cleanup.  (In other words, we should avoid cleaning
 	// up if there are connected players that haven't ACKed up to the game's end tick.)
 	bool someoneStillActive = false;
-	for(size_t i = 0; i < sNetworkPlayers.size(); i++)
+	for(size_t i = 0; i < sHub->mNetworkPlayers.size(); i++)
 	{
-		NetworkPlayer_hub& thePlayer = sNetworkPlayers[i];
-		if(thePlayer.mConnected && thePlayer.mSmallestUnacknowledgedTick < sSmallestPostGameTick)
+		NetworkPlayer_hub& thePlayer = sHub->mNetworkPlayers[i];
+		if(thePlayer.mConnected && thePlayer.mSmallestUnacknowledgedTick < sHub->mSmallestPostGameTick)
 		{
 			someoneStillActive = true;
 			break;
@@ -638,7 +710,7 @@ hub_check_for_completion()
 	}
 
 	if(!someoneStillActive)
-		sHubActive = false;
+		sHub->mHubActive = false;
 }
 		
 
@@ -655,7 +727,7 @@ hub_received_network_packet(DDPPacketBufferPtr inPacket)
 		ps >> thePacketMagic;
 
 		// Processing packets?
-		if(!sHubActive &&
+		if(!sHub->mHubActive &&
 		   thePacketMagic != kPingRequestPacket &&
 		   thePacketMagic != kPingResponsePacket)
 			return;
@@ -669,10 +741,10 @@ hub_received_network_packet(DDPPacketBufferPtr inPacket)
 
 		if (thePacketCRC != calculate_data_crc_ccitt(inPacket->datagramData, inPacket->datagramSize))
 		{
-			if (thePacketMagic == kSpokeToHubGameDataPacketV1Magic)
+			if (thePacketMagic == kSpokeToHubGameDataPacketV1Magic || thePacketMagic == kSpokeToHubGameDataPacketV2Magic)
 			{
-				AddressToPlayerIndexType::iterator theEntry = sAddressToPlayerIndex.find(inPacket->sourceAddress);
-				if (theEntry != sAddressToPlayerIndex.end())
+				AddressToPlayerIndexType::iterator theEntry = sHub->mAddressToPlayerIndex.find(inPacket->sourceAddress);
+				if (theEntry != sHub->mAddressToPlayerIndex.end())
 				{
 					int theSenderIndex = theEntry->second;
 					getNetworkPlayer(theSenderIndex).mStats.errors++;
@@ -684,21 +756,22 @@ hub_received_network_packet(DDPPacketBufferPtr inPacket)
                 switch(thePacketMagic)
                 {
                         case kSpokeToHubGameDataPacketV1Magic:
+                        case kSpokeToHubGameDataPacketV2Magic:
 			{
 				// Find sender
-				AddressToPlayerIndexType::iterator theEntry = sAddressToPlayerIndex.find(inPacket->sourceAddress);
-				if(theEntry == sAddressToPlayerIndex.end())
+				AddressToPlayerIndexType::iterator theEntry = sHub->mAddressToPlayerIndex.find(inPacket->sourceAddress);
+				if(theEntry == sHub->mAddressToPlayerIndex.end())
 					return;
 				
 				int theSenderIndex = theEntry->second;
 				
 				if (getNetworkPlayer(theSenderIndex).mConnected)
 				{
-					hub_received_game_data_packet_v1(ps, theSenderIndex);
+					hub_received_game_data_packet(ps, theSenderIndex, thePacketMagic == kSpokeToHubGameDataPacketV2Magic ? 2 : 1);
 				}
 				else
 				{
-					// Unconnected players should not have entries in sAddressToPlayerIndex
+					// Unconnected players should not have entries in mAddressToPlayerIndex
 					logWarningNMT("received game data packet from disconnected player %i; ignoring", theSenderIndex);
 				}
 			}
@@ -734,11 +807,20 @@ hub_received_identification_packet(AIStream& ps, NetAddrBlock address)
 {
 	int16 theSenderIndex;
 	ps >> theSenderIndex;
+
+	if (theSenderIndex < 0 || static_cast<size_t>(theSenderIndex) >= sHub->mNetworkPlayers.size())
+		return;
+
+	// Older spokes stop at the index
+	uint16 thePacketVersion = 1;
+	if (ps.tellg() < ps.maxg())
+		ps >> thePacketVersion;
 	
-	if (!sNetworkPlayers[theSenderIndex].mAddressKnown) {
-		sAddressToPlayerIndex[address] = theSenderIndex;
-		sNetworkPlayers[theSenderIndex].mAddressKnown = true;
-		sNetworkPlayers[theSenderIndex].mAddress = address;
+	if (!sHub->mNetworkPlayers[theSenderIndex].mAddressKnown) {
+		sHub->mAddressToPlayerIndex[address] = theSenderIndex;
+		sHub->mNetworkPlayers[theSenderIndex].mAddressKnown = true;
+		sHub->mNetworkPlayers[theSenderIndex].mAddress = address;
+		sHub->mNetworkPlayers[theSenderIndex].mPacketVersion = std::min(thePacketVersion, static_cast<uint16>(kStarPacketVersion));
 	}
 
 } // hub_received_idetification_packet()
@@ -752,37 +834,37 @@ hub_received_ping_request(AIStream& ps, NetAddrBlock address)
 	
 	// respond back to requestor
 	bool initedFrame = false;
-	if (!sOutgoingFrame)
+	if (!sHub->mOutgoingFrame)
 	{
-		sOutgoingFrame = NetDDPNewFrame();
+		sHub->mOutgoingFrame = NetDDPNewFrame();
 		initedFrame = true;
 	}
 	
-	AOStreamBE hdr(sOutgoingFrame->data, kStarPacketHeaderSize);
-	AOStreamBE ops(sOutgoingFrame->data, ddpMaxData, kStarPacketHeaderSize);
+	AOStreamBE hdr(sHub->mOutgoingFrame->data, kStarPacketHeaderSize);
+	AOStreamBE ops(sHub->mOutgoingFrame->data, ddpMaxData, kStarPacketHeaderSize);
 	
 	try {
 		hdr << (uint16)kPingResponsePacket;
 		ops << pingIdentifier;
 		
 		// blank out the CRC field before calculating
-		sOutgoingFrame->data[2] = 0;
-		sOutgoingFrame->data[3] = 0;
+		sHub->mOutgoingFrame->data[2] = 0;
+		sHub->mOutgoingFrame->data[3] = 0;
 		
-		uint16 crc = calculate_data_crc_ccitt(sOutgoingFrame->data, ops.tellp());
+		uint16 crc = calculate_data_crc_ccitt(sHub->mOutgoingFrame->data, ops.tellp());
 		hdr << crc;
 		
 		// Send the packet
-		sOutgoingFrame->data_size = ops.tellp();
-		NetDDPSendFrame(sOutgoingFrame, &address, kPROTOCOL_TYPE, 0 /* ignored */);
+		sHub->mOutgoingFrame->data_size = ops.tellp();
+		NetDDPSendFrame(sHub->mOutgoingFrame, &address, kPROTOCOL_TYPE, 0 /* ignored */);
 	} catch (...) {
 		logWarningNMT("Caught exception while constructing/sending ping response packet");
 	}
 	
 	if (initedFrame)
 	{
-		NetDDPDisposeFrame(sOutgoingFrame);
-		sOutgoingFrame = NULL;
+		NetDDPDisposeFrame(sHub->mOutgoingFrame);
+		sHub->mOutgoingFrame = NULL;
 	}
 } // hub_received_ping_request()
 
@@ -803,16 +885,16 @@ hub_received_ping_response(AIStream& ps, NetAddrBlock address)
 // As it stands, a malformed packet could have have a well-formed prefix of it interpreted
 // before the remainder is discarded.
 static void
-hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
+hub_received_game_data_packet(AIStream& ps, int inSenderIndex, uint16 inPacketVersion)
 {
         // Process the piggybacked acknowledgement
         int32	theSmallestUnacknowledgedTick;
         ps >> theSmallestUnacknowledgedTick;
 
         // If ack is too soon we throw out the entire packet to be safer
-        if(theSmallestUnacknowledgedTick > sSmallestIncompleteTick)
+        if(theSmallestUnacknowledgedTick > sHub->mSmallestIncompleteTick)
         {
-                logAnomalyNMT("received ack from player %d for tick %d; have only sent up to %d", inSenderIndex, theSmallestUnacknowledgedTick, sSmallestIncompleteTick);
+                logAnomalyNMT("received ack from player %d for tick %d; have only sent up to %d", inSenderIndex, theSmallestUnacknowledgedTick, sHub->mSmallestIncompleteTick);
                 return;
         }                
 
@@ -835,10 +917,21 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
 
         // Make sure there's an integral number of action_flags
         int	theRemainingDataLength = ps.maxg() - ps.tellg();
-        if(theRemainingDataLength % kActionFlagsSerializedLength != 0)
+        if(inPacketVersion < 2 && theRemainingDataLength % kActionFlagsSerializedLength != 0)
                 return;
 
-        int32	theActionFlagsCount = theRemainingDataLength / kActionFlagsSerializedLength;
+	// A version 2 packet's length doesn't say how many there are, so they're all decoded first
+	sIncomingFlags.clear();
+	ActionFlagsReader theReader(ps, 1, inPacketVersion);
+	while(!theReader.done())
+	{
+		// No spoke holds more than a queue's worth; more is a malformed run
+		if(sIncomingFlags.size() >= kFlagsQueueSize)
+			return;
+		sIncomingFlags.push_back(theReader.read(0));
+	}
+
+        int32	theActionFlagsCount = sIncomingFlags.size();
 
         TickBasedActionQueue& theQueue = getFlagsQueue(inSenderIndex);
 	TickBasedActionQueue& theLateQueue = getLateFlagsQueue(inSenderIndex);
@@ -853,7 +946,7 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
 	{
 		while (theLateQueue.getWriteTick() < theQueue.getWriteTick())
 		{
-			theLateQueue.enqueue(sLastFlagsReceived[inSenderIndex]);
+			theLateQueue.enqueue(sHub->mLastFlagsReceived[inSenderIndex]);
 			theLateQueue.dequeue();
 		}
 	}
@@ -861,24 +954,22 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
         // Skip redundant flags without processing/checking them
 //        int	theRedundantActionFlagsCount = std::min(theQueue.getWriteTick() - theStartTick, theActionFlagsCount);
 	int     theRedundantActionFlagsCount = std::min(theLateQueue.getWriteTick() - theStartTick, theActionFlagsCount);
-	int	theRedundantDataLength = theRedundantActionFlagsCount * kActionFlagsSerializedLength;
-	ps.ignore(theRedundantDataLength);
+	int	theNextActionFlags = theRedundantActionFlagsCount;
 
 	assert(theQueue.getWriteTick() >= theLateQueue.getWriteTick());
 	// Enqueue late flags
 	int theLateActionFlagsCount = std::min(theQueue.getWriteTick() - theLateQueue.getWriteTick(), theActionFlagsCount - theRedundantActionFlagsCount);
 	for (int i = 0; i < theLateActionFlagsCount; i++)
 	{
-		action_flags_t theActionFlags;
-		ps >> theActionFlags;
+		action_flags_t theActionFlags = sIncomingFlags[theNextActionFlags++];
 		// we consume these faster than we enqueue them (hopefully)
 		// so, not checking for capacity though we probably should
 		theLateQueue.enqueue(theActionFlags);
-		sLastFlagsReceived[inSenderIndex] = theActionFlags;
+		sHub->mLastFlagsReceived[inSenderIndex] = theActionFlags;
 	}
 
         // Enqueue flags that are new to us
-        int	theRemainingQueueSpace = (sPlayerDataDisposition.getReadTick() < sSmallestRealGameTick && theQueue.size() > sHubPreferences.mPregameWindowSize) ? 0 : theQueue.availableCapacity();
+        int	theRemainingQueueSpace = (sHub->mPlayerDataDisposition.getReadTick() < sHub->mSmallestRealGameTick && theQueue.size() > sHubPreferences.mPregameWindowSize) ? 0 : theQueue.availableCapacity();
 	int theUsefulActionFlagsCount = theActionFlagsCount - theRedundantActionFlagsCount - theLateActionFlagsCount;
         int	theEnqueueableFlagsCount = std::min(theUsefulActionFlagsCount, theRemainingQueueSpace);
 
@@ -886,16 +977,15 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
         
         for(int i = 0; i < theEnqueueableFlagsCount; i++)
         {
-                action_flags_t theActionFlags;
-                ps >> theActionFlags;
+                action_flags_t theActionFlags = sIncomingFlags[theNextActionFlags++];
                 theQueue.enqueue(theActionFlags);
 		theLateQueue.enqueue(theActionFlags);
-		sLastFlagsReceived[inSenderIndex] = theActionFlags;
+		sHub->mLastFlagsReceived[inSenderIndex] = theActionFlags;
         }
 
 	// Update timing data
 	NetworkPlayer_hub& thePlayer = getNetworkPlayer(inSenderIndex);
-	NetworkPlayer_hub& theReferencePlayer = getNetworkPlayer(sReferencePlayerIndex);
+	NetworkPlayer_hub& theReferencePlayer = getNetworkPlayer(sHub->mReferencePlayerIndex);
 	while(thePlayer.mSmallestUnheardTick < theStartTick + theActionFlagsCount)
 	{
 		int32 theReferenceTick = theReferencePlayer.mSmallestUnheardTick;
@@ -906,28 +996,28 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
 	}
 
         // Make the pregame -> ingame transition
-        if(thePlayer.mSmallestUnheardTick >= sSmallestRealGameTick && static_cast<int32>(thePlayer.mNthElementFinder.window_size()) != sHubPreferences.mInGameWindowSize)
+        if(thePlayer.mSmallestUnheardTick >= sHub->mSmallestRealGameTick && static_cast<int32>(thePlayer.mNthElementFinder.window_size()) != sHubPreferences.mInGameWindowSize)
 		thePlayer.mNthElementFinder.reset(sHubPreferences.mInGameWindowSize);
 
 	if(thePlayer.mOutstandingTimingAdjustment == 0 && thePlayer.mNthElementFinder.window_full())
 	{
-		thePlayer.mOutstandingTimingAdjustment = thePlayer.mNthElementFinder.nth_smallest_element((thePlayer.mSmallestUnheardTick >= sSmallestRealGameTick) ? sHubPreferences.mInGameNthElement : sHubPreferences.mPregameNthElement);
+		thePlayer.mOutstandingTimingAdjustment = thePlayer.mNthElementFinder.nth_smallest_element((thePlayer.mSmallestUnheardTick >= sHub->mSmallestRealGameTick) ? sHubPreferences.mInGameNthElement : sHubPreferences.mPregameNthElement);
 
 		if(thePlayer.mOutstandingTimingAdjustment != 0)
 		{
-			thePlayer.mTimingAdjustmentTick = sSmallestIncompleteTick;
-			logTraceNMT("tick %d: asking player %d to adjust timing by %d", sSmallestIncompleteTick, inSenderIndex, thePlayer.mOutstandingTimingAdjustment);
+			thePlayer.mTimingAdjustmentTick = sHub->mSmallestIncompleteTick;
+			logTraceNMT("tick %d: asking player %d to adjust timing by %d", sHub->mSmallestIncompleteTick, inSenderIndex, thePlayer.mOutstandingTimingAdjustment);
 
 #ifdef DEBUG_TIMING_ADJUSTMENTS
-			if (debug_timing_adjustments && thePlayer.mSmallestUnheardTick >= sSmallestRealGameTick)
+			if (debug_timing_adjustments && thePlayer.mSmallestUnheardTick >= sHub->mSmallestRealGameTick)
 			{
-				dout << sNetworkTicker
+				dout << sHub->mNetworkTicker
 				     << ": "
 				     << "P" << inSenderIndex
 				     << " "
 				     << "H" << thePlayer.mLastNetworkTickHeard
 				     << " "
-				     << "T" << sSmallestIncompleteTick
+				     << "T" << sHub->mSmallestIncompleteTick
 				     << " "
 				     << "A" << thePlayer.mSmallestUnacknowledgedTick
 				     << " "
@@ -963,18 +1053,16 @@ hub_received_game_data_packet_v1(AIStream& ps, int inSenderIndex)
 				}
 				dout << std::endl;
 			}
-
-		}
-		
 #endif
+		}
 	}
 	
         // Do any needed post-processing
         if(theEnqueueableFlagsCount > 0)
         {
-		// Actually the shouldSend business is probably unnecessary now with sSmallestUnsentTick
+		// Actually the shouldSend business is probably unnecessary now with mSmallestUnsentTick
                 bool shouldSend = player_provided_flags_from_tick_to_tick(inSenderIndex, theStartTick + theRedundantActionFlagsCount + theLateActionFlagsCount, theStartTick + theRedundantActionFlagsCount + theEnqueueableFlagsCount + theLateActionFlagsCount);
-                if(shouldSend && (sSmallestIncompleteTick - sSmallestUnsentTick >= sHubPreferences.mSendPeriod))
+                if(shouldSend && (sHub->mSmallestIncompleteTick - sHub->mSmallestUnsentTick >= sHubPreferences.mSendPeriod))
                         send_packets();
         }
 } // hub_received_game_data_packet_v1()
@@ -992,18 +1080,18 @@ player_acknowledged_up_to_tick(size_t inPlayerIndex, int32 inSmallestUnacknowled
                 return;
 
         // We've heard from this player
-        thePlayer.mLastNetworkTickHeard = sNetworkTicker;
+        thePlayer.mLastNetworkTickHeard = sHub->mNetworkTicker;
 
         // Mark us ACKed for each intermediate tick
         for(int theTick = thePlayer.mSmallestUnacknowledgedTick; theTick < inSmallestUnacknowledgedTick; theTick++)
         {
-		logDumpNMT("tick %d: sPlayerDataDisposition=%d", theTick, sPlayerDataDisposition[theTick]);
+		logDumpNMT("tick %d: mPlayerDataDisposition=%d", theTick, sHub->mPlayerDataDisposition[theTick]);
 		
-                assert(sPlayerDataDisposition[theTick] & (((uint32)1) << inPlayerIndex));
-                sPlayerDataDisposition[theTick] &= ~(((uint32)1) << inPlayerIndex);
-		if (inPlayerIndex != sLocalPlayerIndex) 
+                assert(sHub->mPlayerDataDisposition[theTick] & (((uint32)1) << inPlayerIndex));
+                sHub->mPlayerDataDisposition[theTick] &= ~(((uint32)1) << inPlayerIndex);
+		if (inPlayerIndex != sHub->mLocalPlayerIndex) 
 		{
-			assert(theTick < sFlagSendTimeQueue.getWriteTick());
+			assert(theTick < sHub->mFlagSendTimeQueue.getWriteTick());
 
 			// update the latency calculations
 			if (thePlayer.mLatencyBuffer.size() >= kDisplayLatencyWindow)
@@ -1015,27 +1103,27 @@ player_acknowledged_up_to_tick(size_t inPlayerIndex, int32 inSmallestUnacknowled
 			{
 				thePlayer.mLatencyBuffer.pop_back();
 			}
-			int32 latency = sNetworkTicker - sFlagSendTimeQueue.peek(theTick);
+			int32 latency = sHub->mNetworkTicker - sHub->mFlagSendTimeQueue.peek(theTick);
 			thePlayer.mLatencyBuffer.push_front(latency);
 			thePlayer.mLatencyTicks += latency;
 
 		}
 			
-                if(sPlayerDataDisposition[theTick] == 0)
+                if(sHub->mPlayerDataDisposition[theTick] == 0)
                 {
-                        assert(theTick == sPlayerDataDisposition.getReadTick());
-			assert(theTick == sFlagSendTimeQueue.getReadTick());
-			assert(theTick == sPlayerReflectedFlags.getReadTick());
+                        assert(theTick == sHub->mPlayerDataDisposition.getReadTick());
+			assert(theTick == sHub->mFlagSendTimeQueue.getReadTick());
+			assert(theTick == sHub->mPlayerReflectedFlags.getReadTick());
                         
-                        sPlayerDataDisposition.dequeue();
-			sFlagSendTimeQueue.dequeue();
-			sPlayerReflectedFlags.dequeue();
-                        for(size_t i = 0; i < sFlagsQueues.size(); i++)
+                        sHub->mPlayerDataDisposition.dequeue();
+			sHub->mFlagSendTimeQueue.dequeue();
+			sHub->mPlayerReflectedFlags.dequeue();
+                        for(size_t i = 0; i < sHub->mFlagsQueues.size(); i++)
                         {
-                                if(sFlagsQueues[i].size() > 0)
+                                if(sHub->mFlagsQueues[i].size() > 0)
                                 {
-                                        assert(sFlagsQueues[i].getReadTick() == theTick);
-                                        sFlagsQueues[i].dequeue();
+                                        assert(sHub->mFlagsQueues[i].getReadTick() == theTick);
+                                        sHub->mFlagsQueues[i].dequeue();
                                 }
                         }
                 }
@@ -1059,31 +1147,31 @@ static bool make_up_flags_for_first_incomplete_tick()
 {
 	// find the smallest incomplete tick, and make up flags for anybody in that tick!
 	
-	if (sPlayerDataDisposition.getWriteTick() == sSmallestIncompleteTick) 
+	if (sHub->mPlayerDataDisposition.getWriteTick() == sHub->mSmallestIncompleteTick) 
 		// we don't have flags for anybody!
 		return false;
 
-	// never make up flags for ourself
-	if (getFlagsQueue(sLocalPlayerIndex).getWriteTick() == sSmallestIncompleteTick)
+	// never make up flags for ourself (standalone hub has no self)
+	if (sHub->mLocalPlayerIndex < sHub->mNetworkPlayers.size() && getFlagsQueue(sHub->mLocalPlayerIndex).getWriteTick() == sHub->mSmallestIncompleteTick)
 		return false;
 
 	// check to make sure everyone we want to make up flags for is in the lagging players bitmask
-	for (int i = 0; i < sNetworkPlayers.size(); i++)
+	for (int i = 0; i < sHub->mNetworkPlayers.size(); i++)
 	{
-		if (getFlagsQueue(i).getWriteTick() == sSmallestIncompleteTick && !(sLaggingPlayersBitmask & (1 << i)))
+		if (getFlagsQueue(i).getWriteTick() == sHub->mSmallestIncompleteTick && !(sHub->mLaggingPlayersBitmask & (1 << i)))
 			return false;
 	}
 
-	logTraceNMT("making up flags for tick %i", sSmallestIncompleteTick);
+	logTraceNMT("making up flags for tick %i", sHub->mSmallestIncompleteTick);
 
-	for (int i = 0; i < sNetworkPlayers.size(); i++)
+	for (int i = 0; i < sHub->mNetworkPlayers.size(); i++)
 	{
-		if (getFlagsQueue(i).getWriteTick() == sSmallestIncompleteTick)
+		if (getFlagsQueue(i).getWriteTick() == sHub->mSmallestIncompleteTick)
 		{
 			// network code shouldn't figure this out, someone else should
 			action_flags_t motionFlags;
 			TickBasedActionQueue& theLateQueue = getLateFlagsQueue(i);
-			if (sLaggingPlayersBitmask & (1 << i) && theLateQueue.getWriteTick() > theLateQueue.getReadTick())
+			if (sHub->mLaggingPlayersBitmask & (1 << i) && theLateQueue.getWriteTick() > theLateQueue.getReadTick())
 			{
 				uint32 midpoint = ((theLateQueue.getWriteTick() - theLateQueue.getReadTick()) / 2 + theLateQueue.getReadTick());
 				// collapse the queue up to the midpoint
@@ -1101,16 +1189,16 @@ static bool make_up_flags_for_first_incomplete_tick()
 			} 
 			else
 			{
-				motionFlags = sLastFlagsReceived[i] & (_moving | _sidestepping);
-				if (local_random() % 10 > 8) sLastFlagsReceived[i] = 0;
+				motionFlags = sHub->mLastFlagsReceived[i] & (_moving | _sidestepping);
+				if (local_random() % 10 > 8) sHub->mLastFlagsReceived[i] = 0;
 			}
-			sPlayerReflectedFlags[sSmallestIncompleteTick] |= (1 << i);
+			sHub->mPlayerReflectedFlags[sHub->mSmallestIncompleteTick] |= (1 << i);
 			getFlagsQueue(i).enqueue(motionFlags);
 		}
 	}
-	sPlayerDataDisposition[sSmallestIncompleteTick] = sConnectedPlayersBitmask;
-	sSmallestIncompleteTick++;
-	sLastRealUpdate = sNetworkTicker;
+	sHub->mPlayerDataDisposition[sHub->mSmallestIncompleteTick] = sHub->mConnectedPlayersBitmask;
+	sHub->mSmallestIncompleteTick++;
+	sHub->mLastRealUpdate = sHub->mNetworkTicker;
 	return true;
 }
 
@@ -1122,38 +1210,38 @@ player_provided_flags_from_tick_to_tick(size_t inPlayerIndex, int32 inFirstNewTi
 	
         bool shouldSend = false;
 
-	assert(sPlayerDataDisposition.getWriteTick() == sPlayerReflectedFlags.getWriteTick());
+	assert(sHub->mPlayerDataDisposition.getWriteTick() == sHub->mPlayerReflectedFlags.getWriteTick());
 
-        for(int i = sPlayerDataDisposition.getWriteTick(); i < inSmallestUnreceivedTick; i++)
+        for(int i = sHub->mPlayerDataDisposition.getWriteTick(); i < inSmallestUnreceivedTick; i++)
         {
-		logDumpNMT("tick %d: enqueueing sPlayerDataDisposition %d", i, sConnectedPlayersBitmask);
-                sPlayerDataDisposition.enqueue(sConnectedPlayersBitmask);
-		sPlayerReflectedFlags.enqueue(0);
+		logDumpNMT("tick %d: enqueueing mPlayerDataDisposition %d", i, sHub->mConnectedPlayersBitmask);
+                sHub->mPlayerDataDisposition.enqueue(sHub->mConnectedPlayersBitmask);
+		sHub->mPlayerReflectedFlags.enqueue(0);
         }
 
         for(int i = inFirstNewTick; i < inSmallestUnreceivedTick; i++)
         {
-		logDumpNMT("tick %d: sPlayerDataDisposition=%d", i, sPlayerDataDisposition[i]);
+		logDumpNMT("tick %d: mPlayerDataDisposition=%d", i, sHub->mPlayerDataDisposition[i]);
 		
-                assert(sPlayerDataDisposition[i] & (((uint32)1) << inPlayerIndex));
-                sPlayerDataDisposition[i] &= ~(((uint32)1) << inPlayerIndex);
+                assert(sHub->mPlayerDataDisposition[i] & (((uint32)1) << inPlayerIndex));
+                sHub->mPlayerDataDisposition[i] &= ~(((uint32)1) << inPlayerIndex);
 		
 		// remove the player from the list of lagging players, and
 		// dequeue his late flags
-		sLaggingPlayersBitmask &= ~(((uint32)1) << inPlayerIndex);
+		sHub->mLaggingPlayersBitmask &= ~(((uint32)1) << inPlayerIndex);
 		TickBasedActionQueue& theLateQueue = getLateFlagsQueue(inPlayerIndex);
 		while (theLateQueue.getReadTick() < theLateQueue.getWriteTick())
 			theLateQueue.dequeue();
 
-                if(sPlayerDataDisposition[i] == 0)
+                if(sHub->mPlayerDataDisposition[i] == 0)
                 {
-                        assert(sSmallestIncompleteTick == i);
-                        sSmallestIncompleteTick++;
-			sLastRealUpdate = sNetworkTicker;
+                        assert(sHub->mSmallestIncompleteTick == i);
+                        sHub->mSmallestIncompleteTick++;
+			sHub->mLastRealUpdate = sHub->mNetworkTicker;
                         shouldSend = true;
 
                         // Now people need to ACK
-                        sPlayerDataDisposition[i] = sConnectedPlayersBitmask;
+                        sHub->mPlayerDataDisposition[i] = sHub->mConnectedPlayersBitmask;
                 }
 
         } // loop over ticks with new data
@@ -1192,7 +1280,7 @@ process_messages(AIStream& ps, int inSenderIndex)
 static void
 process_lossy_byte_stream_message(AIStream& ps, int inSenderIndex, uint16 inLength)
 {
-	assert(inSenderIndex >= 0 && inSenderIndex < static_cast<int>(sNetworkPlayers.size()));
+	assert(inSenderIndex >= 0 && inSenderIndex < static_cast<int>(sHub->mNetworkPlayers.size()));
 
 	HubLossyByteStreamChunkDescriptor theDescriptor;
 
@@ -1205,14 +1293,14 @@ process_lossy_byte_stream_message(AIStream& ps, int inSenderIndex, uint16 inLeng
 
 	bool canEnqueue = true;
 	
-	if(sOutgoingLossyByteStreamDescriptors.getRemainingSpace() < 1)
+	if(sHub->mOutgoingLossyByteStreamDescriptors.getRemainingSpace() < 1)
 	{
 		logNoteNMT("no descriptor space remains; discarding (%uh) bytes of lossy streaming data of distribution type %hd from player %hu destined for 0x%lx", theDescriptor.mLength, theDescriptor.mType, theDescriptor.mSender, theDescriptor.mDestinations);
 		canEnqueue = false;
 	}
 
 	// We avoid enqueueing a partial chunk to make things easier on code that uses us
-	if(theDescriptor.mLength > sOutgoingLossyByteStreamData.getRemainingSpace())
+	if(theDescriptor.mLength > sHub->mOutgoingLossyByteStreamData.getRemainingSpace())
 	{
 		logNoteNMT("insufficient buffer space for %uh bytes of lossy streaming data of distribution type %hd from player %hu destined for 0x%lx; discarded", theDescriptor.mLength, theDescriptor.mType, theDescriptor.mSender, theDescriptor.mDestinations);
 		canEnqueue = false;
@@ -1230,8 +1318,8 @@ process_lossy_byte_stream_message(AIStream& ps, int inSenderIndex, uint16 inLeng
 			// XXX extraneous copy, needed given the current interfaces to these things
 			ps.read(sScratchBuffer, theDescriptor.mLength);
 	
-			sOutgoingLossyByteStreamData.enqueueBytes(sScratchBuffer, theDescriptor.mLength);
-			sOutgoingLossyByteStreamDescriptors.enqueue(theDescriptor);
+			sHub->mOutgoingLossyByteStreamData.enqueueBytes(sScratchBuffer, theDescriptor.mLength);
+			sHub->mOutgoingLossyByteStreamDescriptors.enqueue(theDescriptor);
 		}
 	}
 	else
@@ -1241,6 +1329,51 @@ process_lossy_byte_stream_message(AIStream& ps, int inSenderIndex, uint16 inLeng
 
 
 
+static void
+process_world_hash_message(AIStream& ps, int inSenderIndex, uint16 inLength)
+{
+	int32 theTick;
+	uint32 theHash;
+
+	size_t theStartOfMessage = ps.tellg();
+	ps >> theTick >> theHash;
+	// Allow for future versions tacking more data on the end
+	ps.ignore(inLength - (ps.tellg() - theStartOfMessage));
+
+	// Too old to compare against anything?
+	if(!sHub->mWorldHashReports.empty() && theTick < sHub->mWorldHashReports.rbegin()->first - kWorldHashWindowSize)
+		return;
+
+	TickToWorldHashReport::iterator i = sHub->mWorldHashReports.find(theTick);
+	if(i == sHub->mWorldHashReports.end())
+	{
+		WorldHashReport theReport;
+		theReport.mHash = theHash;
+		theReport.mFirstReporter = inSenderIndex;
+		theReport.mReportersBitmask = (((uint32)1) << inSenderIndex);
+		sHub->mWorldHashReports[theTick] = theReport;
+
+		// Forget about ticks everyone should have reported by now
+		sHub->mWorldHashReports.erase(sHub->mWorldHashReports.begin(), sHub->mWorldHashReports.lower_bound(sHub->mWorldHashReports.rbegin()->first - kWorldHashWindowSize));
+		return;
+	}
+
+	WorldHashReport& theReport = i->second;
+
+	// Spokes repeat their reports in case of packet loss
+	if(theReport.mReportersBitmask & (((uint32)1) << inSenderIndex))
+		return;
+
+	theReport.mReportersBitmask |= (((uint32)1) << inSenderIndex);
+
+	if(theHash != theReport.mHash)
+		logErrorNMT("player %d is out of sync with player %d at tick %d (world hash 0x%08x vs 0x%08x)", inSenderIndex, theReport.mFirstReporter, theTick, theHash, theReport.mHash);
+	else
+		logDumpNMT("player %d agrees with player %d at tick %d", inSenderIndex, theReport.mFirstReporter, theTick);
+}
+
+
+
 static void
 process_optional_message(AIStream& ps, int inSenderIndex, uint16 inMessageType)
 {
@@ -1252,6 +1385,8 @@ process_optional_message(AIStream& ps, int inSenderIndex, uint16 inMessageType)
 
 	if(inMessageType == kSpokeToHubLossyByteStreamMessageType)
 		process_lossy_byte_stream_message(ps, inSenderIndex, theMessageLength);
+	else if(inMessageType == kSpokeToHubWorldHashMessageType)
+		process_world_hash_message(ps, inSenderIndex, theMessageLength);
 	else
 	{
 		// Currently we ignore (skip) all optional messages
@@ -1270,23 +1405,40 @@ make_player_netdead(int inPlayerIndex)
 
 	// make sure we're not processing a packet
 	{
+#ifndef A1_NETWORK_STANDALONE_HUB
 		MyTMMutexTaker mutex;
-		thePlayer.mNetDeadTick = sSmallestIncompleteTick;
+#endif
+		thePlayer.mNetDeadTick = sHub->mSmallestIncompleteTick;
 		thePlayer.mConnected = false;
-		sConnectedPlayersBitmask &= ~(((uint32)1) << inPlayerIndex);
-		sAddressToPlayerIndex.erase(thePlayer.mAddress);
+		sHub->mConnectedPlayersBitmask &= ~(((uint32)1) << inPlayerIndex);
+		sHub->mAddressToPlayerIndex.erase(thePlayer.mAddress);
 	}
 
 	// We save this off because player_provided... call below may change it.
-	int32 theSavedIncompleteTick = sSmallestIncompleteTick;
+	int32 theSavedIncompleteTick = sHub->mSmallestIncompleteTick;
 	
         // Pretend for housekeeping that he's provided data for all currently known ticks
         // We go from the first tick for which we don't actually have his data through the last
         // tick we actually know about.
-        player_provided_flags_from_tick_to_tick(inPlayerIndex, getFlagsQueue(inPlayerIndex).getWriteTick(), sPlayerDataDisposition.getWriteTick());
+        player_provided_flags_from_tick_to_tick(inPlayerIndex, getFlagsQueue(inPlayerIndex).getWriteTick(), sHub->mPlayerDataDisposition.getWriteTick());
 
         // Pretend for housekeeping that he's already acknowledged all sent ticks
         player_acknowledged_up_to_tick(inPlayerIndex, theSavedIncompleteTick);
+
+#ifdef A1_NETWORK_STANDALONE_HUB
+	// With no local player to time everyone against, the reference role passes to someone still here.
+	if(static_cast<size_t>(inPlayerIndex) == sHub->mReferencePlayerIndex)
+	{
+		for(size_t i = 0; i < sHub->mNetworkPlayers.size(); i++)
+		{
+			if(sHub->mNetworkPlayers[i].mConnected)
+			{
+				sHub->mReferencePlayerIndex = i;
+				break;
+			}
+		}
+	}
+#endif
 }
 
 static int add_squares(int x, int y) { return x + y * y; }
@@ -1294,24 +1446,29 @@ static int add_squares(int x, int y) { return x + y * y; }
 static bool
 hub_tick()
 {
-        sNetworkTicker++;
+        sHub->mNetworkTicker++;
+
+	logContextNMT("performing hub_tick %d", sHub->mNetworkTicker);
 
-	logContextNMT("performing hub_tick %d", sNetworkTicker);
+#ifndef A1_NETWORK_STANDALONE_HUB
+        // Handle whatever the receiving thread queued since last tick
+        NetDDPDispatchQueuedPackets();
+#endif
 
         // Check for newly netdead players
         bool shouldSend = false;
-        for(size_t i = 0; i < sNetworkPlayers.size(); i++)
+        for(size_t i = 0; i < sHub->mNetworkPlayers.size(); i++)
         {
-                int theSilentTicksBeforeNetDeath = (sNetworkPlayers[i].mSmallestUnacknowledgedTick < sSmallestRealGameTick) ? sHubPreferences.mPregameTicksBeforeNetDeath : sHubPreferences.mInGameTicksBeforeNetDeath;
-                if (sNetworkPlayers[i].mConnected && sNetworkTicker - sNetworkPlayers[i].mLastNetworkTickHeard > theSilentTicksBeforeNetDeath)
+                int theSilentTicksBeforeNetDeath = (sHub->mNetworkPlayers[i].mSmallestUnacknowledgedTick < sHub->mSmallestRealGameTick) ? sHubPreferences.mPregameTicksBeforeNetDeath : sHubPreferences.mInGameTicksBeforeNetDeath;
+                if (sHub->mNetworkPlayers[i].mConnected && sHub->mNetworkTicker - sHub->mNetworkPlayers[i].mLastNetworkTickHeard > theSilentTicksBeforeNetDeath)
                 {
                         make_player_netdead(i);
                         shouldSend = true;
                 }
 		// if this guy's last ACK was longer ago than the queues have space to store things, I guess dump him
-		else if (i != sLocalPlayerIndex && sNetworkPlayers[i].mConnected && sNetworkPlayers[i].mSmallestUnacknowledgedTick >= sSmallestRealGameTick && (sNetworkPlayers[sReferencePlayerIndex].mSmallestUnacknowledgedTick - sNetworkPlayers[i].mSmallestUnacknowledgedTick) >= kFlagsQueueSize) {
+		else if (i != sHub->mLocalPlayerIndex && sHub->mNetworkPlayers[i].mConnected && sHub->mNetworkPlayers[i].mSmallestUnacknowledgedTick >= sHub->mSmallestRealGameTick && (sHub->mNetworkPlayers[sHub->mReferencePlayerIndex].mSmallestUnacknowledgedTick - sHub->mNetworkPlayers[i].mSmallestUnacknowledgedTick) >= kFlagsQueueSize) {
 			{
-				logWarningNMT("Disconnecting player %i for late ACKs (last ACK %i, reference ACK %i", i, sNetworkPlayers[i].mSmallestUnacknowledgedTick, sNetworkPlayers[sReferencePlayerIndex].mSmallestUnacknowledgedTick);
+				logWarningNMT("Disconnecting player %i for late ACKs (last ACK %i, reference ACK %i", i, sHub->mNetworkPlayers[i].mSmallestUnacknowledgedTick, sHub->mNetworkPlayers[sHub->mReferencePlayerIndex].mSmallestUnacknowledgedTick);
 				make_player_netdead(i);
 				shouldSend = true;
 			}
@@ -1321,33 +1478,33 @@ hub_tick()
 			
 	// if we're getting behind, make up flags
 	
-	if (sHubPreferences.mBandwidthReduction && sPlayerDataDisposition.getReadTick() >= sSmallestRealGameTick)
+	if (sHubPreferences.mBandwidthReduction && sHub->mPlayerDataDisposition.getReadTick() >= sHub->mSmallestRealGameTick)
 	{
-		if (sHubPreferences.mMinimumSendPeriod >= sHubPreferences.mSendPeriod && sSmallestIncompleteTick < sPlayerDataDisposition.getWriteTick())
+		if (sHubPreferences.mMinimumSendPeriod >= sHubPreferences.mSendPeriod && sHub->mSmallestIncompleteTick < sHub->mPlayerDataDisposition.getWriteTick())
 		{
 			
-			if (sNetworkTicker - sLastRealUpdate >= sHubPreferences.mMinimumSendPeriod)
+			if (sHub->mNetworkTicker - sHub->mLastRealUpdate >= sHubPreferences.mMinimumSendPeriod)
 			{
 				// add anybody holding us back to the lagging player bitmask
-				for (int i = 0; i < sNetworkPlayers.size(); i++)
+				for (int i = 0; i < sHub->mNetworkPlayers.size(); i++)
 				{
-					if (i != sLocalPlayerIndex && sNetworkPlayers[i].mConnected && sSmallestRealGameTick > sNetworkPlayers[i].mNetDeadTick)
+					if (i != sHub->mLocalPlayerIndex && sHub->mNetworkPlayers[i].mConnected && sHub->mSmallestRealGameTick > sHub->mNetworkPlayers[i].mNetDeadTick)
 					{
-						if (sPlayerDataDisposition[sSmallestIncompleteTick] & (1 << i))
-							sLaggingPlayersBitmask |= (1 << i);
+						if (sHub->mPlayerDataDisposition[sHub->mSmallestIncompleteTick] & (1 << i))
+							sHub->mLaggingPlayersBitmask |= (1 << i);
 					}
 				}
 			}
 			
-			if (sLaggingPlayersBitmask) {
+			if (sHub->mLaggingPlayersBitmask) {
 				// make up flags if a majority of players are ready to go
 				int readyPlayers = 0;
 				int nonReadyPlayers = 0;
-				for (int i = 0; i < sNetworkPlayers.size(); i++)
+				for (int i = 0; i < sHub->mNetworkPlayers.size(); i++)
 				{
-					if (sNetworkPlayers[i].mConnected && sSmallestRealGameTick > sNetworkPlayers[i].mNetDeadTick)
+					if (sHub->mNetworkPlayers[i].mConnected && sHub->mSmallestRealGameTick > sHub->mNetworkPlayers[i].mNetDeadTick)
 					{
-						if (sPlayerDataDisposition[sSmallestIncompleteTick] & (1 << i))
+						if (sHub->mPlayerDataDisposition[sHub->mSmallestIncompleteTick] & (1 << i))
 							nonReadyPlayers++;
 						else
 							readyPlayers++;
@@ -1369,7 +1526,7 @@ hub_tick()
 		else
 		{
 			// Make sure we send at least every once in a while to keep things going
-			if(sNetworkTicker > sLastNetworkTickSent && (sNetworkTicker - sLastNetworkTickSent) >= sHubPreferences.mRecoverySendPeriod)
+			if(sHub->mNetworkTicker > sHub->mLastNetworkTickSent && (sHub->mNetworkTicker - sHub->mLastNetworkTickSent) >= sHubPreferences.mRecoverySendPeriod)
 				send_packets();
 		}
 		
@@ -1377,13 +1534,13 @@ hub_tick()
         check_send_packet_to_spoke();
 
 	// calculate standard deviation
-	if (sNetworkTicker % kJitterUpdateInterval == 0)
+	if (sHub->mNetworkTicker % kJitterUpdateInterval == 0)
 	{
-		for (int i = 0; i < sNetworkPlayers.size(); ++i)
+		for (int i = 0; i < sHub->mNetworkPlayers.size(); ++i)
 		{
-			if (i != sLocalPlayerIndex)
+			if (i != sHub->mLocalPlayerIndex)
 			{
-				NetworkPlayer_hub& thePlayer = sNetworkPlayers[i];
+				NetworkPlayer_hub& thePlayer = sHub->mNetworkPlayers[i];
 				if (thePlayer.mConnected)
 				{
 					if (thePlayer.mLatencyBuffer.size())
@@ -1403,18 +1560,29 @@ hub_tick()
 		}
 	}
 
+	// action_flags bandwidth, over the last second
+	if (sHub->mNetworkTicker % TICKS_PER_SECOND == 0)
+	{
+		for (int i = 0; i < sHub->mNetworkPlayers.size(); ++i)
+		{
+			NetworkPlayer_hub& thePlayer = sHub->mNetworkPlayers[i];
+			thePlayer.mStats.flags_bytes_per_tick = std::min(thePlayer.mFlagsBytesSent / TICKS_PER_SECOND, static_cast<int32>(UINT16_MAX));
+			thePlayer.mFlagsBytesSent = 0;
+		}
+	}
+
 	// calculate ping
-	for (int i = 0; i < sNetworkPlayers.size(); ++i)
+	for (int i = 0; i < sHub->mNetworkPlayers.size(); ++i)
 	{
-		NetworkPlayer_hub& thePlayer = sNetworkPlayers[i];
-		if (i != sLocalPlayerIndex)
+		NetworkPlayer_hub& thePlayer = sHub->mNetworkPlayers[i];
+		if (i != sHub->mLocalPlayerIndex)
 		{
 			if (thePlayer.mConnected)
 			{
 				if (thePlayer.mLatencyBuffer.size())
 				{
 					int32 samples = std::min(thePlayer.mLatencyBuffer.size(), static_cast<size_t>(kDisplayLatencyWindow));
-					int32 latency_ticks = std::max(thePlayer.mLatencyTicks, ((sNetworkTicker - thePlayer.mLastNetworkTickHeard) * samples));
+					int32 latency_ticks = std::max(thePlayer.mLatencyTicks, ((sHub->mNetworkTicker - thePlayer.mLastNetworkTickHeard) * samples));
 					thePlayer.mStats.latency = (latency_ticks * 1000 / TICKS_PER_SECOND / samples);
 				}
 			}
@@ -1443,30 +1611,30 @@ send_packets()
 	// we do some processing here outside the loop since the results'd be the same every time.
 	HubLossyByteStreamChunkDescriptor theDescriptor = { 0, 0, 0, 0 };
 	bool haveLossyData = false;
-	if(sOutgoingLossyByteStreamDescriptors.getCountOfElements() > 0)
+	if(sHub->mOutgoingLossyByteStreamDescriptors.getCountOfElements() > 0)
 	{
 		haveLossyData = true;
-		theDescriptor = sOutgoingLossyByteStreamDescriptors.peek();
+		theDescriptor = sHub->mOutgoingLossyByteStreamDescriptors.peek();
 
 		// XXX extraneous copy due to limited interfaces
 		// We assert here; the real "test" happened when it was enqueued.
 		assert(theDescriptor.mLength <= sizeof(sScratchBuffer));
-		sOutgoingLossyByteStreamData.peekBytes(sScratchBuffer, theDescriptor.mLength);
+		sHub->mOutgoingLossyByteStreamData.peekBytes(sScratchBuffer, theDescriptor.mLength);
 	}
 
 	// remember when we sent flags for the first time
-	for (int32 i = sFlagSendTimeQueue.getWriteTick(); i < sSmallestIncompleteTick; i++) 
+	for (int32 i = sHub->mFlagSendTimeQueue.getWriteTick(); i < sHub->mSmallestIncompleteTick; i++) 
 	{
-		sFlagSendTimeQueue.enqueue(sNetworkTicker);
+		sHub->mFlagSendTimeQueue.enqueue(sHub->mNetworkTicker);
 	}
 		
-        for(size_t i = 0; i < sNetworkPlayers.size(); i++)
+        for(size_t i = 0; i < sHub->mNetworkPlayers.size(); i++)
         {
-                NetworkPlayer_hub& thePlayer = sNetworkPlayers[i];
+                NetworkPlayer_hub& thePlayer = sHub->mNetworkPlayers[i];
                 if(thePlayer.mConnected && thePlayer.mAddressKnown)
                 {
-			AOStreamBE hdr(sOutgoingFrame->data, kStarPacketHeaderSize);
-                        AOStreamBE ps(sOutgoingFrame->data, ddpMaxData, kStarPacketHeaderSize);
+			AOStreamBE hdr(sHub->mOutgoingFrame->data, kStarPacketHeaderSize);
+                        AOStreamBE ps(sHub->mOutgoingFrame->data, ddpMaxData, kStarPacketHeaderSize);
 
                         try {
                                 // acknowledgement
@@ -1476,19 +1644,19 @@ send_packets()
                                 // Timing adjustment?
                                 if(thePlayer.mOutstandingTimingAdjustment != 0)
                                 {
-					int8 adjustment = PIN(thePlayer.mOutstandingTimingAdjustment, INT8_MIN, INT8_MAX);
+					int8 adjustment = A1_PIN(thePlayer.mOutstandingTimingAdjustment, INT8_MIN, INT8_MAX);
                                         ps << (uint16)kTimingAdjustmentMessageType
 					   << adjustment;
                                 }
         
                                 // Netdead players?
-                                for(size_t j = 0; j < sNetworkPlayers.size(); j++)
+                                for(size_t j = 0; j < sHub->mNetworkPlayers.size(); j++)
                                 {
-                                        if(thePlayer.mSmallestUnacknowledgedTick <= sNetworkPlayers[j].mNetDeadTick)
+                                        if(thePlayer.mSmallestUnacknowledgedTick <= sHub->mNetworkPlayers[j].mNetDeadTick)
                                         {
                                                 ps << (uint16)kPlayerNetDeadMessageType
                                                         << (uint8)j	// dead player index
-                                                        << sNetworkPlayers[j].mNetDeadTick;
+                                                        << sHub->mNetworkPlayers[j].mNetDeadTick;
                                         }
                                 }
 
@@ -1518,7 +1686,7 @@ send_packets()
 				int32 startTick;
 				int32 endTick;
 
-				if (sHubPreferences.mBandwidthReduction && sPlayerDataDisposition.getReadTick() >= sSmallestRealGameTick)
+				if (sHubPreferences.mBandwidthReduction && sHub->mPlayerDataDisposition.getReadTick() >= sHub->mSmallestRealGameTick)
 				{
 					// never send fewer than 2 full updates per second, or more than 15
 					int32 latencyCount = std::min(thePlayer.mLatencyBuffer.size(), static_cast<size_t>(kDisplayLatencyWindow));
@@ -1532,51 +1700,51 @@ send_packets()
 						effectiveLatency = TICKS_PER_SECOND / 2;
 					}
 					
-					if (sNetworkTicker - thePlayer.mLastRecoverySend >= effectiveLatency)
+					if (sHub->mNetworkTicker - thePlayer.mLastRecoverySend >= effectiveLatency)
 					{
 						// send a large update
-						thePlayer.mLastRecoverySend = sNetworkTicker;
+						thePlayer.mLastRecoverySend = sHub->mNetworkTicker;
 						
 						// we want to send 4 seconds worth of flags per second
 						int maxTicks = 4 * effectiveLatency;
 
 						int bytesAvailableForFlags = ps.maxp() - ps.tellp() - 4; // have to encode the tick
-						// don't run out of room in the packet, though
-						if (maxTicks * sNetworkPlayers.size() * 4 > bytesAvailableForFlags) 
+						// don't run out of room in the packet, though (version 2 stops when it's full)
+						if (thePlayer.mPacketVersion < 2 && maxTicks * sHub->mNetworkPlayers.size() * 4 > bytesAvailableForFlags) 
 						{
-							int maximumBytesPerTick = sNetworkPlayers.size() * 4;
+							int maximumBytesPerTick = sHub->mNetworkPlayers.size() * 4;
 							maxTicks = bytesAvailableForFlags / maximumBytesPerTick;
 						}
 
 						startTick = thePlayer.mSmallestUnacknowledgedTick;
-						endTick = (startTick + maxTicks < sSmallestIncompleteTick) ? startTick + maxTicks : sSmallestIncompleteTick;
+						endTick = (startTick + maxTicks < sHub->mSmallestIncompleteTick) ? startTick + maxTicks : sHub->mSmallestIncompleteTick;
 					}
 					else
 					{
 						// send the last 3 flags
-						startTick = std::max(sSmallestIncompleteTick - 3, thePlayer.mSmallestUnacknowledgedTick);
-						endTick = sSmallestIncompleteTick;
+						startTick = std::max(sHub->mSmallestIncompleteTick - 3, thePlayer.mSmallestUnacknowledgedTick);
+						endTick = sHub->mSmallestIncompleteTick;
 					}
 				}
 				else 
 				{
 					startTick = thePlayer.mSmallestUnacknowledgedTick;
-					endTick = sSmallestIncompleteTick;
+					endTick = sHub->mSmallestIncompleteTick;
 				}
 
 				bool reflectFlags = false;
 				// find out if we need to reflect flags
 				for (int32 tick = startTick; tick < endTick && !reflectFlags; tick++)
 				{
-					if (sPlayerReflectedFlags.peek(tick) & (1 << i)) reflectFlags = true;
+					if (sHub->mPlayerReflectedFlags.peek(tick) & (1 << i)) reflectFlags = true;
 				}
         
                                 // Action_flags!!
                                 // First, preprocess the players to figure out at what tick they'll each stop
                                 // contributing
 				std::vector<int32> theSmallestTickWeWontSend;
-                                theSmallestTickWeWontSend.resize(sNetworkPlayers.size());
-                                for(size_t j = 0; j < sNetworkPlayers.size(); j++)
+                                theSmallestTickWeWontSend.resize(sHub->mNetworkPlayers.size());
+                                for(size_t j = 0; j < sHub->mNetworkPlayers.size(); j++)
                                 {
                                         // Don't encode our own flags
                                         if(j == i && !reflectFlags)
@@ -1585,8 +1753,8 @@ send_packets()
                                                 continue;
                                         }
         
-                                        theSmallestTickWeWontSend[j] = sSmallestIncompleteTick;
-                                        NetworkPlayer_hub& theOtherPlayer = sNetworkPlayers[j];
+                                        theSmallestTickWeWontSend[j] = sHub->mSmallestIncompleteTick;
+                                        NetworkPlayer_hub& theOtherPlayer = sHub->mNetworkPlayers[j];
         
                                         // Don't send flags for netdead people
                                         if(!theOtherPlayer.mConnected && theSmallestTickWeWontSend[j] > theOtherPlayer.mNetDeadTick)
@@ -1595,9 +1763,15 @@ send_packets()
         
                                 // Now, encode the flags in tick-major order (this is much easier to decode
                                 // at the other end)
+				int32 theFlagsStart = ps.tellp();
+				ActionFlagsWriter theWriter(ps, sHub->mNetworkPlayers.size(), thePlayer.mPacketVersion);
                                 for(int32 tick = startTick; tick < endTick; tick++)
                                 {
-                                        for(size_t j = 0; j < sNetworkPlayers.size(); j++)
+					// Send the ticks that fit, rather than no packet at all
+					if(haveSentStartTick && !theWriter.has_room(sHub->mNetworkPlayers.size()))
+						break;
+
+                                        for(size_t j = 0; j < sHub->mNetworkPlayers.size(); j++)
                                         {
                                                 if(tick < theSmallestTickWeWontSend[j])
                                                 {
@@ -1606,26 +1780,31 @@ send_packets()
                                                                 ps << tick;
                                                                 haveSentStartTick = true;
                                                         }
-                                                        ps << getFlagsQueue(j).peek(tick);
+                                                        theWriter.write(j, getFlagsQueue(j).peek(tick));
                                                 }
                                         }
                                 }
+				theWriter.flush();
+				thePlayer.mFlagsBytesSent += ps.tellp() - theFlagsStart;
 				
-				hdr << (uint16) (reflectFlags ? kHubToSpokeGameDataPacketWithSpokeFlagsV1Magic : kHubToSpokeGameDataPacketV1Magic);
+				if(thePlayer.mPacketVersion >= 2)
+					hdr << (uint16) (reflectFlags ? kHubToSpokeGameDataPacketWithSpokeFlagsV2Magic : kHubToSpokeGameDataPacketV2Magic);
+				else
+					hdr << (uint16) (reflectFlags ? kHubToSpokeGameDataPacketWithSpokeFlagsV1Magic : kHubToSpokeGameDataPacketV1Magic);
 
 				// blank out the CRC field before calculating
-				sOutgoingFrame->data[2] = 0;
-				sOutgoingFrame->data[3] = 0;
+				sHub->mOutgoingFrame->data[2] = 0;
+				sHub->mOutgoingFrame->data[3] = 0;
 
-				uint16 crc = calculate_data_crc_ccitt(sOutgoingFrame->data, ps.tellp());
+				uint16 crc = calculate_data_crc_ccitt(sHub->mOutgoingFrame->data, ps.tellp());
 				hdr << crc;
         
                                 // Send the packet
-                                sOutgoingFrame->data_size = ps.tellp();
-                                if(i == sLocalPlayerIndex)
-                                        send_frame_to_local_spoke(sOutgoingFrame, &thePlayer.mAddress, kPROTOCOL_TYPE, 0 /* ignored */);
+                                sHub->mOutgoingFrame->data_size = ps.tellp();
+                                if(i == sHub->mLocalPlayerIndex)
+                                        send_frame_to_local_spoke(sHub->mOutgoingFrame, &thePlayer.mAddress, kPROTOCOL_TYPE, 0 /* ignored */);
                                 else
-                                        NetDDPSendFrame(sOutgoingFrame, &thePlayer.mAddress, kPROTOCOL_TYPE, 0 /* ignored */);
+                                        NetDDPSendFrame(sHub->mOutgoingFrame, &thePlayer.mAddress, kPROTOCOL_TYPE, 0 /* ignored */);
                         } // try
                         catch (...)
                         {
@@ -1636,13 +1815,13 @@ send_packets()
 
         } // iterate over players
 
-        sLastNetworkTickSent = sNetworkTicker;
-	sSmallestUnsentTick = sSmallestIncompleteTick;
+        sHub->mLastNetworkTickSent = sHub->mNetworkTicker;
+	sHub->mSmallestUnsentTick = sHub->mSmallestIncompleteTick;
 
 	if(haveLossyData)
 	{
-		sOutgoingLossyByteStreamData.dequeue(theDescriptor.mLength);
-		sOutgoingLossyByteStreamDescriptors.dequeue();
+		sHub->mOutgoingLossyByteStreamData.dequeue(theDescriptor.mLength);
+		sHub->mOutgoingLossyByteStreamDescriptors.dequeue();
 	}
 	
 } // send_packets()
@@ -1652,6 +1831,69 @@ const NetworkStats& hub_stats(int player_index)
 	return getNetworkPlayer(player_index).mStats;
 }
 
+
+
+#ifdef A1_NETWORK_STANDALONE_HUB
+HubInstance*
+hub_new_instance()
+{
+	return new HubInstance;
+}
+
+
+
+void
+hub_delete_instance(HubInstance* inInstance)
+{
+	if(sHub == inInstance)
+		sHub = &sDefaultHub;
+
+	delete inInstance;
+}
+
+
+
+void
+hub_set_instance(HubInstance* inInstance)
+{
+	sHub = (inInstance != NULL) ? inInstance : &sDefaultHub;
+}
+
+
+
+bool
+hub_standalone_tick()
+{
+	if(!sHub->mHubActive)
+		return false;
+
+	return hub_tick();
+}
+
+
+
+bool
+hub_is_active()
+{
+	return sHub->mHubActive;
+}
+
+
+
+size_t
+hub_connected_player_count()
+{
+	size_t theCount = 0;
+	for(size_t i = 0; i < sHub->mNetworkPlayers.size(); i++)
+	{
+		if(sHub->mNetworkPlayers[i].mConnected)
+			theCount++;
+	}
+
+	return theCount;
+}
+#endif // A1_NETWORK_STANDALONE_HUB
+
 enum {
 	// kOutgoingFlagsQueueSizeAttribute,
 	kPregameTicksBeforeNetDeathAttribute,
@@ -62,7 +62,8 @@ enum {
 	kDefaultTimingNthElement = kDefaultTimingWindowSize / 2,
 	kLossyByteStreamDataBufferSize = 1280,
 	kTypicalLossyByteStreamChunkSize = 56,
-	kLossyByteStreamDescriptorCount = kLossyByteStreamDataBufferSize / kTypicalLossyByteStreamChunkSize
+	kLossyByteStreamDescriptorCount = kLossyByteStreamDataBufferSize / kTypicalLossyByteStreamChunkSize,
+	kWorldHashSendCount = 3
 };
 
 struct SpokePreferences
@@ -123,6 +124,8 @@ static WindowedNthElementFinder<int32> sNthElementFinder(kDefaultTimingWindowSiz
 static bool sTimingMeasurementValid;
 static int32 sTimingMeasurement;
 static bool sHeardFromHub = false;
+// game data packet version we send the hub; 2 once it's sent us version 2 (see kStarPacketVersion)
+static uint16 sHubPacketVersion = 1;
 
 static vector<int32> sDisplayLatencyBuffer; // stores the last 30 latency calculations, in ticks
 static uint32 sDisplayLatencyCount = 0;
@@ -146,9 +149,15 @@ static CircularQueue<SpokeLossyByteStreamChunkDescriptor> sOutgoingLossyByteStre
 // This is currently used only to hold incoming streaming data until it's passed to the upper-level code
 static byte sScratchBuffer[kLossyByteStreamDataBufferSize];
 
+// The most recent world hash the game reported.  Packets can be lost, so we repeat it
+// in the next few packets we send; the hub ignores the duplicates.
+static int32 sWorldHashTick;
+static uint32 sWorldHash;
+static int sWorldHashSendsRemaining;
+
 
 static void spoke_became_disconnected();
-static void spoke_received_game_data_packet_v1(AIStream& ps, bool reflected_flags);
+static void spoke_received_game_data_packet(AIStream& ps, bool reflected_flags, uint16 inPacketVersion);
 static void spoke_received_ping_request(AIStream& ps, NetAddrBlock address);
 static void spoke_received_ping_response(AIStream& ps, NetAddrBlock address);
 static void process_messages(AIStream& ps, IncomingGameDataPacketProcessingContext& context);
@@ -261,6 +270,8 @@ spoke_initialize(const NetAddrBlock& inHubAddress, int32 inFirstTick, size_t inN
 	sOutgoingLossyByteStreamDescriptors.reset();
 	sOutgoingLossyByteStreamData.reset();
 
+	sWorldHashSendsRemaining = 0;
+
         sMessageTypeToMessageHandler.clear();
         sMessageTypeToMessageHandler[kEndOfMessagesMessageType] = handle_end_of_messages_message;
         sMessageTypeToMessageHandler[kTimingAdjustmentMessageType] = handle_timing_adjustment_message;
@@ -277,6 +288,7 @@ spoke_initialize(const NetAddrBlock& inHubAddress, int32 inFirstTick, size_t inN
 	sDisplayLatencyTicks = 0;
 	
 	sHeardFromHub = false;
+	sHubPacketVersion = 1;
 }
 
 
@@ -396,6 +408,19 @@ spoke_distribute_lossy_streaming_bytes(int16 inDistributionType, uint32 inDestin
 
 
 
+void
+spoke_report_world_hash(int32 inTick, uint32 inHash)
+{
+	// make sure we're not in the middle of sending a packet
+	MyTMMutexTaker mutex;
+
+	sWorldHashTick = inTick;
+	sWorldHash = inHash;
+	sWorldHashSendsRemaining = kWorldHashSendCount;
+}
+
+
+
 static void
 spoke_became_disconnected()
 {
@@ -446,11 +471,19 @@ spoke_received_network_packet(DDPPacketBufferPtr inPacket)
                 switch(thePacketMagic)
                 {
 		case kHubToSpokeGameDataPacketV1Magic:
-			spoke_received_game_data_packet_v1(ps, false);
+			spoke_received_game_data_packet(ps, false, 1);
 			break;
 
 		case kHubToSpokeGameDataPacketWithSpokeFlagsV1Magic:
-			spoke_received_game_data_packet_v1(ps, true);
+			spoke_received_game_data_packet(ps, true, 1);
+			break;
+
+		case kHubToSpokeGameDataPacketV2Magic:
+			spoke_received_game_data_packet(ps, false, 2);
+			break;
+
+		case kHubToSpokeGameDataPacketWithSpokeFlagsV2Magic:
+			spoke_received_game_data_packet(ps, true, 2);
 			break;
 		
 		case kPingRequestPacket:
@@ -476,9 +509,10 @@ spoke_received_network_packet(DDPPacketBufferPtr inPacket)
 
 
 static void
-spoke_received_game_data_packet_v1(AIStream& ps, bool reflected_flags)
+spoke_received_game_data_packet(AIStream& ps, bool reflected_flags, uint16 inPacketVersion)
 {
 	sHeardFromHub = true;
+	sHubPacketVersion = inPacketVersion;
 
         IncomingGameDataPacketProcessingContext context;
         
@@ -622,7 +656,8 @@ spoke_received_game_data_packet_v1(AIStream& ps, bool reflected_flags)
         // The body of this loop is a bit more convoluted than you might
         // expect, because the same loop is used to skip already-seen action_flags
         // and to enqueue new ones.
-	while(ps.tellg() < ps.maxg())
+	ActionFlagsReader theReader(ps, sNetworkPlayers.size(), inPacketVersion);
+	while(!theReader.done())
         {
                 // If we've no room to enqueue stuff, no point in finishing reading the packet.
                 if(theSmallestQueueSpace <= 0)
@@ -681,7 +716,7 @@ spoke_received_game_data_packet_v1(AIStream& ps, bool reflected_flags)
                                 // We should have a flag for this player for this tick!
 				try 
 				{
-					ps >> theFlags;
+					theFlags = theReader.read(i);
 				}
 				catch (const AStream::failure& f)
 				{
@@ -903,6 +938,9 @@ spoke_tick()
 {
 	logContextNMT("processing spoke_tick %d", sNetworkTicker);
 	
+        // Handle whatever the receiving thread queued since last tick (on the hub's machine, this feeds the hub too)
+        NetDDPDispatchQueuedPackets();
+
         sNetworkTicker++;
 
         if(sConnected)
@@ -1028,7 +1066,7 @@ send_packet()
                 AOStreamBE ps(sOutgoingFrame->data, ddpMaxData, kStarPacketHeaderSize);
         
                 // Packet type
-                hdr << (uint16)kSpokeToHubGameDataPacketV1Magic;
+                hdr << (uint16)(sHubPacketVersion >= 2 ? kSpokeToHubGameDataPacketV2Magic : kSpokeToHubGameDataPacketV1Magic);
 
                 // Acknowledgement
                 ps << sSmallestUnreceivedTick;
@@ -1061,6 +1099,17 @@ send_packet()
 
 			ps.write(sScratchBuffer, theDescriptor.mLength);
 		}
+
+		// Recently reported world hash?
+		if(sWorldHashSendsRemaining > 0)
+		{
+			ps << (uint16)kSpokeToHubWorldHashMessageType
+				<< (uint16)(sizeof(sWorldHashTick) + sizeof(sWorldHash))
+				<< sWorldHashTick
+				<< sWorldHash;
+
+			sWorldHashSendsRemaining--;
+		}
 		
                 // No more messages
                 ps << (uint16)kEndOfMessagesMessageType;
@@ -1069,8 +1118,10 @@ send_packet()
                 if(sOutgoingFlags.size() > 0)
                 {
                         ps << sOutgoingFlags.getReadTick();
-                        for(int32 tick = sOutgoingFlags.getReadTick(); tick < sOutgoingFlags.getWriteTick(); tick++)
-                                ps << sOutgoingFlags.peek(tick);
+			ActionFlagsWriter theWriter(ps, 1, sHubPacketVersion);
+                        for(int32 tick = sOutgoingFlags.getReadTick(); tick < sOutgoingFlags.getWriteTick() && theWriter.has_room(1); tick++)
+                                theWriter.write(0, sOutgoingFlags.peek(tick));
+			theWriter.flush();
                 }
 
 		logDumpNMT("preparing to send packet: ACK %d, flags [%d,%d)", sSmallestUnreceivedTick, sOutgoingFlags.getReadTick(), sOutgoingFlags.getWriteTick());
@@ -1108,8 +1159,9 @@ send_identification_packet()
 		// Message type
 		hdr << (uint16) kSpokeToHubIdentification;
         
-                // ID
-                ps << (uint16)sLocalPlayerIndex;
+                // ID, and the newest game data packet version we speak (older hubs ignore it)
+                ps << (uint16)sLocalPlayerIndex
+			<< (uint16)kStarPacketVersion;
 
 		// blank out the CRC field before calculating
 		sOutgoingFrame->data[2] = 0;
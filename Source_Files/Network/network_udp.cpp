@@ -36,16 +36,30 @@
 #include "network_private.h"
 
 #include <SDL_thread.h>
+#include <SDL_atomic.h>
+#include <algorithm>
 
 #include "thread_priority_sdl.h"
 #include "mytm.h" // mytm_mutex stuff
 
 // Global variables (most comments and "sSomething" variables are ZZZ)
-// Storage for incoming packet data
+// Storage for outgoing packet data
 static UDPpacket*		sUDPPacketBuffer	= NULL;
 
-// Storage for the DDP packet we pass back to the handler proc
-static DDPPacketBuffer		ddpPacketBuffer;
+// Storage for incoming packet data (kept apart from the above so sending needn't wait for the receiving thread)
+static UDPpacket*		sReceivePacketBuffer	= NULL;
+
+// Incoming datagrams wait here between the receiving thread (the only producer) and
+// NetDDPDispatchQueuedPackets() (the only consumer, since it always runs under the mytm mutex).
+// sReceiveQueueHead is only written by the consumer, sReceiveQueueTail only by the producer.
+enum { kReceiveQueueSize = 64 };
+static DDPPacketBuffer		sReceiveQueue[kReceiveQueueSize];
+static SDL_atomic_t		sReceiveQueueHead;
+static SDL_atomic_t		sReceiveQueueTail;
+static SDL_atomic_t		sReceiveQueueDrops;
+
+// When false, the receiving thread dispatches what it queued itself (taking the mytm mutex)
+static volatile bool		sDeferredDispatch	= false;
 
 // Keep track of our one sending/receiving socket
 static UDPsocket 		sSocket			= NULL;
@@ -63,43 +77,96 @@ static SDL_Thread*		sReceivingThread	= NULL;
 static volatile bool		sKeepListening		= false;
 
 
-// ZZZ: the socket listening thread loops in this function.  It calls the registered
-// packet handler when it gets something.
+
+// Copies the datagram in sReceivePacketBuffer into the queue; returns false if the queue is full
+static bool
+enqueue_received_packet() {
+        int theTail = SDL_AtomicGet(&sReceiveQueueTail);
+        int theNextTail = (theTail + 1) % kReceiveQueueSize;
+        if(theNextTail == SDL_AtomicGet(&sReceiveQueueHead))
+                return false;
+
+        DDPPacketBuffer& thePacket	= sReceiveQueue[theTail];
+        thePacket.protocolType		= kPROTOCOL_TYPE;
+        thePacket.sourceAddress		= sReceivePacketBuffer->address;
+        thePacket.datagramSize		= sReceivePacketBuffer->len;
+        memcpy(thePacket.datagramData, sReceivePacketBuffer->data, sReceivePacketBuffer->len);
+
+        // SDL_AtomicSet() is a full barrier, so the packet contents are visible before the new tail
+        SDL_AtomicSet(&sReceiveQueueTail, theNextTail);
+        return true;
+}
+
+
+
+// ZZZ: the socket listening thread loops in this function.  It queues whatever it receives,
+// and (unless dispatch is deferred) calls the registered packet handler on it.
 static int
 receive_thread_function(void*) {
     while(true) {
+
         // We listen with a timeout so we can shut ourselves down when needed.
         int theResult = SDLNet_CheckSockets(sSocketSet, 1000);
-        
+
         if(!sKeepListening)
             break;
-        
+
         if(theResult > 0) {
-            theResult = SDLNet_UDP_Recv(sSocket, sUDPPacketBuffer);
+            theResult = SDLNet_UDP_Recv(sSocket, sReceivePacketBuffer);
             if(theResult > 0) {
-                if(take_mytm_mutex()) {
-                    ddpPacketBuffer.protocolType	= kPROTOCOL_TYPE;
-                    ddpPacketBuffer.sourceAddress	= sUDPPacketBuffer->address;
-                    ddpPacketBuffer.datagramSize	= sUDPPacketBuffer->len;
-                    
-                    // Hope the other guy is done using whatever's in there!
-                    // (As I recall, all uses happen in sPacketHandler and its progeny, so we should be fine.)
-                    memcpy(ddpPacketBuffer.datagramData, sUDPPacketBuffer->data, sUDPPacketBuffer->len);
-                    
-                    sPacketHandler(&ddpPacketBuffer);
-                    
-                    release_mytm_mutex();
+                if(!enqueue_received_packet())
+                    SDL_AtomicAdd(&sReceiveQueueDrops, 1);
+
+                if(!sDeferredDispatch) {
+                    if(take_mytm_mutex()) {
+                        NetDDPDispatchQueuedPackets();
+                        release_mytm_mutex();
+                    }
+                    else
+                        fdprintf("could not take mytm mutex - incoming packets left queued");
                 }
-                else
-                    fdprintf("could not take mytm mutex - incoming packet dropped");
             }
         }
     }
-    
+
     return 0;
 }
 
 
+
+/*
+ *  Receive queue
+ */
+
+// Caller must hold the mytm mutex
+void NetDDPDispatchQueuedPackets(void)
+{
+	int theHead = SDL_AtomicGet(&sReceiveQueueHead);
+	while(theHead != SDL_AtomicGet(&sReceiveQueueTail)) {
+		sPacketHandler(&sReceiveQueue[theHead]);
+		theHead = (theHead + 1) % kReceiveQueueSize;
+		// the slot may be reused by the receiving thread as soon as this is published
+		SDL_AtomicSet(&sReceiveQueueHead, theHead);
+	}
+}
+
+void NetDDPSetDeferredDispatch(bool inDeferred)
+{
+	sDeferredDispatch = inDeferred;
+}
+
+void NetDDPGetReceiveQueueStats(uint16* outDepth, uint16* outDrops)
+{
+	int theDepth = SDL_AtomicGet(&sReceiveQueueTail) - SDL_AtomicGet(&sReceiveQueueHead);
+	if(theDepth < 0)
+		theDepth += kReceiveQueueSize;
+
+	*outDepth = static_cast<uint16>(theDepth);
+	*outDrops = static_cast<uint16>(std::min(SDL_AtomicGet(&sReceiveQueueDrops), 0xffff));
+}
+
+
+
 /*
  *  Initialize/shutdown module
  */
@@ -135,6 +202,13 @@ OSErr NetDDPOpenSocket(short *ioPortNumber, PacketHandlerProcPtr packetHandler)
 	if (sUDPPacketBuffer == NULL)
 		return -1;
 
+	sReceivePacketBuffer = SDLNet_AllocPacket(ddpMaxData);
+	if (sReceivePacketBuffer == NULL) {
+		SDLNet_FreePacket(sUDPPacketBuffer);
+		sUDPPacketBuffer = NULL;
+		return -1;
+	}
+
         //PORTGUESS
 	// Open socket (SDLNet_Open seems to like port in host byte order)
         // NOTE: only SDLNet_UDP_Open wants port in host byte order.  All other uses of port in SDL_net
@@ -143,6 +217,8 @@ OSErr NetDDPOpenSocket(short *ioPortNumber, PacketHandlerProcPtr packetHandler)
 	if (sSocket == NULL) {
 		SDLNet_FreePacket(sUDPPacketBuffer);
 		sUDPPacketBuffer = NULL;
+		SDLNet_FreePacket(sReceivePacketBuffer);
+		sReceivePacketBuffer = NULL;
 		return -1;
 	}
 
@@ -151,6 +227,10 @@ OSErr NetDDPOpenSocket(short *ioPortNumber, PacketHandlerProcPtr packetHandler)
         SDLNet_UDP_AddSocket(sSocketSet, sSocket);
         
         // Set up receiver
+        SDL_AtomicSet(&sReceiveQueueHead, 0);
+        SDL_AtomicSet(&sReceiveQueueTail, 0);
+        SDL_AtomicSet(&sReceiveQueueDrops, 0);
+        sDeferredDispatch	= false;
         sKeepListening		= true;
         sPacketHandler		= packetHandler;
         sReceivingThread	= SDL_CreateThread(receive_thread_function, "NetDDPOpenSocket_ReceivingThread", NULL);
@@ -192,6 +272,9 @@ OSErr NetDDPCloseSocket(short portNumber)
 		SDLNet_FreePacket(sUDPPacketBuffer);
 		sUDPPacketBuffer = NULL;
 
+		SDLNet_FreePacket(sReceivePacketBuffer);
+		sReceivePacketBuffer = NULL;
+
 		SDLNet_UDP_Close(sSocket);
 		sSocket = NULL;
 	}
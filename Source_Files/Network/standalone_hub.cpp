@@ -0,0 +1,442 @@
+/*
+ *  standalone_hub.cpp
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+ *  Main loop for alephone-hub, the dedicated star hub (network_star_hub.cpp built with
+ *  A1_NETWORK_STANDALONE_HUB).  One process hosts a game on each of several UDP ports; it's
+ *  all on one thread, so the hub's own locking is never needed.  Each game is restarted as
+ *  soon as all of its players have gone (net-dead or finished).
+ *
+ *  alephone itself still always runs the hub in the gatherer's game, and every game here
+ *  starts at tick 0 with no idea of levels, so for now only the synthetic spokes play here.
+ *
+ *  With --spokes, the process also runs that many synthetic spokes against each game
+ *  (star_load_generator.cpp) and prints how much of the second went to hub work, for
+ *  finding out how many games and players one core can carry.
+ */
+
+#include "cseries.h"
+#include "network_star.h"
+#include "network_private.h"
+#include "star_load_generator.h"
+#include "InfoTree.h"
+#include "Logging.h"
+
+#include <SDL_net.h>
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+enum {
+	kDefaultPlayersPerGame = MAXIMUM_NUMBER_OF_NETWORK_PLAYERS,
+	kTickPeriodMS = 1000 / TICKS_PER_SECOND,
+	kStatsPeriodMS = 1000
+};
+
+struct HubGame
+{
+	uint16		mPort;
+	UDPsocket	mSocket;
+	HubInstance*	mHub;
+	LoadGeneratorGame*	mLoad;
+	uint32		mGamesPlayed;
+};
+
+static std::vector<HubGame> sGames;
+static size_t sPlayersPerGame = kDefaultPlayersPerGame;
+static size_t sSpokesPerGame = 0;
+
+// socket the hub routines are currently sending through (see NetDDPNewFrame() below)
+static UDPsocket sCurrentSocket = NULL;
+static UDPpacket* sPacket = NULL;
+
+static uint32 sPacketsIn = 0;
+static uint32 sPacketsOut = 0;
+
+static volatile sig_atomic_t sQuitRequested = 0;
+
+
+
+// The hub expects these from the rest of the game; the standalone build gets them from here instead.
+
+DDPFramePtr
+NetDDPNewFrame(void)
+{
+	DDPFramePtr frame = (DDPFramePtr)malloc(sizeof(DDPFrame));
+	if (frame) {
+		memset(frame, 0, sizeof(DDPFrame));
+		frame->socket = sCurrentSocket;
+	}
+	return frame;
+}
+
+
+
+void
+NetDDPDisposeFrame(DDPFramePtr frame)
+{
+	if (frame)
+		free(frame);
+}
+
+
+
+OSErr
+NetDDPSendFrame(DDPFramePtr frame, NetAddrBlock *address, short protocolType, short port)
+{
+	assert(frame->data_size <= ddpMaxData);
+
+	sPacket->channel = -1;
+	memcpy(sPacket->data, frame->data, frame->data_size);
+	sPacket->len = frame->data_size;
+	sPacket->address = *address;
+	if (!SDLNet_UDP_Send(frame->socket, -1, sPacket))
+		return -1;
+
+	sPacketsOut++;
+	return 0;
+}
+
+
+
+void
+_alephone_assert(const char *file, int32 line, const char *what)
+{
+	fprintf(stderr, "%s:%d: %s\n", file, line, what);
+	abort();
+}
+
+
+
+static uint16 sRandomSeed = 0x1;
+
+uint16
+local_random(void)
+{
+	// same generator as world.cpp's
+	uint16 seed = sRandomSeed;
+	if (seed & 1)
+		seed = (seed >> 1) ^ 0xb400;
+	else
+		seed >>= 1;
+	return (sRandomSeed = seed);
+}
+
+
+
+static void
+quit_handler(int)
+{
+	sQuitRequested = 1;
+}
+
+
+
+static void
+usage(const char* inProgramName)
+{
+	printf("usage: %s [options]\n"
+	       "  --port N         host a game on UDP port N (may be repeated; default %d)\n"
+	       "  --ports N-M      host a game on every port from N to M\n"
+	       "  --players N      players per game (default %d)\n"
+	       "  --prefs FILE     read hub settings from FILE - an Aleph One preferences file or a bare <hub> element\n"
+	       "  --spokes N       load test: run N synthetic spokes against every game\n"
+	       "  --seconds N      exit after N seconds\n",
+	       inProgramName, DEFAULT_GAME_PORT, kDefaultPlayersPerGame);
+}
+
+
+
+static bool
+load_hub_preferences(const char* inPath)
+{
+	try {
+		boost::property_tree::ptree theTree;
+		boost::property_tree::read_xml(inPath, theTree);
+		// Accept either the user's whole preferences file or just its <hub> element
+		std::string version;
+		boost::optional<boost::property_tree::ptree&> hub = theTree.get_child_optional("mara_prefs.network.star_protocol.hub");
+		if (hub)
+			InfoTree(theTree.get_child("mara_prefs")).read_attr("version", version);
+		else
+			hub = theTree.get_child_optional("hub");
+
+		if (!hub)
+		{
+			fprintf(stderr, "%s has no <hub> element\n", inPath);
+			return false;
+		}
+
+		HubParsePreferencesTree(InfoTree(*hub), version);
+		return true;
+	}
+	catch (const boost::property_tree::ptree_error& e) {
+		fprintf(stderr, "couldn't read %s: %s\n", inPath, e.what());
+		return false;
+	}
+}
+
+
+
+static void
+start_game(HubGame& ioGame)
+{
+	hub_set_instance(ioGame.mHub);
+	sCurrentSocket = ioGame.mSocket;
+
+	if (ioGame.mLoad != NULL)
+	{
+		load_generator_delete_game(ioGame.mLoad);
+		ioGame.mLoad = NULL;
+	}
+
+	hub_cleanup(false, 0);
+
+	// Any non-NULL address marks the seat as taken; the real addresses arrive with each
+	// spoke's identification packet.  No seat is local.
+	NetAddrBlock theDummyAddress;
+	obj_clear(theDummyAddress);
+	std::vector<const NetAddrBlock*> theAddresses(sPlayersPerGame, &theDummyAddress);
+	hub_initialize(0, sPlayersPerGame, &theAddresses[0], 0);
+
+	if (sSpokesPerGame > 0)
+	{
+		IPaddress theHubAddress;
+		SDLNet_ResolveHost(&theHubAddress, "127.0.0.1", ioGame.mPort);
+		ioGame.mLoad = load_generator_new_game(theHubAddress, sSpokesPerGame);
+	}
+
+	ioGame.mGamesPlayed++;
+	logNote("port %d: waiting for %d players", ioGame.mPort, sPlayersPerGame);
+}
+
+
+
+static void
+receive_packets(HubGame& ioGame)
+{
+	hub_set_instance(ioGame.mHub);
+	sCurrentSocket = ioGame.mSocket;
+
+	DDPPacketBuffer thePacket;
+	while (SDLNet_UDP_Recv(ioGame.mSocket, sPacket) > 0)
+	{
+		sPacketsIn++;
+		thePacket.protocolType = kPROTOCOL_TYPE;
+		thePacket.sourceAddress = sPacket->address;
+		thePacket.datagramSize = sPacket->len;
+		memcpy(thePacket.datagramData, sPacket->data, sPacket->len);
+		hub_received_network_packet(&thePacket);
+	}
+}
+
+
+
+static bool
+open_game(uint16 inPort)
+{
+	HubGame theGame;
+	theGame.mPort = inPort;
+	theGame.mSocket = SDLNet_UDP_Open(inPort);
+	theGame.mHub = NULL;
+	theGame.mLoad = NULL;
+	theGame.mGamesPlayed = 0;
+
+	if (theGame.mSocket == NULL)
+	{
+		fprintf(stderr, "couldn't open UDP port %d: %s\n", inPort, SDLNet_GetError());
+		return false;
+	}
+
+	theGame.mHub = hub_new_instance();
+	sGames.push_back(theGame);
+	return true;
+}
+
+
+
+int
+main(int argc, char** argv)
+{
+	std::vector<uint16> thePorts;
+	const char* thePrefsPath = NULL;
+	int32 theSecondsToRun = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* theValue = (i + 1 < argc) ? argv[i + 1] : NULL;
+		int theFirst, theLast;
+
+		if (strcmp(argv[i], "--port") == 0 && theValue)
+			thePorts.push_back(static_cast<uint16>(atoi(theValue)));
+		else if (strcmp(argv[i], "--ports") == 0 && theValue && sscanf(theValue, "%d-%d", &theFirst, &theLast) == 2 && theFirst > 0 && theFirst <= theLast && theLast < 65536)
+		{
+			for (int thePort = theFirst; thePort <= theLast; thePort++)
+				thePorts.push_back(static_cast<uint16>(thePort));
+		}
+		else if (strcmp(argv[i], "--players") == 0 && theValue)
+			sPlayersPerGame = atoi(theValue);
+		else if (strcmp(argv[i], "--prefs") == 0 && theValue)
+			thePrefsPath = theValue;
+		else if (strcmp(argv[i], "--spokes") == 0 && theValue)
+			sSpokesPerGame = atoi(theValue);
+		else if (strcmp(argv[i], "--seconds") == 0 && theValue)
+			theSecondsToRun = atoi(theValue);
+		else
+		{
+			usage(argv[0]);
+			return (strcmp(argv[i], "--help") == 0) ? 0 : 1;
+		}
+		i++;
+	}
+
+	// action_flags bitmasks in the hub are 32 bits wide
+	if (sPlayersPerGame < 1 || sPlayersPerGame > 32 || sSpokesPerGame > sPlayersPerGame)
+	{
+		fprintf(stderr, "need 1-32 players per game, and no more spokes than players\n");
+		return 1;
+	}
+
+	if (thePorts.empty())
+		thePorts.push_back(DEFAULT_GAME_PORT);
+
+	DefaultHubPreferences();
+	if (thePrefsPath != NULL && !load_hub_preferences(thePrefsPath))
+		return 1;
+
+	if (SDL_Init(0) < 0 || SDLNet_Init() < 0)
+	{
+		fprintf(stderr, "couldn't initialize SDL_net: %s\n", SDL_GetError());
+		return 1;
+	}
+	atexit(SDL_Quit);
+	atexit(SDLNet_Quit);
+
+	sPacket = SDLNet_AllocPacket(ddpMaxData);
+	if (sPacket == NULL)
+		return 1;
+
+	for (size_t i = 0; i < thePorts.size(); i++)
+	{
+		if (!open_game(thePorts[i]))
+			return 1;
+	}
+
+	for (size_t i = 0; i < sGames.size(); i++)
+		start_game(sGames[i]);
+
+	signal(SIGINT, quit_handler);
+	signal(SIGTERM, quit_handler);
+
+	printf("hosting %d game(s) of %d players%s\n", (int)sGames.size(), (int)sPlayersPerGame,
+	       sSpokesPerGame > 0 ? " with synthetic spokes" : "");
+
+	const Uint64 theCountsPerSecond = SDL_GetPerformanceFrequency();
+	Uint64 theBusyCounts = 0;
+	LoadGeneratorStats theLastLoadStats = load_generator_stats();
+	uint32 theStartTime = SDL_GetTicks();
+	uint32 theNextTickTime = theStartTime;
+	uint32 theNextStatsTime = theStartTime + kStatsPeriodMS;
+
+	while (!sQuitRequested)
+	{
+		uint32 theNow = SDL_GetTicks();
+		if (theSecondsToRun > 0 && theNow - theStartTime >= static_cast<uint32>(theSecondsToRun) * 1000)
+			break;
+
+		Uint64 theWorkStart = SDL_GetPerformanceCounter();
+
+		for (size_t i = 0; i < sGames.size(); i++)
+		{
+			receive_packets(sGames[i]);
+			if (sGames[i].mLoad != NULL)
+				load_generator_receive(sGames[i].mLoad);
+		}
+
+		while (static_cast<int32>(theNow - theNextTickTime) >= 0)
+		{
+			for (size_t i = 0; i < sGames.size(); i++)
+			{
+				HubGame& theGame = sGames[i];
+				hub_set_instance(theGame.mHub);
+				sCurrentSocket = theGame.mSocket;
+
+				if (!hub_standalone_tick() || hub_connected_player_count() == 0
+				    || (theGame.mLoad != NULL && load_generator_game_over(theGame.mLoad)))
+				{
+					logNote("port %d: game %d is over", theGame.mPort, theGame.mGamesPlayed);
+					start_game(theGame);
+				}
+
+				if (theGame.mLoad != NULL)
+					load_generator_tick(theGame.mLoad);
+			}
+			theNextTickTime += kTickPeriodMS;
+		}
+
+		theBusyCounts += SDL_GetPerformanceCounter() - theWorkStart;
+
+		if (static_cast<int32>(theNow - theNextStatsTime) >= 0)
+		{
+			size_t theConnectedPlayers = 0;
+			for (size_t i = 0; i < sGames.size(); i++)
+			{
+				hub_set_instance(sGames[i].mHub);
+				theConnectedPlayers += hub_connected_player_count();
+			}
+
+			// busy time includes the synthetic spokes, so it overstates the hub's share when load testing
+			printf("games %d  players %d  packets in %u out %u  busy %.1f%%",
+			       (int)sGames.size(), (int)theConnectedPlayers, sPacketsIn, sPacketsOut,
+			       100.0 * theBusyCounts / theCountsPerSecond / (kStatsPeriodMS / 1000.0));
+			if (sSpokesPerGame > 0)
+			{
+				const LoadGeneratorStats& theStats = load_generator_stats();
+				printf("  spokes sent %u received %u bad %u flags %u",
+				       theStats.mPacketsSent - theLastLoadStats.mPacketsSent,
+				       theStats.mPacketsReceived - theLastLoadStats.mPacketsReceived,
+				       theStats.mBadPackets - theLastLoadStats.mBadPackets,
+				       theStats.mFlagsReceived - theLastLoadStats.mFlagsReceived);
+				theLastLoadStats = theStats;
+			}
+			printf("\n");
+			fflush(stdout);
+
+			sPacketsIn = sPacketsOut = 0;
+			theBusyCounts = 0;
+			theNextStatsTime += kStatsPeriodMS;
+		}
+
+		SDL_Delay(1);
+	}
+
+	for (size_t i = 0; i < sGames.size(); i++)
+	{
+		hub_set_instance(sGames[i].mHub);
+		hub_cleanup(false, 0);
+		load_generator_delete_game(sGames[i].mLoad);
+		hub_delete_instance(sGames[i].mHub);
+		SDLNet_UDP_Close(sGames[i].mSocket);
+	}
+
+	SDLNet_FreePacket(sPacket);
+	return 0;
+}
@@ -0,0 +1,433 @@
+/*
+ *  star_load_generator.cpp
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+ *  Synthetic spokes for load-testing the standalone hub.  The packet handling mirrors
+ *  network_star_spoke.cpp, minus everything a real spoke does with the data.
+ */
+
+#if !defined(DISABLE_NETWORKING)
+
+#include "star_load_generator.h"
+
+#include "network_star.h"
+#include "network_private.h"	// kPROTOCOL_TYPE
+#include "AStream.h"
+#include "crc.h"
+#include "Logging.h"
+
+#include <vector>
+#include <algorithm>
+
+enum {
+	kOutgoingFlagsCapacity = TICKS_PER_SECOND / 2,	// as kDefaultOutgoingFlagsQueueSize in the spoke
+	kIdentificationPeriod = TICKS_PER_SECOND,
+	kRecoverySendPeriod = TICKS_PER_SECOND / 2,
+	kTicksBeforeGivingUp = 10 * TICKS_PER_SECOND,	// hub silent this long -> spoke is done
+	kMaximumFlagsPerPacket = (ddpMaxData - kStarPacketHeaderSize - 4 /* ack */ - 2 /* EM */ - 4 /* start tick */)
+					/ kActionFlagsSerializedLength
+};
+
+struct SyntheticSpoke
+{
+	UDPsocket	mSocket;
+	int32		mNextTickToGenerate;
+	int32		mSmallestUnacknowledgedTick;	// hub hasn't confirmed our flags from here on
+	int32		mSmallestUnreceivedTick;	// we haven't seen everyone's flags from here on
+	int		mOutstandingTimingAdjustment;
+	int8		mRequestedTimingAdjustment;
+	bool		mHeardFromHub;
+	bool		mDone;
+	int32		mLastNetworkTickHeard;
+	int32		mTicksSinceLastSend;
+	std::vector<int32>	mNetDeadTicks;	// INT32_MAX while connected
+};
+
+struct LoadGeneratorGame
+{
+	IPaddress	mHubAddress;
+	int32		mNetworkTicker;
+	std::vector<SyntheticSpoke>	mSpokes;
+};
+
+static LoadGeneratorStats sStats;
+static UDPpacket* sPacket = NULL;
+
+
+
+// Stand-in for the local player's keymap: cheap, and the same tick always gives the same flags,
+// so redundant retransmissions really are redundant.
+static action_flags_t
+synthetic_action_flags(size_t inPlayerIndex, int32 inTick)
+{
+	uint32 theHash = static_cast<uint32>(inTick) * 2654435761U + static_cast<uint32>(inPlayerIndex) * 40503U;
+	return theHash ^ (theHash >> 15);
+}
+
+
+
+static void
+send_spoke_packet(const IPaddress& inHubAddress, SyntheticSpoke& inSpoke, AOStreamBE& hdr, AOStreamBE& ps, uint16 inMagic)
+{
+	hdr << inMagic;
+
+	// blank out the CRC field before calculating
+	sPacket->data[2] = 0;
+	sPacket->data[3] = 0;
+
+	uint16 crc = calculate_data_crc_ccitt(sPacket->data, ps.tellp());
+	hdr << crc;
+
+	sPacket->len = ps.tellp();
+	sPacket->address = inHubAddress;
+	sPacket->channel = -1;
+	if(SDLNet_UDP_Send(inSpoke.mSocket, -1, sPacket))
+	{
+		sStats.mPacketsSent++;
+		inSpoke.mTicksSinceLastSend = 0;
+	}
+}
+
+
+
+static void
+send_identification(const IPaddress& inHubAddress, SyntheticSpoke& inSpoke, size_t inIndex)
+{
+	AOStreamBE hdr(sPacket->data, kStarPacketHeaderSize);
+	AOStreamBE ps(sPacket->data, ddpMaxData, kStarPacketHeaderSize);
+
+	try {
+		ps << (uint16)inIndex;
+		send_spoke_packet(inHubAddress, inSpoke, hdr, ps, kSpokeToHubIdentification);
+	}
+	catch (...) {
+	}
+}
+
+
+
+static void
+send_game_data(const IPaddress& inHubAddress, SyntheticSpoke& inSpoke, size_t inIndex)
+{
+	AOStreamBE hdr(sPacket->data, kStarPacketHeaderSize);
+	AOStreamBE ps(sPacket->data, ddpMaxData, kStarPacketHeaderSize);
+
+	try {
+		ps << inSpoke.mSmallestUnreceivedTick
+			<< (uint16)kEndOfMessagesMessageType;
+
+		int32 theEndTick = std::min(inSpoke.mNextTickToGenerate,
+					    inSpoke.mSmallestUnacknowledgedTick + static_cast<int32>(kMaximumFlagsPerPacket));
+		if(inSpoke.mSmallestUnacknowledgedTick < theEndTick)
+		{
+			ps << inSpoke.mSmallestUnacknowledgedTick;
+			for(int32 tick = inSpoke.mSmallestUnacknowledgedTick; tick < theEndTick; tick++)
+				ps << synthetic_action_flags(inIndex, tick);
+		}
+
+		send_spoke_packet(inHubAddress, inSpoke, hdr, ps, kSpokeToHubGameDataPacketV1Magic);
+	}
+	catch (...) {
+		logWarningNMT("load generator couldn't build a packet for spoke %d", inIndex);
+	}
+}
+
+
+
+static void
+spoke_tick(LoadGeneratorGame& inGame, size_t inIndex)
+{
+	SyntheticSpoke& theSpoke = inGame.mSpokes[inIndex];
+	if(theSpoke.mDone)
+		return;
+
+	theSpoke.mTicksSinceLastSend++;
+
+	if(!theSpoke.mHeardFromHub)
+	{
+		if(theSpoke.mTicksSinceLastSend >= kIdentificationPeriod)
+			send_identification(inGame.mHubAddress, theSpoke, inIndex);
+		return;
+	}
+
+	if(inGame.mNetworkTicker - theSpoke.mLastNetworkTickHeard > kTicksBeforeGivingUp)
+	{
+		theSpoke.mDone = true;
+		return;
+	}
+
+	// Timing adjustment exactly as the real spoke does it: negative means produce extra ticks,
+	// positive means sit this tick out.
+	bool shouldSend = false;
+	if(theSpoke.mOutstandingTimingAdjustment <= 0)
+	{
+		int theNumberOfFlagsToProvide = -theSpoke.mOutstandingTimingAdjustment + 1;
+		while(theNumberOfFlagsToProvide > 0
+		      && theSpoke.mNextTickToGenerate - theSpoke.mSmallestUnacknowledgedTick < kOutgoingFlagsCapacity)
+		{
+			theSpoke.mNextTickToGenerate++;
+			shouldSend = true;
+			theNumberOfFlagsToProvide--;
+		}
+
+		if(theNumberOfFlagsToProvide != -theSpoke.mOutstandingTimingAdjustment + 1)
+			theSpoke.mOutstandingTimingAdjustment = -theNumberOfFlagsToProvide;
+	}
+	else
+		theSpoke.mOutstandingTimingAdjustment--;
+
+	if(shouldSend || theSpoke.mTicksSinceLastSend >= kRecoverySendPeriod)
+		send_game_data(inGame.mHubAddress, theSpoke, inIndex);
+}
+
+
+
+static void
+spoke_received_packet(LoadGeneratorGame& inGame, size_t inIndex, UDPpacket& inPacket)
+{
+	SyntheticSpoke& theSpoke = inGame.mSpokes[inIndex];
+
+	AIStreamBE ps(inPacket.data, inPacket.len);
+
+	try {
+		uint16 thePacketMagic;
+		uint16 thePacketCRC;
+		ps >> thePacketMagic >> thePacketCRC;
+
+		// blank out the CRC field before calculating
+		inPacket.data[2] = 0;
+		inPacket.data[3] = 0;
+
+		if(thePacketCRC != calculate_data_crc_ccitt(inPacket.data, inPacket.len))
+		{
+			sStats.mBadPackets++;
+			return;
+		}
+
+		if(thePacketMagic != kHubToSpokeGameDataPacketV1Magic && thePacketMagic != kHubToSpokeGameDataPacketWithSpokeFlagsV1Magic)
+			return;
+
+		sStats.mPacketsReceived++;
+		theSpoke.mHeardFromHub = true;
+		theSpoke.mLastNetworkTickHeard = inGame.mNetworkTicker;
+
+		int32 theSmallestUnacknowledgedTick;
+		ps >> theSmallestUnacknowledgedTick;
+		if(theSmallestUnacknowledgedTick > theSpoke.mSmallestUnacknowledgedTick && theSmallestUnacknowledgedTick <= theSpoke.mNextTickToGenerate)
+			theSpoke.mSmallestUnacknowledgedTick = theSmallestUnacknowledgedTick;
+
+		bool gotTimingAdjustment = false;
+		for(bool messagesDone = false; !messagesDone; )
+		{
+			uint16 theMessageType;
+			ps >> theMessageType;
+
+			switch(theMessageType)
+			{
+				case kEndOfMessagesMessageType:
+					messagesDone = true;
+					break;
+
+				case kTimingAdjustmentMessageType:
+				{
+					int8 theAdjustment;
+					ps >> theAdjustment;
+					if(theAdjustment != theSpoke.mRequestedTimingAdjustment)
+					{
+						theSpoke.mOutstandingTimingAdjustment = theAdjustment;
+						theSpoke.mRequestedTimingAdjustment = theAdjustment;
+					}
+					gotTimingAdjustment = true;
+				}
+				break;
+
+				case kPlayerNetDeadMessageType:
+				{
+					uint8 thePlayerIndex;
+					int32 theTick;
+					ps >> thePlayerIndex >> theTick;
+					if(thePlayerIndex < theSpoke.mNetDeadTicks.size())
+					{
+						theSpoke.mNetDeadTicks[thePlayerIndex] = theTick;
+						if(thePlayerIndex == inIndex)
+							theSpoke.mDone = true;
+					}
+				}
+				break;
+
+				default:
+				{
+					// Lossy byte stream or anything newer - all carry a length
+					uint16 theLength;
+					ps >> theLength;
+					ps.ignore(theLength);
+				}
+				break;
+			}
+		}
+
+		if(!gotTimingAdjustment)
+			theSpoke.mRequestedTimingAdjustment = 0;
+
+		if(ps.tellg() >= ps.maxg())
+			return;
+
+		// Flags come in tick-major order; work out who is in each tick the same way the hub did
+		int32 theStartTick;
+		ps >> theStartTick;
+		bool includesOwnFlags = (thePacketMagic == kHubToSpokeGameDataPacketWithSpokeFlagsV1Magic);
+
+		int32 tick = theStartTick;
+		while(ps.tellg() < ps.maxg())
+		{
+			bool readAnyFlags = false;
+			for(size_t j = 0; j < theSpoke.mNetDeadTicks.size(); j++)
+			{
+				if(j == inIndex && !includesOwnFlags)
+					continue;
+				if(tick >= theSpoke.mNetDeadTicks[j])
+					continue;
+
+				action_flags_t theFlags;
+				ps >> theFlags;
+				sStats.mFlagsReceived++;
+				readAnyFlags = true;
+			}
+			if(!readAnyFlags)
+				break;	// everyone we'd expect is dead; whatever's left doesn't parse
+			tick++;
+
+			// Only count ticks that extend what we had contiguously
+			if(tick - 1 == theSpoke.mSmallestUnreceivedTick)
+				theSpoke.mSmallestUnreceivedTick = tick;
+		}
+	}
+	catch (...) {
+		sStats.mBadPackets++;
+	}
+}
+
+
+
+LoadGeneratorGame*
+load_generator_new_game(const IPaddress& inHubAddress, size_t inNumberOfSpokes)
+{
+	if(sPacket == NULL)
+	{
+		sPacket = SDLNet_AllocPacket(ddpMaxData);
+		if(sPacket == NULL)
+			return NULL;
+	}
+
+	LoadGeneratorGame* theGame = new LoadGeneratorGame;
+	theGame->mHubAddress = inHubAddress;
+	theGame->mNetworkTicker = 0;
+	theGame->mSpokes.resize(inNumberOfSpokes);
+
+	for(size_t i = 0; i < inNumberOfSpokes; i++)
+	{
+		SyntheticSpoke& theSpoke = theGame->mSpokes[i];
+		theSpoke.mSocket = SDLNet_UDP_Open(0);
+		theSpoke.mNextTickToGenerate = -kPregameTicks;
+		theSpoke.mSmallestUnacknowledgedTick = -kPregameTicks;
+		theSpoke.mSmallestUnreceivedTick = -kPregameTicks;
+		theSpoke.mOutstandingTimingAdjustment = 0;
+		theSpoke.mRequestedTimingAdjustment = 0;
+		theSpoke.mHeardFromHub = false;
+		theSpoke.mDone = false;
+		theSpoke.mLastNetworkTickHeard = 0;
+		theSpoke.mTicksSinceLastSend = kIdentificationPeriod;	// identify on the first tick
+		theSpoke.mNetDeadTicks.resize(inNumberOfSpokes, INT32_MAX);
+
+		if(theSpoke.mSocket == NULL)
+		{
+			logErrorNMT("load generator couldn't open a socket for spoke %d: %s", i, SDLNet_GetError());
+			load_generator_delete_game(theGame);
+			return NULL;
+		}
+	}
+
+	return theGame;
+}
+
+
+
+void
+load_generator_delete_game(LoadGeneratorGame* inGame)
+{
+	if(inGame == NULL)
+		return;
+
+	for(size_t i = 0; i < inGame->mSpokes.size(); i++)
+	{
+		if(inGame->mSpokes[i].mSocket != NULL)
+			SDLNet_UDP_Close(inGame->mSpokes[i].mSocket);
+	}
+
+	delete inGame;
+}
+
+
+
+void
+load_generator_tick(LoadGeneratorGame* inGame)
+{
+	inGame->mNetworkTicker++;
+
+	for(size_t i = 0; i < inGame->mSpokes.size(); i++)
+		spoke_tick(*inGame, i);
+}
+
+
+
+void
+load_generator_receive(LoadGeneratorGame* inGame)
+{
+	for(size_t i = 0; i < inGame->mSpokes.size(); i++)
+	{
+		if(inGame->mSpokes[i].mSocket == NULL)
+			continue;
+
+		while(SDLNet_UDP_Recv(inGame->mSpokes[i].mSocket, sPacket) > 0)
+			spoke_received_packet(*inGame, i, *sPacket);
+	}
+}
+
+
+
+bool
+load_generator_game_over(LoadGeneratorGame* inGame)
+{
+	for(size_t i = 0; i < inGame->mSpokes.size(); i++)
+	{
+		if(!inGame->mSpokes[i].mDone)
+			return false;
+	}
+
+	return true;
+}
+
+
+
+const LoadGeneratorStats&
+load_generator_stats()
+{
+	return sStats;
+}
+
+#endif // !defined(DISABLE_NETWORKING)
@@ -0,0 +1,59 @@
+/*
+ *  star_load_generator.h
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+ *  Synthetic spokes for load-testing the standalone hub.  Each fake spoke has its own UDP
+ *  socket and speaks just enough of the star protocol (identification, action_flags,
+ *  acknowledgements, timing adjustments, net-dead notices) to keep a hub game running as
+ *  if real players were connected.  Nothing here knows anything about the game itself.
+ */
+
+#ifndef STAR_LOAD_GENERATOR_H
+#define STAR_LOAD_GENERATOR_H
+
+#include "cseries.h"
+#include "sdl_network.h"
+
+struct LoadGeneratorStats
+{
+	uint32	mPacketsSent;
+	uint32	mPacketsReceived;
+	uint32	mBadPackets;		// failed CRC or didn't parse
+	uint32	mFlagsReceived;		// action_flags of other players delivered by the hub
+};
+
+struct LoadGeneratorGame;
+
+// Opens inNumberOfSpokes sockets and identifies each (as player 0, 1, ...) to the hub at inHubAddress.
+// Returns NULL if the sockets couldn't be opened.
+extern LoadGeneratorGame* load_generator_new_game(const IPaddress& inHubAddress, size_t inNumberOfSpokes);
+extern void load_generator_delete_game(LoadGeneratorGame* inGame);
+
+// Call at TICKS_PER_SECOND; every spoke generates and sends its flags for the tick.
+extern void load_generator_tick(LoadGeneratorGame* inGame);
+// Drains and parses whatever the hub has sent the game's spokes.  Does not block.
+extern void load_generator_receive(LoadGeneratorGame* inGame);
+
+// True once the hub has declared every spoke net-dead (or stopped answering long enough that the
+// spokes gave up) - the driver should then delete the game and start another.
+extern bool load_generator_game_over(LoadGeneratorGame* inGame);
+
+// Totals across all games since the process started.
+extern const LoadGeneratorStats& load_generator_stats();
+
+#endif // STAR_LOAD_GENERATOR_H
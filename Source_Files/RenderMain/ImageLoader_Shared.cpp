@@ -137,28 +137,39 @@ bool ImageDescriptor::Minify()
 	else if (Format == RGBA8)
 	{
 		if (!(Width > 1 || Height > 1)) return false;
-		int newWidth = Width >> 1;
-		int newHeight = Height >> 1;
-#ifdef HAVE_OPENGL
-		if (OGL_IsActive())
-		{
-			
-			uint32 *newPixels = new uint32[newWidth * newHeight];
-			gluScaleImage(GL_RGBA, Width, Height, GL_UNSIGNED_BYTE, Pixels, newWidth, newHeight, GL_UNSIGNED_BYTE, newPixels);
-			delete []Pixels;
-			Pixels = newPixels;
-			Width = newWidth;
-			Height = newHeight;
-			Size = newWidth * newHeight;
-			return true;
-			
-		} 
-		else 
-#endif
+		int newWidth = MAX(1, Width >> 1);
+		int newHeight = MAX(1, Height >> 1);
+
+		// Averages each block of pixels, like gluScaleImage() does, but without
+		// OpenGL, so textures can be loaded on other threads
+		uint32 *newPixels = new uint32[newWidth * newHeight];
+		const uint8 *src = reinterpret_cast<const uint8 *>(Pixels);
+		uint8 *dst = reinterpret_cast<uint8 *>(newPixels);
+		for (int y = 0; y < newHeight; y++)
 		{
-			fprintf(stderr, "GL not active\n");
-			return false;
+			int y0 = y * Height / newHeight;
+			int y1 = MAX(y0 + 1, (y + 1) * Height / newHeight);
+			for (int x = 0; x < newWidth; x++)
+			{
+				int x0 = x * Width / newWidth;
+				int x1 = MAX(x0 + 1, (x + 1) * Width / newWidth);
+				int count = (x1 - x0) * (y1 - y0);
+				for (int c = 0; c < 4; c++)
+				{
+					int sum = 0;
+					for (int sy = y0; sy < y1; sy++)
+						for (int sx = x0; sx < x1; sx++)
+							sum += src[(sy * Width + sx) * 4 + c];
+					*dst++ = (sum + count / 2) / count;
+				}
+			}
 		}
+		delete []Pixels;
+		Pixels = newPixels;
+		Width = newWidth;
+		Height = newHeight;
+		Size = newWidth * newHeight * 4;
+		return true;
 	} 
 	else 
 	{
@@ -451,7 +462,7 @@ bool ImageDescriptor::LoadDDSFromFile(FileSpecifier& File, int flags, int actual
 		// we don't handle incomplete mip map chains
 		// if we're only missing one, that's OK; XBLA textures do that
 		if (!(OriginalMipMapCount == ExpectedMipMapCount || OriginalMipMapCount == (ExpectedMipMapCount - 1))) {
-			logWarning("incomplete mipmap chain (%ix%i, %ix%i, %i mipmaps)", Width, Height, ddsd.dwWidth, ddsd.dwHeight, OriginalMipMapCount);
+			logWarningNMT("incomplete mipmap chain (%ix%i, %ix%i, %i mipmaps)", Width, Height, ddsd.dwWidth, ddsd.dwHeight, OriginalMipMapCount);
 			return false;
 		}
 
@@ -31,11 +31,16 @@
 #ifdef HAVE_OPENGL
 
 #include <cmath>
+#include <stdio.h>
 
 #include "Dim3_Loader.h"
+#include "Model3D_simd.h"
+#include "ModelRenderer.h"
 #include "StudioLoader.h"
 #include "WavefrontLoader.h"
 #include "InfoTree.h"
+#include "FileHandler.h"
+#include "crc.h"
 
 
 // Model-data stuff;
@@ -370,6 +375,210 @@ static bool StringsEqual(const char *String1, const char *String2, int MaxStrLen
 }
 
 
+/*
+ *  Model cache
+ *
+ *  Parsing a model's text (or XML) and working out its normals, tangents and vertex-source
+ *  indices happens every time a level loads it, so the finished Model3D is kept in the cache
+ *  directory.  It is named for a hash of the model files' contents and every MML option that
+ *  goes into the processing, so editing either just means a rebuild; it is read back with a
+ *  single mapping (or a single read) and copied straight into the model's arrays.
+ */
+
+// Bump whenever loading or processing a model comes out differently, so old cache files are rebuilt
+const uint32 MODEL_CACHE_VERSION = 1;
+
+template<class T> static void append_model_key(vector<uint8>& key, const T& value)
+{
+	const uint8 *bytes = (const uint8 *) &value;
+	key.insert(key.end(), bytes, bytes + sizeof(T));
+}
+
+static void append_model_file_key(vector<uint8>& key, FileSpecifier& File)
+{
+	bool Present = (File != FileSpecifier() && File.Exists());
+	append_model_key(key, Present);
+	if (!Present) return;
+	
+	OpenedFile OFile;
+	int32 Length = 0;
+	uint32 CRC = 0;
+	if (File.Open(OFile) && OFile.GetLength(Length))
+		CRC = calculate_crc_for_opened_file(OFile);
+	append_model_key(key, Length);
+	append_model_key(key, CRC);
+}
+
+static uint32 model_cache_hash(OGL_ModelData& Data)
+{
+	vector<uint8> key;
+	// also catches a cache directory shared between machines of different byte order
+	append_model_key(key, uint32(0x01020304));
+	append_model_key(key, MODEL_CACHE_VERSION);
+	append_model_key(key, sizeof(Model3D_VertexSource));
+	append_model_key(key, sizeof(Model3D_Bone));
+	append_model_key(key, sizeof(Model3D_SeqFrame));
+	
+	append_model_file_key(key, Data.ModelFile);
+	append_model_file_key(key, Data.ModelFile1);
+	append_model_file_key(key, Data.ModelFile2);
+	key.insert(key.end(), Data.ModelType.begin(), Data.ModelType.end());
+	
+	append_model_key(key, Data.Scale);
+	append_model_key(key, Data.XRot);
+	append_model_key(key, Data.YRot);
+	append_model_key(key, Data.ZRot);
+	append_model_key(key, Data.XShift);
+	append_model_key(key, Data.YShift);
+	append_model_key(key, Data.ZShift);
+	append_model_key(key, Data.NormalType);
+	append_model_key(key, Data.NormalSplit);
+	
+	return calculate_data_crc(&key[0], key.size());
+}
+
+static void get_model_cache_file(uint32 inputs_hash, FileSpecifier& file)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "Model %08x", inputs_hash);
+	file.SetToImageCacheDir();
+	file.AddPart(name);
+}
+
+// Every array of a Model3D, in the order they're kept in a cache file
+template<class F> static void for_each_model_array(Model3D& Model, F& f)
+{
+	f(Model.Positions);
+	f(Model.TxtrCoords);
+	f(Model.Normals);
+	f(Model.Tangents);
+	f(Model.Colors);
+	f(Model.VtxSrcIndices);
+	f(Model.VtxSources);
+	f(Model.NormSources);
+	f(Model.InverseVSIndices);
+	f(Model.InvVSIPointers);
+	f(Model.Bones);
+	f(Model.VertIndices);
+	f(Model.Frames);
+	f(Model.SeqFrames);
+	f(Model.SeqFrmPointers);
+}
+
+struct model_array_writer
+{
+	vector<uint8>& buffer;
+	model_array_writer(vector<uint8>& _buffer) : buffer(_buffer) {}
+	
+	template<class T> void operator()(const vector<T>& array)
+	{
+		append_model_key(buffer, uint32(array.size()));
+		if (!array.empty())
+		{
+			const uint8 *bytes = (const uint8 *) &array[0];
+			buffer.insert(buffer.end(), bytes, bytes + array.size() * sizeof(T));
+		}
+	}
+};
+
+struct model_array_reader
+{
+	const uint8 *p, *end;
+	bool ok;
+	model_array_reader(const uint8 *_p, const uint8 *_end) : p(_p), end(_end), ok(true) {}
+	
+	bool read(void *dest, size_t size)
+	{
+		if (!ok || size > size_t(end - p)) return ok = false;
+		memcpy(dest, p, size);
+		p += size;
+		return true;
+	}
+	
+	template<class T> void operator()(vector<T>& array)
+	{
+		uint32 count;
+		if (!read(&count, sizeof(count)) || count > size_t(end - p) / sizeof(T))
+		{
+			ok = false;
+			return;
+		}
+		const T *first = (const T *) p;
+		array.assign(first, first + count);
+		p += count * sizeof(T);
+	}
+};
+
+static bool read_cached_model(uint32 inputs_hash, Model3D& Model)
+{
+	FileSpecifier file;
+	get_model_cache_file(inputs_hash, file);
+	
+	OpenedFile f;
+	int32 length;
+	if (!file.Exists() || !file.Open(f) || !f.GetLength(length))
+		return false;
+	
+	// One mapping if we can have it, otherwise one read
+	FileMapping mapping;
+	vector<uint8> buffer;
+	const uint8 *data;
+	if (mapping.Map(f, 0, length))
+	{
+		data = mapping.GetPointer();
+	}
+	else
+	{
+		buffer.resize(length);
+		if (!length || !f.Read(length, &buffer[0]))
+			return false;
+		data = &buffer[0];
+	}
+	
+	model_array_reader reader(data, data + length);
+	uint32 cached_hash;
+	if (!reader.read(&cached_hash, sizeof(cached_hash)) || cached_hash != inputs_hash)
+		return false;
+	
+	for_each_model_array(Model, reader);
+	reader.read(Model.BoundingBox, sizeof(Model.BoundingBox));
+	reader.read(Model.TransformPos.M, sizeof(Model.TransformPos.M));
+	reader.read(Model.TransformNorm.M, sizeof(Model.TransformNorm.M));
+	
+	if (!reader.ok || reader.p != reader.end)
+	{
+		Model.Clear();
+		return false;
+	}
+	return true;
+}
+
+static void write_cached_model(uint32 inputs_hash, Model3D& Model)
+{
+	vector<uint8> buffer;
+	append_model_key(buffer, inputs_hash);
+	model_array_writer writer(buffer);
+	for_each_model_array(Model, writer);
+	append_model_key(buffer, Model.BoundingBox);
+	append_model_key(buffer, Model.TransformPos.M);
+	append_model_key(buffer, Model.TransformNorm.M);
+	
+	FileSpecifier file;
+	get_model_cache_file(inputs_hash, file);
+	
+	OpenedFile f;
+	if (!file.Open(f, true))
+		return;
+	
+	if (!f.Write(buffer.size(), &buffer[0]))
+	{
+		// a short file would fail to read back anyway; don't leave it lying around
+		f.Close();
+		file.Delete();
+	}
+}
+
+
 void OGL_ModelData::Load()
 {
 	// Already loaded?
@@ -377,9 +586,24 @@ void OGL_ModelData::Load()
 	
 	// Load the model
 	Model.Clear();
+	if (!LoadModel())
+	{
+		Model.Clear();
+		return;
+	}
+	
+	// Don't forget the skins
+	OGL_SkinManager::Load();
+}
+
 
-	if (ModelFile == FileSpecifier()) return;
-	if (!ModelFile.Exists()) return;
+bool OGL_ModelData::LoadModel()
+{
+	if (ModelFile == FileSpecifier()) return false;
+	if (!ModelFile.Exists()) return false;
+	
+	uint32 CacheHash = model_cache_hash(*this);
+	if (read_cached_model(CacheHash, Model)) return true;
 
 	bool Success = false;
 	
@@ -436,11 +660,7 @@ void OGL_ModelData::Load()
 	}
 #endif
 	
-	if (!Success)
-	{
-		Model.Clear();
-		return;
-	}
+	if (!Success) return false;
 	
 	// Calculate transformation matrix
 	GLfloat Angle, Cosine, Sine;
@@ -575,8 +795,8 @@ void OGL_ModelData::Load()
 	Model.AdjustNormals(NormalType,NormalSplit);
 	Model.CalculateTangents();
 	
-	// Don't forget the skins
-	OGL_SkinManager::Load();
+	write_cached_model(CacheHash, Model);
+	return true;
 }
 
 
@@ -615,6 +835,89 @@ void OGL_LoadModels(short Collection)
 	}
 }
 
+int OGL_PrebuildModelCaches()
+{
+	int Count = 0;
+	for (int c=0; c<NUMBER_OF_COLLECTIONS; c++)
+	{
+		vector<ModelDataEntry>& ML = MdlList[c];
+		for (vector<ModelDataEntry>::iterator MdlIter = ML.begin(); MdlIter < ML.end(); MdlIter++)
+		{
+			OGL_ModelData& ModelData = MdlIter->ModelData;
+			if (ModelData.ModelPresent()) continue;
+			
+			ModelData.Model.Clear();
+			if (ModelData.LoadModel())
+			{
+				printf("%s\n", ModelData.ModelFile.GetPath());
+				Count++;
+			}
+			else if (ModelData.ModelFile != FileSpecifier())
+			{
+				fprintf(stderr, "Couldn't load %s\n", ModelData.ModelFile.GetPath());
+			}
+			ModelData.Model.Clear();
+		}
+	}
+	return Count;
+}
+
+void OGL_BenchmarkModelSkinning(vector<model_skinning_timing>& Timings)
+{
+	for (int c=0; c<NUMBER_OF_COLLECTIONS; c++)
+	{
+		vector<ModelDataEntry>& ML = MdlList[c];
+		for (vector<ModelDataEntry>::iterator MdlIter = ML.begin(); MdlIter < ML.end(); MdlIter++)
+		{
+			OGL_ModelData& ModelData = MdlIter->ModelData;
+			bool WasPresent = ModelData.ModelPresent();
+			if (!WasPresent)
+			{
+				ModelData.Model.Clear();
+				if (!ModelData.LoadModel()) continue;
+			}
+			
+			model_skinning_timing Timing;
+			if (benchmark_model_skinning(ModelData.Model, Timing))
+			{
+				string Directory;
+				ModelData.ModelFile.SplitPath(Directory, Timing.model);
+				Timings.push_back(Timing);
+			}
+			
+			if (!WasPresent) ModelData.Model.Clear();
+		}
+	}
+}
+
+void OGL_BenchmarkModelSorting(vector<model_sorting_timing>& Timings)
+{
+	for (int c=0; c<NUMBER_OF_COLLECTIONS; c++)
+	{
+		vector<ModelDataEntry>& ML = MdlList[c];
+		for (vector<ModelDataEntry>::iterator MdlIter = ML.begin(); MdlIter < ML.end(); MdlIter++)
+		{
+			OGL_ModelData& ModelData = MdlIter->ModelData;
+			bool WasPresent = ModelData.ModelPresent();
+			if (!WasPresent)
+			{
+				ModelData.Model.Clear();
+				if (!ModelData.LoadModel()) continue;
+			}
+			
+			model_sorting_timing Timing;
+			if (benchmark_model_sorting(ModelData.Model, Timing))
+			{
+				string Directory;
+				ModelData.ModelFile.SplitPath(Directory, Timing.model);
+				Timings.push_back(Timing);
+			}
+			
+			if (!WasPresent) ModelData.Model.Clear();
+		}
+	}
+}
+
 void OGL_UnloadModels(short Collection)
 {
 	vector<ModelDataEntry>& ML = MdlList[Collection];
@@ -123,6 +123,10 @@ public:
 	void Load();
 	void Unload();
 	
+	// Loads and processes the model alone, without its skins, taking it from the
+	// model cache if it's there and putting it there if not
+	bool LoadModel();
+	
 	OGL_ModelData():
 		Scale(1), XRot(0), YRot(0), ZRot(0), XShift(0), YShift(0), ZShift(0), Sidedness(1),
 			NormalType(1), NormalSplit(0.5), LightType(0), DepthType(0), ForceSpriteDepth(false) {}
@@ -145,6 +149,18 @@ void OGL_UnloadModels(short Collection);
 void OGL_ResetForceSpriteDepth();  // to clear before calling OGL_LoadModels
 bool OGL_ForceSpriteDepth();
 
+// Loads every model MML has defined so far, filling the model cache;
+// returns how many were loaded
+int OGL_PrebuildModelCaches();
+
+// Times the skinning of every animated model MML has defined so far
+struct model_skinning_timing;
+void OGL_BenchmarkModelSkinning(vector<model_skinning_timing>& Timings);
+
+// Times the depth-sorting of every model MML has defined so far
+struct model_sorting_timing;
+void OGL_BenchmarkModelSorting(vector<model_sorting_timing>& Timings);
+
 class InfoTree;
 void parse_mml_opengl_model(const InfoTree& root);
 void reset_mml_opengl_model();
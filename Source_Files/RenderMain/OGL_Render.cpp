@@ -161,6 +161,7 @@ May 3, 2003 (Br'fin (Jeremy Parsons))
 #include "Logging.h"
 #include "screen.h"
 #include "OGL_Shader.h"
+#include "Console.h"
 
 #include <cmath>
 
@@ -3260,6 +3261,33 @@ static void SetBlend(short _BlendType)
 	}
 }
 
+struct model_sort_command
+{
+	void operator() (const std::string& arg) const {
+		if (arg != "")
+		{
+			char *end;
+			double angle = strtod(arg.c_str(), &end);
+			if (*end || angle < 0 || angle >= 90)
+			{
+				screen_printf("Usage: .modelsort, .modelsort <degrees under 90>");
+				return;
+			}
+			ModelRenderObject.OrderReuseAngle = GLfloat(angle);
+		}
+		
+		if (ModelRenderObject.OrderReuseAngle > 0)
+			screen_printf("Models keep their triangle order until the view turns %g degrees", ModelRenderObject.OrderReuseAngle);
+		else
+			screen_printf("Models sort their triangles every time they're drawn");
+	}
+};
+
+void OGL_RegisterModelSortCommands()
+{
+	Console::instance()->register_command("modelsort", model_sort_command());
+}
+
 #else
 
 // No OpenGL present
@@ -3268,4 +3296,8 @@ bool OGL_IsActive()
 	return false;
 }
 
+void OGL_RegisterModelSortCommands()
+{
+}
+
 #endif // def HAVE_OPENGL
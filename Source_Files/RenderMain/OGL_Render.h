@@ -113,4 +113,8 @@ void OGL_RenderLines(const std::vector<world_point2d>& points, float thickness);
 // Returns whether or not 2D stuff is to be piped through OpenGL
 bool OGL_Get2D();
 
+// .modelsort and .modelsort <degrees>: how far the view can turn before
+// a semitransparent model's triangles are depth-sorted again
+void OGL_RegisterModelSortCommands();
+
 #endif
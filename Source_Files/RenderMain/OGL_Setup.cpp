@@ -420,20 +420,30 @@ int OGL_CountModelsImages(short Collection)
 // for managing the model and image loading and unloading
 void OGL_LoadModelsImages(short Collection)
 {
-	assert(Collection >= 0 && Collection < MAXIMUM_COLLECTIONS);
+	OGL_LoadModelsImages(std::vector<short>(1, Collection));
+}
+
+void OGL_LoadModelsImages(const std::vector<short>& Collections)
+{
+	for (size_t i = 0; i < Collections.size(); i++)
+		assert(Collections[i] >= 0 && Collections[i] < MAXIMUM_COLLECTIONS);
 
+	// Read here, on the main thread, for the texture loading threads
 	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &glMaxTextureSize);
 	hasS3TC = OGL_CheckExtension("GL_ARB_texture_compression") && OGL_CheckExtension("GL_EXT_texture_compression_s3tc");
 	
 	// For wall/sprite images
-	OGL_LoadTextures(Collection);
+	OGL_LoadTextures(Collections);
 	
 	// For models, skins
 	bool UseModels = TEST_FLAG(Get_OGL_ConfigureData().Flags,OGL_Flag_3D_Models) ? true : false;
-	if (UseModels)
-		OGL_LoadModels(Collection);
-	else
-		OGL_UnloadModels(Collection);
+	for (size_t i = 0; i < Collections.size(); i++)
+	{
+		if (UseModels)
+			OGL_LoadModels(Collections[i]);
+		else
+			OGL_UnloadModels(Collections[i]);
+	}
 }
 
 void OGL_UnloadModelsImages(short Collection)
@@ -453,6 +463,10 @@ void OGL_LoadModelsImages(short)
 {
 }
 
+void OGL_LoadModelsImages(const std::vector<short>&)
+{
+}
+
 void OGL_UnloadModelsImages(short)
 {
 }
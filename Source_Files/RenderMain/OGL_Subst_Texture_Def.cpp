@@ -30,10 +30,17 @@
 #include "Logging.h"
 #include "InfoTree.h"
 
+#include <algorithm>
 #include <set>
 #include <string>
+#include <vector>
 #include <boost/unordered_map.hpp>
 
+#include <SDL_atomic.h>
+#include <SDL_cpuinfo.h>
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+
 #ifdef HAVE_OPENGL
 
 // Texture-options stuff;
@@ -63,15 +70,81 @@ int OGL_CountTextures(short Collection)
 
 extern void OGL_ProgressCallback(int);
 
+// Loading a texture is reading, decoding, converting and shrinking its images, none of
+// which touches OpenGL (that waits for the first time it's drawn), so the loading is
+// spread over a thread per processor.  The main thread moves the progress bar as each
+// texture finishes.
+struct TextureLoader
+{
+	std::vector<OGL_TextureOptions *> Options;
+	SDL_atomic_t Next;
+	SDL_sem *Finished;
+};
+
+static int LoadTexturesThread(void *Data)
+{
+	TextureLoader *Loader = static_cast<TextureLoader *>(Data);
+	int Count = static_cast<int>(Loader->Options.size());
+	int Index;
+
+	while ((Index = SDL_AtomicAdd(&Loader->Next, 1)) < Count)
+	{
+		Loader->Options[Index]->Load();
+		SDL_SemPost(Loader->Finished);
+	}
+
+	return 0;
+}
+
 void OGL_LoadTextures(short Collection)
 {
+	OGL_LoadTextures(std::vector<short>(1, Collection));
+}
 
-	for (TOHash::iterator it = Collections[Collection].begin(); it != Collections[Collection].end(); ++it)
+void OGL_LoadTextures(const std::vector<short>& CollectionList)
+{
+	TextureLoader Loader;
+	for (size_t c = 0; c < CollectionList.size(); c++)
 	{
-		it->second.Load();
-		OGL_ProgressCallback(1);
-		
+		TOHash& Collection = Collections[CollectionList[c]];
+		for (TOHash::iterator it = Collection.begin(); it != Collection.end(); ++it)
+			Loader.Options.push_back(&it->second);
 	}
+	if (Loader.Options.empty()) return;
+
+	SDL_AtomicSet(&Loader.Next, 0);
+	Loader.Finished = SDL_CreateSemaphore(0);
+
+	std::vector<SDL_Thread *> Threads;
+	int ThreadCount = std::min(SDL_GetCPUCount(), static_cast<int>(Loader.Options.size()));
+	for (int i = 0; i < ThreadCount && Loader.Finished; i++)
+	{
+		SDL_Thread *Thread = SDL_CreateThread(LoadTexturesThread, "OGL_LoadTextures_workerThread", &Loader);
+		if (!Thread) break;
+		Threads.push_back(Thread);
+	}
+
+	if (Threads.empty())
+	{
+		// Couldn't get any threads; load them all here
+		for (size_t i = 0; i < Loader.Options.size(); i++)
+		{
+			Loader.Options[i]->Load();
+			OGL_ProgressCallback(1);
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < Loader.Options.size(); i++)
+		{
+			SDL_SemWait(Loader.Finished);
+			OGL_ProgressCallback(1);
+		}
+		for (size_t i = 0; i < Threads.size(); i++)
+			SDL_WaitThread(Threads[i], NULL);
+	}
+
+	if (Loader.Finished) SDL_DestroySemaphore(Loader.Finished);
 }
 
 
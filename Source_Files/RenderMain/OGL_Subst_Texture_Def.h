@@ -51,6 +51,7 @@ OGL_TextureOptions *OGL_GetTextureOptions(short Collection, short CLUT, short Bi
 // for managing the texture loading and unloading;
 int OGL_CountTextures(short Collection);
 void OGL_LoadTextures(short Collection);
+void OGL_LoadTextures(const std::vector<short>& Collections);
 void OGL_UnloadTextures(short Collection);
 
 class InfoTree;
@@ -27,6 +27,8 @@
 
 #include "Rasterizer.h"
 
+#include <vector>
+
 
 class Rasterizer_SW_Class: public RasterizerClass
 {
@@ -37,6 +39,10 @@ public:
 	// Calling this one "screen" for scottish_textures convenience:
 	bitmap_definition *screen;
 
+	// Only the screen columns band_left <= x < band_right get drawn (the whole screen
+	// by default); the parallel rasterizer gives each of its bands to a rasterizer of its own
+	short band_left, band_right;
+
 	// Sets the rasterizer's view data;
 	// be sure to call it before doing any rendering
 	void SetView(view_data& View) {view = &View;}
@@ -49,6 +55,19 @@ public:
 	void texture_vertical_polygon(polygon_definition& textured_polygon);
 	
 	void texture_rectangle(rectangle_definition& textured_rectangle);
+
+	Rasterizer_SW_Class();
+
+private:
+	// Line tables and precalculated line data; these used to be globals in
+	// scottish_textures, but every rasterizer running in parallel needs its own
+	std::vector<short> scratch_table0_storage, scratch_table1_storage;
+	std::vector<char> precalculation_table_storage;
+	short *scratch_table0, *scratch_table1;
+	void *precalculation_table;
+
+	Rasterizer_SW_Class(const Rasterizer_SW_Class&);
+	Rasterizer_SW_Class& operator=(const Rasterizer_SW_Class&);
 };
 
 
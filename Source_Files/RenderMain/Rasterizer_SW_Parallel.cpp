@@ -0,0 +1,237 @@
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Multithreaded software rasterizer
+*/
+
+#include "cseries.h"
+#include "Rasterizer_SW_Parallel.h"
+
+#include <limits.h>
+
+#include <SDL_cpuinfo.h>
+
+// More bands than threads, so a thread that gets an easy band can pick up another
+// while the rest finish theirs
+const int BANDS_PER_THREAD = 2;
+
+Rasterizer_SW_Parallel_Class::Rasterizer_SW_Parallel_Class() :
+	screen(NULL), view(NULL), serial_frame(false), thread_count(1),
+	done(NULL), quitting(false), band_count(0)
+{
+	SDL_AtomicSet(&next_band, 0);
+}
+
+Rasterizer_SW_Parallel_Class::~Rasterizer_SW_Parallel_Class()
+{
+	stop_workers();
+	if (done)
+		SDL_DestroySemaphore(done);
+}
+
+void Rasterizer_SW_Parallel_Class::SetThreadCount(int Count)
+{
+	thread_count = MAX(Count, 0);
+}
+
+int Rasterizer_SW_Parallel_Class::GetThreadCount()
+{
+	return thread_count ? thread_count : MAX(SDL_GetCPUCount(), 1);
+}
+
+void Rasterizer_SW_Parallel_Class::Begin()
+{
+	commands.clear();
+	polygons.clear();
+	rectangles.clear();
+	serial_frame = false;
+}
+
+void Rasterizer_SW_Parallel_Class::End()
+{
+	int count = GetThreadCount();
+	if (workers.size() != static_cast<size_t>(count))
+		start_workers(count);
+
+	if (serial_frame || workers.size() == 1)
+	{
+		draw_band(workers[0]->rasterizer, 0, SHRT_MAX);
+	}
+	else
+	{
+		band_count = workers.size() * BANDS_PER_THREAD;
+		SDL_AtomicSet(&next_band, 0);
+
+		for (size_t i = 1; i < workers.size(); i++)
+			SDL_SemPost(workers[i]->go);
+		draw_bands(workers[0]->rasterizer);
+		for (size_t i = 1; i < workers.size(); i++)
+			SDL_SemWait(done);
+	}
+}
+
+void Rasterizer_SW_Parallel_Class::texture_horizontal_polygon(polygon_definition& textured_polygon)
+{
+	command c = {_horizontal_polygon, static_cast<uint32>(polygons.size())};
+	commands.push_back(c);
+	polygons.push_back(textured_polygon);
+
+	if (textured_polygon.transfer_mode == _static_transfer)
+		serial_frame = true;
+}
+
+void Rasterizer_SW_Parallel_Class::texture_vertical_polygon(polygon_definition& textured_polygon)
+{
+	command c = {_vertical_polygon, static_cast<uint32>(polygons.size())};
+	commands.push_back(c);
+	polygons.push_back(textured_polygon);
+
+	if (textured_polygon.transfer_mode == _static_transfer)
+		serial_frame = true;
+}
+
+void Rasterizer_SW_Parallel_Class::texture_rectangle(rectangle_definition& textured_rectangle)
+{
+	command c = {_rectangle, static_cast<uint32>(rectangles.size())};
+	commands.push_back(c);
+	rectangles.push_back(textured_rectangle);
+
+	if (textured_rectangle.transfer_mode == _static_transfer)
+		serial_frame = true;
+}
+
+void Rasterizer_SW_Parallel_Class::start_workers(int count)
+{
+	stop_workers();
+
+	if (!done)
+		done = SDL_CreateSemaphore(0);
+
+	worker *w = new worker;
+	w->owner = this;
+	w->thread = NULL;
+	w->go = NULL;
+	workers.push_back(w);
+
+	// Carry on with however many threads we get
+	for (int i = 1; i < count && done; i++)
+	{
+		w = new worker;
+		w->owner = this;
+		w->go = SDL_CreateSemaphore(0);
+		w->thread = w->go ? SDL_CreateThread(worker_thread, "Rasterizer_SW_Parallel_workerThread", w) : NULL;
+		if (!w->thread)
+		{
+			if (w->go)
+				SDL_DestroySemaphore(w->go);
+			delete w;
+			break;
+		}
+		workers.push_back(w);
+	}
+}
+
+void Rasterizer_SW_Parallel_Class::stop_workers()
+{
+	quitting = true;
+	for (size_t i = 1; i < workers.size(); i++)
+		SDL_SemPost(workers[i]->go);
+
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		if (workers[i]->thread)
+		{
+			SDL_WaitThread(workers[i]->thread, NULL);
+			SDL_DestroySemaphore(workers[i]->go);
+		}
+		delete workers[i];
+	}
+	workers.clear();
+	quitting = false;
+}
+
+int Rasterizer_SW_Parallel_Class::worker_thread(void *p)
+{
+	worker *w = static_cast<worker *>(p);
+	Rasterizer_SW_Parallel_Class *owner = w->owner;
+
+	while (true)
+	{
+		SDL_SemWait(w->go);
+		if (owner->quitting)
+			break;
+
+		owner->draw_bands(w->rasterizer);
+		SDL_SemPost(owner->done);
+	}
+
+	return 0;
+}
+
+void Rasterizer_SW_Parallel_Class::draw_bands(Rasterizer_SW_Class& rasterizer)
+{
+	int width = screen->width;
+
+	int band;
+	while ((band = SDL_AtomicAdd(&next_band, 1)) < band_count)
+	{
+		// Keep the edges on multiples of 4, where the vertical mappers switch to
+		// drawing four columns at a time
+		short left = (width * band / band_count) & ~3;
+		short right = (band == band_count - 1) ? width : ((width * (band + 1) / band_count) & ~3);
+		if (left < right)
+			draw_band(rasterizer, left, right);
+	}
+}
+
+void Rasterizer_SW_Parallel_Class::draw_band(Rasterizer_SW_Class& rasterizer, short left, short right)
+{
+	rasterizer.view = view;
+	rasterizer.screen = screen;
+	rasterizer.band_left = left;
+	rasterizer.band_right = right;
+
+	// The mappers may clip what they're handed in place, so each band gets its own copy
+	for (size_t i = 0; i < commands.size(); i++)
+	{
+		const command& c = commands[i];
+		switch (c.type)
+		{
+			case _horizontal_polygon:
+			{
+				polygon_definition polygon = polygons[c.index];
+				rasterizer.texture_horizontal_polygon(polygon);
+				break;
+			}
+
+			case _vertical_polygon:
+			{
+				polygon_definition polygon = polygons[c.index];
+				rasterizer.texture_vertical_polygon(polygon);
+				break;
+			}
+
+			case _rectangle:
+			{
+				rectangle_definition rectangle = rectangles[c.index];
+				rasterizer.texture_rectangle(rectangle);
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,118 @@
+#ifndef _RASTERIZER_SOFTWARE_PARALLEL_CLASS_
+#define _RASTERIZER_SOFTWARE_PARALLEL_CLASS_
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Multithreaded software rasterizer
+
+	Records the polygons and rectangles of a frame in the order they come in, then at End()
+	splits the screen into bands of columns and has a pool of threads draw the bands, each
+	band replaying the whole frame clipped to its columns with a Rasterizer_SW_Class of its
+	own.  No pixel is touched by more than one band, and the software mappers advance their
+	texture coordinates exactly, so the frame is identical to one drawn on a single thread.
+*/
+
+#include "Rasterizer_SW.h"
+
+#include <vector>
+
+#include <SDL_atomic.h>
+#include <SDL_mutex.h>
+#include <SDL_thread.h>
+
+
+class Rasterizer_SW_Parallel_Class: public RasterizerClass
+{
+public:
+
+	// As in Rasterizer_SW_Class
+	bitmap_definition *screen;
+
+	void SetView(view_data& View) {view = &View;}
+
+	// Begin() starts recording; End() draws everything recorded and returns when it's done
+	void Begin();
+	void End();
+
+	void texture_horizontal_polygon(polygon_definition& textured_polygon);
+
+	void texture_vertical_polygon(polygon_definition& textured_polygon);
+
+	void texture_rectangle(rectangle_definition& textured_rectangle);
+
+	// Threads drawing a frame, the calling thread included; 0 means one per CPU
+	void SetThreadCount(int Count);
+	int GetThreadCount();
+
+	Rasterizer_SW_Parallel_Class();
+	~Rasterizer_SW_Parallel_Class();
+
+private:
+	enum {
+		_horizontal_polygon,
+		_vertical_polygon,
+		_rectangle
+	};
+
+	struct command
+	{
+		int16 type;
+		// into polygons or rectangles
+		uint32 index;
+	};
+
+	struct worker
+	{
+		Rasterizer_SW_Parallel_Class *owner;
+		Rasterizer_SW_Class rasterizer;
+		SDL_Thread *thread;
+		SDL_sem *go;
+	};
+
+	view_data *view;
+
+	std::vector<command> commands;
+	std::vector<polygon_definition> polygons;
+	std::vector<rectangle_definition> rectangles;
+	// _static_transfer draws from a single random-number sequence across the whole
+	// frame, so a frame with any in it is drawn by one thread, in order
+	bool serial_frame;
+
+	int thread_count;
+	// workers[0] is the calling thread's; the others have threads
+	std::vector<worker *> workers;
+	SDL_sem *done;
+	bool quitting;
+
+	short band_count;
+	SDL_atomic_t next_band;
+
+	void start_workers(int count);
+	void stop_workers();
+
+	void draw_bands(Rasterizer_SW_Class& rasterizer);
+	void draw_band(Rasterizer_SW_Class& rasterizer, short left, short right);
+
+	static int worker_thread(void *p);
+
+	Rasterizer_SW_Parallel_Class(const Rasterizer_SW_Parallel_Class&);
+	Rasterizer_SW_Parallel_Class& operator=(const Rasterizer_SW_Parallel_Class&);
+};
+
+
+#endif
@@ -0,0 +1,704 @@
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Potentially visible sets of polygons
+*/
+
+#include "cseries.h"
+#include "RenderPVS.h"
+
+#include "map.h"
+#include "platforms.h"
+#include "render.h"
+#include "FileHandler.h"
+#include "crc.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+#include <SDL_atomic.h>
+#include <SDL_cpuinfo.h>
+#include <SDL_thread.h>
+
+// Bump whenever the sets come out differently, so old cache files are rebuilt
+const uint32 PVS_VERSION = 1;
+
+// Accepted portals per polygon before giving up on it and calling everything it connects
+// to visible; keeps the odd pathological polygon from taking minutes
+const int32 MAXIMUM_PVS_STEPS = 1 << 15;
+
+// How far past a portal's edges and heights a line of sight may pass and still count,
+// in world units; the vertical one grows with distance, since the renderer rounds to pixels
+const double PVS_TOLERANCE = 1.0;
+const double PVS_VERTICAL_TOLERANCE_PER_DISTANCE = 1.0 / 64;
+
+const double PVS_INFINITY = 1e30;
+
+// Cache files kept for levels not played lately; each is a few kilobytes to a megabyte or so
+const size_t MAXIMUM_CACHED_PVS_FILES = 32;
+
+// What the sets are worked out from, copied out of the map when the level starts so the
+// threads never look at map data the game is changing
+struct pvs_polygon
+{
+	int16 vertex_count;
+	int16 endpoint_indexes[MAXIMUM_VERTICES_PER_POLYGON];
+	int16 line_indexes[MAXIMUM_VERTICES_PER_POLYGON];
+	int16 adjacent_polygon_indexes[MAXIMUM_VERTICES_PER_POLYGON];
+
+	// the lowest the floor and highest the ceiling can ever be
+	world_distance lowest_floor, highest_ceiling;
+};
+
+static std::vector<world_point2d> pvs_endpoints;
+static std::vector<pvs_polygon> pvs_polygons;
+static uint32 pvs_inputs_hash = 0;
+
+// One compressed bitset per polygon: nonzero bytes as they are, runs of zero bytes as a zero
+// followed by the run length
+static std::vector<std::vector<uint8> > pvs_sets;
+
+static std::vector<SDL_Thread *> pvs_threads;
+static SDL_atomic_t pvs_next_polygon;
+static SDL_atomic_t pvs_polygons_left;
+static SDL_atomic_t pvs_cancelled;
+static SDL_atomic_t pvs_ready;
+static bool pvs_discarded = false;
+
+/* ---------- geometry */
+
+struct pvs_segment
+{
+	double x0, y0, x1, y1;
+};
+
+// What a line of sight has to do at one step along a chain of portals: be between lo and
+// hi when it's somewhere between near and far from where it crossed the first portal
+struct pvs_link
+{
+	double lo, hi;
+	double near_distance, far_distance;
+};
+
+// The slopes (rise over distance) a line of sight through the chain so far can have, kept
+// apart for going up and going down since the two constrain it differently
+struct pvs_slopes
+{
+	double rising_min, rising_max;
+	double falling_min, falling_max;
+};
+
+static double cross_product(double ax, double ay, double bx, double by, double px, double py)
+{
+	return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+}
+
+static double point_distance(double ax, double ay, double bx, double by)
+{
+	return sqrt((bx - ax) * (bx - ax) + (by - ay) * (by - ay));
+}
+
+static double segment_length(const pvs_segment& s)
+{
+	return point_distance(s.x0, s.y0, s.x1, s.y1);
+}
+
+static double point_segment_distance(double px, double py, const pvs_segment& s)
+{
+	double dx = s.x1 - s.x0, dy = s.y1 - s.y0;
+	double length_squared = dx * dx + dy * dy;
+	double t = (length_squared > 0) ? ((px - s.x0) * dx + (py - s.y0) * dy) / length_squared : 0;
+	t = PIN(t, 0.0, 1.0);
+	return point_distance(px, py, s.x0 + t * dx, s.y0 + t * dy);
+}
+
+static bool segments_cross(const pvs_segment& a, const pvs_segment& b)
+{
+	double a0 = cross_product(a.x0, a.y0, a.x1, a.y1, b.x0, b.y0);
+	double a1 = cross_product(a.x0, a.y0, a.x1, a.y1, b.x1, b.y1);
+	double b0 = cross_product(b.x0, b.y0, b.x1, b.y1, a.x0, a.y0);
+	double b1 = cross_product(b.x0, b.y0, b.x1, b.y1, a.x1, a.y1);
+	return ((a0 <= 0 && a1 >= 0) || (a0 >= 0 && a1 <= 0)) && ((b0 <= 0 && b1 >= 0) || (b0 >= 0 && b1 <= 0));
+}
+
+static double nearest_distance(const pvs_segment& a, const pvs_segment& b)
+{
+	if (segments_cross(a, b))
+		return 0;
+
+	return MIN(MIN(point_segment_distance(a.x0, a.y0, b), point_segment_distance(a.x1, a.y1, b)),
+		MIN(point_segment_distance(b.x0, b.y0, a), point_segment_distance(b.x1, b.y1, a)));
+}
+
+static double farthest_distance(const pvs_segment& a, const pvs_segment& b)
+{
+	return MAX(MAX(point_distance(a.x0, a.y0, b.x0, b.y0), point_distance(a.x0, a.y0, b.x1, b.y1)),
+		MAX(point_distance(a.x1, a.y1, b.x0, b.y0), point_distance(a.x1, a.y1, b.x1, b.y1)));
+}
+
+// Keeps the part of target on the same side of the line through a and b as keep (give or
+// take PVS_TOLERANCE); false if none of it is
+static bool clip_to_side(pvs_segment& target, double ax, double ay, double bx, double by, double keep_x, double keep_y)
+{
+	double length = point_distance(ax, ay, bx, by);
+	double keep_side = cross_product(ax, ay, bx, by, keep_x, keep_y);
+	if (length < PVS_TOLERANCE || fabs(keep_side) / length < PVS_TOLERANCE)
+		return true;
+
+	double sign = (keep_side > 0) ? 1 : -1;
+	double d0 = sign * cross_product(ax, ay, bx, by, target.x0, target.y0) / length + PVS_TOLERANCE;
+	double d1 = sign * cross_product(ax, ay, bx, by, target.x1, target.y1) / length + PVS_TOLERANCE;
+
+	if (d0 < 0 && d1 < 0)
+		return false;
+	if (d0 < 0)
+	{
+		double t = d0 / (d0 - d1);
+		target.x0 += t * (target.x1 - target.x0);
+		target.y0 += t * (target.y1 - target.y0);
+	}
+	else if (d1 < 0)
+	{
+		double t = d1 / (d1 - d0);
+		target.x1 += t * (target.x0 - target.x1);
+		target.y1 += t * (target.y0 - target.y1);
+	}
+	return true;
+}
+
+// Cuts target down to what a line through source and then pass can reach: the region
+// between the two lines that each join an end of pass to the end of source that puts the
+// rest of source and the rest of pass on opposite sides.  Clips nothing whenever the
+// arrangement is too degenerate to be sure of; false if none of target is left
+static bool clip_to_antipenumbra(pvs_segment& target, const pvs_segment& source, const pvs_segment& pass)
+{
+	double pass_length = segment_length(pass);
+	if (pass_length < PVS_TOLERANCE)
+		return true;
+
+	// source has to be clear of the pass's line, all on one side
+	double s0 = cross_product(pass.x0, pass.y0, pass.x1, pass.y1, source.x0, source.y0) / pass_length;
+	double s1 = cross_product(pass.x0, pass.y0, pass.x1, pass.y1, source.x1, source.y1) / pass_length;
+	if (!((s0 > PVS_TOLERANCE && s1 > PVS_TOLERANCE) || (s0 < -PVS_TOLERANCE && s1 < -PVS_TOLERANCE)))
+		return true;
+
+	double pass_x[2] = {pass.x0, pass.x1}, pass_y[2] = {pass.y0, pass.y1};
+	double source_x[2] = {source.x0, source.x1}, source_y[2] = {source.y0, source.y1};
+
+	for (int j = 0; j < 2; j++)
+	{
+		int separating = NONE;
+		int candidates = 0;
+		for (int i = 0; i < 2; i++)
+		{
+			double other_source = cross_product(source_x[i], source_y[i], pass_x[j], pass_y[j], source_x[1 - i], source_y[1 - i]);
+			double other_pass = cross_product(source_x[i], source_y[i], pass_x[j], pass_y[j], pass_x[1 - j], pass_y[1 - j]);
+			if ((other_source <= 0 && other_pass > 0) || (other_source >= 0 && other_pass < 0))
+			{
+				separating = i;
+				candidates++;
+			}
+		}
+		if (candidates != 1)
+			continue;
+
+		if (!clip_to_side(target, source_x[separating], source_y[separating], pass_x[j], pass_y[j], pass_x[1 - j], pass_y[1 - j]))
+			return false;
+	}
+
+	return true;
+}
+
+static void limit_slope(double& min_slope, double& max_slope, double coefficient, double bound)
+{
+	// coefficient * slope <= bound
+	if (coefficient > 1e-9)
+		max_slope = MIN(max_slope, bound / coefficient);
+	else if (coefficient < -1e-9)
+		min_slope = MAX(min_slope, bound / coefficient);
+	else if (bound < 0)
+		min_slope = PVS_INFINITY;
+}
+
+// A line of sight has height z + slope*s at distance s.  Taking each link's distance as free
+// to be anywhere in its range, for any pair of links j and k some z has to put the line above
+// j's lo and below k's hi, which is a bound on the slope
+static bool add_link(pvs_slopes& slopes, const std::vector<pvs_link>& chain, const pvs_link& link)
+{
+	for (size_t i = 0; i <= chain.size(); i++)
+	{
+		const pvs_link& other = (i < chain.size()) ? chain[i] : link;
+
+		limit_slope(slopes.rising_min, slopes.rising_max, link.near_distance - other.far_distance, link.hi - other.lo);
+		limit_slope(slopes.rising_min, slopes.rising_max, other.near_distance - link.far_distance, other.hi - link.lo);
+		limit_slope(slopes.falling_min, slopes.falling_max, link.far_distance - other.near_distance, link.hi - other.lo);
+		limit_slope(slopes.falling_min, slopes.falling_max, other.far_distance - link.near_distance, other.hi - link.lo);
+	}
+
+	return slopes.rising_min <= slopes.rising_max || slopes.falling_min <= slopes.falling_max;
+}
+
+/* ---------- working out a set */
+
+static pvs_segment polygon_side(const pvs_polygon& polygon, int side)
+{
+	const world_point2d& e0 = pvs_endpoints[polygon.endpoint_indexes[side]];
+	const world_point2d& e1 = pvs_endpoints[polygon.endpoint_indexes[(side + 1) % polygon.vertex_count]];
+	pvs_segment s = {double(e0.x), double(e0.y), double(e1.x), double(e1.y)};
+	return s;
+}
+
+static void mark_polygon(std::vector<uint8>& bits, short polygon_index)
+{
+	bits[polygon_index >> 3] |= 1 << (polygon_index & 7);
+}
+
+// Everything connected to polygon_index, for when working out its set properly takes too long
+static void mark_connected_polygons(std::vector<uint8>& bits, short polygon_index)
+{
+	std::vector<uint8> visited(bits.size(), 0);
+	std::vector<short> queue(1, polygon_index);
+	mark_polygon(visited, polygon_index);
+
+	while (!queue.empty())
+	{
+		short index = queue.back();
+		queue.pop_back();
+		mark_polygon(bits, index);
+
+		const pvs_polygon& polygon = pvs_polygons[index];
+		for (int side = 0; side < polygon.vertex_count; side++)
+		{
+			short adjacent = polygon.adjacent_polygon_indexes[side];
+			if (adjacent != NONE && !(visited[adjacent >> 3] & (1 << (adjacent & 7))))
+			{
+				mark_polygon(visited, adjacent);
+				queue.push_back(adjacent);
+			}
+		}
+	}
+}
+
+struct pvs_frame
+{
+	short polygon_index;
+	short entry_line_index;
+	// the part of the portal we came in through that's in sight; the first portal itself
+	// for the polygon just past it, every side of which is in sight from it
+	pvs_segment pass;
+	bool pass_is_source;
+	pvs_slopes slopes;
+	size_t chain_length;
+	int next_side;
+};
+
+// false if cancelled
+static bool calculate_polygon_pvs(short source_index, std::vector<uint8>& bits)
+{
+	const pvs_polygon& source_polygon = pvs_polygons[source_index];
+	std::vector<pvs_link> chain;
+	std::vector<pvs_frame> stack;
+	int32 steps = 0;
+
+	bits.assign((pvs_polygons.size() + 7) / 8, 0);
+	mark_polygon(bits, source_index);
+
+	for (int first_side = 0; first_side < source_polygon.vertex_count; first_side++)
+	{
+		short first_index = source_polygon.adjacent_polygon_indexes[first_side];
+		if (first_index == NONE)
+			continue;
+		const pvs_polygon& first_polygon = pvs_polygons[first_index];
+		pvs_segment source = polygon_side(source_polygon, first_side);
+
+		// the viewer is somewhere in the source polygon, so up to this far before the
+		// first portal
+		double viewer_distance = 0;
+		for (int i = 0; i < source_polygon.vertex_count; i++)
+		{
+			const world_point2d& p = pvs_endpoints[source_polygon.endpoint_indexes[i]];
+			viewer_distance = MAX(viewer_distance, MAX(point_distance(p.x, p.y, source.x0, source.y0), point_distance(p.x, p.y, source.x1, source.y1)));
+		}
+
+		pvs_link viewer = {source_polygon.lowest_floor - PVS_TOLERANCE, source_polygon.highest_ceiling + PVS_TOLERANCE, -viewer_distance, 0};
+		pvs_link first_portal = {
+			MAX(source_polygon.lowest_floor, first_polygon.lowest_floor) - PVS_TOLERANCE,
+			MIN(source_polygon.highest_ceiling, first_polygon.highest_ceiling) + PVS_TOLERANCE,
+			0, 0};
+		pvs_slopes slopes = {0, PVS_INFINITY, -PVS_INFINITY, 0};
+
+		chain.clear();
+		add_link(slopes, chain, viewer);
+		chain.push_back(viewer);
+		if (!add_link(slopes, chain, first_portal))
+			continue;
+		chain.push_back(first_portal);
+		mark_polygon(bits, first_index);
+
+		pvs_frame first = {first_index, source_polygon.line_indexes[first_side], source, true, slopes, chain.size(), 0};
+		stack.push_back(first);
+
+		while (!stack.empty())
+		{
+			pvs_frame& frame = stack.back();
+			const pvs_polygon& polygon = pvs_polygons[frame.polygon_index];
+			if (frame.next_side >= polygon.vertex_count)
+			{
+				stack.pop_back();
+				continue;
+			}
+
+			int side = frame.next_side++;
+			short next_index = polygon.adjacent_polygon_indexes[side];
+			if (next_index == NONE || polygon.line_indexes[side] == frame.entry_line_index)
+				continue;
+
+			pvs_segment target = polygon_side(polygon, side);
+			if (!frame.pass_is_source && !clip_to_antipenumbra(target, source, frame.pass))
+				continue;
+
+			const pvs_polygon& next_polygon = pvs_polygons[next_index];
+			double far_distance = farthest_distance(source, target);
+			double vertical_tolerance = PVS_TOLERANCE + (viewer_distance + far_distance) * PVS_VERTICAL_TOLERANCE_PER_DISTANCE;
+			pvs_link portal = {
+				MAX(polygon.lowest_floor, next_polygon.lowest_floor) - vertical_tolerance,
+				MIN(polygon.highest_ceiling, next_polygon.highest_ceiling) + vertical_tolerance,
+				nearest_distance(source, target), far_distance};
+
+			chain.resize(frame.chain_length);
+			pvs_slopes next_slopes = frame.slopes;
+			if (!add_link(next_slopes, chain, portal))
+				continue;
+			chain.push_back(portal);
+			mark_polygon(bits, next_index);
+
+			if (++steps > MAXIMUM_PVS_STEPS)
+			{
+				mark_connected_polygons(bits, source_index);
+				return true;
+			}
+			if ((steps & 1023) == 0 && SDL_AtomicGet(&pvs_cancelled))
+				return false;
+
+			// frame is about to be invalidated
+			pvs_frame next = {next_index, polygon.line_indexes[side], target, false, next_slopes, chain.size(), 0};
+			stack.push_back(next);
+		}
+	}
+
+	return true;
+}
+
+static void compress_pvs(const std::vector<uint8>& bits, std::vector<uint8>& compressed)
+{
+	compressed.clear();
+	for (size_t i = 0; i < bits.size(); )
+	{
+		if (bits[i])
+		{
+			compressed.push_back(bits[i++]);
+			continue;
+		}
+
+		size_t run = 0;
+		while (i < bits.size() && !bits[i] && run < 255)
+		{
+			i++;
+			run++;
+		}
+		compressed.push_back(0);
+		compressed.push_back(static_cast<uint8>(run));
+	}
+}
+
+static bool decompress_pvs(const std::vector<uint8>& compressed, std::vector<uint8>& bits)
+{
+	size_t size = (pvs_polygons.size() + 7) / 8;
+	bits.clear();
+	bits.reserve(size);
+
+	for (size_t i = 0; i < compressed.size(); i++)
+	{
+		if (compressed[i])
+			bits.push_back(compressed[i]);
+		else if (++i < compressed.size())
+			bits.insert(bits.end(), static_cast<size_t>(compressed[i]), uint8(0));
+	}
+
+	return bits.size() == size;
+}
+
+/* ---------- cache */
+
+template<class T> static void append_pvs_key(std::vector<uint8>& key, const T& value)
+{
+	const uint8 *bytes = (const uint8 *) &value;
+	key.insert(key.end(), bytes, bytes + sizeof(T));
+}
+
+static uint32 pvs_hash()
+{
+	std::vector<uint8> key;
+	// also catches a cache directory shared between machines of different byte order
+	append_pvs_key(key, uint32(0x01020304));
+	append_pvs_key(key, PVS_VERSION);
+	for (size_t i = 0; i < pvs_endpoints.size(); i++)
+	{
+		append_pvs_key(key, pvs_endpoints[i].x);
+		append_pvs_key(key, pvs_endpoints[i].y);
+	}
+	for (size_t i = 0; i < pvs_polygons.size(); i++)
+	{
+		const pvs_polygon& polygon = pvs_polygons[i];
+		append_pvs_key(key, polygon.vertex_count);
+		for (int j = 0; j < polygon.vertex_count; j++)
+		{
+			append_pvs_key(key, polygon.endpoint_indexes[j]);
+			append_pvs_key(key, polygon.line_indexes[j]);
+			append_pvs_key(key, polygon.adjacent_polygon_indexes[j]);
+		}
+		append_pvs_key(key, polygon.lowest_floor);
+		append_pvs_key(key, polygon.highest_ceiling);
+	}
+
+	return calculate_data_crc(&key[0], key.size());
+}
+
+// Named for the geometry rather than the map file, since saved games and Lua scripts can
+// leave the same level with different heights
+static void get_pvs_cache_file(FileSpecifier& file)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "PVS %08x-%d", pvs_inputs_hash, static_cast<int>(pvs_polygons.size()));
+	file.SetToImageCacheDir();
+	file.AddPart(name);
+}
+
+static bool newer_pvs_cache_file(const dir_entry& a, const dir_entry& b)
+{
+	return a.date > b.date;
+}
+
+// Deletes all but the newest MAXIMUM_CACHED_PVS_FILES cache files
+static void prune_cached_pvs()
+{
+	DirectorySpecifier directory;
+	directory.SetToImageCacheDir();
+
+	std::vector<dir_entry> entries, cached;
+	if (!directory.ReadDirectory(entries))
+		return;
+	for (size_t i = 0; i < entries.size(); i++)
+	{
+		if (!entries[i].is_directory && entries[i].name.compare(0, 4, "PVS ") == 0)
+			cached.push_back(entries[i]);
+	}
+	if (cached.size() <= MAXIMUM_CACHED_PVS_FILES)
+		return;
+
+	std::sort(cached.begin(), cached.end(), newer_pvs_cache_file);
+	for (size_t i = MAXIMUM_CACHED_PVS_FILES; i < cached.size(); i++)
+	{
+		FileSpecifier file = directory + cached[i].name;
+		file.Delete();
+	}
+}
+
+static bool read_cached_pvs()
+{
+	FileSpecifier file;
+	get_pvs_cache_file(file);
+
+	OpenedFile f;
+	if (!file.Exists() || !file.Open(f))
+		return false;
+
+	uint32 cached_hash;
+	int32 cached_count;
+	if (!f.Read(sizeof(cached_hash), &cached_hash) || cached_hash != pvs_inputs_hash ||
+	    !f.Read(sizeof(cached_count), &cached_count) || cached_count != static_cast<int32>(pvs_polygons.size()))
+		return false;
+
+	std::vector<uint8> bits;
+	pvs_sets.resize(pvs_polygons.size());
+	for (size_t i = 0; i < pvs_sets.size(); i++)
+	{
+		uint16 size;
+		if (!f.Read(sizeof(size), &size))
+			return false;
+		pvs_sets[i].resize(size);
+		if ((size && !f.Read(size, &pvs_sets[i][0])) || !decompress_pvs(pvs_sets[i], bits))
+			return false;
+	}
+
+	return true;
+}
+
+static void write_cached_pvs()
+{
+	FileSpecifier file;
+	get_pvs_cache_file(file);
+
+	OpenedFile f;
+	if (!file.Open(f, true))
+		return;
+
+	int32 count = static_cast<int32>(pvs_sets.size());
+	bool written = f.Write(sizeof(pvs_inputs_hash), &pvs_inputs_hash) && f.Write(sizeof(count), &count);
+	for (size_t i = 0; written && i < pvs_sets.size(); i++)
+	{
+		uint16 size = static_cast<uint16>(pvs_sets[i].size());
+		written = f.Write(sizeof(size), &size) && (!size || f.Write(size, &pvs_sets[i][0]));
+	}
+
+	if (!written)
+	{
+		// a short file would fail to read back anyway; don't leave it lying around
+		f.Close();
+		file.Delete();
+		return;
+	}
+
+	f.Close();
+	prune_cached_pvs();
+}
+
+/* ---------- threads */
+
+static int pvs_thread(void *)
+{
+	SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+
+	std::vector<uint8> bits;
+	int count = static_cast<int>(pvs_polygons.size());
+	int polygon_index;
+	while (!SDL_AtomicGet(&pvs_cancelled) && (polygon_index = SDL_AtomicAdd(&pvs_next_polygon, 1)) < count)
+	{
+		if (!calculate_polygon_pvs(polygon_index, bits))
+			break;
+		compress_pvs(bits, pvs_sets[polygon_index]);
+
+		// the last one done saves them all and lets the renderer have them
+		if (SDL_AtomicAdd(&pvs_polygons_left, -1) == 1)
+		{
+			write_cached_pvs();
+			SDL_AtomicSet(&pvs_ready, 1);
+		}
+	}
+
+	return 0;
+}
+
+void start_polygon_pvs()
+{
+	stop_polygon_pvs();
+
+	pvs_endpoints.resize(dynamic_world->endpoint_count);
+	for (short i = 0; i < dynamic_world->endpoint_count; i++)
+		pvs_endpoints[i] = get_endpoint_data(i)->vertex;
+
+	pvs_polygons.resize(dynamic_world->polygon_count);
+	for (short i = 0; i < dynamic_world->polygon_count; i++)
+	{
+		polygon_data *polygon = get_polygon_data(i);
+		pvs_polygon& p = pvs_polygons[i];
+
+		obj_clear(p);
+		p.vertex_count = polygon->vertex_count;
+		for (short j = 0; j < polygon->vertex_count; j++)
+		{
+			p.endpoint_indexes[j] = polygon->endpoint_indexes[j];
+			p.line_indexes[j] = polygon->line_indexes[j];
+			p.adjacent_polygon_indexes[j] = polygon->adjacent_polygon_indexes[j];
+		}
+
+		p.lowest_floor = polygon->floor_height;
+		p.highest_ceiling = polygon->ceiling_height;
+		if (polygon->type == _polygon_is_platform)
+		{
+			platform_data *platform = get_platform_data(polygon->permutation);
+			p.lowest_floor = MIN(p.lowest_floor, platform->minimum_floor_height);
+			p.highest_ceiling = MAX(p.highest_ceiling, platform->maximum_ceiling_height);
+		}
+	}
+
+	pvs_inputs_hash = pvs_hash();
+
+	if (read_cached_pvs())
+	{
+		SDL_AtomicSet(&pvs_ready, 1);
+		return;
+	}
+
+	pvs_sets.assign(pvs_polygons.size(), std::vector<uint8>());
+	if (pvs_polygons.empty())
+		return;
+
+	SDL_AtomicSet(&pvs_next_polygon, 0);
+	SDL_AtomicSet(&pvs_polygons_left, static_cast<int>(pvs_polygons.size()));
+
+	// Leave a processor for the game
+	int thread_count = MAX(SDL_GetCPUCount() - 1, 1);
+	for (int i = 0; i < thread_count; i++)
+	{
+		SDL_Thread *thread = SDL_CreateThread(pvs_thread, "start_polygon_pvs_workerThread", NULL);
+		if (thread)
+			pvs_threads.push_back(thread);
+	}
+}
+
+void stop_polygon_pvs()
+{
+	SDL_AtomicSet(&pvs_cancelled, 1);
+	for (size_t i = 0; i < pvs_threads.size(); i++)
+		SDL_WaitThread(pvs_threads[i], NULL);
+	pvs_threads.clear();
+	SDL_AtomicSet(&pvs_cancelled, 0);
+
+	SDL_AtomicSet(&pvs_ready, 0);
+	pvs_discarded = false;
+	pvs_sets.clear();
+	pvs_endpoints.clear();
+	pvs_polygons.clear();
+}
+
+void discard_polygon_pvs()
+{
+	if (!pvs_discarded)
+	{
+		pvs_discarded = true;
+
+		// the last tree may have stopped short of what's in sight now
+		invalidate_render_tree_cache();
+	}
+}
+
+bool get_polygon_pvs(short polygon_index, world_point3d *origin, std::vector<uint8>& bits)
+{
+	if (pvs_discarded || !SDL_AtomicGet(&pvs_ready) || polygon_index < 0 || static_cast<size_t>(polygon_index) >= pvs_sets.size())
+		return false;
+
+	// The sets only cover lines of sight from inside the polygon
+	polygon_data *polygon = get_polygon_data(polygon_index);
+	if (origin->z < polygon->floor_height || origin->z > polygon->ceiling_height || !point_in_polygon(polygon_index, (world_point2d *) origin))
+		return false;
+
+	return decompress_pvs(pvs_sets[polygon_index], bits);
+}
@@ -0,0 +1,54 @@
+#ifndef _RENDER_PVS_
+#define _RENDER_PVS_
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Potentially visible sets of polygons
+
+	For every polygon, the polygons some line of sight from somewhere inside it could reach,
+	following the map's portals (lines with a polygon on both sides) and passing through
+	each one between the highest its floors and the lowest its ceilings can ever be; platforms
+	count as fully open.  The sets are worked out on background threads when a level starts,
+	kept run-length compressed and saved to the cache directory, so the next time the same
+	geometry is loaded they're there at once.
+
+	The visibility tree stops at polygons outside the set of the one the view is in.  In plan
+	view its rays already reach only what's in sight, so what this saves is walking through
+	rooms hidden above, below or behind ledges, floors and ceilings.
+*/
+
+#include "world.h"
+
+#include <vector>
+
+// entering_map() calls this once the map and its platforms are in place; it loads the sets
+// from the cache directory, or starts working them out in the background
+void start_polygon_pvs();
+
+// Stops any work on the sets, waiting for it, and forgets them
+void stop_polygon_pvs();
+
+// For when a polygon's heights go somewhere the sets didn't allow for (only Lua can do
+// that); the sets aren't used again until the next level
+void discard_polygon_pvs();
+
+// Unpacks into bits (one per polygon) the set for a view from origin in polygon_index; false
+// when there isn't one yet, or origin isn't inside the polygon
+bool get_polygon_pvs(short polygon_index, world_point3d *origin, std::vector<uint8>& bits);
+
+#endif
@@ -54,6 +54,7 @@ May 3, 2003 (Br'fin (Jeremy Parsons))
 #include "lightsource.h"
 #include "media.h"
 #include "RenderPlaceObjs.h"
+#include "RenderProfile.h"
 #include "OGL_Setup.h"
 #include "ChaseCam.h"
 #include "player.h"
@@ -279,6 +280,7 @@ render_object_data *RenderPlaceObjsClass::build_render_object(
 				render_object_data Dummy;
 				Dummy.node = NULL;				// Fake initialization to shut up CW
 				RenderObjects.push_back(Dummy);
+				render_profile_count(_render_count_sprites_placed, 1);
 				POINTER_DATA NewROPointer = POINTER_CAST(&RenderObjects.front());
 				
 				if (NewROPointer != OldROPointer)
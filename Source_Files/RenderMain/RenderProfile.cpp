@@ -0,0 +1,221 @@
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Per-frame renderer profiling
+*/
+
+#include "cseries.h"
+#include "RenderProfile.h"
+
+#include "Console.h"
+#include "FileHandler.h"
+#include "shell.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+
+bool render_profiling = false;
+SDL_atomic_t render_profile_counters[NUMBER_OF_RENDER_COUNTERS];
+
+// Only ever timed on the main thread
+static Uint64 stage_ticks[NUMBER_OF_RENDER_STAGES];
+
+static render_profile_frame last_frame;
+static Uint64 last_frame_end = 0;
+static uint32 frame_number = 0;
+
+static bool overlay_active = false;
+static FILE *csv_file = NULL;
+
+static const char *stage_names[NUMBER_OF_RENDER_STAGES] = {
+	"vis tree",
+	"sort",
+	"objects",
+	"rasterize",
+	"map",
+	"hud",
+	"screen",
+	"total"
+};
+
+static const char *counter_names[NUMBER_OF_RENDER_COUNTERS] = {
+	"polygons",
+	"clip windows",
+	"sprites",
+	"spans",
+	"texels",
+	"glyph hits",
+	"glyph misses"
+};
+
+static void update_render_profiling()
+{
+	bool was_profiling = render_profiling;
+	render_profiling = overlay_active || csv_file;
+
+	// Don't report a half-recorded frame, or the time since profiling was last on
+	if (render_profiling && !was_profiling)
+	{
+		memset(stage_ticks, 0, sizeof(stage_ticks));
+		for (int i = 0; i < NUMBER_OF_RENDER_COUNTERS; i++)
+			SDL_AtomicSet(&render_profile_counters[i], 0);
+		memset(&last_frame, 0, sizeof(last_frame));
+		last_frame_end = 0;
+	}
+}
+
+void add_render_profile_time(int stage, Uint64 ticks)
+{
+	stage_ticks[stage] += ticks;
+}
+
+void end_render_profile_frame()
+{
+	if (!render_profiling)
+		return;
+
+	Uint64 now = SDL_GetPerformanceCounter();
+	double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+
+	last_frame.frame_seconds = last_frame_end ? (now - last_frame_end) / frequency : 0;
+	last_frame_end = now;
+	for (int i = 0; i < NUMBER_OF_RENDER_STAGES; i++)
+	{
+		last_frame.stage_seconds[i] = stage_ticks[i] / frequency;
+		stage_ticks[i] = 0;
+	}
+	for (int i = 0; i < NUMBER_OF_RENDER_COUNTERS; i++)
+		last_frame.counts[i] = SDL_AtomicSet(&render_profile_counters[i], 0);
+
+	++frame_number;
+	if (csv_file)
+	{
+		fprintf(csv_file, "%u,%.3f", frame_number, last_frame.frame_seconds * 1000);
+		for (int i = 0; i < NUMBER_OF_RENDER_STAGES; i++)
+			fprintf(csv_file, ",%.3f", last_frame.stage_seconds[i] * 1000);
+		for (int i = 0; i < NUMBER_OF_RENDER_COUNTERS; i++)
+			fprintf(csv_file, ",%d", last_frame.counts[i]);
+		fprintf(csv_file, "\n");
+	}
+}
+
+const render_profile_frame& last_render_profile_frame()
+{
+	return last_frame;
+}
+
+const char *render_profile_stage_name(int stage)
+{
+	return stage_names[stage];
+}
+
+const char *render_profile_counter_name(int counter)
+{
+	return counter_names[counter];
+}
+
+void set_render_profile_overlay(bool active)
+{
+	overlay_active = active;
+	update_render_profiling();
+}
+
+bool render_profile_overlay_active()
+{
+	return overlay_active;
+}
+
+bool start_render_profile_csv(const char *path)
+{
+	stop_render_profile_csv();
+
+	csv_file = fopen(path, "w");
+	if (!csv_file)
+		return false;
+
+	// Column names without spaces, for whatever reads this
+	fprintf(csv_file, "frame,frame_ms");
+	for (int i = 0; i < NUMBER_OF_RENDER_STAGES; i++)
+	{
+		std::string name = stage_names[i];
+		std::replace(name.begin(), name.end(), ' ', '_');
+		fprintf(csv_file, ",%s_ms", name.c_str());
+	}
+	for (int i = 0; i < NUMBER_OF_RENDER_COUNTERS; i++)
+	{
+		std::string name = counter_names[i];
+		std::replace(name.begin(), name.end(), ' ', '_');
+		fprintf(csv_file, ",%s", name.c_str());
+	}
+	fprintf(csv_file, "\n");
+
+	frame_number = 0;
+	update_render_profiling();
+	return true;
+}
+
+void stop_render_profile_csv()
+{
+	if (csv_file)
+	{
+		fclose(csv_file);
+		csv_file = NULL;
+	}
+	update_render_profiling();
+}
+
+struct profile_command
+{
+	void operator() (const std::string& arg) const {
+		if (arg == "")
+		{
+			set_render_profile_overlay(!render_profile_overlay_active());
+		}
+		else if (arg == "csv")
+		{
+			stop_render_profile_csv();
+			screen_printf("Stopped writing the render profile");
+		}
+		else if (arg.compare(0, 4, "csv ") == 0)
+		{
+			std::string filename = arg.substr(4);
+			if (filename.find(".") == std::string::npos)
+				filename += ".csv";
+
+			FileSpecifier fs;
+			fs.SetToLocalDataDir();
+			fs += filename;
+			if (start_render_profile_csv(fs.GetPath()))
+				screen_printf("Writing the render profile to %s", utf8_to_mac_roman(fs.GetPath()).c_str());
+			else
+				screen_printf("Couldn't write to %s", utf8_to_mac_roman(fs.GetPath()).c_str());
+		}
+		else
+		{
+			screen_printf("Usage: .profile, .profile csv <file>, .profile csv");
+		}
+	}
+};
+
+void register_render_profile_commands()
+{
+	Console::instance()->register_command("profile", profile_command());
+}
@@ -0,0 +1,122 @@
+#ifndef _RENDER_PROFILE_
+#define _RENDER_PROFILE_
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Per-frame renderer profiling
+
+	Scoped timers around the stages of render_view() and render_screen(), and counters the
+	stages bump as they go.  Nothing is recorded unless profiling is on, which the ".profile"
+	console command does for the on-screen overlay and ".profile csv <file>" for a line per
+	frame in a file in the local data directory.  The span and texel counters only count
+	what the software rasterizer draws, and the glyph counters only TrueType text drawn
+	onto surfaces.
+*/
+
+#include "cseries.h"
+
+#include <SDL_atomic.h>
+#include <SDL_timer.h>
+
+enum /* render profile stages */
+{
+	_render_stage_vis_tree,			// RenderVisTreeClass::build_render_tree()
+	_render_stage_sort,				// RenderSortPolyClass::sort_render_tree()
+	_render_stage_place_objects,	// RenderPlaceObjsClass::build_render_object_list()
+	_render_stage_rasterize,		// everything from RasterizerClass::Begin() to End()
+	_render_stage_overhead_map,
+	_render_stage_hud,				// crosshairs, on-screen text and the HUD itself
+	_render_stage_update_screen,	// getting the frame to the window
+	_render_stage_total,			// all of render_screen()
+	NUMBER_OF_RENDER_STAGES
+};
+
+enum /* render profile counters */
+{
+	_render_count_polygons_visited,
+	_render_count_clipping_windows,
+	_render_count_sprites_placed,
+	_render_count_spans_drawn,
+	_render_count_texels_fetched,
+	_render_count_glyph_hits,		// TrueType glyphs drawn from, or measured with, the glyph atlas
+	_render_count_glyph_misses,		// and the ones it had to render first
+	NUMBER_OF_RENDER_COUNTERS
+};
+
+struct render_profile_frame
+{
+	// time since the previous frame ended
+	double frame_seconds;
+	double stage_seconds[NUMBER_OF_RENDER_STAGES];
+	int32 counts[NUMBER_OF_RENDER_COUNTERS];
+};
+
+extern bool render_profiling;
+
+// The counters are bumped from the software rasterizer's threads too
+extern SDL_atomic_t render_profile_counters[NUMBER_OF_RENDER_COUNTERS];
+
+inline void render_profile_count(int counter, int32 count)
+{
+	if (render_profiling)
+		SDL_AtomicAdd(&render_profile_counters[counter], count);
+}
+
+void add_render_profile_time(int stage, Uint64 ticks);
+
+// Times from construction to destruction, adding to the stage's total for the frame
+class RenderProfileTimer
+{
+public:
+	RenderProfileTimer(int stage) : m_stage(stage), m_start(render_profiling ? SDL_GetPerformanceCounter() : 0) {}
+	~RenderProfileTimer()
+	{
+		if (m_start)
+			add_render_profile_time(m_stage, SDL_GetPerformanceCounter() - m_start);
+	}
+
+private:
+	int m_stage;
+	Uint64 m_start;
+
+	RenderProfileTimer(const RenderProfileTimer&);
+	RenderProfileTimer& operator=(const RenderProfileTimer&);
+};
+
+// render_screen() calls this first, before timing anything; it keeps the previous frame
+// for the overlay, writes it to the CSV file if there is one and starts the next
+void end_render_profile_frame();
+
+// The most recently finished frame
+const render_profile_frame& last_render_profile_frame();
+
+const char *render_profile_stage_name(int stage);
+const char *render_profile_counter_name(int counter);
+
+void set_render_profile_overlay(bool active);
+bool render_profile_overlay_active();
+
+// Starts writing frames to the file, replacing any it was writing before; false if it
+// couldn't be opened
+bool start_render_profile_csv(const char *path);
+void stop_render_profile_csv();
+
+// .profile, .profile csv <file> and .profile csv
+void register_render_profile_commands();
+
+#endif
@@ -36,6 +36,7 @@ Oct 13, 2000
 
 #include "map.h"
 #include "RenderSortPoly.h"
+#include "RenderProfile.h"
 
 #include <string.h>
 #include <limits.h>
@@ -399,6 +400,7 @@ clipping_window_data *RenderSortPolyClass::build_clipping_windows(
 					clipping_window_data Dummy;
 					Dummy.next_window = NULL;			// Fake initialization to shut up CW
 					ClippingWindows.push_back(Dummy);
+					render_profile_count(_render_count_clipping_windows, 1);
 					POINTER_DATA NewCWPointer = POINTER_CAST(&ClippingWindows.front());
 				
 					if (NewCWPointer != OldCWPointer)
@@ -37,6 +37,8 @@ Oct 13, 2000
 
 #include "map.h"
 #include "RenderVisTree.h"
+#include "RenderProfile.h"
+#include "RenderPVS.h"
 
 
 // LP: "recommended" sizes of stuff in growable lists
@@ -83,7 +85,7 @@ inline void INITIALIZE_NODE(node_data *node, short node_polygon_index, uint16 no
 
 // Inits everything
 RenderVisTreeClass::RenderVisTreeClass():
-	view(NULL), mark_as_explored(false), add_to_automap(true)
+	walking_hidden(false), pvs_active(false), view(NULL), mark_as_explored(false), add_to_automap(true), use_pvs(false)
 {
 	PolygonQueue.reserve(POLYGON_QUEUE_SIZE);
 	EndpointClips.reserve(MAXIMUM_ENDPOINT_CLIPS);
@@ -99,6 +101,11 @@ void RenderVisTreeClass::Resize(size_t NumEndpoints, size_t NumLines)
 	line_clip_indexes.resize(NumLines);
 }
 
+void RenderVisTreeClass::invalidate_automap_reach()
+{
+	AutomapReached.clear();
+}
+
 // Add a polygon to the polygon queue
 void RenderVisTreeClass::PUSH_POLYGON_INDEX(short polygon_index)
 {
@@ -121,6 +128,9 @@ void RenderVisTreeClass::build_render_tree()
 {
 	assert(view);	// Idiot-proofing
 
+	/* don't bother with polygons that can't be seen from anywhere in the one we're in */
+	pvs_active= use_pvs && get_polygon_pvs(view->origin_polygon_index, &view->origin, PotentiallyVisible);
+
 	/* initialize the queue where we remember polygons we need to fire at */
 	initialize_polygon_queue();
 
@@ -145,6 +155,7 @@ void RenderVisTreeClass::build_render_tree()
 		short vertex_index;
 		short polygon_index= PolygonQueue[--polygon_queue_size];
 		polygon_data *polygon= get_polygon_data(polygon_index);
+		render_profile_count(_render_count_polygons_visited, 1);
 		
 		assert(!POLYGON_IS_DETACHED(polygon));
 		
@@ -191,6 +202,78 @@ void RenderVisTreeClass::build_render_tree()
 			}
 		}
 	}
+	
+	if (pvs_active && (add_to_automap || mark_as_explored)) walk_hidden_polygons();
+}
+
+/* ---------- filling in the automap behind the potentially visible set */
+
+/* fires at every endpoint that can be seen from the origin in plan view, as the tree would without
+	the set if the view turned all the way around; the automap and exploration only ever gain
+	polygons, so once from each polygon is enough to keep them close to what they'd be without it */
+void RenderVisTreeClass::walk_hidden_polygons()
+{
+	short origin_polygon_index= view->origin_polygon_index;
+	
+	if (AutomapReached.size()!=static_cast<size_t>((dynamic_world->polygon_count+7)/8))
+	{
+		AutomapReached.assign((dynamic_world->polygon_count+7)/8, 0);
+	}
+	if (AutomapReached[origin_polygon_index>>3]&(1<<(origin_polygon_index&7))) return;
+	AutomapReached[origin_polygon_index>>3]|= 1<<(origin_polygon_index&7);
+	
+	walking_hidden= true;
+	HiddenPolygonQueue.clear();
+	HiddenPolygonQueue.push_back(origin_polygon_index);
+	SET_RENDER_FLAG(origin_polygon_index, _polygon_is_hidden);
+	
+	while (!HiddenPolygonQueue.empty())
+	{
+		short polygon_index= HiddenPolygonQueue.back();
+		polygon_data *polygon= get_polygon_data(polygon_index);
+		
+		HiddenPolygonQueue.pop_back();
+		for (short vertex_index=0;vertex_index<polygon->vertex_count;++vertex_index)
+		{
+			short endpoint_index= polygon->endpoint_indexes[vertex_index];
+			
+			if (!TEST_RENDER_FLAG(endpoint_index, _endpoint_has_been_visited_for_automap))
+			{
+				endpoint_data *endpoint= get_endpoint_data(endpoint_index);
+				long_vector2d _vector;
+				
+				_vector.i= int32(endpoint->vertex.x)-int32(view->origin.x);
+				_vector.j= int32(endpoint->vertex.y)-int32(view->origin.y);
+				cast_hidden_ray(&_vector, origin_polygon_index, _no_bias);
+				
+				SET_RENDER_FLAG(endpoint_index, _endpoint_has_been_visited_for_automap);
+			}
+		}
+	}
+	
+	walking_hidden= false;
+}
+
+/* cast_render_ray() without the tree */
+void RenderVisTreeClass::cast_hidden_ray(
+	long_vector2d *_vector,
+	short polygon_index,
+	short bias)
+{
+	do
+	{
+		short from_polygon_index= polygon_index;
+		short clipping_endpoint_index= NONE;
+		short clipping_line_index;
+		uint16 clip_flags= next_polygon_along_line(&polygon_index, (world_point2d *) &view->origin, _vector, &clipping_endpoint_index, &clipping_line_index, bias);
+		
+		if (polygon_index==NONE && (clip_flags&_split_render_ray))
+		{
+			cast_hidden_ray(_vector, from_polygon_index, _clockwise_bias);
+			cast_hidden_ray(_vector, from_polygon_index, _counterclockwise_bias);
+		}
+	}
+	while (polygon_index!=NONE);
 }
 
 /* ---------- building the render tree */
@@ -360,7 +443,18 @@ uint16 RenderVisTreeClass::next_polygon_along_line(
 	if (add_to_automap) ADD_POLYGON_TO_AUTOMAP(*polygon_index);
 	if (mark_as_explored && polygon->type == _polygon_must_be_explored)
         polygon->type = _polygon_is_normal;
-	PUSH_POLYGON_INDEX(*polygon_index);
+	if (walking_hidden)
+	{
+		if (!TEST_RENDER_FLAG(*polygon_index, _polygon_is_hidden))
+		{
+			HiddenPolygonQueue.push_back(*polygon_index);
+			SET_RENDER_FLAG(*polygon_index, _polygon_is_hidden);
+		}
+	}
+	else
+	{
+		PUSH_POLYGON_INDEX(*polygon_index);
+	}
 
 	state= _looking_for_first_nonzero_vertex;
 	vertex_index= 0, vertex_delta= 1; /* start searching clockwise from vertex zero */
@@ -480,12 +574,14 @@ uint16 RenderVisTreeClass::next_polygon_along_line(
 		if (add_to_automap) ADD_LINE_TO_AUTOMAP(crossed_line_index);
 
 		/* if the line has a side facing this polygon, mark the side as visible */
-		if (crossed_side_index!=NONE) SET_RENDER_FLAG(crossed_side_index, _side_is_visible);
+		if (crossed_side_index!=NONE && !walking_hidden) SET_RENDER_FLAG(crossed_side_index, _side_is_visible);
 
 		/* if this line is transparent we need to check for a change in elevation for clipping,
 			if its not transparent then we cant pass through it */
 		// LP change: added test for there being a polygon on the other side
-		if (LINE_IS_TRANSPARENT(line) && next_polygon_index != NONE)
+		// the same goes for a polygon outside the potentially visible set
+		if (LINE_IS_TRANSPARENT(line) && next_polygon_index != NONE &&
+			(walking_hidden || polygon_is_potentially_visible(next_polygon_index)))
 		{
 			polygon_data *next_polygon= get_polygon_data(next_polygon_index);
 			
@@ -164,6 +164,17 @@ class RenderVisTreeClass
 	// Turned preprocessor macro into function
 	void PUSH_POLYGON_INDEX(short polygon_index);
 	
+	// What the tree can't reach for the potentially visible set still belongs on the automap
+	// and still counts as explored; it's walked out to, without building any of the tree, all
+	// the way around the first time the view is in each polygon, and not again until
+	// invalidate_automap_reach()
+	vector<uint8> AutomapReached;	// a bit for each polygon that's been walked from
+	vector<short> HiddenPolygonQueue;
+	bool walking_hidden;		// next_polygon_along_line() is doing that
+	
+	void walk_hidden_polygons();
+	void cast_hidden_ray(long_vector2d *_vector, short polygon_index, short bias);
+	
 	void initialize_polygon_queue();
 	
 	void initialize_render_tree();
@@ -188,6 +199,14 @@ class RenderVisTreeClass
 	
 	void ResetLineClips();
 	
+	// Polygons that could be seen from somewhere in the origin polygon, a bit each;
+	// only filled in (and pvs_active set) when there's a set for it
+	vector<uint8> PotentiallyVisible;
+	bool pvs_active;
+	
+	bool polygon_is_potentially_visible(short polygon_index)
+		{return !pvs_active || (PotentiallyVisible[polygon_index >> 3] & (1 << (polygon_index & 7)));}
+	
 public:
 
 	/* gives screen x-coordinates for a map endpoint (only valid if _endpoint_is_visible) */
@@ -227,6 +246,13 @@ public:
 	// the automap.
 	bool add_to_automap;
 	
+	// If true, the render tree will treat lines into polygons
+	// outside the origin polygon's potentially visible set as solid.
+	bool use_pvs;
+	
+	// Has the walk for the automap done again from every polygon; for when lines open or close
+	void invalidate_automap_reach();
+	
 	// Resizes all the objects defined inside;
 	// the resizing is lazy
 	void Resize(size_t NumEndpoints, size_t NumLines);
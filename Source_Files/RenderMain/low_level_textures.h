@@ -34,6 +34,7 @@ Jan 30, 2000 (Loren Petrich):
 #include "preferences.h"
 #include "textures.h"
 #include "scottish_textures.h"
+#include "low_level_textures_simd.h"
 
 /* ---------- global state */
 
@@ -149,6 +150,22 @@ void inline write_pixel(T *dst, pixel8 pixel, T *shading_table, uint8 *opacity_t
 	}	
 }
 
+inline uint32 horizontal_texel_index(uint32 source_x, uint32 source_y)
+{
+	return ((source_y>>(HORIZONTAL_HEIGHT_DOWNSHIFT-7))&(0x7f<<7))+(source_x>>HORIZONTAL_WIDTH_DOWNSHIFT);
+}
+
+template <typename T, int sw_alpha_blend>
+void inline texture_horizontal_span(T *write, int count, pixel8 *base_address, T *shading_table, uint32 source_x, uint32 source_y, uint32 source_dx, uint32 source_dy, uint8 *opacity_table, pixel32 rmask, pixel32 gmask, pixel32 bmask)
+{
+	while ((count-= 1)>=0)
+	{
+		write_pixel<T, sw_alpha_blend, false>(write++, base_address[horizontal_texel_index(source_x, source_y)], shading_table, opacity_table, rmask, gmask, bmask);
+		
+		source_x+= source_dx, source_y+= source_dy;
+	}
+}
+
 template <typename T, int sw_alpha_blend>
 void texture_horizontal_polygon_lines
 (
@@ -192,11 +209,20 @@ void texture_horizontal_polygon_lines
 		register uint32 source_dy= data->source_dy;
 		register short count= x1-x0;
 		
-		while ((count-= 1)>=0)
+		if (sizeof(T)==sizeof(pixel32))
 		{
-			write_pixel<T, sw_alpha_blend, false>(write++, base_address[((source_y>>(HORIZONTAL_HEIGHT_DOWNSHIFT-7))&(0x7f<<7))+(source_x>>HORIZONTAL_WIDTH_DOWNSHIFT)], shading_table, opacity_table, rmask, gmask, bmask);
+			struct horizontal_span32 span;
 			
-			source_x+= source_dx, source_y+= source_dy;
+			span.write= (pixel32 *) write, span.count= count;
+			span.texture= base_address, span.shading_table= (pixel32 *) shading_table, span.opacity_table= opacity_table;
+			span.source_x= source_x, span.source_y= source_y;
+			span.source_dx= source_dx, span.source_dy= source_dy;
+			span.rmask= rmask, span.gmask= gmask, span.bmask= bmask;
+			current_span_kernels32->horizontal[sw_alpha_blend](span);
+		}
+		else
+		{
+			texture_horizontal_span<T, sw_alpha_blend>(write, count, base_address, shading_table, source_x, source_y, source_dx, source_dy, opacity_table, rmask, gmask, bmask);
 		}
 		
 		data+= 1;
@@ -395,21 +421,42 @@ void texture_vertical_polygon_lines(
 				count= MIN(dy0, dy1), count= MIN(count, dy2), count= MIN(count, dy3);
 				ymax+= count;
 				
-				for (; count>0; --count)
+				if (sizeof(T)==sizeof(pixel32))
 				{
-					write_pixel<T, sw_alpha_blend, check_transparent>(write, read0[texture_y0>>downshift], shading_table0, opacity_table, rmask, gmask, bmask);
-					texture_y0+= texture_dy0;
+					struct vertical_span32 span;
+					
+					span.write= (pixel32 *) write, span.bytes_per_row= bytes_per_row, span.count= count;
+					span.downshift= downshift;
+					span.texture[0]= read0, span.texture[1]= read1, span.texture[2]= read2, span.texture[3]= read3;
+					span.shading_table[0]= (pixel32 *) shading_table0, span.shading_table[1]= (pixel32 *) shading_table1;
+					span.shading_table[2]= (pixel32 *) shading_table2, span.shading_table[3]= (pixel32 *) shading_table3;
+					span.opacity_table= opacity_table;
+					span.texture_y[0]= texture_y0, span.texture_y[1]= texture_y1, span.texture_y[2]= texture_y2, span.texture_y[3]= texture_y3;
+					span.texture_dy[0]= texture_dy0, span.texture_dy[1]= texture_dy1, span.texture_dy[2]= texture_dy2, span.texture_dy[3]= texture_dy3;
+					span.rmask= rmask, span.gmask= gmask, span.bmask= bmask;
+					current_span_kernels32->vertical[sw_alpha_blend][check_transparent](span);
+					
+					write= (T *) span.write;
+					texture_y0= span.texture_y[0], texture_y1= span.texture_y[1], texture_y2= span.texture_y[2], texture_y3= span.texture_y[3];
+				}
+				else
+				{
+					for (; count>0; --count)
+					{
+						write_pixel<T, sw_alpha_blend, check_transparent>(write, read0[texture_y0>>downshift], shading_table0, opacity_table, rmask, gmask, bmask);
+						texture_y0+= texture_dy0;
 		
-					write_pixel<T, sw_alpha_blend, check_transparent>(write+1, read1[texture_y1>>downshift], shading_table1, opacity_table, rmask, gmask, bmask);
-					texture_y1+= texture_dy1;
+						write_pixel<T, sw_alpha_blend, check_transparent>(write+1, read1[texture_y1>>downshift], shading_table1, opacity_table, rmask, gmask, bmask);
+						texture_y1+= texture_dy1;
 
-					write_pixel<T, sw_alpha_blend, check_transparent>(write+2, read2[texture_y2>>downshift], shading_table2, opacity_table, rmask, gmask, bmask);
-					texture_y2+= texture_dy2;
+						write_pixel<T, sw_alpha_blend, check_transparent>(write+2, read2[texture_y2>>downshift], shading_table2, opacity_table, rmask, gmask, bmask);
+						texture_y2+= texture_dy2;
 
-					write_pixel<T, sw_alpha_blend, check_transparent>(write+3, read3[texture_y3>>downshift], shading_table3, opacity_table, rmask, gmask, bmask);
-					texture_y3+= texture_dy3;
+						write_pixel<T, sw_alpha_blend, check_transparent>(write+3, read3[texture_y3>>downshift], shading_table3, opacity_table, rmask, gmask, bmask);
+						texture_y3+= texture_dy3;
 					
-					write = (T *)((byte *)write + bytes_per_row);
+						write = (T *)((byte *)write + bytes_per_row);
+					}
 				}
 			}
 
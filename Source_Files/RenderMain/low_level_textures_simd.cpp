@@ -0,0 +1,603 @@
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Span kernels for the 32-bit software texture mappers
+*/
+
+#include "cseries.h"
+#include "low_level_textures.h"
+#include "low_level_textures_simd.h"
+
+#include <string.h>
+
+#include <SDL_cpuinfo.h>
+#include <SDL_timer.h>
+#include <SDL_version.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SPAN_SSE2
+#include <emmintrin.h>
+
+// AVX2 is only compiled for the functions that use it, and only called when the CPU has it
+#if SDL_VERSION_ATLEAST(2, 0, 4)
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+#define SPAN_AVX2
+#define SPAN_AVX2_FUNCTION __attribute__((target("avx2")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && _MSC_VER >= 1800
+#define SPAN_AVX2
+#define SPAN_AVX2_FUNCTION
+#include <immintrin.h>
+#endif
+#endif
+#endif
+
+/* ---------- scalar */
+
+// The templates the mappers use for 8- and 16-bit pixels
+
+template <int sw_alpha_blend>
+static void horizontal_span_scalar(const horizontal_span32& span)
+{
+	texture_horizontal_span<pixel32, sw_alpha_blend>(span.write, span.count, span.texture, span.shading_table, span.source_x, span.source_y, span.source_dx, span.source_dy, span.opacity_table, span.rmask, span.gmask, span.bmask);
+}
+
+template <int sw_alpha_blend, bool check_transparent>
+static void vertical_span_scalar(vertical_span32& span)
+{
+	for (int count = span.count; count > 0; --count)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			write_pixel<pixel32, sw_alpha_blend, check_transparent>(span.write + i, span.texture[i][span.texture_y[i] >> span.downshift], span.shading_table[i], span.opacity_table, span.rmask, span.gmask, span.bmask);
+			span.texture_y[i] += span.texture_dy[i];
+		}
+
+		span.write = (pixel32 *)((byte *)span.write + span.bytes_per_row);
+	}
+}
+
+static const span_kernels32 scalar_kernels = {
+	"scalar",
+	{
+		horizontal_span_scalar<_sw_alpha_off>,
+		horizontal_span_scalar<_sw_alpha_fast>,
+		horizontal_span_scalar<_sw_alpha_nice>
+	},
+	{
+		{vertical_span_scalar<_sw_alpha_off, false>, vertical_span_scalar<_sw_alpha_off, true>},
+		{vertical_span_scalar<_sw_alpha_fast, false>, vertical_span_scalar<_sw_alpha_fast, true>},
+		{vertical_span_scalar<_sw_alpha_nice, false>, vertical_span_scalar<_sw_alpha_nice, true>}
+	}
+};
+
+/* ---------- SSE2 */
+
+#ifdef SPAN_SSE2
+
+// SSE2 has no gather, so texels and shading table entries are fetched one at a time and
+// everything after that (blending, transparency, the store) is done four pixels at once
+
+struct channel_masks_sse2
+{
+	__m128i r, g, b;
+};
+
+// SSE2 has no 32-bit multiply; do the even and odd lanes as 64-bit products and keep the
+// low halves, which wrap just like the scalar code
+static inline __m128i mullo_epi32_sse2(__m128i a, __m128i b)
+{
+	__m128i even = _mm_mul_epu32(a, b);
+	__m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+	return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// average<pixel32>()
+static inline __m128i average_sse2(__m128i fg, __m128i bg)
+{
+	__m128i half = _mm_srli_epi32(_mm_and_si128(_mm_xor_si128(fg, bg), _mm_set1_epi32(0xfffefefe)), 1);
+	return _mm_add_epi32(half, _mm_and_si128(fg, bg));
+}
+
+// One channel of alpha_blend<pixel32>()
+static inline __m128i blend_channel_sse2(__m128i fg, __m128i bg, __m128i alpha, __m128i mask)
+{
+	__m128i f = _mm_and_si128(fg, mask);
+	__m128i b = _mm_and_si128(bg, mask);
+	__m128i delta = _mm_srai_epi32(mullo_epi32_sse2(_mm_sub_epi32(f, b), alpha), 8);
+	return _mm_and_si128(mask, _mm_add_epi32(b, delta));
+}
+
+template <int sw_alpha_blend, bool check_transparent>
+static inline void write_pixels_sse2(pixel32 *dst, __m128i texels, __m128i fg, __m128i alpha, const channel_masks_sse2& masks)
+{
+	__m128i result = fg;
+
+	if (sw_alpha_blend != _sw_alpha_off || check_transparent)
+	{
+		__m128i bg = _mm_loadu_si128(reinterpret_cast<const __m128i *>(dst));
+
+		if (sw_alpha_blend == _sw_alpha_fast)
+		{
+			result = average_sse2(fg, bg);
+		}
+		else if (sw_alpha_blend == _sw_alpha_nice)
+		{
+			result = _mm_or_si128(_mm_or_si128(
+				blend_channel_sse2(fg, bg, alpha, masks.r),
+				blend_channel_sse2(fg, bg, alpha, masks.g)),
+				blend_channel_sse2(fg, bg, alpha, masks.b));
+		}
+
+		if (check_transparent)
+		{
+			__m128i clear = _mm_cmpeq_epi32(texels, _mm_setzero_si128());
+			result = _mm_or_si128(_mm_and_si128(clear, bg), _mm_andnot_si128(clear, result));
+		}
+	}
+
+	_mm_storeu_si128(reinterpret_cast<__m128i *>(dst), result);
+}
+
+template <int sw_alpha_blend>
+static void horizontal_span_sse2(const horizontal_span32& span)
+{
+	pixel32 *write = span.write;
+	int count = span.count;
+	uint32 source_x = span.source_x, source_y = span.source_y;
+	const uint32 source_dx = span.source_dx, source_dy = span.source_dy;
+	pixel8 *texture = span.texture;
+	pixel32 *shading_table = span.shading_table;
+
+	channel_masks_sse2 masks;
+	masks.r = _mm_set1_epi32(span.rmask);
+	masks.g = _mm_set1_epi32(span.gmask);
+	masks.b = _mm_set1_epi32(span.bmask);
+
+	for (; count >= 4; count -= 4, write += 4)
+	{
+		pixel8 p0 = texture[horizontal_texel_index(source_x, source_y)];
+		source_x += source_dx, source_y += source_dy;
+		pixel8 p1 = texture[horizontal_texel_index(source_x, source_y)];
+		source_x += source_dx, source_y += source_dy;
+		pixel8 p2 = texture[horizontal_texel_index(source_x, source_y)];
+		source_x += source_dx, source_y += source_dy;
+		pixel8 p3 = texture[horizontal_texel_index(source_x, source_y)];
+		source_x += source_dx, source_y += source_dy;
+
+		__m128i fg = _mm_set_epi32(shading_table[p3], shading_table[p2], shading_table[p1], shading_table[p0]);
+		__m128i alpha = _mm_setzero_si128();
+		if (sw_alpha_blend == _sw_alpha_nice)
+			alpha = _mm_set_epi32(span.opacity_table[p3], span.opacity_table[p2], span.opacity_table[p1], span.opacity_table[p0]);
+
+		write_pixels_sse2<sw_alpha_blend, false>(write, _mm_setzero_si128(), fg, alpha, masks);
+	}
+
+	texture_horizontal_span<pixel32, sw_alpha_blend>(write, count, texture, shading_table, source_x, source_y, source_dx, source_dy, span.opacity_table, span.rmask, span.gmask, span.bmask);
+}
+
+// The four columns of a vertical span already fill a register, so AVX2 uses this too
+template <int sw_alpha_blend, bool check_transparent>
+static void vertical_span_sse2(vertical_span32& span)
+{
+	pixel32 *write = span.write;
+	const int bytes_per_row = span.bytes_per_row;
+	const int downshift = span.downshift;
+	pixel8 *read0 = span.texture[0], *read1 = span.texture[1], *read2 = span.texture[2], *read3 = span.texture[3];
+	pixel32 *shading_table0 = span.shading_table[0], *shading_table1 = span.shading_table[1];
+	pixel32 *shading_table2 = span.shading_table[2], *shading_table3 = span.shading_table[3];
+	uint32 texture_y0 = span.texture_y[0], texture_y1 = span.texture_y[1], texture_y2 = span.texture_y[2], texture_y3 = span.texture_y[3];
+	const uint32 texture_dy0 = span.texture_dy[0], texture_dy1 = span.texture_dy[1], texture_dy2 = span.texture_dy[2], texture_dy3 = span.texture_dy[3];
+
+	channel_masks_sse2 masks;
+	masks.r = _mm_set1_epi32(span.rmask);
+	masks.g = _mm_set1_epi32(span.gmask);
+	masks.b = _mm_set1_epi32(span.bmask);
+
+	for (int count = span.count; count > 0; --count)
+	{
+		pixel8 p0 = read0[texture_y0 >> downshift];
+		pixel8 p1 = read1[texture_y1 >> downshift];
+		pixel8 p2 = read2[texture_y2 >> downshift];
+		pixel8 p3 = read3[texture_y3 >> downshift];
+		texture_y0 += texture_dy0, texture_y1 += texture_dy1, texture_y2 += texture_dy2, texture_y3 += texture_dy3;
+
+		// transparent texels look up entry 0 like any other, then get masked out
+		__m128i fg = _mm_set_epi32(shading_table3[p3], shading_table2[p2], shading_table1[p1], shading_table0[p0]);
+		__m128i texels = _mm_setzero_si128();
+		if (check_transparent)
+			texels = _mm_set_epi32(p3, p2, p1, p0);
+		__m128i alpha = _mm_setzero_si128();
+		if (sw_alpha_blend == _sw_alpha_nice)
+			alpha = _mm_set_epi32(span.opacity_table[p3], span.opacity_table[p2], span.opacity_table[p1], span.opacity_table[p0]);
+
+		write_pixels_sse2<sw_alpha_blend, check_transparent>(write, texels, fg, alpha, masks);
+		write = (pixel32 *)((byte *)write + bytes_per_row);
+	}
+
+	span.write = write;
+	span.texture_y[0] = texture_y0, span.texture_y[1] = texture_y1, span.texture_y[2] = texture_y2, span.texture_y[3] = texture_y3;
+}
+
+static const span_kernels32 sse2_kernels = {
+	"SSE2",
+	{
+		horizontal_span_sse2<_sw_alpha_off>,
+		horizontal_span_sse2<_sw_alpha_fast>,
+		horizontal_span_sse2<_sw_alpha_nice>
+	},
+	{
+		{vertical_span_sse2<_sw_alpha_off, false>, vertical_span_sse2<_sw_alpha_off, true>},
+		{vertical_span_sse2<_sw_alpha_fast, false>, vertical_span_sse2<_sw_alpha_fast, true>},
+		{vertical_span_sse2<_sw_alpha_nice, false>, vertical_span_sse2<_sw_alpha_nice, true>}
+	}
+};
+
+#endif
+
+/* ---------- AVX2 */
+
+#ifdef SPAN_AVX2
+
+// Eight pixels at once, with texels, shading table entries and opacities all gathered
+
+struct channel_masks_avx2
+{
+	__m256i r, g, b;
+};
+
+// Byte loads as 32-bit gathers: each lane reads the aligned word holding its byte, which
+// can't reach into a page the byte isn't on, and shifts the byte down.  words is the
+// table's address rounded down to 4 bytes and offsets are from there.
+static inline SPAN_AVX2_FUNCTION __m256i gather_bytes_avx2(const int *words, __m256i offsets)
+{
+	__m256i w = _mm256_i32gather_epi32(words, _mm256_srli_epi32(offsets, 2), 4);
+	__m256i shift = _mm256_slli_epi32(_mm256_and_si256(offsets, _mm256_set1_epi32(3)), 3);
+	return _mm256_and_si256(_mm256_srlv_epi32(w, shift), _mm256_set1_epi32(0xff));
+}
+
+static inline SPAN_AVX2_FUNCTION __m256i average_avx2(__m256i fg, __m256i bg)
+{
+	__m256i half = _mm256_srli_epi32(_mm256_and_si256(_mm256_xor_si256(fg, bg), _mm256_set1_epi32(0xfffefefe)), 1);
+	return _mm256_add_epi32(half, _mm256_and_si256(fg, bg));
+}
+
+static inline SPAN_AVX2_FUNCTION __m256i blend_channel_avx2(__m256i fg, __m256i bg, __m256i alpha, __m256i mask)
+{
+	__m256i f = _mm256_and_si256(fg, mask);
+	__m256i b = _mm256_and_si256(bg, mask);
+	__m256i delta = _mm256_srai_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(f, b), alpha), 8);
+	return _mm256_and_si256(mask, _mm256_add_epi32(b, delta));
+}
+
+template <int sw_alpha_blend>
+static SPAN_AVX2_FUNCTION void horizontal_span_avx2(const horizontal_span32& span)
+{
+	pixel32 *write = span.write;
+	int count = span.count;
+	uint32 source_x = span.source_x, source_y = span.source_y;
+	const uint32 source_dx = span.source_dx, source_dy = span.source_dy;
+
+	const size_t texture_misalignment = reinterpret_cast<size_t>(span.texture) & 3;
+	const int *texture_words = reinterpret_cast<const int *>(span.texture - texture_misalignment);
+	const size_t opacity_misalignment = reinterpret_cast<size_t>(span.opacity_table) & 3;
+	const int *opacity_words = reinterpret_cast<const int *>(span.opacity_table - opacity_misalignment);
+	const int *shading_table = reinterpret_cast<const int *>(span.shading_table);
+
+	const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+	__m256i x = _mm256_add_epi32(_mm256_set1_epi32(source_x), _mm256_mullo_epi32(lane, _mm256_set1_epi32(source_dx)));
+	__m256i y = _mm256_add_epi32(_mm256_set1_epi32(source_y), _mm256_mullo_epi32(lane, _mm256_set1_epi32(source_dy)));
+	const __m256i x_step = _mm256_set1_epi32(source_dx * 8);
+	const __m256i y_step = _mm256_set1_epi32(source_dy * 8);
+	const __m256i row_mask = _mm256_set1_epi32(0x7f << 7);
+
+	channel_masks_avx2 masks;
+	masks.r = _mm256_set1_epi32(span.rmask);
+	masks.g = _mm256_set1_epi32(span.gmask);
+	masks.b = _mm256_set1_epi32(span.bmask);
+
+	for (; count >= 8; count -= 8, write += 8)
+	{
+		// horizontal_texel_index()
+		__m256i index = _mm256_add_epi32(
+			_mm256_and_si256(_mm256_srli_epi32(y, HORIZONTAL_HEIGHT_DOWNSHIFT - 7), row_mask),
+			_mm256_srli_epi32(x, HORIZONTAL_WIDTH_DOWNSHIFT));
+		x = _mm256_add_epi32(x, x_step);
+		y = _mm256_add_epi32(y, y_step);
+		source_x += source_dx * 8, source_y += source_dy * 8;
+
+		__m256i texels = gather_bytes_avx2(texture_words, _mm256_add_epi32(index, _mm256_set1_epi32(texture_misalignment)));
+		__m256i result = _mm256_i32gather_epi32(shading_table, texels, 4);
+
+		if (sw_alpha_blend != _sw_alpha_off)
+		{
+			__m256i bg = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(write));
+
+			if (sw_alpha_blend == _sw_alpha_fast)
+			{
+				result = average_avx2(result, bg);
+			}
+			else if (sw_alpha_blend == _sw_alpha_nice)
+			{
+				__m256i alpha = gather_bytes_avx2(opacity_words, _mm256_add_epi32(texels, _mm256_set1_epi32(opacity_misalignment)));
+				result = _mm256_or_si256(_mm256_or_si256(
+					blend_channel_avx2(result, bg, alpha, masks.r),
+					blend_channel_avx2(result, bg, alpha, masks.g)),
+					blend_channel_avx2(result, bg, alpha, masks.b));
+			}
+		}
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i *>(write), result);
+	}
+
+	texture_horizontal_span<pixel32, sw_alpha_blend>(write, count, span.texture, span.shading_table, source_x, source_y, source_dx, source_dy, span.opacity_table, span.rmask, span.gmask, span.bmask);
+}
+
+static const span_kernels32 avx2_kernels = {
+	"AVX2",
+	{
+		horizontal_span_avx2<_sw_alpha_off>,
+		horizontal_span_avx2<_sw_alpha_fast>,
+		horizontal_span_avx2<_sw_alpha_nice>
+	},
+	{
+		{vertical_span_sse2<_sw_alpha_off, false>, vertical_span_sse2<_sw_alpha_off, true>},
+		{vertical_span_sse2<_sw_alpha_fast, false>, vertical_span_sse2<_sw_alpha_fast, true>},
+		{vertical_span_sse2<_sw_alpha_nice, false>, vertical_span_sse2<_sw_alpha_nice, true>}
+	}
+};
+
+#endif
+
+/* ---------- selection */
+
+const span_kernels32 *get_span_kernels32(int set)
+{
+	switch (set)
+	{
+		case _span_kernels_scalar:
+			return &scalar_kernels;
+#ifdef SPAN_SSE2
+		case _span_kernels_sse2:
+			return SDL_HasSSE2() ? &sse2_kernels : NULL;
+#endif
+#ifdef SPAN_AVX2
+		case _span_kernels_avx2:
+			return SDL_HasAVX2() ? &avx2_kernels : NULL;
+#endif
+		default:
+			return NULL;
+	}
+}
+
+static int best_span_kernels()
+{
+	int set = NUMBER_OF_SPAN_KERNEL_SETS - 1;
+	while (!get_span_kernels32(set))
+		--set;
+	return set;
+}
+
+static int current_span_kernel_set = best_span_kernels();
+const span_kernels32 *current_span_kernels32 = get_span_kernels32(current_span_kernel_set);
+
+void set_software_span_kernels(int set)
+{
+	if (get_span_kernels32(set))
+	{
+		current_span_kernel_set = set;
+		current_span_kernels32 = get_span_kernels32(set);
+	}
+}
+
+int get_software_span_kernels()
+{
+	return current_span_kernel_set;
+}
+
+/* ---------- benchmark */
+
+const int BENCHMARK_WIDTH = 1024;
+const int BENCHMARK_HEIGHT = 256;
+const int BENCHMARK_PASSES = 50;
+
+static uint32 benchmark_random(uint32& seed)
+{
+	// xorshift
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+struct span_benchmark_data
+{
+	std::vector<pixel8> texture;
+	std::vector<pixel32> shading_tables;
+	std::vector<uint8> opacity_table;
+	std::vector<pixel32> screen;
+	std::vector<pixel32> pristine_screen;
+
+	std::vector<horizontal_span32> horizontal_spans;
+	std::vector<vertical_span32> vertical_spans;
+};
+
+static void build_span_benchmark(span_benchmark_data& data)
+{
+	uint32 seed = 0x5eed5eed;
+
+	// 128x128 for the horizontal spans; the vertical ones use four 128-texel columns of it.
+	// Every eighth texel is transparent.
+	data.texture.resize(128 * 128);
+	for (size_t i = 0; i < data.texture.size(); i++)
+		data.texture[i] = (i % 8) ? static_cast<pixel8>(benchmark_random(seed)) : 0;
+
+	data.shading_tables.resize(4 * 256);
+	for (size_t i = 0; i < data.shading_tables.size(); i++)
+		data.shading_tables[i] = benchmark_random(seed) & 0x00ffffff;
+
+	data.opacity_table.resize(256);
+	for (size_t i = 0; i < data.opacity_table.size(); i++)
+		data.opacity_table[i] = static_cast<uint8>(benchmark_random(seed));
+
+	data.pristine_screen.resize(BENCHMARK_WIDTH * BENCHMARK_HEIGHT);
+	for (size_t i = 0; i < data.pristine_screen.size(); i++)
+		data.pristine_screen[i] = benchmark_random(seed) & 0x00ffffff;
+	data.screen = data.pristine_screen;
+
+	// A span per row, starting and ending a little way in from either side
+	for (int y = 0; y < BENCHMARK_HEIGHT; y++)
+	{
+		int x0 = benchmark_random(seed) % 64;
+		int x1 = BENCHMARK_WIDTH - benchmark_random(seed) % 64;
+
+		horizontal_span32 span;
+		span.write = &data.screen[y * BENCHMARK_WIDTH + x0];
+		span.count = x1 - x0;
+		span.texture = &data.texture[0];
+		span.shading_table = &data.shading_tables[(y % 4) * 256];
+		span.opacity_table = &data.opacity_table[0];
+		span.source_x = benchmark_random(seed);
+		span.source_y = benchmark_random(seed);
+		span.source_dx = benchmark_random(seed) >> 6;
+		span.source_dy = benchmark_random(seed) >> 6;
+		span.rmask = 0x00ff0000, span.gmask = 0x0000ff00, span.bmask = 0x000000ff;
+		data.horizontal_spans.push_back(span);
+	}
+
+	// Four columns per span, each the full height
+	for (int x = 0; x < BENCHMARK_WIDTH; x += 4)
+	{
+		vertical_span32 span;
+		span.write = &data.screen[x];
+		span.bytes_per_row = BENCHMARK_WIDTH * sizeof(pixel32);
+		span.count = BENCHMARK_HEIGHT;
+		span.downshift = 32 - 7;
+		span.opacity_table = &data.opacity_table[0];
+		for (int i = 0; i < 4; i++)
+		{
+			span.texture[i] = &data.texture[(benchmark_random(seed) % 128) * 128];
+			span.shading_table[i] = &data.shading_tables[i * 256];
+			span.texture_y[i] = benchmark_random(seed);
+			span.texture_dy[i] = benchmark_random(seed) >> 7;
+		}
+		span.rmask = 0x00ff0000, span.gmask = 0x0000ff00, span.bmask = 0x000000ff;
+		data.vertical_spans.push_back(span);
+	}
+}
+
+// Draws every span once; the vertical spans are copied since drawing advances them
+static void draw_benchmark_spans(span_benchmark_data& data, horizontal_span32_proc horizontal, vertical_span32_proc vertical, std::vector<uint32> *texture_y)
+{
+	if (horizontal)
+	{
+		for (size_t i = 0; i < data.horizontal_spans.size(); i++)
+			horizontal(data.horizontal_spans[i]);
+	}
+	else
+	{
+		for (size_t i = 0; i < data.vertical_spans.size(); i++)
+		{
+			vertical_span32 span = data.vertical_spans[i];
+			vertical(span);
+			if (texture_y)
+				texture_y->insert(texture_y->end(), span.texture_y, span.texture_y + 4);
+		}
+	}
+}
+
+static void benchmark_span_kernel(span_benchmark_data& data, const char *name, int alpha, int transparent, span_kernel_timing& timing)
+{
+	timing.kernel = name;
+	timing.identical = true;
+
+	std::vector<pixel32> reference_screen;
+	std::vector<uint32> reference_texture_y;
+	int pixels_per_pass = 0;
+	if (transparent < 0)
+	{
+		for (size_t i = 0; i < data.horizontal_spans.size(); i++)
+			pixels_per_pass += data.horizontal_spans[i].count;
+	}
+	else
+	{
+		pixels_per_pass = BENCHMARK_WIDTH * BENCHMARK_HEIGHT;
+	}
+
+	for (int set = 0; set < NUMBER_OF_SPAN_KERNEL_SETS; set++)
+	{
+		timing.pixels_per_second[set] = 0;
+
+		const span_kernels32 *kernels = get_span_kernels32(set);
+		if (!kernels)
+			continue;
+
+		horizontal_span32_proc horizontal = (transparent < 0) ? kernels->horizontal[alpha] : NULL;
+		vertical_span32_proc vertical = (transparent < 0) ? NULL : kernels->vertical[alpha][transparent];
+
+		// One pass from the same starting screen to compare...
+		std::vector<uint32> texture_y;
+		data.screen = data.pristine_screen;
+		draw_benchmark_spans(data, horizontal, vertical, &texture_y);
+		if (set == _span_kernels_scalar)
+		{
+			reference_screen = data.screen;
+			reference_texture_y = texture_y;
+		}
+		else if (data.screen != reference_screen || texture_y != reference_texture_y)
+		{
+			timing.identical = false;
+		}
+
+		// ...then a few more to time
+		Uint64 start = SDL_GetPerformanceCounter();
+		for (int pass = 0; pass < BENCHMARK_PASSES; pass++)
+			draw_benchmark_spans(data, horizontal, vertical, NULL);
+		double seconds = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+		if (seconds > 0)
+			timing.pixels_per_second[set] = static_cast<double>(pixels_per_pass) * BENCHMARK_PASSES / seconds;
+	}
+}
+
+void benchmark_span_kernels32(std::vector<span_kernel_timing>& timings)
+{
+	static const struct
+	{
+		const char *name;
+		int alpha;
+		// -1 for horizontal
+		int transparent;
+	} kernels[] = {
+		{"horizontal", _sw_alpha_off, -1},
+		{"horizontal fast", _sw_alpha_fast, -1},
+		{"horizontal nice", _sw_alpha_nice, -1},
+		{"vertical", _sw_alpha_off, 0},
+		{"vertical fast", _sw_alpha_fast, 0},
+		{"vertical nice", _sw_alpha_nice, 0},
+		{"vertical transparent", _sw_alpha_off, 1},
+		{"vertical transparent fast", _sw_alpha_fast, 1},
+		{"vertical transparent nice", _sw_alpha_nice, 1}
+	};
+
+	span_benchmark_data data;
+	build_span_benchmark(data);
+
+	timings.resize(sizeof(kernels) / sizeof(kernels[0]));
+	for (size_t i = 0; i < timings.size(); i++)
+		benchmark_span_kernel(data, kernels[i].name, kernels[i].alpha, kernels[i].transparent, timings[i]);
+}
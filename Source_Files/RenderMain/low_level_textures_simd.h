@@ -0,0 +1,111 @@
+#ifndef __LOW_LEVEL_TEXTURES_SIMD_H
+#define __LOW_LEVEL_TEXTURES_SIMD_H
+/*
+
+	Copyright (C) 2026 and beyond by the "Aleph One" developers.
+
+	This program is free software; you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation; either version 3 of the License, or
+	(at your option) any later version.
+
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	This license is contained in the file "COPYING",
+	which is included with this source code; it is available online at
+	http://www.gnu.org/licenses/gpl.html
+
+	Span kernels for the 32-bit software texture mappers
+
+	The innermost loops of texture_horizontal_polygon_lines<pixel32> (a run of pixels along
+	one row) and of texture_vertical_polygon_lines<pixel32> (four neighbouring columns, drawn
+	a row at a time), in scalar, SSE2 and AVX2 versions.  The best set the CPU can run is
+	picked at startup; all of them draw exactly what the scalar templates in
+	low_level_textures.h do.
+*/
+
+#include "cseries.h"
+
+#include <vector>
+
+struct horizontal_span32
+{
+	pixel32 *write;
+	int count;
+
+	// 128x128
+	pixel8 *texture;
+	pixel32 *shading_table;
+	uint8 *opacity_table;
+
+	uint32 source_x, source_y;
+	uint32 source_dx, source_dy;
+
+	pixel32 rmask, gmask, bmask;
+};
+
+struct vertical_span32
+{
+	// advanced past the last row drawn
+	pixel32 *write;
+	int bytes_per_row;
+	int count;
+
+	int downshift;
+	pixel8 *texture[4];
+	pixel32 *shading_table[4];
+	uint8 *opacity_table;
+
+	// advanced past the last row drawn
+	uint32 texture_y[4];
+	uint32 texture_dy[4];
+
+	pixel32 rmask, gmask, bmask;
+};
+
+typedef void (*horizontal_span32_proc)(const horizontal_span32& span);
+typedef void (*vertical_span32_proc)(vertical_span32& span);
+
+enum /* span kernel sets */
+{
+	_span_kernels_scalar,
+	_span_kernels_sse2,
+	_span_kernels_avx2,
+	NUMBER_OF_SPAN_KERNEL_SETS
+};
+
+struct span_kernels32
+{
+	const char *name;
+
+	// by sw_alpha_blend
+	horizontal_span32_proc horizontal[3];
+	// by sw_alpha_blend, then check_transparent
+	vertical_span32_proc vertical[3][2];
+};
+
+// What the mappers call; read once per span, so only change it between frames
+extern const span_kernels32 *current_span_kernels32;
+
+// NULL if this build or this CPU can't run the set; the scalar set is always there
+const span_kernels32 *get_span_kernels32(int set);
+
+void set_software_span_kernels(int set);
+int get_software_span_kernels();
+
+struct span_kernel_timing
+{
+	const char *kernel;
+	// by kernel set; 0 where the set isn't available
+	double pixels_per_second[NUMBER_OF_SPAN_KERNEL_SETS];
+	// every available set drew what the scalar set did
+	bool identical;
+};
+
+// Times every kernel of every available set on made-up spans covering a 1024x256 screen
+void benchmark_span_kernels32(std::vector<span_kernel_timing>& timings);
+
+#endif
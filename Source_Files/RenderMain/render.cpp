@@ -234,6 +234,8 @@ extern WindowPtr screen_window;
 #include "RenderPlaceObjs.h"
 #include "RenderRasterize.h"
 #include "Rasterizer_SW.h"
+#include "Rasterizer_SW_Parallel.h"
+#include "RenderProfile.h"
 #ifdef HAVE_OPENGL
 #include "Rasterizer_OGL.h"
 #include "RenderRasterize_Shader.h"
@@ -290,6 +292,7 @@ static RenderPlaceObjsClass RenderPlaceObjs;		// Object-placement object
 static RenderRasterizerClass Render_Classic;		// Clipping and rasterization class
 
 static Rasterizer_SW_Class Rasterizer_SW;			// Software rasterizer
+static Rasterizer_SW_Parallel_Class Rasterizer_SW_Parallel;	// Software rasterizer, on several threads
 #ifdef HAVE_OPENGL
 static Rasterizer_OGL_Class Rasterizer_OGL;			// OpenGL rasterizer
 static Rasterizer_Shader_Class Rasterizer_Shader;   // Shader rasterizer
@@ -305,6 +308,25 @@ static const int TICKS_PER_EXPLORE = 4;
 static struct view_data explore_view;
 static RenderVisTreeClass explore_tree;
 
+// The visibility tree and polygon sort only depend on where the view is and on the map
+// geometry, so the last frame's are drawn again until either changes
+struct render_tree_view
+{
+	world_point3d origin;
+	short origin_polygon_index;
+	angle yaw;
+	short dtanpitch;
+	short screen_width, screen_height;
+	short world_to_screen_x, world_to_screen_y;
+	world_vector2d untransformed_left_edge, untransformed_right_edge;
+	world_vector2d left_edge, right_edge, top_edge, bottom_edge;
+};
+
+static bool render_tree_is_cached= false;
+static struct render_tree_view cached_render_tree_view;
+// Placing objects adds clipping windows after the sorted nodes' own
+static size_t cached_clipping_window_count= 0;
+
 void OGL_Rasterizer_Init() {
 	
 #ifdef HAVE_OPENGL
@@ -318,6 +340,9 @@ void OGL_Rasterizer_Init() {
 /* ---------- private prototypes */
 
 static void update_view_data(struct view_data *view);
+static void get_render_tree_view(struct view_data *view, struct render_tree_view *tree_view);
+static bool same_world_vector2d(world_vector2d *a, world_vector2d *b);
+static bool same_render_tree_view(struct render_tree_view *a, struct render_tree_view *b);
 static void update_render_effect(struct view_data *view);
 static void shake_view_origin(struct view_data *view, world_distance delta);
 
@@ -344,10 +369,18 @@ void allocate_render_memory(
 	// LP addition: check out pointer-arithmetic hack
 	assert(sizeof(void *) == sizeof(POINTER_DATA));
 	
+	// New map, so nothing from the old one can be drawn again
+	invalidate_render_tree_cache();
+	invalidate_automap_reach();
+
 	// LP change: do max allocation
 	RenderVisTree.Resize(MAXIMUM_ENDPOINTS_PER_MAP,MAXIMUM_LINES_PER_MAP);
 	RenderSortPoly.Resize(MAXIMUM_POLYGONS_PER_MAP);
 	
+	// Only the view's tree is pruned; what the M1 exploration tree finds has to be the
+	// same on every machine, set or no set
+	RenderVisTree.use_pvs = true;
+	
 	// LP change: set up pointers
 	RenderSortPoly.RVPtr = &RenderVisTree;
 	RenderPlaceObjs.RVPtr = &RenderVisTree;
@@ -420,12 +453,27 @@ void render_view(
 	struct view_data *view,
 	struct bitmap_definition *destination)
 {
+	struct render_tree_view tree_view;
+	bool reuse_render_tree;
+
 	update_view_data(view);
 
-	/* clear the render flags */
-	objlist_clear(render_flags, RENDER_FLAGS_BUFFER_SIZE);
+	/* if we're looking from exactly where we were last frame, the render flags, transformed
+		endpoints, clip data and automap it left behind are still good */
+	get_render_tree_view(view, &tree_view);
+	reuse_render_tree= render_tree_is_cached && !view->terminal_mode_active &&
+		(!view->overhead_map_active || map_is_translucent()) &&
+		same_render_tree_view(&tree_view, &cached_render_tree_view);
+
+	if (!reuse_render_tree)
+	{
+		render_tree_is_cached= false;
+
+		/* clear the render flags */
+		objlist_clear(render_flags, RENDER_FLAGS_BUFFER_SIZE);
 
-	ResetOverheadMap();
+		ResetOverheadMap();
+	}
 /*
 #ifdef AUTOMAP_DEBUG
 	memset(automap_lines, 0, (dynamic_world->line_count/8+((dynamic_world->line_count%8)?1:0)*sizeof(byte)));
@@ -446,7 +494,11 @@ void render_view(
 		// LP: now from the visibility-tree class
 		/* build the render tree, regardless of map mode, so the automap updates while active */
 		RenderVisTree.view = view;
-		RenderVisTree.build_render_tree();
+		if (!reuse_render_tree)
+		{
+			RenderProfileTimer timer(_render_stage_vis_tree);
+			RenderVisTree.build_render_tree();
+		}
 		
 		/* do something complicated and difficult to explain */
 		if (!view->overhead_map_active || map_is_translucent())
@@ -455,12 +507,31 @@ void render_view(
 			/* sort the render tree (so we have a depth-ordering of polygons) and accumulate
 				clipping information for each polygon */
 			RenderSortPoly.view = view;
-			RenderSortPoly.sort_render_tree();
+			if (reuse_render_tree)
+			{
+				/* take down the objects the last frame hung on the sorted nodes, and their windows */
+				vector<sorted_node_data>& SortedNodes = RenderSortPoly.SortedNodes;
+				for (size_t i= 0; i<SortedNodes.size(); ++i)
+					SortedNodes[i].interior_objects= SortedNodes[i].exterior_objects= NULL;
+				RenderVisTree.ClippingWindows.resize(cached_clipping_window_count);
+			}
+			else
+			{
+				RenderProfileTimer timer(_render_stage_sort);
+				RenderSortPoly.sort_render_tree();
+
+				cached_render_tree_view= tree_view;
+				cached_clipping_window_count= RenderVisTree.ClippingWindows.size();
+				render_tree_is_cached= true;
+			}
 			
 			// LP: now from the object-placement class
 			/* build the render object list by looking at the sorted render tree */
 			RenderPlaceObjs.view = view;
-			RenderPlaceObjs.build_render_object_list();
+			{
+				RenderProfileTimer timer(_render_stage_place_objects);
+				RenderPlaceObjs.build_render_object_list();
+			}
 			
 			// LP addition: set the current rasterizer to whichever is appropriate here
 			RasterizerClass *RasPtr;
@@ -471,8 +542,16 @@ void render_view(
 			{
 #endif
 				// The software renderer needs this but the OpenGL one doesn't...
-				Rasterizer_SW.screen = destination;
-				RasPtr = &Rasterizer_SW;
+				if (Rasterizer_SW_Parallel.GetThreadCount() > 1)
+				{
+					Rasterizer_SW_Parallel.screen = destination;
+					RasPtr = &Rasterizer_SW_Parallel;
+				}
+				else
+				{
+					Rasterizer_SW.screen = destination;
+					RasPtr = &Rasterizer_SW;
+				}
 #ifdef HAVE_OPENGL
 			}
 #endif
@@ -480,6 +559,8 @@ void render_view(
 			// Set its view:
 			RasPtr->SetView(*view);
 			
+			RenderProfileTimer rasterize_timer(_render_stage_rasterize);
+			
 			// Start rendering main view
 			RasPtr->Begin();
 			
@@ -506,11 +587,74 @@ void render_view(
 		if (view->overhead_map_active)
 		{
 			/* if the overhead map is active, render it */
+			RenderProfileTimer timer(_render_stage_overhead_map);
 			render_overhead_map(view);
+
+			/* which transforms the endpoints its own way */
+			render_tree_is_cached= false;
 		}
 	}
 }
 
+static int software_render_threads= 1;
+
+void set_software_render_threads(
+	int count)
+{
+	software_render_threads= count;
+	Rasterizer_SW_Parallel.SetThreadCount(count);
+}
+
+int get_software_render_threads(
+	void)
+{
+	return software_render_threads;
+}
+
+void invalidate_render_tree_cache(
+	short polygon_index)
+{
+	if (render_tree_is_cached && polygon_index!=NONE)
+	{
+		/* a polygon the last tree never reached can only change it through the solidity of
+			its lines and endpoints, and the tree visited every endpoint of the polygons it did
+			reach */
+		struct polygon_data *polygon= get_polygon_data(polygon_index);
+		bool reached= TEST_RENDER_FLAG(polygon_index, _polygon_is_visible);
+		short i;
+
+		for (i= 0; i<polygon->vertex_count && !reached; ++i)
+		{
+			if (TEST_RENDER_FLAG(polygon->endpoint_indexes[i], _endpoint_has_been_visited)) reached= true;
+		}
+		if (!reached) return;
+	}
+
+	render_tree_is_cached= false;
+}
+
+void invalidate_automap_reach(
+	void)
+{
+	RenderVisTree.invalidate_automap_reach();
+}
+
+void set_render_pvs(
+	bool use_pvs)
+{
+	if (RenderVisTree.use_pvs!=use_pvs)
+	{
+		RenderVisTree.use_pvs= use_pvs;
+		invalidate_render_tree_cache();
+	}
+}
+
+bool get_render_pvs(
+	void)
+{
+	return RenderVisTree.use_pvs;
+}
+
 void start_render_effect(
 	struct view_data *view,
 	short effect)
@@ -582,6 +726,7 @@ void check_m1_exploration(void)
 		explore_view.origin_polygon_index = explore_player->camera_polygon_index;
 
 		update_view_data(&explore_view);
+		invalidate_render_tree_cache();
 		objlist_clear(render_flags, RENDER_FLAGS_BUFFER_SIZE);
         // build_render_tree() actually marks the polygons
 		explore_tree.build_render_tree();
@@ -591,6 +736,51 @@ void check_m1_exploration(void)
 
 /* ---------- private code */
 
+static void get_render_tree_view(
+	struct view_data *view,
+	struct render_tree_view *tree_view)
+{
+	tree_view->origin= view->origin;
+	tree_view->origin_polygon_index= view->origin_polygon_index;
+	tree_view->yaw= view->yaw;
+	tree_view->dtanpitch= view->dtanpitch;
+	tree_view->screen_width= view->screen_width;
+	tree_view->screen_height= view->screen_height;
+	tree_view->world_to_screen_x= view->world_to_screen_x;
+	tree_view->world_to_screen_y= view->world_to_screen_y;
+	tree_view->untransformed_left_edge= view->untransformed_left_edge;
+	tree_view->untransformed_right_edge= view->untransformed_right_edge;
+	tree_view->left_edge= view->left_edge;
+	tree_view->right_edge= view->right_edge;
+	tree_view->top_edge= view->top_edge;
+	tree_view->bottom_edge= view->bottom_edge;
+}
+
+static bool same_world_vector2d(
+	world_vector2d *a,
+	world_vector2d *b)
+{
+	return a->i==b->i && a->j==b->j;
+}
+
+/* exactly the same, since moving the view at all moves every transformed endpoint */
+static bool same_render_tree_view(
+	struct render_tree_view *a,
+	struct render_tree_view *b)
+{
+	return a->origin.x==b->origin.x && a->origin.y==b->origin.y && a->origin.z==b->origin.z &&
+		a->origin_polygon_index==b->origin_polygon_index &&
+		a->yaw==b->yaw && a->dtanpitch==b->dtanpitch &&
+		a->screen_width==b->screen_width && a->screen_height==b->screen_height &&
+		a->world_to_screen_x==b->world_to_screen_x && a->world_to_screen_y==b->world_to_screen_y &&
+		same_world_vector2d(&a->untransformed_left_edge, &b->untransformed_left_edge) &&
+		same_world_vector2d(&a->untransformed_right_edge, &b->untransformed_right_edge) &&
+		same_world_vector2d(&a->left_edge, &b->left_edge) &&
+		same_world_vector2d(&a->right_edge, &b->right_edge) &&
+		same_world_vector2d(&a->top_edge, &b->top_edge) &&
+		same_world_vector2d(&a->bottom_edge, &b->bottom_edge);
+}
+
 static void update_view_data(
 	struct view_data *view)
 {
@@ -155,6 +155,8 @@ enum /* render flags */
 	_line_has_clip_data_bit, /* this line has a valid clip entry */
 	_endpoint_has_clip_data_bit, /* this endpoint has a valid clip entry */
 	_endpoint_has_been_transformed_bit, /* this endpoint has been transformed into screen-space */
+	_polygon_is_hidden_bit, /* outside the potentially visible set, but reached for the automap */
+	_endpoint_has_been_visited_for_automap_bit, /* a ray has been walked out at this endpoint for the automap */
 	NUMBER_OF_RENDER_FLAGS, /* should be <=16 */
 
 	_polygon_is_visible= 1<<_polygon_is_visible_bit,
@@ -163,7 +165,9 @@ enum /* render flags */
 	_side_is_visible= 1<<_side_is_visible_bit,
 	_line_has_clip_data= 1<<_line_has_clip_data_bit,
 	_endpoint_has_clip_data= 1<<_endpoint_has_clip_data_bit,
-	_endpoint_has_been_transformed= 1<<_endpoint_has_been_transformed_bit
+	_endpoint_has_been_transformed= 1<<_endpoint_has_been_transformed_bit,
+	_polygon_is_hidden= 1<<_polygon_is_hidden_bit,
+	_endpoint_has_been_visited_for_automap= 1<<_endpoint_has_been_visited_for_automap_bit
 };
 
 /* ---------- globals */
@@ -180,10 +184,29 @@ void allocate_render_memory(void);
 void initialize_view_data(struct view_data *view, bool ignore_preferences = false);
 void render_view(struct view_data *view, struct bitmap_definition *destination);
 
+// Threads the software renderer draws with; 1 (the default) draws on this thread alone,
+// 0 means one per CPU.  Frames come out the same however many there are
+void set_software_render_threads(int count);
+int get_software_render_threads(void);
+
 void start_render_effect(struct view_data *view, short effect);
 
 void check_m1_exploration(void);
 
+// render_view() draws the last frame's visibility tree and polygon sort again while the view
+// hasn't moved; call this when a polygon's floor or ceiling moves, or with NONE when anything
+// else they were built from changes
+void invalidate_render_tree_cache(short polygon_index = NONE);
+
+// The automap behind the potentially visible sets is only filled in the first time the view is
+// in each polygon; call this when a line opens or closes
+void invalidate_automap_reach(void);
+
+// For the render benchmark: whether the view's tree is cut down to the potentially visible
+// sets (the default)
+void set_render_pvs(bool use_pvs);
+bool get_render_pvs(void);
+
 
 /* ----------- prototypes/SCREEN.C */
 void render_overhead_map(struct view_data *view);
@@ -114,9 +114,11 @@ not only that, but texture_horizontal_polygon() is actually faster than texture_
 #include "low_level_textures.h"
 #include "render.h"
 #include "Rasterizer_SW.h"
+#include "RenderProfile.h"
 
 #include <stdlib.h>
 #include <limits.h>
+#include <string.h>
 
 #include "preferences.h"
 #include "SW_Texture_Extras.h"
@@ -170,16 +172,6 @@ static void calculate_shading_table(void * &result,view_data *view, void *shadin
 	} 
 }
 
-/* ---------- globals */
-
-/* these tables are used by the polygon rasterizer (to store the x-coordinates of the left and
-	right lines of the current polygon), the trapezoid rasterizer (to store the y-coordinates
-	of the top and bottom of the current trapezoid) and the rectangle mapper (for its
-	vertical and if necessary horizontal distortion tables).  these are not necessary as
-	globals, just as global storage. */
-static short *scratch_table0 = NULL, *scratch_table1 = NULL;
-static void *precalculation_table = NULL;
-
 /* ---------- private prototypes */
 
 static void _pretexture_horizontal_polygon_lines(struct polygon_definition *polygon,
@@ -197,17 +189,30 @@ static void _prelandscape_horizontal_polygon_lines(struct polygon_definition *po
 	struct bitmap_definition *screen, struct view_data *view, struct _horizontal_polygon_line_data *data,
 	short y0, short *x0_table, short *x1_table, short line_count);
 
+static bool polygon_overlaps_band(struct polygon_definition *polygon, short left, short right);
+static void clip_horizontal_polygon_lines(struct _horizontal_polygon_line_data *data,
+	short *x0_table, short *x1_table, short line_count, short left, short right, bool clip_source_y);
+static bool clip_vertical_polygon_lines(struct _vertical_polygon_data *data,
+	short *&y0_table, short *&y1_table, short left, short right);
+static void count_polygon_lines(short *start_table, short *end_table, short line_count);
+
 /* ---------- code */
 
-/* set aside memory at launch for two line tables (remember, we precalculate all the y-values
-	for trapezoids and two lines worth of x-values for polygons before mapping them) */
-void allocate_texture_tables(
-	void)
+/* these tables are used by the polygon rasterizer (to store the x-coordinates of the left and
+	right lines of the current polygon), the trapezoid rasterizer (to store the y-coordinates
+	of the top and bottom of the current trapezoid) and the rectangle mapper (for its
+	vertical and if necessary horizontal distortion tables).  set aside memory for two line
+	tables (remember, we precalculate all the y-values for trapezoids and two lines worth of
+	x-values for polygons before mapping them) */
+Rasterizer_SW_Class::Rasterizer_SW_Class() :
+	view(NULL), screen(NULL), band_left(0), band_right(SHRT_MAX),
+	scratch_table0_storage(MAXIMUM_SCRATCH_TABLE_ENTRIES),
+	scratch_table1_storage(MAXIMUM_SCRATCH_TABLE_ENTRIES),
+	precalculation_table_storage(MAXIMUM_PRECALCULATION_TABLE_ENTRY_SIZE*MAXIMUM_SCRATCH_TABLE_ENTRIES)
 {
-	scratch_table0= new short[MAXIMUM_SCRATCH_TABLE_ENTRIES];
-	scratch_table1= new short[MAXIMUM_SCRATCH_TABLE_ENTRIES];
-	precalculation_table= (void*)new char[MAXIMUM_PRECALCULATION_TABLE_ENTRY_SIZE*MAXIMUM_SCRATCH_TABLE_ENTRIES];
-	fc_assert(scratch_table0&&scratch_table1&&precalculation_table);
+	scratch_table0= &scratch_table0_storage[0];
+	scratch_table1= &scratch_table1_storage[0];
+	precalculation_table= &precalculation_table_storage[0];
 }
 
 void Rasterizer_SW_Class::texture_horizontal_polygon(polygon_definition& textured_polygon)
@@ -237,6 +242,9 @@ void Rasterizer_SW_Class::texture_horizontal_polygon(polygon_definition& texture
 		else if (vertices[vertex].y>vertices[lowest_vertex].y) lowest_vertex= vertex;
 	}
 
+	/* dont bother with polygons entirely outside our band of the screen */
+	if (!polygon_overlaps_band(polygon, band_left, band_right)) return;
+
 	/* if this polygon is not a horizontal line, draw it */
 	if (highest_vertex!=lowest_vertex)
 	{
@@ -322,6 +330,14 @@ void Rasterizer_SW_Class::texture_horizontal_polygon(polygon_definition& texture
 			default:
 				VHALT_DEBUG(csprintf(temporary, "horizontal_polygons dont support mode #%d", polygon->transfer_mode));
 		}
+
+		/* confine every line to our band of the screen */
+		if (band_left>0 || band_right<screen->width)
+		{
+			clip_horizontal_polygon_lines((struct _horizontal_polygon_line_data *)precalculation_table, left_table, right_table,
+				aggregate_total_line_count, band_left, band_right, polygon->transfer_mode==_textured_transfer);
+		}
+		count_polygon_lines(left_table, right_table, aggregate_total_line_count);
 		
 		/* render all lines */
 		switch (bit_depth)
@@ -457,6 +473,9 @@ void Rasterizer_SW_Class::texture_vertical_polygon(polygon_definition& textured_
 		}
 	}
 
+	/* dont bother with polygons entirely outside our band of the screen */
+	if (!polygon_overlaps_band(polygon, band_left, band_right)) return;
+
 	/* if this polygon is not a vertical line, draw it */
 	if (highest_vertex!=lowest_vertex)
 	{
@@ -529,6 +548,14 @@ void Rasterizer_SW_Class::texture_vertical_polygon(polygon_definition& textured_
               _pretexture_vertical_polygon_lines(polygon, screen, view, (struct _vertical_polygon_data *)precalculation_table, vertices[highest_vertex].x, left_table, right_table, aggregate_total_line_count);
           }
           else VHALT_DEBUG(csprintf(temporary, "vertical_polygons dont support mode #%d", polygon->transfer_mode));
+
+		/* confine the polygon to our band of the screen */
+		if ((band_left>0 || band_right<screen->width) &&
+			!clip_vertical_polygon_lines((struct _vertical_polygon_data *)precalculation_table, left_table, right_table, band_left, band_right))
+		{
+			return;
+		}
+		count_polygon_lines(left_table, right_table, ((struct _vertical_polygon_data *)precalculation_table)->width);
           
 		/* render all lines */
 		switch (bit_depth)
@@ -667,6 +694,10 @@ void Rasterizer_SW_Class::texture_rectangle(rectangle_definition& textured_recta
 		if (rectangle->clip_right>screen->width) rectangle->clip_right= screen->width;
 		if (rectangle->clip_top<0) rectangle->clip_top= 0;
 		if (rectangle->clip_bottom>screen->height) rectangle->clip_bottom= screen->height;
+
+		/* ...and our band of the screen */
+		if (rectangle->clip_left<band_left) rectangle->clip_left= band_left;
+		if (rectangle->clip_right>band_right) rectangle->clip_right= band_right;
 	
 		/* subsume left and right sides of the rectangle into clipping parameters */
 		if (rectangle->clip_left<rectangle->x0) rectangle->clip_left= rectangle->x0;
@@ -803,6 +834,7 @@ void Rasterizer_SW_Class::texture_rectangle(rectangle_definition& textured_recta
 					fc_assert(y0<=screen->height);
 					fc_assert(y1<=screen->height);
 				}
+				count_polygon_lines(scratch_table0, scratch_table1, header->width);
 		
 				switch (bit_depth)
 				{
@@ -1169,6 +1201,107 @@ static void _prelandscape_horizontal_polygon_lines(
 	}
 }
 
+/* the screen columns a polygon covers run from its leftmost vertex up to (not including) its rightmost */
+static bool polygon_overlaps_band(
+	struct polygon_definition *polygon,
+	short left,
+	short right)
+{
+	short vertex;
+	short x0= SHRT_MAX, x1= SHRT_MIN;
+
+	for (vertex= 0; vertex<polygon->vertex_count; ++vertex)
+	{
+		x0= MIN(x0, polygon->vertices[vertex].x);
+		x1= MAX(x1, polygon->vertices[vertex].x);
+	}
+
+	return x0<right && x1>left;
+}
+
+/* moves the start of each precalculated line right to the band, advancing the texture
+	coordinates exactly as many steps as the line mapper would have (the coordinates wrap
+	modulo 2^32 either way, so the pixels come out the same), and cuts off what runs past
+	it; the landscape mappers source_y is a row, not a coordinate, and stays put */
+static void clip_horizontal_polygon_lines(
+	struct _horizontal_polygon_line_data *data,
+	short *x0_table,
+	short *x1_table,
+	short line_count,
+	short left,
+	short right,
+	bool clip_source_y)
+{
+	while ((line_count-= 1)>=0)
+	{
+		if (*x0_table<left)
+		{
+			uint32 delta= left-*x0_table;
+			
+			data->source_x+= delta*data->source_dx;
+			if (clip_source_y) data->source_y+= delta*data->source_dy;
+			*x0_table= left;
+		}
+		if (*x1_table>right) *x1_table= right;
+		if (*x1_table<*x0_table) *x1_table= *x0_table;
+		
+		data+= 1;
+		x0_table+= 1;
+		x1_table+= 1;
+	}
+}
+
+/* drops the precalculated columns outside the band; each column was calculated on its own,
+	so the ones left are untouched.  returns false if theres nothing left to draw */
+static bool clip_vertical_polygon_lines(
+	struct _vertical_polygon_data *data,
+	short *&y0_table,
+	short *&y1_table,
+	short left,
+	short right)
+{
+	struct _vertical_polygon_line_data *line= (struct _vertical_polygon_line_data *) (data+1);
+	short skip= MAX(left-data->x0, 0);
+	short width= MIN(data->x0+data->width, right) - (data->x0+skip);
+	
+	if (width<=0) return false;
+	
+	if (skip)
+	{
+		memmove(line, line+skip, width*sizeof(struct _vertical_polygon_line_data));
+		y0_table+= skip;
+		y1_table+= skip;
+		data->x0+= skip;
+	}
+	data->width= width;
+	
+	return true;
+}
+
+/* for the renderer profile: each line is a span, each pixel on it a texel fetched */
+static void count_polygon_lines(
+	short *start_table,
+	short *end_table,
+	short line_count)
+{
+	if (render_profiling)
+	{
+		int32 span_count= 0, texel_count= 0;
+		short line;
+		
+		for (line= 0; line<line_count; ++line)
+		{
+			if (end_table[line]>start_table[line])
+			{
+				span_count+= 1;
+				texel_count+= end_table[line]-start_table[line];
+			}
+		}
+		render_profile_count(_render_count_spans_drawn, span_count);
+		render_profile_count(_render_count_texels_fetched, texel_count);
+	}
+}
+
 /* y0<y1; this is for vertical polygons */
 static short *build_x_table(
 	short *table,
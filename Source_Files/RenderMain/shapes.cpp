@@ -109,12 +109,14 @@ Jan 17, 2001 (Loren Petrich):
 #include "InfoTree.h"
 
 #include "Packing.h"
+#include "crc.h"
 #include "SW_Texture_Extras.h"
 
 #include <SDL_rwops.h>
+#include <SDL_atomic.h>
+#include <SDL_thread.h>
 #include <memory>
 
-#include <boost/shared_ptr.hpp>
 
 #include "Plugins.h"
 
@@ -173,6 +175,9 @@ short number_of_shading_tables, shading_table_fractional_bits, shading_table_siz
 static OpenedFile ShapesFile;
 static OpenedResourceFile M1ShapesFile;
 
+// names the shading table cache files; 0 turns the cache off
+static uint32 shapes_file_checksum= 0;
+
 static enum {
 	M1_SHAPES_VERSION = 1,
 	M2_SHAPES_VERSION
@@ -208,7 +213,9 @@ static bool collection_loaded(struct collection_header *header);
 static void unload_collection(struct collection_header *header);
 static void unlock_collection(struct collection_header *header);
 static void lock_collection(struct collection_header *header);
-static bool load_collection(short collection_index, bool strip);
+static bool read_collection_data(short collection_index, std::vector<uint8>& data);
+static collection_definition *decode_collection(const std::vector<uint8>& data, int version);
+static bool install_collection(short collection_index, collection_definition *cd, bool strip);
 
 static void shutdown_shape_handler(void);
 static void close_shapes_file(void);
@@ -745,93 +752,118 @@ static void allocate_shading_tables(short collection_index, bool strip)
 
 /*
  *  Load collection
+ *
+ *  Each collection is read from disk in one piece on the main thread, then decoded from memory;
+ *  decoding touches nothing but its own buffer, so load_collections() runs it on worker threads.
  */
 
-static bool load_collection(short collection_index, bool strip)
+static bool read_collection_data(short collection_index, std::vector<uint8>& data)
 {
-	SDL_RWops* p;
-	boost::shared_ptr<SDL_RWops> m1_p; // automatic deallocation
-	LoadedResource r;
-	int32 src_offset;
-
 	collection_header *header = get_collection_header(collection_index);
-	
+
 	if (shapes_file_version == M1_SHAPES_VERSION)
 	{
 		// Collections are stored in .256 resources
+		LoadedResource r;
 		if (!M1ShapesFile.Get('.', '2', '5', '6', 128 + collection_index, r))
 		{
 			return false;
 		}
 
-		m1_p.reset(SDL_RWFromConstMem(r.GetPointer(), r.GetLength()), SDL_FreeRW);
-		p = m1_p.get();
-		src_offset = 0;
+		uint8 *resource_data = (uint8 *) r.GetPointer();
+		data.assign(resource_data, resource_data + r.GetLength());
 	}
 	else
 	{
 		// Get offset and length of data in source file from header
-		
+		int32 src_offset, src_length;
 		if (bit_depth == 8 || header->offset16 == -1) {
 			if (header->offset == -1)
 			{
 				return false;
 			}
 			src_offset = header->offset;
+			src_length = header->length;
 		} else {
 			src_offset = header->offset16;
+			src_length = header->length16;
 		}
 
-		p = ShapesFile.GetRWops();
-		ShapesFile.SetPosition(0);
-		src_offset += SDL_RWtell(p);
+		if (src_length <= 0)
+			return false;
+
+		data.resize(src_length);
+		if (!ShapesFile.SetPosition(src_offset) || !ShapesFile.Read(src_length, &data[0]))
+		{
+			data.clear();
+			return false;
+		}
 	}
 
+	return !data.empty();
+}
+
+static collection_definition *decode_collection(const std::vector<uint8>& data, int version)
+{
+	SDL_RWops *p = SDL_RWFromConstMem(&data[0], data.size());
+	if (!p)
+		return NULL;
+
 	// Read collection definition
-	std::auto_ptr<collection_definition> cd(new collection_definition);
-	SDL_RWseek(p, src_offset, RW_SEEK_SET);
-	load_collection_definition(cd.get(), p);
-	header->status &= ~markPATCHED;
+	collection_definition *cd = new collection_definition;
+	load_collection_definition(cd, p);
 
 	// Convert CLUTS
-	SDL_RWseek(p, src_offset + cd->color_table_offset, RW_SEEK_SET);
+	SDL_RWseek(p, cd->color_table_offset, RW_SEEK_SET);
 	load_clut(&cd->color_tables[0], cd->clut_count * cd->color_count, p);
 
 	// Convert high-level shape definitions
-	SDL_RWseek(p, src_offset + cd->high_level_shape_offset_table_offset, RW_SEEK_SET);
+	SDL_RWseek(p, cd->high_level_shape_offset_table_offset, RW_SEEK_SET);
 
 	std::vector<uint32> t(cd->high_level_shape_count);
 	SDL_RWread(p, &t[0], sizeof(uint32), cd->high_level_shape_count);
 	byte_swap_memory(&t[0], _4byte, cd->high_level_shape_count);
 	for (int i = 0; i < cd->high_level_shape_count; i++) {
-		SDL_RWseek(p, src_offset + t[i], RW_SEEK_SET);
+		SDL_RWseek(p, t[i], RW_SEEK_SET);
 		load_high_level_shape(cd->high_level_shapes[i], p);
 	}
 
 	// Convert low-level shape definitions
-	SDL_RWseek(p, src_offset + cd->low_level_shape_offset_table_offset, RW_SEEK_SET);
+	SDL_RWseek(p, cd->low_level_shape_offset_table_offset, RW_SEEK_SET);
 	t.resize(cd->low_level_shape_count);
 	SDL_RWread(p, &t[0], sizeof(uint32), cd->low_level_shape_count);
 	byte_swap_memory(&t[0], _4byte, cd->low_level_shape_count);
 
 	for (int i = 0; i < cd->low_level_shape_count; i++) {
-		SDL_RWseek(p, src_offset + t[i], RW_SEEK_SET);
+		SDL_RWseek(p, t[i], RW_SEEK_SET);
 		load_low_level_shape(&cd->low_level_shapes[i], p);
 	}
 
 	// Convert bitmap definitions
-	SDL_RWseek(p, src_offset + cd->bitmap_offset_table_offset, RW_SEEK_SET);
+	SDL_RWseek(p, cd->bitmap_offset_table_offset, RW_SEEK_SET);
 	t.resize(cd->bitmap_count);
 	SDL_RWread(p, &t[0], sizeof(uint32), cd->bitmap_count);
 	byte_swap_memory(&t[0], _4byte, cd->bitmap_count);
 
 	for (int i = 0; i < cd->bitmap_count; i++) {
-		SDL_RWseek(p, src_offset + t[i], RW_SEEK_SET);
-		load_bitmap(cd->bitmaps[i], p, shapes_file_version);
+		SDL_RWseek(p, t[i], RW_SEEK_SET);
+		load_bitmap(cd->bitmaps[i], p, version);
 	}
 
-	header->collection = cd.release();
-	
+	SDL_RWclose(p);
+	return cd;
+}
+
+static bool install_collection(short collection_index, collection_definition *cd, bool strip)
+{
+	collection_header *header = get_collection_header(collection_index);
+
+	if (!cd)
+		return false;
+
+	header->collection = cd;
+	header->status &= ~markPATCHED;
+
 	if (strip) {
 		//!! don't know what to do
 		fprintf(stderr, "Stripped shapes not implemented\n");
@@ -839,7 +871,7 @@ static bool load_collection(short collection_index, bool strip)
 	}
 
 	allocate_shading_tables(collection_index, strip);
-	
+
 	if (header->shading_tables == NULL) {
 		delete header->collection;
 		header->collection = NULL;
@@ -848,8 +880,60 @@ static bool load_collection(short collection_index, bool strip)
 
 	// Everything OK
 	return true;
-}	
-			
+}
+
+struct collection_decode_job
+{
+	short collection_index;
+	std::vector<uint8> data;
+	collection_definition *definition;
+};
+
+struct collection_decode_queue
+{
+	std::vector<collection_decode_job> *jobs;
+	int version;
+	SDL_atomic_t next_job;
+};
+
+static int decode_collections_thread(void *p)
+{
+	collection_decode_queue *queue = (collection_decode_queue *) p;
+
+	int job;
+	while ((job = SDL_AtomicAdd(&queue->next_job, 1)) < (int) queue->jobs->size())
+	{
+		collection_decode_job& j = (*queue->jobs)[job];
+		j.definition = j.data.empty() ? NULL : decode_collection(j.data, queue->version);
+		std::vector<uint8>().swap(j.data);
+	}
+
+	return 0;
+}
+
+// The calling thread decodes too, alongside one helper per additional CPU
+static void decode_collections(std::vector<collection_decode_job>& jobs, int version)
+{
+	collection_decode_queue queue;
+	queue.jobs = &jobs;
+	queue.version = version;
+	SDL_AtomicSet(&queue.next_job, 0);
+
+	int helper_count = std::min<int>(SDL_GetCPUCount(), jobs.size()) - 1;
+	std::vector<SDL_Thread *> helpers;
+	for (int i = 0; i < helper_count; i++)
+	{
+		SDL_Thread *helper = SDL_CreateThread(decode_collections_thread, "load_collections_decodeThread", &queue);
+		if (helper)
+			helpers.push_back(helper);
+	}
+
+	decode_collections_thread(&queue);
+
+	for (size_t i = 0; i < helpers.size(); i++)
+		SDL_WaitThread(helpers[i], NULL);
+}
+
 
 /*
  *  Unload collection
@@ -1033,6 +1117,7 @@ void initialize_shape_handler()
 
 void open_shapes_file(FileSpecifier& File)
 {
+	shapes_file_checksum = 0;
 	if (File.Open(M1ShapesFile) && M1ShapesFile.Check('.','2','5','6',128))
 	{
 		shapes_file_version = M1_SHAPES_VERSION;
@@ -1074,6 +1159,12 @@ void open_shapes_file(FileSpecifier& File)
 		
 		assert((S - CollHdrStream) == Count*SIZEOF_collection_header);
 		
+		// The header table holds every collection's offset and length, so together with the
+		// file length it stands in for a checksum of the whole file without reading it all
+		int32 file_length= 0;
+		ShapesFile.GetLength(file_length);
+		shapes_file_checksum= calculate_data_crc(CollHdrStream, Size) ^ static_cast<uint32>(file_length);
+
 		delete []CollHdrStream;
 		
 	}
@@ -1407,7 +1498,9 @@ void load_collections(
 		}
 	}
 	
-	/* ... then go back through the list of collections and load any that we were asked to */
+	/* ... then go back through the list of collections and read any that we were asked to
+		load; they're all decoded together afterwards */
+	std::vector<collection_decode_job> jobs;
 	for (collection_index= 0, header= collection_headers; collection_index<MAXIMUM_COLLECTIONS; ++collection_index, ++header)
 	{
 //		if (with_progress_bar)
@@ -1423,19 +1516,32 @@ void load_collections(
 		{
 			if (header->status&markLOAD)
 			{
-				/* load and decompress collection */
-				if (!load_collection(collection_index, (header->status&markSTRIP) ? true : false))
-				{
-					if (shapes_file_version != M1_SHAPES_VERSION)
-					{
-						alert_out_of_memory();
-					}
-				}
-//				OGL_LoadModelsImages(collection_index);
+				jobs.push_back(collection_decode_job());
+				jobs.back().collection_index= collection_index;
+				jobs.back().definition= NULL;
+				read_collection_data(collection_index, jobs.back().data);
 			}
 		}
-		
-		/* clear action flags */
+	}
+
+	decode_collections(jobs, shapes_file_version);
+
+	for (size_t i= 0; i<jobs.size(); ++i)
+	{
+		header= get_collection_header(jobs[i].collection_index);
+		if (!install_collection(jobs[i].collection_index, jobs[i].definition, (header->status&markSTRIP) ? true : false))
+		{
+			if (shapes_file_version != M1_SHAPES_VERSION)
+			{
+				alert_out_of_memory();
+			}
+		}
+//		OGL_LoadModelsImages(collection_index);
+	}
+
+	/* clear action flags */
+	for (collection_index= 0, header= collection_headers; collection_index<MAXIMUM_COLLECTIONS; ++collection_index, ++header)
+	{
 		header->status= markNONE;
 		header->flags= 0;
 	}
@@ -1489,14 +1595,18 @@ void load_replacement_collections()
 {
 	struct collection_header *header;
 	short collection_index;
+	std::vector<short> collections;
 
 	for (collection_index= 0, header= collection_headers; collection_index < MAXIMUM_COLLECTIONS; ++collection_index, ++header)
 	{
 		if (collection_loaded(header))
 		{
-			OGL_LoadModelsImages(collection_index);
+			collections.push_back(collection_index);
 		}
 	}
+
+	// All together, so their textures load in parallel
+	OGL_LoadModelsImages(collections);
 }
 
 #endif
@@ -1588,6 +1698,101 @@ static short find_or_add_color(
 	return (*color_count)++;
 }
 
+/*
+ *  Shading table cache
+ *
+ *  16- and 32-bit shading tables take a SDL_MapRGB() per entry (256 tables of 256 entries per
+ *  clut at 32-bit) but depend only on a collection's colors and the pixel format, so they're
+ *  kept in the cache directory between runs.  The file name comes from the shapes file and
+ *  bit depth; the file itself starts with a hash of every input to the tables, so patches,
+ *  MML tints or a new pixel format just mean a rebuild.
+ */
+
+template<class T> static void append_shading_key(std::vector<uint8>& key, const T& value)
+{
+	const uint8 *bytes = (const uint8 *) &value;
+	key.insert(key.end(), bytes, bytes + sizeof(T));
+}
+
+static uint32 shading_table_inputs_hash(short collection_index, bool is_opengl)
+{
+	collection_definition *collection = get_collection_definition(collection_index);
+	SDL_PixelFormat *fmt = (bit_depth == 16) ? &pixel_format_16 : &pixel_format_32;
+
+	std::vector<uint8> key;
+	// also catches a cache directory shared between machines of different byte order
+	append_shading_key(key, uint32(0x01020304));
+	append_shading_key(key, bit_depth);
+	append_shading_key(key, number_of_shading_tables);
+	append_shading_key(key, is_opengl);
+	append_shading_key(key, fmt->BytesPerPixel);
+	append_shading_key(key, fmt->Rmask);
+	append_shading_key(key, fmt->Gmask);
+	append_shading_key(key, fmt->Bmask);
+	append_shading_key(key, fmt->Amask);
+	append_shading_key(key, collection->color_count);
+	append_shading_key(key, collection->clut_count);
+
+	// not .value, which update_color_environment() rewrites in place
+	for (size_t i = 0; i < collection->color_tables.size(); ++i)
+	{
+		const rgb_color_value& color = collection->color_tables[i];
+		append_shading_key(key, color.flags);
+		append_shading_key(key, color.red);
+		append_shading_key(key, color.green);
+		append_shading_key(key, color.blue);
+	}
+
+	return calculate_data_crc(&key[0], key.size());
+}
+
+static void get_shading_cache_file(short collection_index, FileSpecifier& file)
+{
+	char name[64];
+	snprintf(name, sizeof(name), "Shading %08x-%d-%02d", shapes_file_checksum, bit_depth, collection_index);
+	file.SetToImageCacheDir();
+	file.AddPart(name);
+}
+
+static bool read_cached_shading_tables(short collection_index, uint32 inputs_hash)
+{
+	int32 size = get_shading_table_size(collection_index) * get_collection_definition(collection_index)->clut_count;
+
+	FileSpecifier file;
+	get_shading_cache_file(collection_index, file);
+
+	OpenedFile f;
+	if (!file.Exists() || !file.Open(f))
+		return false;
+
+	uint32 cached_hash;
+	int32 cached_size;
+	return f.Read(sizeof(cached_hash), &cached_hash) && cached_hash == inputs_hash &&
+		f.Read(sizeof(cached_size), &cached_size) && cached_size == size &&
+		f.Read(size, get_collection_shading_tables(collection_index, 0));
+}
+
+static void write_cached_shading_tables(short collection_index, uint32 inputs_hash)
+{
+	int32 size = get_shading_table_size(collection_index) * get_collection_definition(collection_index)->clut_count;
+
+	FileSpecifier file;
+	get_shading_cache_file(collection_index, file);
+
+	OpenedFile f;
+	if (!file.Open(f, true))
+		return;
+
+	if (!f.Write(sizeof(inputs_hash), &inputs_hash) ||
+	    !f.Write(sizeof(size), &size) ||
+	    !f.Write(size, get_collection_shading_tables(collection_index, 0)))
+	{
+		// a short file would fail the size check anyway; don't leave it lying around
+		f.Close();
+		file.Delete();
+	}
+}
+
 static void update_color_environment(
 	bool is_opengl)
 {
@@ -1645,11 +1850,16 @@ static void update_color_environment(
 				remap_bitmap(bitmap, remapping_table);
 			}
 			
+			/* 16- and 32-bit shading tables come from the disk cache when they can */
+			short collection_bit_depth= collection->type==_interface_collection ? 8 : bit_depth;
+			bool use_shading_cache= collection_bit_depth!=8 && shapes_file_checksum!=0;
+			uint32 shading_inputs_hash= use_shading_cache ? shading_table_inputs_hash(collection_index, is_opengl) : 0;
+			bool shading_tables_cached= use_shading_cache && read_cached_shading_tables(collection_index, shading_inputs_hash);
+
 			/* build a shading table for each clut in this collection */
 			for (clut_index= 0; clut_index<collection->clut_count; ++clut_index)
 			{
 				void *primary_shading_table= get_collection_shading_tables(collection_index, 0);
-				short collection_bit_depth= collection->type==_interface_collection ? 8 : bit_depth;
 
 				if (clut_index)
 				{
@@ -1681,11 +1891,11 @@ static void update_color_environment(
 							break;
 						
 						case 16:
-							build_shading_tables16(colors, color_count, (pixel16 *)alternate_shading_table, shading_remapping_table, is_opengl); break;
+							if (!shading_tables_cached) build_shading_tables16(colors, color_count, (pixel16 *)alternate_shading_table, shading_remapping_table, is_opengl);
 							break;
 						
 						case 32:
-							build_shading_tables32(colors, color_count, (pixel32 *)alternate_shading_table, shading_remapping_table, is_opengl); break;
+							if (!shading_tables_cached) build_shading_tables32(colors, color_count, (pixel32 *)alternate_shading_table, shading_remapping_table, is_opengl);
 							break;
 						
 						default:
@@ -1699,8 +1909,8 @@ static void update_color_environment(
 					switch (collection_bit_depth)
 					{
 					case 8: build_shading_tables8(colors, color_count, (unsigned char *)primary_shading_table); break;
-					case 16: build_shading_tables16(colors, color_count, (pixel16 *)primary_shading_table, (byte *) NULL, is_opengl); break;
-					case 32: build_shading_tables32(colors, color_count,  (pixel32 *)primary_shading_table, (byte *) NULL, is_opengl); break;
+					case 16: if (!shading_tables_cached) build_shading_tables16(colors, color_count, (pixel16 *)primary_shading_table, (byte *) NULL, is_opengl); break;
+					case 32: if (!shading_tables_cached) build_shading_tables32(colors, color_count,  (pixel32 *)primary_shading_table, (byte *) NULL, is_opengl); break;
 						default:
 							assert(false);
 							break;
@@ -1708,6 +1918,9 @@ static void update_color_environment(
 				}
 			}
 			
+			if (use_shading_cache && !shading_tables_cached)
+				write_cached_shading_tables(collection_index, shading_inputs_hash);
+
 			build_collection_tinting_table(colors, color_count, collection_index, is_opengl);
 			
 			/* 8-bit interface, non-8-bit main window; remember interface CLUT separately */
@@ -43,6 +43,9 @@
 #include "world.h"
 #include "map.h"
 #include "render.h"
+#include "low_level_textures_simd.h"
+#include "RenderProfile.h"
+#include "monster_think.h"
 #include "shell.h"
 #include "interface.h"
 #include "player.h"
@@ -204,6 +207,12 @@ void Screen::Initialize(screen_mode_data* mode)
 		world_view->horizontal_scale = 1;
 		world_view->vertical_scale = 1;
 		world_view->tunnel_vision_active = false;
+
+		register_render_profile_commands();
+		register_monster_think_commands();
+
+		set_software_render_threads(graphics_preferences->software_multithreaded ? 0 : 1);
+		OGL_RegisterModelSortCommands();
 		
 		SDL_DisplayMode desktop;
 		SDL_GetCurrentDisplayMode(0, &desktop);
@@ -1114,6 +1123,9 @@ static bool clear_next_screen = false;
 
 void render_screen(short ticks_elapsed)
 {
+	end_render_profile_frame();
+	RenderProfileTimer total_timer(_render_stage_total);
+
 	// Make whatever changes are necessary to the world_view structure based on whichever player is frontmost
 	world_view->ticks_elapsed = ticks_elapsed;
 	world_view->tick_count = dynamic_world->tick_count;
@@ -1305,31 +1317,36 @@ void render_screen(short ticks_elapsed)
 		(MapIsTranslucent || Screen::instance()->lua_hud()))
         clear_screen_margin();
     
-	// Render crosshairs
-	if (!world_view->overhead_map_active && !world_view->terminal_mode_active)
-	  if (NetAllowCrosshair())
-	    if (Crosshairs_IsActive())
+	{
+		RenderProfileTimer timer(_render_stage_hud);
+		
+		// Render crosshairs
+		if (!world_view->overhead_map_active && !world_view->terminal_mode_active)
+		  if (NetAllowCrosshair())
+		    if (Crosshairs_IsActive())
 #ifdef HAVE_OPENGL
-			if (!OGL_RenderCrosshairs())
+				if (!OGL_RenderCrosshairs())
 #endif
-				Crosshairs_Render(world_pixels);
+					Crosshairs_Render(world_pixels);
 
-	SDL_Surface *disp_pixels = world_pixels;
-	if (world_view->overhead_map_active)
-		disp_pixels = Map_Buffer;
+		SDL_Surface *disp_pixels = world_pixels;
+		if (world_view->overhead_map_active)
+			disp_pixels = Map_Buffer;
 	
-	// Display FPS and position
-	if (!world_view->terminal_mode_active) {
-	  extern bool chat_input_mode;
-	  if (!chat_input_mode){
-		update_fps_display(disp_pixels);
-	  }
-	  DisplayPosition(disp_pixels);
-	  DisplayNetMicStatus(disp_pixels);
-	  DisplayScores(disp_pixels);
+		// Display FPS and position
+		if (!world_view->terminal_mode_active) {
+		  extern bool chat_input_mode;
+		  if (!chat_input_mode){
+			update_fps_display(disp_pixels);
+		  }
+		  DisplayRenderProfile(disp_pixels);
+		  DisplayPosition(disp_pixels);
+		  DisplayNetMicStatus(disp_pixels);
+		  DisplayScores(disp_pixels);
+		}
+		DisplayMessages(disp_pixels);
+		DisplayInputLine(disp_pixels);
 	}
-	DisplayMessages(disp_pixels);
-	DisplayInputLine(disp_pixels);
 	
 #ifdef HAVE_OPENGL
 	// Set OpenGL viewport to whole window (so HUD will be in the right position)
@@ -1341,6 +1358,8 @@ void render_screen(short ticks_elapsed)
 	// then blit the software rendering to the screen
 	if (screen_mode.acceleration != _no_acceleration) {
 #ifdef HAVE_OPENGL
+		RenderProfileTimer timer(_render_stage_hud);
+		
 		if (Screen::instance()->hud()) {
 			if (Screen::instance()->lua_hud())
 				Lua_DrawHUD(ticks_elapsed);
@@ -1363,57 +1382,154 @@ void render_screen(short ticks_elapsed)
 
 #endif
 	} else {
-		// Update world window
-		if (!world_view->terminal_mode_active &&
-			(!world_view->overhead_map_active || MapIsTranslucent))
-			update_screen(BufferRect, ViewRect, HighResolution);
+		{
+			RenderProfileTimer timer(_render_stage_update_screen);
+			
+			// Update world window
+			if (!world_view->terminal_mode_active &&
+				(!world_view->overhead_map_active || MapIsTranslucent))
+				update_screen(BufferRect, ViewRect, HighResolution);
 		
-		// Update map
-		if (world_view->overhead_map_active) {
-			SDL_Rect src_rect = { 0, 0, MapRect.w, MapRect.h };
-			DrawSurface(Map_Buffer, MapRect, src_rect);
+			// Update map
+			if (world_view->overhead_map_active) {
+				SDL_Rect src_rect = { 0, 0, MapRect.w, MapRect.h };
+				DrawSurface(Map_Buffer, MapRect, src_rect);
+			}
 		}
 		
-		// Update HUD
-		if (Screen::instance()->lua_hud())
 		{
-			Lua_DrawHUD(ticks_elapsed);
-		}
-		else if (HUD_RenderRequest) {
-			SDL_Rect src_rect = { 0, 320, 640, 160 };
-			DrawSurface(HUD_Buffer, HUD_DestRect, src_rect);
-			HUD_RenderRequest = false;
-		}
+			RenderProfileTimer timer(_render_stage_hud);
+			
+			// Update HUD
+			if (Screen::instance()->lua_hud())
+			{
+				Lua_DrawHUD(ticks_elapsed);
+			}
+			else if (HUD_RenderRequest) {
+				SDL_Rect src_rect = { 0, 320, 640, 160 };
+				DrawSurface(HUD_Buffer, HUD_DestRect, src_rect);
+				HUD_RenderRequest = false;
+			}
 
-		// Update terminal
-		if (world_view->terminal_mode_active) {
-			if (Term_RenderRequest || Screen::instance()->lua_hud()) {
-				SDL_Rect src_rect = { 0, 0, Term_Buffer->w, Term_Buffer->h };
-				DrawSurface(Term_Buffer, TermRect, src_rect);
-				Term_RenderRequest = false;
+			// Update terminal
+			if (world_view->terminal_mode_active) {
+				if (Term_RenderRequest || Screen::instance()->lua_hud()) {
+					SDL_Rect src_rect = { 0, 0, Term_Buffer->w, Term_Buffer->h };
+					DrawSurface(Term_Buffer, TermRect, src_rect);
+					Term_RenderRequest = false;
+				}
 			}
 		}
 
-		if (update_full_screen || Screen::instance()->lua_hud())
 		{
-			MainScreenUpdateRect(0, 0, 0, 0);
-		}
-		else if ((!world_view->overhead_map_active || MapIsTranslucent) &&
-				 !world_view->terminal_mode_active)
-		{
-			MainScreenUpdateRects(1, &ViewRect);
+			RenderProfileTimer timer(_render_stage_update_screen);
+			
+			if (update_full_screen || Screen::instance()->lua_hud())
+			{
+				MainScreenUpdateRect(0, 0, 0, 0);
+			}
+			else if ((!world_view->overhead_map_active || MapIsTranslucent) &&
+					 !world_view->terminal_mode_active)
+			{
+				MainScreenUpdateRects(1, &ViewRect);
+			}
 		}
 	}
 
 #ifdef HAVE_OPENGL
 	// Swap OpenGL double-buffers
 	if (screen_mode.acceleration != _no_acceleration)
+	{
+		RenderProfileTimer timer(_render_stage_update_screen);
 		OGL_SwapBuffers();
+	}
 #endif
 	
 	Movie::instance()->AddFrame(Movie::FRAME_NORMAL);
 }
 
+bool benchmark_software_render(short width, short height, const std::vector<int>& thread_counts, std::vector<double>& seconds)
+{
+	assert(bit_depth == 16 || bit_depth == 32);
+	SDL_PixelFormat& f = (bit_depth == 16) ? pixel_format_16 : pixel_format_32;
+	SDL_Surface *surface = SDL_CreateRGBSurface(SDL_SWSURFACE, width, height, bit_depth, f.Rmask, f.Gmask, f.Bmask, 0);
+	if (surface == NULL)
+		alert_out_of_memory();
+
+	std::vector<byte> bitmap_storage(sizeof(struct bitmap_definition) + sizeof(pixel8 *) * height);
+	struct bitmap_definition *bitmap = (struct bitmap_definition *)&bitmap_storage[0];
+	bitmap->width = width;
+	bitmap->height = height;
+	bitmap->bytes_per_row = surface->pitch;
+	bitmap->flags = 0;
+	bitmap->bit_depth = bit_depth;
+	bitmap->row_addresses[0] = (pixel8 *)surface->pixels;
+	precalculate_bitmap_row_addresses(bitmap);
+
+	// Set up the view as render_screen() does, minus the map, terminal and chase cam
+	struct view_data view = *world_view;
+	view.ticks_elapsed = 1;
+	view.tick_count = dynamic_world->tick_count;
+	view.yaw = current_player->facing;
+	view.pitch = current_player->elevation;
+	view.maximum_depth_intensity = current_player->weapon_intensity;
+	view.shading_mode = current_player->infravision_duration ? _shading_infravision : _shading_normal;
+	view.overhead_map_active = false;
+	view.terminal_mode_active = false;
+	view.screen_width = width;
+	view.screen_height = height;
+	view.standard_screen_width = 2 * height;
+	initialize_view_data(&view);
+	view.origin = current_player->camera_location;
+	view.origin_polygon_index = current_player->camera_polygon_index;
+	view.show_weapons_in_hand = true;
+
+	// The blending and tinting mappers take the pixel format from world_pixels
+	SDL_Surface *saved_world_pixels = world_pixels;
+	world_pixels = surface;
+	int saved_threads = get_software_render_threads();
+	int saved_span_kernels = get_software_span_kernels();
+	size_t row_length = width * surface->format->BytesPerPixel;
+
+	// Everything is compared against a frame drawn on one thread with the scalar span kernels
+	std::vector<uint8> reference_frame;
+	{
+		struct view_data frame_view = view;
+		set_software_render_threads(1);
+		set_software_span_kernels(_span_kernels_scalar);
+		render_view(&frame_view, bitmap);
+		for (short y = 0; y < height; y++)
+			reference_frame.insert(reference_frame.end(), bitmap->row_addresses[y], bitmap->row_addresses[y] + row_length);
+		set_software_span_kernels(saved_span_kernels);
+	}
+
+	bool identical = true;
+	for (size_t i = 0; i < thread_counts.size(); i++)
+	{
+		// render_view() advances effects and field-of-view changes in the view it's given
+		struct view_data frame_view = view;
+		set_software_render_threads(thread_counts[i]);
+
+		// a view that's moving never gets to reuse the last frame's tree
+		invalidate_render_tree_cache();
+		Uint64 start = SDL_GetPerformanceCounter();
+		render_view(&frame_view, bitmap);
+		seconds[i] += static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+		for (short y = 0; y < height; y++)
+		{
+			if (memcmp(bitmap->row_addresses[y], &reference_frame[y * row_length], row_length) != 0)
+				identical = false;
+		}
+	}
+
+	set_software_render_threads(saved_threads);
+	world_pixels = saved_world_pixels;
+	SDL_FreeSurface(surface);
+
+	return identical;
+}
+
 /*
  *  Blit world view to screen
  */
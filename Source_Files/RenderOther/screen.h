@@ -215,6 +215,11 @@ void calculate_destination_frame(short size, bool high_resolution, Rect *frame);
 // May need to be modified for pass-through video cards like the older 3dfx ones.
 void dump_screen();
 
+// For the render benchmark: draws the current player's view in software at the given size,
+// once with each of thread_counts, adding the time each took to seconds[]; returns false if
+// any of the frames differed from one drawn on a single thread with the scalar span kernels
+bool benchmark_software_render(short width, short height, const std::vector<int>& thread_counts, std::vector<double>& seconds);
+
 // For getting and setting tunnel-vision mode
 bool GetTunnelVision();
 bool SetTunnelVision(bool TunnelVisionOn);
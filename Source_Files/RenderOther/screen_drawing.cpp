@@ -524,73 +524,31 @@ int sdl_font_info::_draw_text(SDL_Surface *s, const char *text, size_t length, i
 
 int ttf_font_info::_draw_text(SDL_Surface *s, const char *text, size_t length, int x, int y, uint32 pixel, uint16 style, bool utf8) const
 {
-	int clip_top, clip_bottom, clip_left, clip_right;
-	if (draw_clip_rect_active) {
-		clip_top = draw_clip_rect.top;
-		clip_bottom = draw_clip_rect.bottom;
-		clip_left = draw_clip_rect.left;
-		clip_right = draw_clip_rect.right;
-	} else {
-		clip_top = clip_left = 0;
-		clip_right = s->w;
-		clip_bottom = s->h;
-	}
-
 	SDL_Color c;
 	SDL_GetRGB(pixel, s->format, &c.r, &c.g, &c.b);
 	c.a = 0xff;
-	SDL_Surface *text_surface = 0;
-	if (utf8) 
-	{
-		char *temp = process_printable(text, length);
-		if (environment_preferences->smooth_text)
-			text_surface = TTF_RenderUTF8_Blended(get_ttf(style), temp, c);	
-		else
-			text_surface = TTF_RenderUTF8_Solid(get_ttf(style), temp, c);
-	}
-	else
-	{
-		uint16 *temp = process_macroman(text, length);
-		if (environment_preferences->smooth_text)
-			text_surface = TTF_RenderUNICODE_Blended(get_ttf(style), temp, c);
-		else
-			text_surface = TTF_RenderUNICODE_Solid(get_ttf(style), temp, c);
-	}
-	if (!text_surface) return 0;
-	
-	SDL_Rect dst_rect;
-	dst_rect.x = x;
-	dst_rect.y = y - TTF_FontAscent(get_ttf(style));
 
+	SDL_Rect old_clip_rect;
+	SDL_GetClipRect(s, &old_clip_rect);
 	if (draw_clip_rect_active)
 	{
-		SDL_Rect src_rect;
-		src_rect.x = 0;
-		src_rect.y = 0;
-
-		if (clip_top > dst_rect.y)
-		{
-			src_rect.y += dst_rect.y - clip_top;
-		}
-
-		if (clip_left > dst_rect.x)
-		{
-			src_rect.x += dst_rect.x - clip_left;
-		}
+		SDL_Rect clip_rect;
+		clip_rect.x = draw_clip_rect.left;
+		clip_rect.y = draw_clip_rect.top;
+		clip_rect.w = draw_clip_rect.right - draw_clip_rect.left;
+		clip_rect.h = draw_clip_rect.bottom - draw_clip_rect.top;
+		SDL_SetClipRect(s, &clip_rect);
+	}
 
-		src_rect.w = (clip_right > dst_rect.x) ? clip_right - dst_rect.x : 0;
-		src_rect.h = (clip_bottom > dst_rect.y) ? clip_bottom - dst_rect.y : 0;
+	uint16 *temp = utf8 ? process_utf8(text, length) : process_macroman(text, length);
+	int width = get_atlas(style, environment_preferences->smooth_text)->draw_text(s, temp, x, y, c);
 
-		SDL_BlitSurface(text_surface, &src_rect, s, &dst_rect);
-	}
-	else
-		SDL_BlitSurface(text_surface, NULL, s, &dst_rect);
+	if (draw_clip_rect_active)
+		SDL_SetClipRect(s, &old_clip_rect);
 
 	if (s == MainScreenSurface())
 		MainScreenUpdateRect(x, y - TTF_FontAscent(get_ttf(style)), text_width(text, style, utf8), TTF_FontHeight(get_ttf(style)));
 
-	int width = text_surface->w;
-	SDL_FreeSurface(text_surface);
 	return width;
 }
 
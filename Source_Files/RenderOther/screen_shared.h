@@ -58,6 +58,7 @@ extern SDL_Surface *world_pixels;
 #include "screen_drawing.h"
 
 #include "network_games.h"
+#include "RenderProfile.h"
 #include "Image_Blitter.h"
 #include "OGL_Blitter.h"
 
@@ -518,6 +519,40 @@ static void update_fps_display(SDL_Surface *s)
 	}
 }
 
+// The last frame's stage times and counters, stacked up from just above the FPS display
+static void DisplayRenderProfile(SDL_Surface *s)
+{
+	if (!render_profile_overlay_active()) return;
+	
+	const render_profile_frame& frame = last_render_profile_frame();
+	FontSpecifier& Font = GetOnScreenFont();
+	
+	DisplayTextDest = s;
+	DisplayTextFont = Font.Info;
+	DisplayTextStyle = Font.Style;
+	
+	short LineSpacing = Font.LineSpacing;
+	short X = LineSpacing/3;
+	short Y = s->h - LineSpacing/3;
+	if (Console::instance()->input_active()) Y -= LineSpacing;
+	if (displaying_fps) Y -= LineSpacing;
+	
+	// bottom line first
+	for (int i = NUMBER_OF_RENDER_COUNTERS - 1; i >= 0; i--)
+	{
+		sprintf(temporary, "%-12s %9d", render_profile_counter_name(i), frame.counts[i]);
+		DisplayText(X, Y, temporary);
+		Y -= LineSpacing;
+	}
+	for (int i = NUMBER_OF_RENDER_STAGES - 1; i >= 0; i--)
+	{
+		sprintf(temporary, "%-12s %6.2f ms", render_profile_stage_name(i), frame.stage_seconds[i] * 1000);
+		DisplayText(X, Y, temporary);
+		Y -= LineSpacing;
+	}
+	sprintf(temporary, "%-12s %6.2f ms", "frame", frame.frame_seconds * 1000);
+	DisplayText(X, Y, temporary);
+}
 
 static void DisplayPosition(SDL_Surface *s)
 {
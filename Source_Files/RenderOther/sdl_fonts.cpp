@@ -48,6 +48,7 @@ using std::map;
 
 #include <boost/tuple/tuple_comparison.hpp>
 #include "preferences.h" // smooth_font
+#include "RenderProfile.h"
 #include "AlephSansMono-Bold.h"
 #include "ProFontAO.h"
 
@@ -56,6 +57,13 @@ using std::map;
 #include "CourierPrimeItalic.h"
 #include "CourierPrimeBoldItalic.h"
 
+// TTF_GetFontKerningSizeGlyphs() arrived in SDL_ttf 2.0.14, along with the macro to check for it
+#ifdef SDL_TTF_VERSION_ATLEAST
+#if SDL_TTF_VERSION_ATLEAST(2, 0, 14)
+#define HAVE_TTF_KERNING_GLYPHS
+#endif
+#endif
+
 // Global variables
 typedef pair<int, int> id_and_size_t;
 typedef map<id_and_size_t, sdl_font_info *> font_list_t;
@@ -442,6 +450,10 @@ void ttf_font_info::_unload()
 {
 	for (int i = 0; i < styleUnderline; ++i)
 	{
+		delete m_atlases[i][0];
+		delete m_atlases[i][1];
+		m_atlases[i][0] = m_atlases[i][1] = 0;
+
 		ttf_font_list_t::iterator it = ttf_font_list.find(m_keys[i]);
 		if (it != ttf_font_list.end())
 		{
@@ -511,69 +523,230 @@ int sdl_font_info::_trunc_text(const char *text, int max_width, uint16 style) co
 
 // sdl_font_info::_draw_text is in screen_drawing.cpp
 
-int8 ttf_font_info::char_width(uint8 c, uint16 style) const
+static const int glyph_atlas_page_size = 512;
+
+ttf_glyph_atlas::ttf_glyph_atlas(TTF_Font *font, bool smooth) :
+	m_font(font),
+	m_smooth(smooth),
+	m_shelf_x(0),
+	m_shelf_y(0),
+	m_shelf_height(0)
 {
-	int advance;
-	TTF_GlyphMetrics(get_ttf(style), mac_roman_to_unicode(static_cast<char>(c)), 0, 0, 0, 0, &advance);
+}
 
-	return advance;
+ttf_glyph_atlas::~ttf_glyph_atlas()
+{
+	for (size_t i = 0; i < m_pages.size(); ++i)
+		SDL_FreeSurface(m_pages[i]);
 }
-uint16 ttf_font_info::_text_width(const char *text, uint16 style, bool utf8) const
+
+const ttf_glyph_atlas::glyph& ttf_glyph_atlas::find_glyph(uint16 c)
 {
-	return _text_width(text, strlen(text), style, utf8);
+	map<uint16, glyph>::iterator it = m_glyphs.find(c);
+	if (it != m_glyphs.end())
+	{
+		render_profile_count(_render_count_glyph_hits, 1);
+		return it->second;
+	}
+	render_profile_count(_render_count_glyph_misses, 1);
+
+	glyph& g = m_glyphs[c];
+	g.page = -1;
+	g.rect.x = g.rect.y = g.rect.w = g.rect.h = 0;
+	g.minx = g.advance = 0;
+	TTF_GlyphMetrics(m_font, c, &g.minx, 0, 0, 0, &g.advance);
+
+	// Rendered as a string of one, it sits in its surface just as it would in a longer
+	// string; converting gives unsmoothed glyphs alpha where they had a color key
+	uint16 text[2] = { c, 0 };
+	SDL_Color white = { 0xff, 0xff, 0xff, 0xff };
+	SDL_Surface *rendered = m_smooth ? TTF_RenderUNICODE_Blended(m_font, text, white) : TTF_RenderUNICODE_Solid(m_font, text, white);
+	if (rendered)
+	{
+		SDL_Surface *converted = SDL_ConvertSurfaceFormat(rendered, SDL_PIXELFORMAT_ARGB8888, 0);
+		if (converted)
+		{
+			add_to_page(converted, g);
+			SDL_FreeSurface(converted);
+		}
+		SDL_FreeSurface(rendered);
+	}
+
+	return g;
 }
 
-uint16 ttf_font_info::_text_width(const char *text, size_t length, uint16 style, bool utf8) const
+void ttf_glyph_atlas::add_to_page(SDL_Surface *rendered, glyph& g)
 {
-	int width = 0;
-	if (utf8)
+	// Glyphs go left to right along shelves as tall as the tallest on them
+	if (!m_pages.empty() && m_shelf_x + rendered->w > m_pages.back()->w)
 	{
-		char *temp = process_printable(text, length);
-		TTF_SizeUTF8(get_ttf(style), temp, &width, 0);
+		m_shelf_x = 0;
+		m_shelf_y += m_shelf_height;
+		m_shelf_height = 0;
 	}
-	else
+
+	if (m_pages.empty() || m_shelf_y + rendered->h > m_pages.back()->h || rendered->w > m_pages.back()->w)
 	{
-		uint16 *temp = process_macroman(text, length);
-		TTF_SizeUNICODE(get_ttf(style), temp, &width, 0);
+		SDL_Surface *page = SDL_CreateRGBSurface(SDL_SWSURFACE, max(rendered->w, glyph_atlas_page_size), max(rendered->h, glyph_atlas_page_size), 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000);
+		if (!page) return;
+		SDL_SetSurfaceBlendMode(page, SDL_BLENDMODE_BLEND);
+		m_pages.push_back(page);
+		m_shelf_x = m_shelf_y = m_shelf_height = 0;
 	}
-	
-	return width;
+
+	g.page = m_pages.size() - 1;
+	g.rect.x = m_shelf_x;
+	g.rect.y = m_shelf_y;
+	g.rect.w = rendered->w;
+	g.rect.h = rendered->h;
+
+	// Copy the alpha too, rather than blending it onto the empty page
+	SDL_Rect dst_rect = g.rect;
+	SDL_SetSurfaceBlendMode(rendered, SDL_BLENDMODE_NONE);
+	SDL_BlitSurface(rendered, NULL, m_pages.back(), &dst_rect);
+
+	m_shelf_x += rendered->w;
+	m_shelf_height = max(m_shelf_height, static_cast<int>(rendered->h));
 }
 
-int ttf_font_info::_trunc_text(const char *text, int max_width, uint16 style) const
+// What to move the pen by between the glyph before p and the one at p
+int ttf_glyph_atlas::kerning(const uint16 *text, const uint16 *p) const
 {
-	int width;
-	static uint16 temp[1024];
-	mac_roman_to_unicode(text, temp, 1024);
-	TTF_SizeUNICODE(get_ttf(style), temp, &width, 0);
-	if (width < max_width) return strlen(text);
+#ifdef HAVE_TTF_KERNING_GLYPHS
+	if (p != text && TTF_GetFontKerning(m_font))
+		return TTF_GetFontKerningSizeGlyphs(m_font, p[-1], p[0]);
+#endif
+	return 0;
+}
+
+int ttf_glyph_atlas::measure(const uint16 *text, int max_width, int *count)
+{
+	int pen = 0;
+	const uint16 *p;
+	for (p = text; *p; ++p)
+	{
+		const glyph& g = find_glyph(*p);
 
-	int num = strlen(text) - 1;
+		int next = pen + kerning(text, p) + g.advance;
+		if (p == text && g.minx < 0)
+			next -= g.minx;
+		if (next > max_width)
+			break;
+
+		pen = next;
+	}
+
+	if (count)
+		*count = p - text;
+	return pen;
+}
 
-	while (num > 0 && width > max_width)
+int ttf_glyph_atlas::draw_text(SDL_Surface *s, const uint16 *text, int x, int y, SDL_Color color)
+{
+	int top = y - TTF_FontAscent(m_font);
+	int pen = x;
+
+	for (const uint16 *p = text; *p; ++p)
 	{
-		num--;
-		temp[num] = 0x0;
-		TTF_SizeUNICODE(get_ttf(style), temp, &width, 0);
+		const glyph& g = find_glyph(*p);
+
+		pen += kerning(text, p);
+
+		// SDL_ttf moves a string right when its first glyph reaches left of the pen, and
+		// does the same to a glyph rendered on its own
+		if (p == text && g.minx < 0)
+			pen -= g.minx;
+
+		if (g.page >= 0)
+		{
+			SDL_Surface *page = m_pages[g.page];
+			SDL_SetSurfaceColorMod(page, color.r, color.g, color.b);
+
+			SDL_Rect src_rect = g.rect;
+			SDL_Rect dst_rect;
+			dst_rect.x = pen + min(g.minx, 0);
+			dst_rect.y = top;
+			dst_rect.w = g.rect.w;
+			dst_rect.h = g.rect.h;
+			SDL_BlitSurface(page, &src_rect, s, &dst_rect);
+		}
+
+		pen += g.advance;
 	}
 
-	return num;
+	return pen - x;
+}
+
+ttf_glyph_atlas *ttf_font_info::get_atlas(uint16 style, bool smooth) const
+{
+	ttf_glyph_atlas *&atlas = m_atlases[style & (styleBold | styleItalic)][smooth ? 1 : 0];
+	if (!atlas)
+		atlas = new ttf_glyph_atlas(get_ttf(style), smooth);
+
+	return atlas;
+}
+
+int8 ttf_font_info::char_width(uint8 c, uint16 style) const
+{
+	return get_atlas(style, environment_preferences->smooth_text)->char_width(mac_roman_to_unicode(static_cast<char>(c)));
+}
+uint16 ttf_font_info::_text_width(const char *text, uint16 style, bool utf8) const
+{
+	return _text_width(text, strlen(text), style, utf8);
+}
+
+// Measured with the glyph atlas _draw_text() uses, so that widths match what's drawn
+uint16 ttf_font_info::_text_width(const char *text, size_t length, uint16 style, bool utf8) const
+{
+	uint16 *temp = utf8 ? process_utf8(text, length) : process_macroman(text, length);
+	return get_atlas(style, environment_preferences->smooth_text)->text_width(temp);
+}
+
+int ttf_font_info::_trunc_text(const char *text, int max_width, uint16 style) const
+{
+	// One character for each byte, so the count is a length in text
+	static uint16 temp[1024];
+	mac_roman_to_unicode(text, temp, 1024);
+	return get_atlas(style, environment_preferences->smooth_text)->trunc_text(temp, max_width);
 }
 
 // ttf_font_info::_draw_text is in screen_drawing.cpp
 
-char *ttf_font_info::process_printable(const char *src, int len) const 
+// Decodes UTF-8 for the glyph atlas, leaving out control characters; what doesn't fit in
+// 16 bits becomes the replacement character
+uint16 *ttf_font_info::process_utf8(const char *src, int len) const
 {
-	static char dst[1024];
+	static uint16 dst[1024];
 	if (len > 1023) len = 1023;
-	char *p = dst;
-	while (*src && len-- > 0)
+	const unsigned char *p = reinterpret_cast<const unsigned char *>(src);
+	const unsigned char *end = p + len;
+	uint16 *q = dst;
+	while (p < end && *p)
 	{
-		if ((unsigned char) *src >= ' ') *p++ = *src;
-		src++;
+		uint32 c;
+		int used;
+		if (*p < 0x80) { c = *p; used = 1; }
+		else if (*p < 0xe0) { c = *p & 0x1f; used = 2; }
+		else if (*p < 0xf0) { c = *p & 0x0f; used = 3; }
+		else { c = *p & 0x07; used = 4; }
+
+		for (int i = 1; i < used; i++)
+		{
+			if (p + i >= end || (p[i] & 0xc0) != 0x80)
+			{
+				c = 0xfffd;
+				used = i;
+				break;
+			}
+			c = (c << 6) | (p[i] & 0x3f);
+		}
+		p += used;
+
+		if (c > 0xffff) c = 0xfffd;
+		if (c >= ' ') *q++ = c;
 	}
 
-	*p = '\0';
+	*q = 0x0;
 	return dst;
 }
 
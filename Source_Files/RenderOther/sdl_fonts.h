@@ -33,7 +33,9 @@
 #include <SDL_ttf.h>
 #include <boost/tuple/tuple.hpp>
 
+#include <map>
 #include <string>
+#include <vector>
 
 /*
  *  Definitions
@@ -113,6 +115,48 @@ private:
 
 typedef boost::tuple<std::string, uint16, int16> ttf_font_key_t;
 
+// The glyphs of one TrueType font, rendered in white the first time they're drawn and kept
+// in pages; text is drawn by blitting them tinted to its color, instead of rendering every
+// string to a new surface
+class ttf_glyph_atlas {
+public:
+	ttf_glyph_atlas(TTF_Font *font, bool smooth);
+	~ttf_glyph_atlas();
+
+	// Draws text up to a 0 with its baseline at y; returns its width
+	int draw_text(SDL_Surface *s, const uint16 *text, int x, int y, SDL_Color color);
+	int char_width(uint16 c) { return find_glyph(c).advance; }
+
+	// Measured the way draw_text() places the glyphs, kerning included
+	int text_width(const uint16 *text) { return measure(text, INT_MAX, 0); }
+	// How many characters of text fit in max_width
+	int trunc_text(const uint16 *text, int max_width) { int count; measure(text, max_width, &count); return count; }
+
+private:
+	struct glyph {
+		int page;			// -1 when there's nothing to draw
+		SDL_Rect rect;
+		int minx;
+		int advance;
+	};
+
+	const glyph& find_glyph(uint16 c);
+	int measure(const uint16 *text, int max_width, int *count);
+	int kerning(const uint16 *text, const uint16 *p) const;
+	void add_to_page(SDL_Surface *rendered, glyph& g);
+
+	TTF_Font *m_font;
+	bool m_smooth;
+	std::map<uint16, glyph> m_glyphs;
+	std::vector<SDL_Surface *> m_pages;
+
+	// where the next glyph goes on the last page
+	int m_shelf_x, m_shelf_y, m_shelf_height;
+
+	ttf_glyph_atlas(const ttf_glyph_atlas&);
+	ttf_glyph_atlas& operator=(const ttf_glyph_atlas&);
+};
+
 class ttf_font_info : public font_info { 
 public:
 	uint16 get_ascent() const { return TTF_FontAscent(m_styles[styleNormal]); };
@@ -128,7 +172,7 @@ public:
 	int8 char_width(uint8, uint16) const;
 
 	ttf_font_info() { 
-		for (int i = 0; i < styleUnderline; i++) { m_styles[i] = 0; } 
+		for (int i = 0; i < styleUnderline; i++) { m_styles[i] = 0; m_atlases[i][0] = m_atlases[i][1] = 0; } 
 	}
 protected:
 	virtual int _draw_text(SDL_Surface *s, const char *text, size_t length, int x, int y, uint32 pixel, uint16 style, bool utf8) const;
@@ -136,10 +180,14 @@ protected:
 	virtual uint16 _text_width(const char *text, uint16 style, bool utf8) const;	
 	virtual int _trunc_text(const char *text, int max_width, uint16 style) const;
 private:
-	char *process_printable(const char *src, int len) const;
 	uint16 *process_macroman(const char *src, int len) const;
+	uint16 *process_utf8(const char *src, int len) const;
 	TTF_Font *get_ttf(uint16 style) const { return m_styles[style & (styleBold | styleItalic)]; }
+	ttf_glyph_atlas *get_atlas(uint16 style, bool smooth) const;
 	virtual void _unload();
+
+	// by style, then smooth or not
+	mutable ttf_glyph_atlas *m_atlases[styleUnderline][2];
 };
 
 /*
@@ -22,6 +22,14 @@
 #include "Mixer.h"
 #include "interface.h" // for strERRORS
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIXER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define MIXER_NEON
+#include <arm_neon.h>
+#endif
+
 Mixer* Mixer::m_instance = 0;
 
 extern bool option_nosound;
@@ -341,6 +349,124 @@ static inline int32 lerp(int32 x0, int32 x1, _fixed rate)
 
 template<class T, bool stereo, bool le_or_signed>
 void Mixer::Resample_(Channel* c, int16* left, int16* right, int& samples)
+{
+	if (!c->active)
+	{
+		std::fill_n(left, samples, 0);
+		std::fill_n(right, samples, 0);
+		samples = 0;
+		return;
+	}
+
+	// While the frame after the current one is still in the buffer, every output
+	// sample is a plain interpolation, so do those in one block without the
+	// per-sample end-of-data tests. The rate is fixed, so the position of each
+	// output sample follows straight from the starting counter.
+	const int stride = stereo ? 2 : 1;
+	int32 interpolatable_frames = (c->length - 1) / c->info.bytes_per_frame;
+	if (interpolatable_frames > 0 && samples > 0)
+	{
+		Sint64 position = c->counter;
+		Sint64 limit = (static_cast<Sint64>(interpolatable_frames) << 16) - position;
+		int block = samples;
+		if (c->rate > 0 && (limit + c->rate - 1) / c->rate < block)
+		{
+			block = static_cast<int>((limit + c->rate - 1) / c->rate);
+		}
+
+		for (int i = 0; i < block; ++i)
+		{
+			const T* data = reinterpret_cast<const T*>(c->data + (position >> 16) * c->info.bytes_per_frame);
+			_fixed fraction = static_cast<_fixed>(position & 0xffff);
+			int32 left0 = Convert<le_or_signed>(data[0]);
+			int32 left1 = Convert<le_or_signed>(data[stride]);
+			if (stereo)
+			{
+				int32 right0 = Convert<le_or_signed>(data[1]);
+				int32 right1 = Convert<le_or_signed>(data[stride + 1]);
+				*left++ = lerp(left0, left1, fraction);
+				*right++ = lerp(right0, right1, fraction);
+			}
+			else
+			{
+				*left++ = *right++ = lerp(left0, left1, fraction);
+			}
+			position += c->rate;
+		}
+
+		int32 count = static_cast<int32>(position >> 16);
+		c->counter = static_cast<_fixed>(position & 0xffff);
+		c->data += c->info.bytes_per_frame * count;
+		c->length -= c->info.bytes_per_frame * count;
+		samples -= block;
+
+		if (c->length <= 0)
+		{
+			c->GetMoreData();
+			return;  // sample format may have changed
+		}
+	}
+
+	// the last frame of the buffer has nothing to interpolate towards
+	while (samples--)
+	{
+		int32 left0, right0;
+		const T* data = reinterpret_cast<const T*>(c->data);
+
+		left0 = Convert<le_or_signed>(*data++);
+		if (stereo)
+		{
+			right0 = Convert<le_or_signed>(*data++);
+		}
+		
+		if ((c->counter & 0xffff) && c->length > c->info.bytes_per_frame)
+		{
+			int32 left1 = Convert<le_or_signed>(*data++);
+			if (stereo) 
+			{
+				int32 right1 = Convert<le_or_signed>(*data++);
+				*left++ = lerp(left0, left1, c->counter);
+				*right++ = lerp(right0, right1, c->counter);
+			}
+			else
+			{
+				*left++ = *right++ = lerp(left0, left1, c->counter);
+			}
+		}
+		else
+		{
+			if (stereo)
+			{
+				*left++ = left0;
+				*right++ = right0;
+			} 
+			else
+			{
+				*left++ = *right++ = left0;
+			}
+		}
+
+		c->counter += c->rate;
+		if (c->counter >= 0x10000)
+		{
+			int count = c->counter >> 16;
+			c->counter &= 0xffff;
+			c->data += c->info.bytes_per_frame * count;
+			c->length -= c->info.bytes_per_frame * count;
+		
+			if (c->length <= 0) 
+			{
+				c->GetMoreData();
+				return;  // sample format may have changed
+			}
+		}
+	}
+}
+
+// Resample_() one sample at a time all the way, as it used to be; only
+// CheckResampler() runs it
+template<class T, bool stereo, bool le_or_signed>
+void Mixer::ResampleScalar_(Channel* c, int16* left, int16* right, int& samples)
 {
 	while (samples--)
 	{
@@ -405,6 +531,85 @@ void Mixer::Resample_(Channel* c, int16* left, int16* right, int& samples)
 	}
 }
 
+// Plays made-up sounds of every length up to a few frames, looped and not, at
+// a standstill, below, at and above the output rate and from several starting
+// fractions, through both resamplers, as Resample() would call them
+template<class T, bool stereo, bool le_or_signed>
+bool Mixer::CheckResample_()
+{
+	const int max_frames = 9;
+	const int max_samples = 48;
+	const int bytes_per_frame = sizeof(T) * (stereo ? 2 : 1);
+	static const _fixed rates[] = { 0, 0x100, 0x8000, 0xffff, 0x10000, 0x10001, 0x18000, 0x2a3b5, 0x40000 };
+	static const _fixed counters[] = { 0, 1, 0x8000, 0xffff };
+	static const int sample_counts[] = { 1, 2, 3, 7, 16, max_samples };
+
+	uint8 sound[max_frames * 4];
+	uint32 seed = 1;
+	for (unsigned i = 0; i < sizeof(sound); i++)
+	{
+		seed = seed * 1664525 + 1013904223;
+		sound[i] = static_cast<uint8>(seed >> 24);
+	}
+
+	for (int frames = 1; frames <= max_frames; frames++)
+	{
+		for (int looped = 0; looped < 2; looped++)
+		{
+			for (unsigned r = 0; r < sizeof(rates) / sizeof(rates[0]); r++)
+			{
+				for (unsigned k = 0; k < sizeof(counters) / sizeof(counters[0]); k++)
+				{
+					for (unsigned n = 0; n < sizeof(sample_counts) / sizeof(sample_counts[0]); n++)
+					{
+						Channel block, scalar;
+						block.info.bytes_per_frame = bytes_per_frame;
+						block.active = true;
+						block.source = Channel::SOURCE_RESOURCE;
+						block.data = block.loop = sound;
+						block.length = frames * bytes_per_frame;
+						block.loop_length = looped ? block.length : 0;
+						block.rate = rates[r];
+						block.counter = counters[k];
+						scalar = block;
+
+						int samples = sample_counts[n];
+						int16 block_left[max_samples], block_right[max_samples];
+						int16 scalar_left[max_samples], scalar_right[max_samples];
+						std::fill_n(block_left, max_samples, 0x5555);
+						std::fill_n(block_right, max_samples, 0x5555);
+						std::fill_n(scalar_left, max_samples, 0x5555);
+						std::fill_n(scalar_right, max_samples, 0x5555);
+
+						int left_to_process = samples;
+						while (left_to_process > 0)
+							Resample_<T, stereo, le_or_signed>(&block, block_left + samples - left_to_process, block_right + samples - left_to_process, left_to_process);
+						left_to_process = samples;
+						while (left_to_process > 0)
+							ResampleScalar_<T, stereo, le_or_signed>(&scalar, scalar_left + samples - left_to_process, scalar_right + samples - left_to_process, left_to_process);
+
+						if (memcmp(block_left, scalar_left, sizeof(block_left)) != 0 ||
+						    memcmp(block_right, scalar_right, sizeof(block_right)) != 0 ||
+						    block.active != scalar.active || block.data != scalar.data ||
+						    block.length != scalar.length || block.counter != scalar.counter)
+							return false;
+					}
+				}
+			}
+		}
+	}
+
+	return true;
+}
+
+bool Mixer::CheckResampler()
+{
+	return CheckResample_<int16, true, true>() && CheckResample_<int16, true, false>() &&
+		CheckResample_<int8, true, true>() && CheckResample_<uint8, true, false>() &&
+		CheckResample_<int16, false, true>() && CheckResample_<int16, false, false>() &&
+		CheckResample_<int8, false, true>() && CheckResample_<uint8, false, false>();
+}
+
 void Mixer::Resample(Channel* c, int16* left, int16* right, int samples)
 {
 	int left_to_process = samples;
@@ -468,7 +673,48 @@ void Mixer::ResampleInner(Channel* c, int16* left, int16* right, int& samples)
 	}
 }
 
-static inline void apply_volume_and_clip(int32* v, int16 main_volume, int samples)
+// The stages below are each a SIMD loop, then the scalar loop for whatever's left over;
+// Mixer::CheckSIMD() compares them with the scalar loops alone
+
+// output[i] += (input[i] * volume) >> 8
+static inline void accumulate_scalar(int32* output, const int16* input, int16 volume, int samples)
+{
+	while (samples--)
+	{
+		*output++ += (*input++ * volume) >> 8;
+	}
+}
+
+static inline void accumulate(int32* output, const int16* input, int16 volume, int samples)
+{
+#if defined(MIXER_SSE2)
+	const __m128i v = _mm_set1_epi16(volume);
+	for (; samples >= 8; samples -= 8, input += 8, output += 8)
+	{
+		__m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input));
+		__m128i lo = _mm_mullo_epi16(in, v);
+		__m128i hi = _mm_mulhi_epi16(in, v);
+		__m128i out0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(output));
+		__m128i out1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(output + 4));
+		out0 = _mm_add_epi32(out0, _mm_srai_epi32(_mm_unpacklo_epi16(lo, hi), 8));
+		out1 = _mm_add_epi32(out1, _mm_srai_epi32(_mm_unpackhi_epi16(lo, hi), 8));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output), out0);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 4), out1);
+	}
+#elif defined(MIXER_NEON)
+	for (; samples >= 8; samples -= 8, input += 8, output += 8)
+	{
+		int16x8_t in = vld1q_s16(input);
+		int32x4_t out0 = vaddq_s32(vld1q_s32(output), vshrq_n_s32(vmull_n_s16(vget_low_s16(in), volume), 8));
+		int32x4_t out1 = vaddq_s32(vld1q_s32(output + 4), vshrq_n_s32(vmull_n_s16(vget_high_s16(in), volume), 8));
+		vst1q_s32(output, out0);
+		vst1q_s32(output + 4, out1);
+	}
+#endif
+	accumulate_scalar(output, input, volume, samples);
+}
+
+static inline void apply_volume_and_clip_scalar(int32* v, int16 main_volume, int samples)
 {
 	while (samples--)
 	{
@@ -486,7 +732,37 @@ static inline void apply_volume_and_clip(int32* v, int16 main_volume, int sample
 	}
 }
 
-void Output(int16* output, int32* left, int32* right, int samples, bool)
+static inline void apply_volume_and_clip(int32* v, int16 main_volume, int samples)
+{
+#if defined(MIXER_SSE2)
+	// SSE2 has no 32-bit multiply; do the even and odd lanes as 64-bit
+	// products and keep the low halves, which wrap just like the scalar code
+	const __m128i volume = _mm_set1_epi32(main_volume);
+	for (; samples >= 4; samples -= 4, v += 4)
+	{
+		__m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v));
+		__m128i even = _mm_mul_epu32(x, volume);
+		__m128i odd = _mm_mul_epu32(_mm_srli_si128(x, 4), volume);
+		x = _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+		x = _mm_srai_epi32(x, 8);
+		// saturate to 16 bits and sign extend back
+		x = _mm_packs_epi32(x, x);
+		x = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(v), x);
+	}
+#elif defined(MIXER_NEON)
+	for (; samples >= 4; samples -= 4, v += 4)
+	{
+		int32x4_t x = vshrq_n_s32(vmulq_n_s32(vld1q_s32(v), main_volume), 8);
+		vst1q_s32(v, vmovl_s16(vqmovn_s32(x)));
+	}
+#endif
+	apply_volume_and_clip_scalar(v, main_volume, samples);
+}
+
+// The Output() functions expect samples already clipped to 16 bits
+
+static inline void output_scalar(int16* output, int32* left, int32* right, int samples)
 {
 	while (samples--)
 	{
@@ -495,7 +771,7 @@ void Output(int16* output, int32* left, int32* right, int samples, bool)
 	}
 }
 
-void Output(int16* output, int32* left, int samples, bool)
+static inline void output_scalar(int16* output, int32* left, int samples)
 {
 	while (samples--)
 	{
@@ -503,6 +779,45 @@ void Output(int16* output, int32* left, int samples, bool)
 	}
 }
 
+void Output(int16* output, int32* left, int32* right, int samples, bool)
+{
+#if defined(MIXER_SSE2)
+	for (; samples >= 8; samples -= 8, left += 8, right += 8, output += 16)
+	{
+		__m128i l = _mm_packs_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(left)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + 4)));
+		__m128i r = _mm_packs_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(right)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(right + 4)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output), _mm_unpacklo_epi16(l, r));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output + 8), _mm_unpackhi_epi16(l, r));
+	}
+#elif defined(MIXER_NEON)
+	for (; samples >= 8; samples -= 8, left += 8, right += 8, output += 16)
+	{
+		int16x8x2_t lr;
+		lr.val[0] = vcombine_s16(vqmovn_s32(vld1q_s32(left)), vqmovn_s32(vld1q_s32(left + 4)));
+		lr.val[1] = vcombine_s16(vqmovn_s32(vld1q_s32(right)), vqmovn_s32(vld1q_s32(right + 4)));
+		vst2q_s16(output, lr);
+	}
+#endif
+	output_scalar(output, left, right, samples);
+}
+
+void Output(int16* output, int32* left, int samples, bool)
+{
+#if defined(MIXER_SSE2)
+	for (; samples >= 8; samples -= 8, left += 8, output += 8)
+	{
+		__m128i l = _mm_packs_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(left)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(left + 4)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(output), l);
+	}
+#elif defined(MIXER_NEON)
+	for (; samples >= 8; samples -= 8, left += 8, output += 8)
+	{
+		vst1q_s16(output, vcombine_s16(vqmovn_s32(vld1q_s32(left)), vqmovn_s32(vld1q_s32(left + 4))));
+	}
+#endif
+	output_scalar(output, left, samples);
+}
+
 void Output(int8* output, int32* left, int32* right, int samples, bool is_signed)
 {
 	if (is_signed)
@@ -570,11 +885,8 @@ void Mixer::Mix(uint8* p, int len, bool stereo, bool is_sixteen_bit, bool is_sig
 				left_volume = right_volume = SoundManager::instance()->GetNetmicVolumeAdjustment();
 			}
 
-			for (int i = 0; i < samples; ++i)
-			{
-				output_left[i] += (channel_left[i] * left_volume) >> 8;
-				output_right[i] += (channel_right[i] * right_volume) >> 8;
-			}
+			accumulate(output_left, channel_left, left_volume, samples);
+			accumulate(output_right, channel_right, right_volume, samples);
 		}
 
 		if (game_is_networked &&
@@ -623,7 +935,7 @@ void Mixer::Mix(uint8* p, int len, bool stereo, bool is_sixteen_bit, bool is_sig
 			{
 				if (is_sixteen_bit)
 				{
-					Output(reinterpret_cast<int16*>(p), output_left, output_right, samples, is_signed);
+					Output(reinterpret_cast<int16*>(p), output_left, samples, is_signed);
 					p += samples * 2;
 				}
 				else
@@ -637,3 +949,89 @@ void Mixer::Mix(uint8* p, int len, bool stereo, bool is_sixteen_bit, bool is_sig
 		len -= samples;
 	}
 }
+
+// Runs each SIMD stage and its scalar loop over the same made-up buffers, at
+// every length up to a few vectors and at unaligned starts, so that --check-mixer
+// can tell whether the two still agree
+bool Mixer::CheckSIMD()
+{
+	const int max_samples = 40;
+	const int max_offset = 3;
+	uint32 seed = 1;
+
+	for (int offset = 0; offset <= max_offset; offset++)
+	{
+		for (int samples = 0; samples <= max_samples; samples++)
+		{
+			int16 input[max_samples + max_offset];
+			int32 left[max_samples + max_offset], right[max_samples + max_offset];
+			int32 simd[max_samples + max_offset], scalar[max_samples + max_offset];
+			int16 simd_output[2 * (max_samples + max_offset)], scalar_output[2 * (max_samples + max_offset)];
+
+			for (int i = 0; i < max_samples + max_offset; i++)
+			{
+				seed = seed * 1664525 + 1013904223;
+				input[i] = static_cast<int16>(seed >> 16);
+				// wide enough that apply_volume_and_clip() clips at both ends
+				left[i] = static_cast<int32>(seed >> 8) - (1 << 23);
+				right[i] = static_cast<int16>(seed);
+			}
+
+			// accumulate() at full, half and negative volume
+			static const int16 volumes[] = { 0, 1, 128, 256, 511, -256 };
+			for (unsigned v = 0; v < sizeof(volumes) / sizeof(volumes[0]); v++)
+			{
+				memcpy(simd, left, sizeof(simd));
+				memcpy(scalar, left, sizeof(scalar));
+				accumulate(simd + offset, input + offset, volumes[v], samples);
+				accumulate_scalar(scalar + offset, input + offset, volumes[v], samples);
+				if (memcmp(simd, scalar, sizeof(simd)) != 0)
+					return false;
+			}
+
+			// apply_volume_and_clip() with the main volume quiet, at unity and loud
+			static const int16 main_volumes[] = { 0, 64, 256, 512 };
+			for (unsigned v = 0; v < sizeof(main_volumes) / sizeof(main_volumes[0]); v++)
+			{
+				memcpy(simd, left, sizeof(simd));
+				memcpy(scalar, left, sizeof(scalar));
+				apply_volume_and_clip(simd + offset, main_volumes[v], samples);
+				apply_volume_and_clip_scalar(scalar + offset, main_volumes[v], samples);
+				if (memcmp(simd, scalar, sizeof(simd)) != 0)
+					return false;
+			}
+
+			// Output() takes samples already clipped to 16 bits
+			int32 clipped[max_samples + max_offset];
+			memcpy(clipped, left, sizeof(clipped));
+			apply_volume_and_clip_scalar(clipped, 256, max_samples + max_offset);
+
+			memset(simd_output, 0, sizeof(simd_output));
+			memset(scalar_output, 0, sizeof(scalar_output));
+			Output(simd_output + offset, clipped + offset, right + offset, samples, true);
+			output_scalar(scalar_output + offset, clipped + offset, right + offset, samples);
+			if (memcmp(simd_output, scalar_output, sizeof(simd_output)) != 0)
+				return false;
+
+			memset(simd_output, 0, sizeof(simd_output));
+			memset(scalar_output, 0, sizeof(scalar_output));
+			Output(simd_output + offset, clipped + offset, samples, true);
+			output_scalar(scalar_output + offset, clipped + offset, samples);
+			if (memcmp(simd_output, scalar_output, sizeof(simd_output)) != 0)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+const char *Mixer::SIMDName()
+{
+#if defined(MIXER_SSE2)
+	return "SSE2";
+#elif defined(MIXER_NEON)
+	return "NEON";
+#else
+	return 0;
+#endif
+}
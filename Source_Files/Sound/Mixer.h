@@ -70,6 +70,15 @@ public:
 	void PlaySoundResource(LoadedResource &rsrc, _fixed pitch = _normal_frequency);
 	void StopSoundResource();
 
+	// compares the SIMD mixing stages with their scalar loops; SIMDName() is
+	// NULL when the mixer was built without any
+	static bool CheckSIMD();
+	static const char *SIMDName();
+
+	// compares the resampler with its one-sample-at-a-time loop, for every
+	// sample format
+	static bool CheckResampler();
+
 private:
         Mixer() : sNetworkAudioBufferDesc(0) { };
 	
@@ -136,6 +145,10 @@ private:
 	void ResampleInner(Channel* c, int16* left, int16* right, int& samples);
 	template<class T, bool stereo, bool le_or_signed>
 	static void Resample_(Channel* c, int16* left, int16* right, int& samples);
+	template<class T, bool stereo, bool le_or_signed>
+	static void ResampleScalar_(Channel* c, int16* left, int16* right, int& samples);
+	template<class T, bool stereo, bool le_or_signed>
+	static bool CheckResample_();
 
 	static void MixerCallback(void *user, uint8 *stream, int len);
 	void Callback(uint8 *stream, int len);
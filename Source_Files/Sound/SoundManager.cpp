@@ -20,7 +20,7 @@ SOUND.C
 
 */
 
-#include <iostream>
+#include "Logging.h"
 
 #include "SoundManager.h"
 #include "ReplacementSounds.h"
@@ -34,61 +34,121 @@ SOUND.C
 #define MARK_SLOT_AS_FREE(o) ((o)->flags&=(uint16)~0x8000)
 #define MARK_SLOT_AS_USED(o) ((o)->flags|=(uint16)0x8000)
 
+// Keeps loaded sounds under a byte budget, releasing the least recently
+// played ones first; entries are threaded on an intrusive LRU list (head is
+// oldest) and cache their total size, so touching and evicting are O(1)
 class SoundMemoryManager {
 public:
-	SoundMemoryManager(std::size_t max_size) : m_size(0), m_max_size(max_size) { }
+	SoundMemoryManager(std::size_t max_size) : m_size(0), m_max_size(max_size), m_oldest(0), m_newest(0), m_hits(0), m_misses(0), m_evictions(0) { }
 
-	void SetMaxSize(std::size_t max_size) { m_max_size = max_size; }
+	void SetMaxSize(std::size_t max_size);
+	std::size_t GetSize() const { return m_size; }
+	std::size_t GetMaxSize() const { return m_max_size; }
 
 	void Add(boost::shared_ptr<SoundData> data, short index, short slot);
 	boost::shared_ptr<SoundData> Get(short index, short slot) { return m_entries[index].data[slot]; }
 	void Update(short index);
+	void Miss() { ++m_misses; }
 	boost::function<void (short)> SoundReleased;
 
 	bool IsLoaded(short index) {
 		return m_entries.count(index);
 	}
 
-	void Clear() { m_entries.clear(); m_size = 0; }
+	void Clear() { m_entries.clear(); m_size = 0; m_oldest = m_newest = 0; }
+
+	uint32 GetHits() const { return m_hits; }
+	uint32 GetMisses() const { return m_misses; }
+	uint32 GetEvictions() const { return m_evictions; }
 
 private:
 	struct Entry {
-		Entry() : data(5), last_played(0) { }
+		Entry() : data(5), size(0), index(NONE), older(0), newer(0) { }
 		std::vector<boost::shared_ptr<SoundData> > data;
-		uint32 last_played;
+		std::size_t size;
 
-		std::size_t size() {
-			std::size_t n = 0;
-			for (std::vector<boost::shared_ptr<SoundData> >::iterator it = data.begin(); it != data.end(); ++it) 
-			{
-				if (it->get()) 
-				{
-					n += (*it)->size();
-				}
-			}
-			
-			return n;
-		}
+		short index;
+		Entry *older;
+		Entry *newer;
 	};
 
+	void Unlink(Entry *entry);
+	void LinkNewest(Entry *entry);
 	void ReleaseOldestSound();
 	void Release(short index);
 	std::map<short, Entry> m_entries;
 	std::size_t m_size;
 	std::size_t m_max_size;
+
+	// map nodes never move, so the LRU links can point straight at them
+	Entry *m_oldest;
+	Entry *m_newest;
+
+	uint32 m_hits;
+	uint32 m_misses;
+	uint32 m_evictions;
 };
 
+void SoundMemoryManager::Unlink(Entry *entry)
+{
+	if (entry->older)
+		entry->older->newer = entry->newer;
+	else if (m_oldest == entry)
+		m_oldest = entry->newer;
+	
+	if (entry->newer)
+		entry->newer->older = entry->older;
+	else if (m_newest == entry)
+		m_newest = entry->older;
+
+	entry->older = entry->newer = 0;
+}
+
+void SoundMemoryManager::LinkNewest(Entry *entry)
+{
+	entry->older = m_newest;
+	entry->newer = 0;
+	if (m_newest)
+		m_newest->newer = entry;
+	else
+		m_oldest = entry;
+	m_newest = entry;
+}
+
+void SoundMemoryManager::SetMaxSize(std::size_t max_size)
+{
+	m_max_size = max_size;
+	while (m_size > m_max_size && m_oldest)
+	{
+		ReleaseOldestSound();
+	}
+}
+
 void SoundMemoryManager::Add(boost::shared_ptr<SoundData> data, short index, short slot)
 {
-	m_entries[index].data[slot] = data;
-	m_entries[index].last_played = machine_tick_count();
+	Entry& entry = m_entries[index];
+	entry.index = index;
 
+	if (entry.data[slot].get())
+	{
+		entry.size -= entry.data[slot]->size();
+		m_size -= entry.data[slot]->size();
+	}
+	entry.data[slot] = data;
+	entry.size += data->size();
 	m_size += data->size();
 
-	while (m_size > m_max_size)
+	Unlink(&entry);
+	LinkNewest(&entry);
+
+	if (m_size > m_max_size)
 	{
-		std::cerr << "Size is too big (" << m_size << ">" << m_max_size << ")" << std::endl;
-		ReleaseOldestSound();
+		uint32 evictions = m_evictions;
+		while (m_size > m_max_size && m_oldest)
+		{
+			ReleaseOldestSound();
+		}
+		logTrace("released %u sounds to stay under %u bytes (now %u)", m_evictions - evictions, static_cast<uint32>(m_max_size), static_cast<uint32>(m_size));
 	}
 }
 
@@ -98,35 +158,36 @@ void SoundMemoryManager::Release(short index)
 	{
 		SoundReleased(index);
 	}
-	m_size -= m_entries[index].size();
-	m_entries.erase(index);
+
+	std::map<short, Entry>::iterator it = m_entries.find(index);
+	if (it != m_entries.end())
+	{
+		Unlink(&it->second);
+		m_size -= it->second.size;
+		m_entries.erase(it);
+	}
 }
 
 void SoundMemoryManager::ReleaseOldestSound()
 {
-	if (!m_entries.size())
+	if (!m_oldest)
 	{
 		return;
 	}
-	
-	std::map<short, Entry>::iterator oldest_sound = m_entries.begin();
-	std::map<short, Entry>::iterator it = oldest_sound;
-	++it;
-	for (; it != m_entries.end(); ++it)
-	{
-		if (it->second.last_played < oldest_sound->second.last_played)
-		{
-			oldest_sound = it;
-		}
-	}
 
-	std::cerr << "Dropping sound " << oldest_sound->first << std::endl;
-	Release(oldest_sound->first);
+	++m_evictions;
+	Release(m_oldest->index);
 }
 
 void SoundMemoryManager::Update(short index)
 {
-	m_entries[index].last_played = machine_tick_count();
+	std::map<short, Entry>::iterator it = m_entries.find(index);
+	if (it != m_entries.end())
+	{
+		++m_hits;
+		Unlink(&it->second);
+		LinkNewest(&it->second);
+	}
 }
 
 SoundManager *SoundManager::m_instance = 0;
@@ -281,6 +342,7 @@ bool SoundManager::LoadSound(short sound_index)
 		} 
 		else
 		{
+			sounds->Miss();
 			for (int i = 0; i < NumSlots; ++i)
 			{
 				boost::shared_ptr<SoundData> p = sound_file->GetSoundData(definition, i);
@@ -337,6 +399,7 @@ void SoundManager::UnloadAllSounds()
 	if (active)
 	{
 		StopSound(NONE, NONE);
+		logNote("sound cache: %u hits, %u misses, %u evictions", sounds->GetHits(), sounds->GetMisses(), sounds->GetEvictions());
 		sounds->Clear();
 	}
 }
@@ -691,6 +754,17 @@ short SoundManager::RandomSoundIndexToSoundIndex(short random_sound_index)
 		return NONE;
 }
 
+SoundManager::CacheStats SoundManager::GetCacheStats()
+{
+	CacheStats stats;
+	stats.hits = sounds->GetHits();
+	stats.misses = sounds->GetMisses();
+	stats.evictions = sounds->GetEvictions();
+	stats.size = sounds->GetSize();
+	stats.max_size = sounds->GetMaxSize();
+	return stats;
+}
+
 SoundManager::Parameters::Parameters() :
 	channel_count(MAXIMUM_SOUND_CHANNELS),
 	volume(DEFAULT_SOUND_LEVEL),
@@ -699,7 +773,8 @@ SoundManager::Parameters::Parameters() :
 	samples(DEFAULT_SAMPLES),
 	music(DEFAULT_MUSIC_LEVEL),
 	volume_while_speaking(DEFAULT_VOLUME_WHILE_SPEAKING),
-	mute_while_transmitting(true)
+	mute_while_transmitting(true),
+	cache_size(0)
 {
 }
 
@@ -707,6 +782,7 @@ bool SoundManager::Parameters::Verify()
 {
 	channel_count = PIN(channel_count, 0, MAXIMUM_SOUND_CHANNELS);
 	volume = PIN(volume, 0, NUMBER_OF_SOUND_VOLUME_LEVELS);
+	cache_size = PIN(cache_size, 0, MAXIMUM_CACHE_SIZE);
 	
 	return true;
 }
@@ -747,6 +823,10 @@ void SoundManager::SetStatus(bool active)
 				{
 					total_buffer_size = total_buffer_size * parameters.channel_count / 4;
 				}
+				if (parameters.cache_size)
+				{
+					total_buffer_size = parameters.cache_size * MEG;
+				}
 
 				sounds->SetMaxSize(total_buffer_size);
 				
@@ -64,6 +64,17 @@ public:
 
 	void UnloadAllSounds();
 
+	// loaded sound cache activity since startup
+	struct CacheStats
+	{
+		uint32 hits;
+		uint32 misses;
+		uint32 evictions;
+		std::size_t size; // bytes
+		std::size_t max_size;
+	};
+	CacheStats GetCacheStats();
+
 	void PlaySound(short sound_index, world_location3d *source, short identifier, _fixed pitch = _normal_frequency);
 	void PlayLocalSound(short sound_index, _fixed pitch = _normal_frequency) { PlaySound(sound_index, 0, NONE, pitch); }
 	void DirectPlaySound(short sound_index, angle direction, short volume, _fixed pitch);
@@ -108,6 +119,9 @@ public:
 		int16 volume_while_speaking; // [0, NUMBER_OF_SOUND_VOLUME_LEVELS)
 		bool mute_while_transmitting;
 
+		static const int MAXIMUM_CACHE_SIZE = 1024;
+		uint16 cache_size; // in MB; 0 sizes it from the channel count and flags
+
 		Parameters();
 		bool Verify();
 	} parameters;
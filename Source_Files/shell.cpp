@@ -29,9 +29,11 @@
 #include "monsters.h"
 #include "player.h"
 #include "render.h"
+#include "low_level_textures_simd.h"
 #include "shell.h"
 #include "interface.h"
 #include "SoundManager.h"
+#include "Mixer.h"
 #include "fades.h"
 #include "screen.h"
 #include "Music.h"
@@ -51,10 +53,14 @@
 #include "interface_menus.h"
 #include "weapons.h"
 #include "lua_script.h"
+#include "world_hash.h"
+#include "RenderPVS.h"
 
 #include "Crosshairs.h"
 #include "OGL_Render.h"
 #include "OGL_Blitter.h"
+#include "OGL_Model_Def.h"
+#include "Model3D_simd.h"
 #include "XML_ParseTreeRoot.h"
 #include "FileHandler.h"
 #include "Plugins.h"
@@ -94,6 +100,7 @@
 
 #ifdef HAVE_OPENGL
 #include "OGL_Headers.h"
+#include "ModelRenderer.h"
 #endif
 
 #if !defined(DISABLE_NETWORKING)
@@ -175,11 +182,18 @@ bool option_nogamma = false;	      // Disable gamma table effects (menu fades)
 bool option_debug = false;
 bool option_nojoystick = false;
 bool insecure_lua = false;
+static bool option_benchmark = false; // Replay a film headless and report timing
+static bool option_render_benchmark = false; // Replay a film headless, timing the software renderer
+static bool option_prebuild_models = false; // Fill the model cache for the scenario and quit
 static bool force_fullscreen = false; // Force fullscreen mode
 static bool force_windowed = false;   // Force windowed mode
 
 // Prototypes
 static void main_event_loop(void);
+static void run_replay_benchmark(void);
+static void run_render_benchmark(void);
+static void prebuild_model_caches(void);
+static void check_mixer(void);
 extern int process_keyword_key(char key);
 extern void handle_keyword(int type_of_cheat);
 
@@ -221,6 +235,23 @@ static void usage(const char *prg_name)
 	  "\t[-s | --nosound]       Do not access the sound card\n"
 	  "\t[-m | --nogamma]       Disable gamma table effects (menu fades)\n"
           "\t[-j | --nojoystick]    Do not initialize joysticks\n"
+	  "\t[-b | --benchmark]     Replay the given film as fast as possible without\n"
+	  "\t                       drawing, then report timing and a world checksum\n"
+	  "\t[-c | --check-mixer]   Check the sound mixer's SIMD stages and resampler\n"
+	  "\t                       against their plain loops, and quit\n"
+	  "\t[-r | --render-benchmark] Replay the given film without a window, drawing\n"
+	  "\t                       views in software at 1080p and 4K with 1, 2, 4...\n"
+	  "\t                       threads, then report frames per second for each,\n"
+	  "\t                       with and without the potentially visible sets,\n"
+	  "\t                       and the speed of each SIMD span kernel\n"
+#ifdef HAVE_OPENGL
+	  "\t                       and of each model skinning kernel and model\n"
+	  "\t                       triangle sort\n"
+#endif
+#ifdef HAVE_OPENGL
+	  "\t[-p | --prebuild-models] Load every 3D model the scenario's MML and\n"
+	  "\t                       plugins define, filling the model cache, and quit\n"
+#endif
 	  // Documenting this might be a bad idea?
 	  // "\t[-i | --insecure_lua]  Allow Lua netscripts to take over your computer\n"
 	  "\tdirectory              Directory containing scenario data files\n"
@@ -342,6 +373,16 @@ int main(int argc, char **argv)
 			insecure_lua = true;
 		} else if (strcmp(*argv, "-d") == 0 || strcmp(*argv, "--debug") == 0) {
 		  option_debug = true;
+		} else if (strcmp(*argv, "-b") == 0 || strcmp(*argv, "--benchmark") == 0) {
+			option_benchmark = true;
+		} else if (strcmp(*argv, "-c") == 0 || strcmp(*argv, "--check-mixer") == 0) {
+			check_mixer();
+		} else if (strcmp(*argv, "-r") == 0 || strcmp(*argv, "--render-benchmark") == 0) {
+			option_render_benchmark = true;
+#ifdef HAVE_OPENGL
+		} else if (strcmp(*argv, "-p") == 0 || strcmp(*argv, "--prebuild-models") == 0) {
+			option_prebuild_models = true;
+#endif
 		} else if (*argv[0] != '-') {
 			// if it's a directory, make it the default data dir
 			// otherwise push it and handle it later
@@ -362,6 +403,13 @@ int main(int argc, char **argv)
 		argv++;
 	}
 
+	if (option_benchmark || option_render_benchmark || option_prebuild_models) {
+		// No window, no sound card, no joysticks: only the world simulation runs
+		SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+		option_nosound = true;
+		option_nojoystick = true;
+	}
+
 	try {
 		
 		// Initialize everything
@@ -376,7 +424,14 @@ int main(int argc, char **argv)
 		}
 
 		// Run the main loop
-		main_event_loop();
+		if (option_prebuild_models)
+			prebuild_model_caches();
+		else if (option_benchmark)
+			run_replay_benchmark();
+		else if (option_render_benchmark)
+			run_render_benchmark();
+		else
+			main_event_loop();
 
 	} catch (exception &e) {
 		try 
@@ -645,6 +700,10 @@ static void initialize_application(void)
 		graphics_preferences->screen_mode.fullscreen = false;
 	write_preferences();
 
+	// The benchmarks never draw to the screen; don't bother setting up OpenGL for them (and don't save that)
+	if (option_benchmark || option_render_benchmark || option_prebuild_models)
+		graphics_preferences->screen_mode.acceleration = _no_acceleration;
+
 	Plugins::instance()->load_mml();
 
 //	SDL_WM_SetCaption(application_name, application_name);
@@ -897,6 +956,210 @@ static void main_event_loop(void)
 	}
 }
 
+// Runs the film opened from the command line with no speed limit and no rendering,
+// then prints ticks/sec, where update_world() spent its time, and a hash of the
+// final world state (which should be identical on every run of the same film)
+static void run_replay_benchmark(void)
+{
+	if (get_game_state() != _game_in_progress) {
+		fprintf(stderr, "The benchmark needs a film to replay.\n");
+		exit(1);
+	}
+
+	// input_controller() pulls more flags per call at higher replay speeds
+	for (int i = 0; i < 10; i++)
+		increment_replay_speed();
+
+	set_world_profiling(true);
+	Uint64 start = SDL_GetPerformanceCounter();
+
+	short game_state;
+	while ((game_state = get_game_state()) == _game_in_progress || game_state == _change_level) {
+		input_controller();
+		update_world();
+	}
+
+	double elapsed = static_cast<double>(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+	int32 ticks = get_world_profile_tick_count();
+	set_world_profiling(false);
+
+	printf("Replayed %d ticks in %.3f seconds (%.1f ticks/sec)\n", ticks, elapsed, elapsed > 0 ? ticks / elapsed : 0.0);
+	for (short stage = 0; stage < NUMBER_OF_WORLD_PROFILE_STAGES; stage++) {
+		double seconds = get_world_profile_seconds(stage);
+		printf("  %-12s %8.3f s  %5.1f%%\n", get_world_profile_stage_name(stage), seconds, elapsed > 0 ? 100.0 * seconds / elapsed : 0.0);
+	}
+	printf("The world hash netgames check every tick took %.2f microseconds a tick\n",
+		ticks > 0 ? 1e6 * get_world_profile_seconds(_world_profile_hash) / ticks : 0.0);
+	printf("World checksum: %08x\n", calculate_world_hash());
+
+	exit(0);
+}
+
+// Runs the mixer's fast paths against the plain loops they replaced; needs no
+// scenario, film or sound card
+static void check_mixer(void)
+{
+	bool simd_matches = Mixer::CheckSIMD();
+	if (Mixer::SIMDName())
+		printf("Mixer %s stages %s the scalar code\n", Mixer::SIMDName(), simd_matches ? "match" : "DIFFER from");
+	else
+		printf("Mixer built without SIMD stages\n");
+
+	bool resampler_matches = Mixer::CheckResampler();
+	printf("Resampler %s the one-sample-at-a-time loop\n", resampler_matches ? "matches" : "DIFFERS from");
+
+	exit(simd_matches && resampler_matches ? 0 : 1);
+}
+
+// Loads each model the MML defines once, which leaves it in the model cache
+// for the next time a level needs it
+static void prebuild_model_caches(void)
+{
+#ifdef HAVE_OPENGL
+	printf("Cached %d models\n", OGL_PrebuildModelCaches());
+#endif
+	exit(0);
+}
+
+static void run_render_benchmark(void)
+{
+	if (get_game_state() != _game_in_progress) {
+		fprintf(stderr, "The render benchmark needs a film to replay.\n");
+		exit(1);
+	}
+	if (bit_depth != 16 && bit_depth != 32) {
+		fprintf(stderr, "The render benchmark needs a 16- or 32-bit color depth.\n");
+		exit(1);
+	}
+
+	const short sizes[][2] = {{1920, 1080}, {3840, 2160}};
+	const int size_count = sizeof(sizes) / sizeof(sizes[0]);
+	// Draw a frame for every second of the film
+	const int32 ticks_per_frame = TICKS_PER_SECOND;
+
+	std::vector<int> thread_counts;
+	int cpu_count = std::max(SDL_GetCPUCount(), 1);
+	for (int n = 1; n < cpu_count; n *= 2)
+		thread_counts.push_back(n);
+	thread_counts.push_back(cpu_count);
+
+	std::vector<std::vector<double> > seconds(size_count, std::vector<double>(thread_counts.size(), 0.0));
+	int frames = 0;
+	bool identical = true;
+
+	// The first size again on every processor, without and then with the potentially visible sets
+	std::vector<int> pvs_thread_counts(1, cpu_count);
+	std::vector<std::vector<double> > pvs_seconds(2, std::vector<double>(1, 0.0));
+	std::vector<uint8> pvs_bits;
+	int pvs_frames = 0;
+
+	std::vector<span_kernel_timing> span_timings;
+	benchmark_span_kernels32(span_timings);
+	bool spans_identical = true;
+
+	for (int i = 0; i < 10; i++)
+		increment_replay_speed();
+
+	int32 next_frame_tick = 0;
+	short game_state;
+	while ((game_state = get_game_state()) == _game_in_progress || game_state == _change_level) {
+		input_controller();
+		update_world();
+
+		if (get_game_state() == _game_in_progress && dynamic_world->tick_count >= next_frame_tick) {
+			for (int size = 0; size < size_count; size++)
+				if (!benchmark_software_render(sizes[size][0], sizes[size][1], thread_counts, seconds[size]))
+					identical = false;
+			for (int use_pvs = 0; use_pvs < 2; use_pvs++) {
+				set_render_pvs(use_pvs != 0);
+				if (!benchmark_software_render(sizes[0][0], sizes[0][1], pvs_thread_counts, pvs_seconds[use_pvs]))
+					identical = false;
+			}
+			if (get_polygon_pvs(current_player->camera_polygon_index, &current_player->camera_location, pvs_bits))
+				pvs_frames++;
+			frames++;
+			next_frame_tick = dynamic_world->tick_count + ticks_per_frame;
+		}
+	}
+
+	printf("Drew %d frames at each size, %d-bit\n", frames, bit_depth);
+	printf("%-12s", "threads");
+	for (size_t t = 0; t < thread_counts.size(); t++)
+		printf(" %9d", thread_counts[t]);
+	printf("\n");
+	for (int size = 0; size < size_count; size++) {
+		char label[32];
+		sprintf(label, "%dx%d", sizes[size][0], sizes[size][1]);
+		printf("%-12s", label);
+		for (size_t t = 0; t < thread_counts.size(); t++)
+			printf(" %5.1f fps", seconds[size][t] > 0 ? frames / seconds[size][t] : 0.0);
+		printf("\n");
+	}
+	printf("%dx%d on %d threads: %.1f fps without the potentially visible sets, %.1f fps with them (%d of the frames had one)\n",
+		sizes[0][0], sizes[0][1], cpu_count,
+		pvs_seconds[0][0] > 0 ? frames / pvs_seconds[0][0] : 0.0, pvs_seconds[1][0] > 0 ? frames / pvs_seconds[1][0] : 0.0, pvs_frames);
+	printf(identical ? "Every thread count drew the same frames as the scalar kernels on one thread\n" : "Frames DIFFERED between thread counts or span kernels\n");
+
+	printf("\n%-26s", "span kernel (Mpixels/s)");
+	for (int set = 0; set < NUMBER_OF_SPAN_KERNEL_SETS; set++)
+		printf(" %9s", get_span_kernels32(set) ? get_span_kernels32(set)->name : "-");
+	printf("\n");
+	for (size_t k = 0; k < span_timings.size(); k++) {
+		printf("%-26s", span_timings[k].kernel);
+		for (int set = 0; set < NUMBER_OF_SPAN_KERNEL_SETS; set++)
+			printf(" %9.1f", span_timings[k].pixels_per_second[set] / 1e6);
+		printf("%s\n", span_timings[k].identical ? "" : "  DIFFERED");
+		if (!span_timings[k].identical)
+			spans_identical = false;
+	}
+	printf("Drawing with the %s span kernels\n", get_span_kernels32(get_software_span_kernels())->name);
+
+	bool models_identical = true;
+#ifdef HAVE_OPENGL
+	// A made-up monster, then whatever animated models the scenario has
+	std::vector<model_skinning_timing> model_timings(1);
+	Model3D benchmark_model;
+	build_benchmark_model(benchmark_model);
+	benchmark_model_skinning(benchmark_model, model_timings[0]);
+	model_timings[0].model = "(made up)";
+	OGL_BenchmarkModelSkinning(model_timings);
+
+	printf("\n%-26s", "model (Mvertices/s)");
+	for (int set = 0; set < NUMBER_OF_MODEL_KERNEL_SETS; set++)
+		printf(" %9s", get_model_kernels(set) ? get_model_kernels(set)->name : "-");
+	printf(" %9s\n", "same pose");
+	for (size_t m = 0; m < model_timings.size(); m++) {
+		printf("%-26.26s", model_timings[m].model.c_str());
+		for (int set = 0; set < NUMBER_OF_MODEL_KERNEL_SETS; set++)
+			printf(" %9.1f", model_timings[m].vertices_per_second[set] / 1e6);
+		printf(" %9.1f", model_timings[m].cached_vertices_per_second / 1e6);
+		printf("%s\n", model_timings[m].identical ? "" : "  DIFFERED");
+		if (!model_timings[m].identical)
+			models_identical = false;
+	}
+	printf("Skinning models with the %s kernels\n", get_model_kernels(get_model_kernels_set())->name);
+
+	// The same made-up monster, then every model the scenario has
+	std::vector<model_sorting_timing> sorting_timings(1);
+	benchmark_model_sorting(benchmark_model, sorting_timings[0]);
+	sorting_timings[0].model = "(made up)";
+	OGL_BenchmarkModelSorting(sorting_timings);
+
+	printf("\n%-26s %9s %9s %9s %9s\n", "model sort (Mtriangles/s)", "triangles", "std::sort", "radix", "reused");
+	for (size_t m = 0; m < sorting_timings.size(); m++) {
+		printf("%-26.26s %9d", sorting_timings[m].model.c_str(), static_cast<int>(sorting_timings[m].triangles));
+		printf(" %9.1f", sorting_timings[m].std_sort_triangles_per_second / 1e6);
+		printf(" %9.1f", sorting_timings[m].radix_triangles_per_second / 1e6);
+		printf(" %9.1f", sorting_timings[m].reused_triangles_per_second / 1e6);
+		printf("%s\n", sorting_timings[m].ordered ? "" : "  OUT OF ORDER");
+		if (!sorting_timings[m].ordered)
+			models_identical = false;
+	}
+#endif
+
+	exit(identical && spans_identical && models_identical ? 0 : 1);
+}
+
 static bool has_cheat_modifiers(void)
 {
 	SDL_Keymod m = SDL_GetModState();